@@ -43,6 +43,7 @@ void HandlerInit(BC127_t *bt, IBus_t *ibus)
     memset(&Context.bodyModuleStatus, 0, sizeof(HandlerBodyModuleStatus_t));
     Context.powerStatus = HANDLER_POWER_ON;
     Context.scanIntervals = 0;
+    HandlerReconnectLoad(&Context);
     EventRegisterCallback(
         BC127Event_Boot,
         &HandlerBC127Boot,
@@ -63,6 +64,11 @@ void HandlerInit(BC127_t *bt, IBus_t *ibus)
         &HandlerBC127DeviceLinkConnected,
         &Context
     );
+    EventRegisterCallback(
+        BC127Event_DeviceLinkFailed,
+        &HandlerBC127DeviceLinkFailed,
+        &Context
+    );
     EventRegisterCallback(
         BC127Event_DeviceDisconnected,
         &HandlerBC127DeviceDisconnected,
@@ -193,6 +199,11 @@ void HandlerInit(BC127_t *bt, IBus_t *ibus)
         &Context,
         HANDLER_INT_POWEROFF
     );
+    TimerRegisterScheduledTask(
+        &HandlerTimerReconnect,
+        &Context,
+        HANDLER_INT_RECONNECT
+    );
     TimerRegisterScheduledTask(
         &HandlerTimerScanDevices,
         &Context,
@@ -244,6 +255,218 @@ static void HandlerSwitchUI(HandlerContext_t *context, unsigned char newUi)
     context->uiMode = newUi;
 }
 
+/**
+ * HandlerGetReconnect()
+ *     Description:
+ *         Get the reconnect list, along with the time it took to get audio
+ *         after the ignition last came on
+ *     Params:
+ *         None
+ *     Returns:
+ *         HandlerReconnect_t * - The reconnect state
+ */
+HandlerReconnect_t *HandlerGetReconnect()
+{
+    return &Context.reconnect;
+}
+
+/**
+ * HandlerReconnectLoad()
+ *     Description:
+ *         Read the reconnect list from the EEPROM. A blank page, or one that
+ *         we do not recognize, leaves the list empty.
+ *     Params:
+ *         HandlerContext_t *context - The handler context
+ *     Returns:
+ *         void
+ */
+void HandlerReconnectLoad(HandlerContext_t *context)
+{
+    HandlerReconnect_t *reconnect = &context->reconnect;
+    unsigned char page[
+        HANDLER_RECONNECT_HEADER_SIZE +
+        HANDLER_RECONNECT_DEVICES * HANDLER_RECONNECT_ENTRY_SIZE
+    ];
+    memset(reconnect, 0, sizeof(HandlerReconnect_t));
+    EEPROMReadBytes(HANDLER_RECONNECT_ADDRESS, page, sizeof(page));
+    if (page[0] != HANDLER_RECONNECT_MAGIC ||
+        page[1] > HANDLER_RECONNECT_DEVICES
+    ) {
+        return;
+    }
+    uint8_t idx;
+    for (idx = 0; idx < page[1]; idx++) {
+        unsigned char *entry = &page[
+            HANDLER_RECONNECT_HEADER_SIZE + idx * HANDLER_RECONNECT_ENTRY_SIZE
+        ];
+        memcpy(reconnect->devices[idx].macId, entry, BC127_MAC_ID_LENGTH);
+        reconnect->devices[idx].profiles = entry[BC127_MAC_ID_LENGTH];
+    }
+    reconnect->count = page[1];
+}
+
+/**
+ * HandlerReconnectSave()
+ *     Description:
+ *         Write the reconnect list to the EEPROM. It fits in a single page,
+ *         so it goes out in one write cycle.
+ *     Params:
+ *         HandlerContext_t *context - The handler context
+ *     Returns:
+ *         void
+ */
+static void HandlerReconnectSave(HandlerContext_t *context)
+{
+    HandlerReconnect_t *reconnect = &context->reconnect;
+    unsigned char page[
+        HANDLER_RECONNECT_HEADER_SIZE +
+        HANDLER_RECONNECT_DEVICES * HANDLER_RECONNECT_ENTRY_SIZE
+    ];
+    memset(page, 0xFF, sizeof(page));
+    page[0] = HANDLER_RECONNECT_MAGIC;
+    page[1] = reconnect->count;
+    uint8_t idx;
+    for (idx = 0; idx < reconnect->count; idx++) {
+        unsigned char *entry = &page[
+            HANDLER_RECONNECT_HEADER_SIZE + idx * HANDLER_RECONNECT_ENTRY_SIZE
+        ];
+        memcpy(entry, reconnect->devices[idx].macId, BC127_MAC_ID_LENGTH);
+        entry[BC127_MAC_ID_LENGTH] = reconnect->devices[idx].profiles;
+    }
+    EEPROMWritePage(HANDLER_RECONNECT_ADDRESS, page, sizeof(page));
+}
+
+/**
+ * HandlerReconnectOpen()
+ *     Description:
+ *         Open the profiles that we know work to a device on the reconnect
+ *         list. The most recent device gets all of its profiles at once,
+ *         since it is the one most likely to be in the car. The others only
+ *         get A2DP, and the link handler opens the rest. The next device is
+ *         only tried once the OPEN for this one has failed.
+ *     Params:
+ *         HandlerContext_t *context - The handler context
+ *         uint8_t index - The device to connect to
+ *     Returns:
+ *         void
+ */
+void HandlerReconnectOpen(HandlerContext_t *context, uint8_t index)
+{
+    HandlerReconnect_t *reconnect = &context->reconnect;
+    HandlerReconnectDevice_t *device = &reconnect->devices[index];
+    char macIdText[13];
+    BC127MacIdFormat(macIdText, device->macId);
+    LogDebug(
+        LOG_SOURCE_SYSTEM,
+        "Handler: Reconnect to %s [%d of %d]",
+        macIdText,
+        index + 1,
+        reconnect->count
+    );
+    BC127CommandProfileOpen(context->bt, device->macId, "A2DP");
+    if (index == 0) {
+        if ((device->profiles & (1U << BC127_LINK_AVRCP)) != 0) {
+            BC127CommandProfileOpen(context->bt, device->macId, "AVRCP");
+        }
+        if ((device->profiles & (1U << BC127_LINK_HFP)) != 0 &&
+            ConfigGetSetting(CONFIG_SETTING_HFP) == CONFIG_SETTING_ON
+        ) {
+            BC127CommandProfileOpen(context->bt, device->macId, "HFP");
+        }
+    }
+    reconnect->index = index;
+    reconnect->lastAttempt = TimerGetMillis();
+    reconnect->attempts++;
+}
+
+/**
+ * HandlerReconnectNext()
+ *     Description:
+ *         Move on to the next device on the reconnect list, unless we have
+ *         connected in the mean time or the list has run out, in which case
+ *         the device scan takes over
+ *     Params:
+ *         HandlerContext_t *context - The handler context
+ *     Returns:
+ *         void
+ */
+void HandlerReconnectNext(HandlerContext_t *context)
+{
+    HandlerReconnect_t *reconnect = &context->reconnect;
+    if (context->bt->activeDevice.a2dpLinkId != 0 ||
+        context->ibus->ignitionStatus == IBUS_IGNITION_OFF
+    ) {
+        reconnect->active = 0;
+        return;
+    }
+    if (reconnect->index + 1 >= reconnect->count) {
+        LogDebug(LOG_SOURCE_SYSTEM, "Handler: Reconnect list exhausted");
+        reconnect->active = 0;
+        BC127CommandList(context->bt);
+        return;
+    }
+    BC127ClearPairingErrors(context->bt);
+    HandlerReconnectOpen(context, reconnect->index + 1);
+}
+
+/**
+ * HandlerReconnectUpdate()
+ *     Description:
+ *         Move the active device to the front of the reconnect list and add
+ *         the profiles that are open to it. The list is only written back
+ *         when it changes, which keeps the EEPROM writes to a minimum.
+ *     Params:
+ *         HandlerContext_t *context - The handler context
+ *     Returns:
+ *         void
+ */
+void HandlerReconnectUpdate(HandlerContext_t *context)
+{
+    HandlerReconnect_t *reconnect = &context->reconnect;
+    BC127Connection_t *device = &context->bt->activeDevice;
+    HandlerReconnectDevice_t entry;
+    uint8_t profiles = 0;
+    uint8_t idx = 0;
+    if (device->a2dpLinkId != 0) {
+        profiles |= 1U << BC127_LINK_A2DP;
+    }
+    if (device->avrcpLinkId != 0) {
+        profiles |= 1U << BC127_LINK_AVRCP;
+    }
+    if (device->hfpLinkId != 0) {
+        profiles |= 1U << BC127_LINK_HFP;
+    }
+    if (profiles == 0 || BC127MacIdIsEmpty(device->macId) == 1) {
+        return;
+    }
+    while (idx < reconnect->count &&
+           memcmp(reconnect->devices[idx].macId, device->macId, BC127_MAC_ID_LENGTH) != 0
+    ) {
+        idx++;
+    }
+    if (idx < reconnect->count) {
+        entry = reconnect->devices[idx];
+        if (idx == 0 && (entry.profiles | profiles) == entry.profiles) {
+            return;
+        }
+    } else {
+        memset(&entry, 0, sizeof(HandlerReconnectDevice_t));
+        memcpy(entry.macId, device->macId, BC127_MAC_ID_LENGTH);
+        // The least recent device falls off a full list
+        if (reconnect->count < HANDLER_RECONNECT_DEVICES) {
+            reconnect->count++;
+        }
+        idx = reconnect->count - 1;
+    }
+    entry.profiles |= profiles;
+    while (idx > 0) {
+        reconnect->devices[idx] = reconnect->devices[idx - 1];
+        idx--;
+    }
+    reconnect->devices[0] = entry;
+    HandlerReconnectSave(context);
+}
+
 /**
  * HandlerBC127Boot()
  *     Description:
@@ -334,6 +557,19 @@ void HandlerBC127DeviceLinkConnected(void *ctx, unsigned char *data)
 {
     HandlerContext_t *context = (HandlerContext_t *) ctx;
     if (context->ibus->ignitionStatus > IBUS_IGNITION_OFF) {
+        HandlerReconnect_t *reconnect = &context->reconnect;
+        HandlerReconnectUpdate(context);
+        if (reconnect->a2dpPending == 1 &&
+            context->bt->activeDevice.a2dpLinkId != 0
+        ) {
+            reconnect->timeToA2DP = TimerGetMillis() - reconnect->ignitionOn;
+            reconnect->a2dpPending = 0;
+            LogInfo(
+                LOG_SOURCE_SYSTEM,
+                "Handler: A2DP up %lums after ignition",
+                (long unsigned int) reconnect->timeToA2DP
+            );
+        }
         // Once A2DP and AVRCP are connected, we can disable connectability
         // If HFP is enabled, do not disable connectability until the
         // profile opens
@@ -357,7 +593,7 @@ void HandlerBC127DeviceLinkConnected(void *ctx, unsigned char *data)
             } else if (ConfigGetSetting(CONFIG_SETTING_HFP) == CONFIG_SETTING_ON &&
                        context->bt->activeDevice.hfpLinkId == 0
             ) {
-                char *macId = (char *) context->bt->activeDevice.macId;
+                uint8_t *macId = context->bt->activeDevice.macId;
                 BC127CommandProfileOpen(context->bt, macId, "HFP");
             }
             if (ConfigGetSetting(CONFIG_SETTING_HFP) == CONFIG_SETTING_ON) {
@@ -369,6 +605,32 @@ void HandlerBC127DeviceLinkConnected(void *ctx, unsigned char *data)
     }
 }
 
+/**
+ * HandlerBC127DeviceLinkFailed()
+ *     Description:
+ *         If the device that we are reconnecting to could not be reached, try
+ *         the next one on the reconnect list
+ *     Params:
+ *         void *ctx - The context provided at registration
+ *         unsigned char *data - The MAC ID of the device
+ *     Returns:
+ *         void
+ */
+void HandlerBC127DeviceLinkFailed(void *ctx, unsigned char *data)
+{
+    HandlerContext_t *context = (HandlerContext_t *) ctx;
+    HandlerReconnect_t *reconnect = &context->reconnect;
+    if (reconnect->active == 1 &&
+        memcmp(
+            reconnect->devices[reconnect->index].macId,
+            data,
+            BC127_MAC_ID_LENGTH
+        ) == 0
+    ) {
+        HandlerReconnectNext(context);
+    }
+}
+
 /**
  * HandlerBC127DeviceDisconnected()
  *     Description:
@@ -426,9 +688,10 @@ void HandlerBC127DeviceFound(void *ctx, unsigned char *data)
     HandlerContext_t *context = (HandlerContext_t *) ctx;
     if (context->bt->activeDevice.deviceId == 0 &&
         context->btConnectionStatus == HANDLER_BT_CONN_OFF &&
-        context->ibus->ignitionStatus > IBUS_IGNITION_OFF
+        context->ibus->ignitionStatus > IBUS_IGNITION_OFF &&
+        context->reconnect.active == 0
     ) {
-        char *macId = (char *) data;
+        uint8_t *macId = (uint8_t *) data;
         LogDebug(LOG_SOURCE_SYSTEM, "Handler: No Device -- Attempt connection");
         BC127CommandProfileOpen(context->bt, macId, "A2DP");
         if (ConfigGetSetting(CONFIG_SETTING_HFP) == CONFIG_SETTING_ON) {
@@ -469,6 +732,18 @@ void HandlerBC127PlaybackStatus(void *ctx, unsigned char *data)
         }
         context->btStartupIsRun = 1;
     }
+    if (context->reconnect.streamPending == 1 &&
+        context->bt->playbackStatus == BC127_AVRCP_STATUS_PLAYING
+    ) {
+        HandlerReconnect_t *reconnect = &context->reconnect;
+        reconnect->timeToStream = TimerGetMillis() - reconnect->ignitionOn;
+        reconnect->streamPending = 0;
+        LogInfo(
+            LOG_SOURCE_SYSTEM,
+            "Handler: A2DP streaming %lums after ignition",
+            (long unsigned int) reconnect->timeToStream
+        );
+    }
     if (context->bt->playbackStatus == BC127_AVRCP_STATUS_PLAYING &&
         context->ibus->cdChangerFunction == IBUS_CDC_FUNC_NOT_PLAYING
     ) {
@@ -792,6 +1067,9 @@ void HandlerIBusIKEIgnitionStatus(void *ctx, unsigned char *pkt)
             BC127CommandBtState(context->bt, BC127_STATE_OFF, BC127_STATE_OFF);
             BC127CommandClose(context->bt, BC127_CLOSE_ALL);
             BC127ClearPairedDevices(context->bt);
+            context->reconnect.active = 0;
+            context->reconnect.a2dpPending = 0;
+            context->reconnect.streamPending = 0;
             // Unlock the vehicle
             if (ConfigGetSetting(CONFIG_SETTING_COMFORT_LOCKS_ADDRESS) ==
                 CONFIG_SETTING_ON
@@ -822,6 +1100,19 @@ void HandlerIBusIKEIgnitionStatus(void *ctx, unsigned char *pkt)
             BC127ClearMetadata(context->bt);
             // Set the BT module connectable
             BC127CommandBtState(context->bt, BC127_STATE_ON, BC127_STATE_OFF);
+            // Go straight to the most recent device instead of waiting on
+            // the device list, and fall back down the list from the timer
+            HandlerReconnect_t *reconnect = &context->reconnect;
+            reconnect->ignitionOn = TimerGetMillis();
+            reconnect->a2dpPending = 1;
+            reconnect->streamPending = 1;
+            reconnect->attempts = 0;
+            if (reconnect->count > 0 &&
+                context->bt->activeDevice.a2dpLinkId == 0
+            ) {
+                reconnect->active = 1;
+                HandlerReconnectOpen(context, 0);
+            }
             // Request BC127 state
             BC127CommandStatus(context->bt);
             BC127CommandList(context->bt);
@@ -1363,7 +1654,7 @@ void HandlerTimerCDCSendStatus(void *ctx)
 void HandlerTimerDeviceConnection(void *ctx)
 {
     HandlerContext_t *context = (HandlerContext_t *) ctx;
-    if (strlen(context->bt->activeDevice.macId) > 0 &&
+    if (BC127MacIdIsEmpty(context->bt->activeDevice.macId) == 0 &&
         context->bt->activeDevice.a2dpLinkId == 0
     ) {
         if (context->btDeviceConnRetries <= HANDLER_DEVICE_MAX_RECONN) {
@@ -1423,7 +1714,7 @@ void HandlerTimerLCMIOStatus(void *ctx)
 void HandlerTimerOpenProfileErrors(void *ctx)
 {
     HandlerContext_t *context = (HandlerContext_t *) ctx;
-    if (strlen(context->bt->activeDevice.macId) > 0) {
+    if (BC127MacIdIsEmpty(context->bt->activeDevice.macId) == 0) {
         uint8_t idx;
         for (idx = 0; idx < BC127_PROFILE_COUNT; idx++) {
             if (context->bt->pairingErrors[idx] == 1) {
@@ -1473,6 +1764,27 @@ void HandlerTimerPoweroff(void *ctx)
     }
 }
 
+/**
+ * HandlerTimerReconnect()
+ *     Description:
+ *         Move on down the reconnect list if the OPEN for the current device
+ *         never resolved, which only happens if it could not be queued
+ *     Params:
+ *         void *ctx - The context provided at registration
+ *     Returns:
+ *         void
+ */
+void HandlerTimerReconnect(void *ctx)
+{
+    HandlerContext_t *context = (HandlerContext_t *) ctx;
+    HandlerReconnect_t *reconnect = &context->reconnect;
+    if (reconnect->active == 1 &&
+        TimerGetMillis() - reconnect->lastAttempt > HANDLER_RECONNECT_TIMEOUT
+    ) {
+        HandlerReconnectNext(context);
+    }
+}
+
 /**
  * HandlerTimerScanDevices()
  *     Description:
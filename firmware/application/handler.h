@@ -11,6 +11,7 @@
 #include "lib/bc127.h"
 #include "lib/log.h"
 #include "lib/event.h"
+#include "lib/eeprom.h"
 #include "lib/ibus.h"
 #include "lib/timer.h"
 #include "lib/utils.h"
@@ -37,11 +38,65 @@
 #define HANDLER_INT_LCM_IO_STATUS 5000
 #define HANDLER_INT_PROFILE_ERROR 2500
 #define HANDLER_INT_POWEROFF 1000
+#define HANDLER_INT_RECONNECT 250
 #define HANDLER_MFL_STATUS_OFF 0
 #define HANDLER_MFL_STATUS_SPEAK_HOLD 1
 #define HANDLER_POWER_OFF 0
 #define HANDLER_POWER_ON 1
 #define HANDLER_POWER_TIMEOUT_MILLIS 61000
+/* EEPROM 0x100 - 0x1FF: Devices to reconnect to, most recent first */
+#define HANDLER_RECONNECT_ADDRESS 0x100
+// Give up on a device whose OPEN never resolved, even behind a full queue
+#define HANDLER_RECONNECT_TIMEOUT \
+    ((BC127_CMD_OPEN_QUEUE_SIZE + 1) * BC127_CMD_OPEN_TIMEOUT)
+#define HANDLER_RECONNECT_DEVICES 8
+#define HANDLER_RECONNECT_ENTRY_SIZE 7
+#define HANDLER_RECONNECT_HEADER_SIZE 2
+#define HANDLER_RECONNECT_MAGIC 0xB8
+/**
+ * HandlerReconnectDevice_t
+ *     Description:
+ *         A device that we have connected to before
+ *     Fields:
+ *         macId - The MAC ID of the device (6 bytes, binary)
+ *         profiles - The profiles that opened with the device, as a bitmask
+ *             of (1 << BC127_LINK_*)
+ */
+typedef struct HandlerReconnectDevice_t {
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    uint8_t profiles;
+} HandlerReconnectDevice_t;
+/**
+ * HandlerReconnect_t
+ *     Description:
+ *         The reconnect list as stored on the EEPROM, along with the state of
+ *         the reconnect attempts that follow the ignition turning on
+ *     Fields:
+ *         devices - The devices we connected to, most recent first
+ *         count - The number of devices in the list
+ *         active - 1 while we are working through the list
+ *         index - The device that we last tried to connect to
+ *         lastAttempt - When we last tried to connect
+ *         attempts - The connection attempts made since the ignition came on
+ *         ignitionOn - When the ignition last came on
+ *         a2dpPending / streamPending - Set until we measured the time to
+ *             the A2DP link and the time to the A2DP stream
+ *         timeToA2DP - Milliseconds from the ignition to the A2DP link
+ *         timeToStream - Milliseconds from the ignition to the A2DP stream
+ */
+typedef struct HandlerReconnect_t {
+    HandlerReconnectDevice_t devices[HANDLER_RECONNECT_DEVICES];
+    uint8_t count;
+    uint8_t active;
+    uint8_t index;
+    uint32_t lastAttempt;
+    uint8_t attempts;
+    uint32_t ignitionOn;
+    uint8_t a2dpPending;
+    uint8_t streamPending;
+    uint32_t timeToA2DP;
+    uint32_t timeToStream;
+} HandlerReconnect_t;
 typedef struct HandlerModuleStatus_t {
     uint8_t BMBT: 1;
     uint8_t DSP: 1;
@@ -75,12 +130,19 @@ typedef struct HandlerContext_t {
     uint8_t scanIntervals;
     uint32_t cdChangerLastPoll;
     uint32_t cdChangerLastStatus;
+    HandlerReconnect_t reconnect;
 } HandlerContext_t;
 void HandlerInit(BC127_t *, IBus_t *);
+HandlerReconnect_t *HandlerGetReconnect();
+void HandlerReconnectLoad(HandlerContext_t *);
+void HandlerReconnectOpen(HandlerContext_t *, uint8_t);
+void HandlerReconnectNext(HandlerContext_t *);
+void HandlerReconnectUpdate(HandlerContext_t *);
 void HandlerBC127Boot(void *, unsigned char *);
 void HandlerBC127BootStatus(void *, unsigned char *);
 void HandlerBC127CallStatus(void *, unsigned char *);
 void HandlerBC127DeviceLinkConnected(void *, unsigned char *);
+void HandlerBC127DeviceLinkFailed(void *, unsigned char *);
 void HandlerBC127DeviceDisconnected(void *, unsigned char *);
 void HandlerBC127DeviceFound(void *, unsigned char *);
 void HandlerBC127PlaybackStatus(void *, unsigned char *);
@@ -110,5 +172,6 @@ void HandlerTimerDeviceConnection(void *);
 void HandlerTimerLCMIOStatus(void *);
 void HandlerTimerOpenProfileErrors(void *);
 void HandlerTimerPoweroff(void *);
+void HandlerTimerReconnect(void *);
 void HandlerTimerScanDevices(void *);
 #endif /* HANDLER_H */
@@ -37,6 +37,13 @@ int8_t BC127CVCGainTable[] = {
     39 // Technically 39.5 - D6
 };
 
+static BC127CommandQueue_t BC127Commands;
+static BC127Metadata_t BC127Metadata;
+// Device names, shared by the paired devices and the active device. The
+// first byte is always left empty, so that it can serve as the blank name.
+static char BC127NamePool[BC127_NAME_POOL_SIZE];
+static uint16_t BC127NamePoolLength = 1;
+
 /**
  * BC127Init()
  *     Description:
@@ -49,15 +56,20 @@ int8_t BC127CVCGainTable[] = {
 BC127_t BC127Init()
 {
     BC127_t bt;
+    memset(BC127NamePool, 0, sizeof(BC127NamePool));
+    BC127NamePoolLength = 1;
     bt.activeDevice = BC127ConnectionInit();
     bt.connectable = BC127_STATE_ON;
     bt.discoverable = BC127_STATE_ON;
     bt.callStatus = BC127_CALL_INACTIVE;
     bt.metadataStatus = BC127_METADATA_STATUS_NEW;
     bt.pairedDevicesCount = 0;
+    memset(bt.pairedDevicesIndex, -1, sizeof(bt.pairedDevicesIndex));
     bt.playbackStatus = BC127_AVRCP_STATUS_PAUSED;
     bt.scoStatus = BC127_CALL_SCO_CLOSE;
     bt.rxQueueAge = 0;
+    memset(&BC127Commands, 0, sizeof(BC127Commands));
+    BC127Commands.pending = CharQueueInit();
     memset(bt.pairingErrors, 0, sizeof(bt.pairingErrors));
     // Make sure that we initialize the char arrays to all zeros
     BC127ClearMetadata(&bt);
@@ -76,7 +88,8 @@ BC127_t BC127Init()
 /**
  * BC127ClearMetadata()
  *     Description:
- *        (Re)Initialize the metadata fields to blank
+ *        (Re)Initialize the metadata fields to blank, along with what the UIs
+ *        display
  *     Params:
  *         BC127_t *bt - A pointer to the module object
  *     Returns:
@@ -84,9 +97,12 @@ BC127_t BC127Init()
  */
 void BC127ClearMetadata(BC127_t *bt)
 {
+    uint16_t version = BC127Metadata.version;
     memset(bt->title, 0, BC127_METADATA_FIELD_SIZE);
     memset(bt->artist, 0, BC127_METADATA_FIELD_SIZE);
     memset(bt->album, 0, BC127_METADATA_FIELD_SIZE);
+    memset(&BC127Metadata, 0, sizeof(BC127Metadata));
+    BC127Metadata.version = version + 1;
 }
 
 /**
@@ -121,6 +137,7 @@ void BC127ClearPairedDevices(BC127_t *bt)
             memset(btConn, 0, sizeof(bt->pairedDevices[idx]));
         }
     }
+    memset(bt->pairedDevicesIndex, -1, sizeof(bt->pairedDevicesIndex));
     memset(bt->pairingErrors, 0, sizeof(bt->pairingErrors));
     bt->pairedDevicesCount = 0;
 }
@@ -136,24 +153,16 @@ void BC127ClearPairedDevices(BC127_t *bt)
  */
 void BC127ClearInactivePairedDevices(BC127_t *bt)
 {
-    uint8_t idx;
-    uint8_t pairedDevices = bt->pairedDevicesCount;
-    bt->pairedDevicesCount = 0;
-    for (idx = 0; idx < pairedDevices; idx++) {
-        BC127PairedDevice_t *btConn = &bt->pairedDevices[idx];
-        if (btConn != 0) {
-            if (strcmp(btConn->macId, bt->activeDevice.macId) == 0) {
-                // Move the connected devices to the first index, unless it's
-                // already there
-                if (idx != 0) {
-                    BC127PairedDeviceInit(bt, btConn->macId, btConn->deviceName);
-                }
-            } else {
-                memset(btConn, 0, sizeof(bt->pairedDevices[idx]));
-            }
-        }
+    int8_t idx = BC127PairedDeviceFind(bt, bt->activeDevice.macId);
+    BC127PairedDevice_t activeDevice;
+    if (idx != -1) {
+        activeDevice = bt->pairedDevices[idx];
+    }
+    BC127ClearPairedDevices(bt);
+    // Move the connected device to the first index
+    if (idx != -1) {
+        BC127PairedDeviceInit(bt, activeDevice.macId, activeDevice.deviceName);
     }
-    memset(bt->pairingErrors, 0, sizeof(bt->pairingErrors));
 }
 
 /**
@@ -460,14 +469,16 @@ void BC127CommandForwardSeekRelease(BC127_t *bt)
  *         Go to the next track on the currently selected A2DP device
  *     Params:
  *         BC127_t *bt - A pointer to the module object
- *         char *macId - The MAC ID of the device to get the name for
+ *         uint8_t *macId - The MAC ID of the device to get the name for
  *     Returns:
  *         void
  */
-void BC127CommandGetDeviceName(BC127_t *bt, char *macId)
+void BC127CommandGetDeviceName(BC127_t *bt, uint8_t *macId)
 {
     char command[18];
-    snprintf(command, 18, "NAME %s", macId);
+    char macIdText[13];
+    BC127MacIdFormat(macIdText, macId);
+    snprintf(command, 18, "NAME %s", macIdText);
     BC127SendCommand(bt, command);
 }
 
@@ -484,6 +495,8 @@ void BC127CommandGetMetadata(BC127_t *bt)
 {
     if (bt->activeDevice.avrcpLinkId != 0) {
         char command[19];
+        // Whoever asked wants to hear back, even if nothing changed
+        BC127Metadata.republish = 1;
         snprintf(command, 19, "AVRCP_META_DATA %d", bt->activeDevice.avrcpLinkId);
         BC127SendCommand(bt, command);
     } else {
@@ -571,17 +584,26 @@ void BC127CommandProfileClose(BC127_t *bt, uint8_t linkId)
  *         device so we can reference it in case we get OPEN_ERROR's
  *     Params:
  *         BC127_t *bt - A pointer to the module object
- *         char *macId - The MAC ID of the device for which to open the profile
+ *         uint8_t *macId - The MAC ID of the device for which to open the profile
  *         char *profile - The Profile type to open
  *     Returns:
  *         void
  */
-void BC127CommandProfileOpen(BC127_t *bt, char *macId, char *profile)
+void BC127CommandProfileOpen(BC127_t *bt, uint8_t *macId, char *profile)
 {
-    char command[24];
-    strncpy(bt->activeDevice.macId, macId, 12);
-    snprintf(command, 24, "OPEN %s %s", macId, profile);
-    BC127SendCommand(bt, command);
+    memmove(bt->activeDevice.macId, macId, BC127_MAC_ID_LENGTH);
+    if (BC127Commands.opensCount == BC127_CMD_OPEN_QUEUE_SIZE ||
+        strlen(profile) >= BC127_CMD_OPEN_PROFILE_LENGTH
+    ) {
+        BC127Commands.dropped++;
+        LogError("BT: Command 'OPEN %s' dropped", profile);
+        return;
+    }
+    uint8_t idx = (BC127Commands.opensHead + BC127Commands.opensCount) %
+        BC127_CMD_OPEN_QUEUE_SIZE;
+    memcpy(BC127Commands.opens[idx].macId, macId, BC127_MAC_ID_LENGTH);
+    strcpy(BC127Commands.opens[idx].profile, profile);
+    BC127Commands.opensCount++;
 }
 
 /**
@@ -1054,425 +1076,1474 @@ uint8_t BC127GetDeviceId(char *str)
     return UtilsStrToInt(deviceIdStr);
 }
 
+/*
+ * The commands that can be sent again without harm if their response was
+ * lost, since sending them twice leaves the module as once would. Skipping
+ * a track, changing the volume or answering a call must happen only once.
+ */
+static const char *BC127RepeatableCommands[] = {
+    "AVRCP_META_DATA",
+    "BT_STATE ",
+    "CLOSE ",
+    "CONFIG",
+    "CVC_CFG ",
+    "LIST",
+    "NAME ",
+    "SET ",
+    "STATUS",
+    "VERSION",
+    "WRITE"
+};
+#define BC127_REPEATABLE_COMMANDS_COUNT \
+    (sizeof(BC127RepeatableCommands) / sizeof(BC127RepeatableCommands[0]))
+
+/**
+ * BC127CommandIsRepeatable()
+ *     Description:
+ *         Check if a command is safe to send again
+ *     Params:
+ *         const char *command - The command
+ *     Returns:
+ *         uint8_t - 1 if the command may be retried, 0 otherwise
+ */
+static uint8_t BC127CommandIsRepeatable(const char *command)
+{
+    uint8_t idx;
+    for (idx = 0; idx < BC127_REPEATABLE_COMMANDS_COUNT; idx++) {
+        const char *prefix = BC127RepeatableCommands[idx];
+        if (strncmp(command, prefix, strlen(prefix)) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /**
- * BC127Process()
+ * BC127CommandTransmit()
  *     Description:
- *         Read the RX queue and process the messages into meaningful data
+ *         Write the command in flight to the UART, if the UART has room for
+ *         all of it
  *     Params:
  *         BC127_t *bt - A pointer to the module object
  *     Returns:
+ *         uint8_t - 1 if the command was written, 0 otherwise
+ */
+static uint8_t BC127CommandTransmit(BC127_t *bt)
+{
+    uint16_t space = CHAR_QUEUE_SIZE - CharQueueGetSize(&bt->uart.txQueue);
+    if (space < BC127Commands.inFlightLength + 1) {
+        return 0;
+    }
+    LogDebug(LOG_SOURCE_BT, "BT: Send Command '%s'", BC127Commands.inFlight);
+    UARTSendBytes(
+        &bt->uart,
+        (unsigned char *) BC127Commands.inFlight,
+        BC127Commands.inFlightLength
+    );
+    UARTSendChar(&bt->uart, BC127_MSG_END_CHAR);
+    BC127Commands.sentAt = TimerGetMillis();
+    return 1;
+}
+
+/**
+ * BC127CommandCount()
+ *     Description:
+ *         Count a command that was answered, and its round trip time
+ *     Params:
+ *         uint32_t sentAt - When the command was sent
+ *         uint8_t status - BC127_CMD_STATUS_OK or BC127_CMD_STATUS_ERROR
+ *     Returns:
  *         void
  */
-void BC127Process(BC127_t *bt)
+static void BC127CommandCount(uint32_t sentAt, uint8_t status)
 {
-    uint16_t messageLength = CharQueueSeek(&bt->uart.rxQueue, BC127_MSG_END_CHAR);
-    if (messageLength > 0) {
-        char msg[messageLength];
-        uint16_t i;
-        uint16_t delimCount = 1;
-        for (i = 0; i < messageLength; i++) {
-            char c = CharQueueNext(&bt->uart.rxQueue);
-            if (c == BC127_MSG_DELIMETER) {
-                delimCount++;
-            }
-            if (c != BC127_MSG_END_CHAR) {
-                msg[i] = c;
-            } else {
-                // The protocol states that 0x0D delimits messages,
-                // so we change it to a null terminator instead
-                msg[i] = '\0';
-            }
+    uint32_t latency = TimerGetMillis() - sentAt;
+    if (status == BC127_CMD_STATUS_OK) {
+        BC127Commands.completed++;
+        BC127Commands.latencyTotal += latency;
+        if (latency > BC127Commands.latencyMax) {
+            BC127Commands.latencyMax = latency > 0xFFFF ? 0xFFFF : latency;
         }
-        // Copy the message, since strtok adds a null terminator after the first
-        // occurence of the delimiter, causes issues with any functions used going forward
-        char tmpMsg[messageLength];
-        strcpy(tmpMsg, msg);
-        char *msgBuf[delimCount];
-        char *p = strtok(tmpMsg, " ");
-        i = 0;
-        while (p != NULL) {
-            msgBuf[i++] = p;
-            p = strtok(NULL, " ");
-        }
-        LogDebug(LOG_SOURCE_BT, "BT: %s", msg);
+    } else {
+        BC127Commands.errors++;
+    }
+}
 
-        if (strcmp(msgBuf[0], "AVRCP_MEDIA") == 0) {
-            // Always copy size of buffer minus one to make sure we're always
-            // null terminated
-            if (strcmp(msgBuf[2], "TITLE:") == 0) {
-                // Clear Metadata since we're receiving new data
-                BC127ClearMetadata(bt);
-                bt->metadataStatus = BC127_METADATA_STATUS_NEW;
-                strncpy(
-                    bt->title,
-                    &msg[BC127_METADATA_TITLE_OFFSET],
-                    BC127_METADATA_FIELD_SIZE - 1
-                );
-            } else if (strcmp(msgBuf[2], "ARTIST:") == 0) {
-                strncpy(
-                    bt->artist,
-                    &msg[BC127_METADATA_ARTIST_OFFSET],
-                    BC127_METADATA_FIELD_SIZE - 1
-                );
-            } else {
-                if (strcmp(msgBuf[2], "ALBUM:") == 0) {
-                    strncpy(
-                        bt->album,
-                        &msg[BC127_METADATA_ALBUM_OFFSET],
-                        BC127_METADATA_FIELD_SIZE - 1
-                    );
-                }
-                if (bt->metadataStatus == BC127_METADATA_STATUS_NEW) {
-                    LogDebug(
-                        LOG_SOURCE_BT, 
-                        "BT: title=%s,artist=%s,album=%s",
-                        bt->title,
-                        bt->artist,
-                        bt->album
-                    );
-                    EventTriggerCallback(BC127Event_MetadataChange, 0);
-                    // Setting this flag in either event prevents us from
-                    // potentially spamming the BC127 with metadata requests
-                    bt->metadataStatus = BC127_METADATA_STATUS_CUR;
-                }
-            }
-            bt->metadataTimestamp = TimerGetMillis();
-        } else if(strcmp(msgBuf[0], "AVRCP_PLAY") == 0) {
-            uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
-            if (bt->activeDevice.deviceId == deviceId) {
-                bt->playbackStatus = BC127_AVRCP_STATUS_PLAYING;
-                LogDebug(LOG_SOURCE_BT, "BT: Playing");
-                EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
-            }
-        } else if(strcmp(msgBuf[0], "AVRCP_PAUSE") == 0) {
-            uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
-            if (bt->activeDevice.deviceId == deviceId) {
-                bt->playbackStatus = BC127_AVRCP_STATUS_PAUSED;
-                LogDebug(LOG_SOURCE_BT, "BT: Paused");
-                EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
-            }
-        } else if(strcmp(msgBuf[0], "A2DP_STREAM_START") == 0) {
-            if (bt->playbackStatus == BC127_AVRCP_STATUS_PAUSED) {
-                bt->playbackStatus = BC127_AVRCP_STATUS_PLAYING;
-                LogDebug(LOG_SOURCE_BT, "BT: Playing [A2DP Stream Start]");
-                EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
-            }
-        } else if(strcmp(msgBuf[0], "A2DP_STREAM_SUSPEND") == 0) {
-            if (bt->playbackStatus == BC127_AVRCP_STATUS_PLAYING) {
-                bt->playbackStatus = BC127_AVRCP_STATUS_PAUSED;
-                LogDebug(LOG_SOURCE_BT, "BT: Paused [A2DP Stream Suspend]");
-                EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
-            }
-        } else if(strcmp(msgBuf[0], "CALL_ACTIVE") == 0) {
-            bt->callStatus = BC127_CALL_ACTIVE;
-            EventTriggerCallback(
-                BC127Event_CallStatus,
-                (unsigned char *) BC127_CALL_ACTIVE
-            );
-        } else if(strcmp(msgBuf[0], "CALL_END") == 0) {
-            bt->callStatus = BC127_CALL_INACTIVE;
-            EventTriggerCallback(
-                BC127Event_CallStatus,
-                (unsigned char *) BC127_CALL_INACTIVE
-            );
-        } else if(strcmp(msgBuf[0], "CALL_INCOMING") == 0) {
-            bt->callStatus = BC127_CALL_INCOMING;
-            EventTriggerCallback(
-                BC127Event_CallStatus,
-                (unsigned char *) BC127_CALL_INCOMING
-            );
-        } else if (strcmp(msgBuf[0], "CALL_OUTGOING") == 0) {
-            bt->callStatus = BC127_CALL_OUTGOING;
-            EventTriggerCallback(
-                BC127Event_CallStatus,
-                (unsigned char *) BC127_CALL_OUTGOING
-            );
-        } else if(strcmp(msgBuf[0], "LINK") == 0) {
-            uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
-            uint8_t isNew = 0;
-            // No active device is configured
-            if (bt->activeDevice.deviceId == 0) {
-                LogDebug(LOG_SOURCE_BT, "BT: New Active Device");
-                bt->activeDevice.deviceId = deviceId;
-                strncpy(bt->activeDevice.macId, msgBuf[4], 12);
-                char *deviceName = BC127PairedDeviceGetName(bt, msgBuf[4]);
-                if (deviceName != 0) {
-                    strncpy(bt->activeDevice.deviceName, deviceName, 32);
-                } else {
-                    BC127CommandGetDeviceName(bt, msgBuf[4]);
-                }
-                isNew = 1;
-            }
-            if (bt->activeDevice.deviceId == deviceId) {
-                uint8_t linkId = UtilsStrToInt(msgBuf[1]);
-                BC127ConnectionOpenProfile(&bt->activeDevice, msgBuf[3], linkId);
-                // Set the playback status
-                if (strcmp(msgBuf[3], "AVRCP") == 0) {
-                    if (strcmp(msgBuf[5], "PLAYING") == 0) {
-                       bt->playbackStatus = BC127_AVRCP_STATUS_PLAYING;
-                    } else {
-                        bt->playbackStatus = BC127_AVRCP_STATUS_PAUSED;
-                    }
-                    EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
-                }
-                EventTriggerCallback(
-                    BC127Event_DeviceLinkConnected,
-                    (unsigned char *) msgBuf[1]
-                );
-            }
-            if (isNew == 1) {
-                EventTriggerCallback(BC127Event_DeviceConnected, 0);
-            }
-        } else if(strcmp(msgBuf[0], "LIST") == 0) {
-            // Request the device name. Note that the name will only be returned
-            // if the device is in range
-            LogDebug(LOG_SOURCE_BT, "BT: Paired Device %s", msgBuf[1]);
-            BC127CommandGetDeviceName(bt, msgBuf[1]);
-        } else if(strcmp(msgBuf[0], "CLOSE_OK") == 0) {
-            uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
-            // If the open connection is closing, update the state
-            if (bt->activeDevice.deviceId == deviceId) {
-                uint8_t status = BC127ConnectionCloseProfile(
-                    &bt->activeDevice,
-                    msgBuf[2]
-                );
-                if (status == BC127_CONN_STATE_DISCONNECTED) {
-                    bt->playbackStatus = BC127_AVRCP_STATUS_PAUSED;
-                    // Notify the world that the device disconnected
-                    memset(&bt->activeDevice, 0, sizeof(BC127Connection_t));
-                    bt->activeDevice = BC127ConnectionInit();
-                    EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
-                    EventTriggerCallback(BC127Event_DeviceDisconnected, 0);
-                }
-                LogDebug(LOG_SOURCE_BT, "BT: Closed link %s", msgBuf[1]);
-            }
-        } else if (strcmp(msgBuf[0], "OPEN_OK") == 0) {
-            uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
-            uint8_t linkId = UtilsStrToInt(msgBuf[1]);
-            if (bt->activeDevice.deviceId != deviceId) {
-                bt->activeDevice.deviceId = deviceId;
-                strncpy(bt->activeDevice.macId, msgBuf[3], 12);
-                char *deviceName = BC127PairedDeviceGetName(bt, msgBuf[3]);
-                if (deviceName != 0) {
-                    strncpy(bt->activeDevice.deviceName, deviceName, 32);
-                } else {
-                    BC127CommandGetDeviceName(bt, msgBuf[3]);
-                }
-                EventTriggerCallback(BC127Event_DeviceConnected, 0);
-            }
-            // Clear the pairing error
-            if (strcmp(msgBuf[2], "A2DP") == 0) {
-                bt->pairingErrors[BC127_LINK_A2DP] = 0;
-            }
-            if (strcmp(msgBuf[2], "AVRCP") == 0) {
-                bt->pairingErrors[BC127_LINK_AVRCP] = 0;
-            }
-            if (strcmp(msgBuf[2], "HFP") == 0) {
-                bt->pairingErrors[BC127_LINK_HFP] = 0;
-            }
-            BC127ConnectionOpenProfile(&bt->activeDevice, msgBuf[2], linkId);
-            LogDebug(LOG_SOURCE_BT, "BT: Open %s for ID %s", msgBuf[2], msgBuf[1]);
-            EventTriggerCallback(
-                BC127Event_DeviceLinkConnected,
-                (unsigned char *) msgBuf[1]
-            );
-        } else if (strcmp(msgBuf[0], "OPEN_ERROR") == 0) {
-            if (strcmp(msgBuf[1], "A2DP") == 0) {
-                bt->pairingErrors[BC127_LINK_A2DP] = 1;
-            }
-            if (strcmp(msgBuf[1], "AVRCP") == 0) {
-                bt->pairingErrors[BC127_LINK_AVRCP] = 1;
-            }
-            if (strcmp(msgBuf[1], "HFP") == 0) {
-                bt->pairingErrors[BC127_LINK_HFP] = 1;
-            }
-        } else if (strcmp(msgBuf[0], "NAME") == 0) {
-            char deviceName[33];
-            uint8_t idx;
-            uint8_t strIdx = 0;
-            for (idx = 0; idx < strlen(msg) - 19; idx++) {
-                char c = msg[idx + 19];
-                // 0x22 (") is the character that wraps the device name
-                if (c != 0x22) {
-                    deviceName[strIdx] = c;
-                    strIdx++;
-                }
-            }
-            deviceName[strIdx] = '\0';
-            if (strcmp(msgBuf[1], bt->activeDevice.macId) == 0) {
-                memset(bt->activeDevice.deviceName, 0, 33);
-                strncpy(bt->activeDevice.deviceName, deviceName, 32);
-                EventTriggerCallback(BC127Event_DeviceConnected, 0);
-            }
-            BC127PairedDeviceInit(bt, msgBuf[1], deviceName);
-            EventTriggerCallback(BC127Event_DeviceFound, (unsigned char *) msgBuf[1]);
-            LogDebug(LOG_SOURCE_BT, "BT: New Pairing Profile %s -> %s", msgBuf[1], deviceName);
-        } else if(strcmp(msgBuf[0], "Build:") == 0) {
-            // Clear the Metadata
-            BC127ClearMetadata(bt);
-            // The device sometimes resets without sending the "Ready" message
-            // so we instead watch for the build string
-            memset(&bt->activeDevice, 0, sizeof(BC127Connection_t));
-            bt->activeDevice = BC127ConnectionInit();
-            bt->callStatus = BC127_CALL_INACTIVE;
-            bt->metadataStatus = BC127_METADATA_STATUS_NEW;
-            LogDebug(LOG_SOURCE_BT, "BT: Boot Complete");
-            EventTriggerCallback(BC127Event_Boot, 0);
-            EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
-        } else if(strcmp(msgBuf[0], "SCO_OPEN") == 0) {
-            bt->scoStatus = BC127_CALL_SCO_OPEN;
-            EventTriggerCallback(
-                BC127Event_CallStatus,
-                (unsigned char *) BC127_CALL_SCO_OPEN
-            );
-        } else if (strcmp(msgBuf[0], "SCO_CLOSE") == 0) {
-            bt->scoStatus = BC127_CALL_SCO_CLOSE;
-            EventTriggerCallback(
-                BC127Event_CallStatus,
-                (unsigned char *) BC127_CALL_SCO_CLOSE
-            );
-        } else if (strcmp(msgBuf[0], "STATE") == 0) {
-            // Make sure the state is not "OFF", like when module first boots
-            if (strcmp(msgBuf[1], "OFF") != 0) {
-                if (strcmp(msgBuf[2], "CONNECTABLE[ON]") == 0) {
-                    bt->connectable = BC127_STATE_ON;
-                } else if (strcmp(msgBuf[2], "CONNECTABLE[OFF]") == 0) {
-                    bt->connectable = BC127_STATE_OFF;
-                }
-                if (strcmp(msgBuf[3], "DISCOVERABLE[ON]") == 0) {
-                    bt->discoverable = BC127_STATE_ON;
-                } else if (strcmp(msgBuf[3], "DISCOVERABLE[OFF]") == 0) {
-                    bt->discoverable = BC127_STATE_OFF;
-                }
-                LogDebug(LOG_SOURCE_BT, "BT: Got Status %s %s", msgBuf[2], msgBuf[3]);
-            } else {
-                // The BT Radio is off, likely meaning a reboot
-                EventTriggerCallback(BC127Event_BootStatus, 0);
-            }
-        }
-        // Reset the age of the Rx queue
-        bt->rxQueueAge = 0;
-    } else if (bt->uart.rxQueue.size > 0) {
-        if (bt->rxQueueAge == 0) {
-            bt->rxQueueAge = TimerGetMillis();
-        } else {
-            if ((TimerGetMillis() - bt->rxQueueAge) > BC127_RX_QUEUE_TIMEOUT) {
-                UARTRXQueueReset(&bt->uart);
-                bt->rxQueueAge = 0;
-                LogInfo(LOG_SOURCE_BT, "BT: RX Queue Timeout");
-            }
-        }
+/**
+ * BC127CommandOpenStart()
+ *     Description:
+ *         Put the first OPEN command in flight, if the UART has room for all
+ *         of it
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+static void BC127CommandOpenStart(BC127_t *bt)
+{
+    BC127OpenCommand_t *open = &BC127Commands.opens[BC127Commands.opensHead];
+    char macIdText[13];
+    BC127MacIdFormat(macIdText, open->macId);
+    uint8_t length = snprintf(
+        BC127Commands.inFlight,
+        BC127_CMD_MAX_LENGTH,
+        "OPEN %s %s",
+        macIdText,
+        open->profile
+    );
+    if (CHAR_QUEUE_SIZE - CharQueueGetSize(&bt->uart.txQueue) < length + 1) {
+        return;
     }
-    /* Sometimes there is not more than a Title or Album, which does not give
-     * us sufficient information to push a metadata update. Sometimes, this is
-     * because the data is stuck in a buffer, and other times it's because it's
-     * not available. Therefore, we send a blank command to try to push data
-     * out of the buffer. Otherwise, request the full metadata if we have
-     * partial metadata for more than the specified timeout value.
-     **/
-    uint32_t now = TimerGetMillis();
-    if ((now - bt->metadataTimestamp) > BC127_METADATA_TIMEOUT &&
-        bt->metadataStatus == BC127_METADATA_STATUS_NEW &&
-        bt->activeDevice.avrcpLinkId != 0
+    BC127Commands.inFlightLength = length;
+    BC127Commands.inFlightResponse = BC127_CMD_RESPONSE_OPEN;
+    BC127Commands.inFlightRetries = 0;
+    BC127Commands.sent++;
+    BC127CommandTransmit(bt);
+}
+
+/**
+ * BC127CommandOpenDone()
+ *     Description:
+ *         Retire the OPEN command in flight, and let the handler know if the
+ *         profile could not be opened
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         uint8_t status - BC127_CMD_STATUS_OK or BC127_CMD_STATUS_ERROR
+ *     Returns:
+ *         void
+ */
+static void BC127CommandOpenDone(BC127_t *bt, uint8_t status)
+{
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    memcpy(macId, BC127Commands.opens[BC127Commands.opensHead].macId, BC127_MAC_ID_LENGTH);
+    BC127Commands.opensHead = (BC127Commands.opensHead + 1) % BC127_CMD_OPEN_QUEUE_SIZE;
+    BC127Commands.opensCount--;
+    BC127Commands.openInFlight = 0;
+    if (status == BC127_CMD_STATUS_ERROR) {
+        EventTriggerCallback(BC127Event_DeviceLinkFailed, macId);
+    }
+}
+
+/**
+ * BC127CommandOpenComplete()
+ *     Description:
+ *         Match OPEN_OK or OPEN_ERROR to the OPEN command in flight, whether
+ *         or not its OK came first. A device that connects by itself also
+ *         brings OPEN_OK, so the device and the profile must be the ones
+ *         that we asked for.
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         uint8_t *macId - The device that the response names, 0 if none
+ *         char *profile - The profile that the response names
+ *         uint8_t status - BC127_CMD_STATUS_OK or BC127_CMD_STATUS_ERROR
+ *     Returns:
+ *         void
+ */
+static void BC127CommandOpenComplete(
+    BC127_t *bt,
+    uint8_t *macId,
+    char *profile,
+    uint8_t status
+) {
+    BC127OpenCommand_t *open = &BC127Commands.opens[BC127Commands.opensHead];
+    uint8_t waitingOk = BC127Commands.inFlightLength > 0 &&
+        BC127Commands.inFlightResponse == BC127_CMD_RESPONSE_OPEN;
+    if ((BC127Commands.openInFlight == 0 && waitingOk == 0) ||
+        strcmp(open->profile, profile) != 0 ||
+        (macId != 0 && memcmp(open->macId, macId, BC127_MAC_ID_LENGTH) != 0)
     ) {
-        BC127CommandGetMetadata(bt);
-        bt->metadataTimestamp = now;
+        return;
     }
-    UARTReportErrors(&bt->uart);
+    if (waitingOk == 1) {
+        BC127Commands.inFlightLength = 0;
+        BC127CommandCount(BC127Commands.sentAt, status);
+    } else {
+        BC127CommandCount(BC127Commands.openSentAt, status);
+    }
+    BC127CommandOpenDone(bt, status);
 }
 
 /**
- * BC127SendCommand()
+ * BC127CommandComplete()
  *     Description:
- *         Send data over UART
+ *         Match a response from the BC127 to the command in flight. OK and
+ *         ERROR answer any command, and a reboot ends whatever command was
+ *         waiting, OPEN included. An OPEN that gets its OK moves to its own
+ *         slot, to wait for OPEN_OK or OPEN_ERROR there.
  *     Params:
  *         BC127_t *bt - A pointer to the module object
- *         char *command - A command to send, with null termination included
+ *         uint8_t response - The BC127_CMD_RESPONSE_* that was received
+ *         uint8_t status - BC127_CMD_STATUS_OK or BC127_CMD_STATUS_ERROR
  *     Returns:
  *         void
  */
-void BC127SendCommand(BC127_t *bt, char *command)
+static void BC127CommandComplete(BC127_t *bt, uint8_t response, uint8_t status)
 {
-    LogDebug(LOG_SOURCE_BT, "BT: Send Command '%s'", command);
-    uint8_t idx = 0;
-    for (idx = 0; idx < strlen(command); idx++) {
-        CharQueueAdd(&bt->uart.txQueue, command[idx]);
+    if (response == BC127_CMD_RESPONSE_BOOT && BC127Commands.openInFlight == 1) {
+        BC127CommandCount(BC127Commands.openSentAt, BC127_CMD_STATUS_ERROR);
+        BC127CommandOpenDone(bt, BC127_CMD_STATUS_ERROR);
+    }
+    if (BC127Commands.inFlightLength == 0) {
+        return;
+    }
+    // A reboot answers a reset, and cuts any other command short
+    if (response == BC127_CMD_RESPONSE_BOOT &&
+        BC127Commands.inFlightResponse != BC127_CMD_RESPONSE_BOOT
+    ) {
+        status = BC127_CMD_STATUS_ERROR;
+    }
+    BC127Commands.inFlightLength = 0;
+    if (BC127Commands.inFlightResponse == BC127_CMD_RESPONSE_OPEN &&
+        status == BC127_CMD_STATUS_OK
+    ) {
+        BC127Commands.openSentAt = BC127Commands.sentAt;
+        BC127Commands.openInFlight = 1;
+        return;
+    }
+    BC127CommandCount(BC127Commands.sentAt, status);
+    if (status == BC127_CMD_STATUS_ERROR) {
+        LogDebug(
+            LOG_SOURCE_BT,
+            "BT: Command '%s' failed",
+            BC127Commands.inFlight
+        );
+        if (BC127Commands.inFlightResponse == BC127_CMD_RESPONSE_OPEN) {
+            BC127CommandOpenDone(bt, status);
+        }
     }
-    CharQueueAdd(&bt->uart.txQueue, BC127_MSG_END_CHAR);
-    // Set the interrupt flag
-    SetUARTTXIE(bt->uart.moduleIndex, 1);
 }
 
 /**
- * BC127SendCommandEmpty()
+ * BC127CommandProcess()
  *     Description:
- *         Send a carriage return over UART
+ *         Retry the command in flight if its response is overdue and it is
+ *         safe to send again, give up on an OPEN that was never answered,
+ *         and send the next commands once nothing is in flight
  *     Params:
  *         BC127_t *bt - A pointer to the module object
  *     Returns:
  *         void
  */
-void BC127SendCommandEmpty(BC127_t *bt)
+static void BC127CommandProcess(BC127_t *bt)
 {
-    CharQueueAdd(&bt->uart.txQueue, BC127_MSG_END_CHAR);
-    // Set the interrupt flag
-    SetUARTTXIE(bt->uart.moduleIndex, 1);
+    uint32_t now = TimerGetMillis();
+    if (BC127Commands.openInFlight == 1 &&
+        (now - BC127Commands.openSentAt) > BC127_CMD_OPEN_TIMEOUT
+    ) {
+        // Paging again would most likely fail the same way, so leave that
+        // to the handler
+        BC127Commands.timeouts++;
+        LogDebug(
+            LOG_SOURCE_BT,
+            "BT: Command 'OPEN %s' timed out",
+            BC127Commands.opens[BC127Commands.opensHead].profile
+        );
+        BC127CommandOpenDone(bt, BC127_CMD_STATUS_ERROR);
+    }
+    if (BC127Commands.inFlightLength > 0) {
+        uint16_t timeout = BC127_CMD_TIMEOUT;
+        if (BC127Commands.inFlightResponse == BC127_CMD_RESPONSE_BOOT) {
+            timeout = BC127_CMD_BOOT_TIMEOUT;
+        }
+        if ((now - BC127Commands.sentAt) <= timeout) {
+            return;
+        }
+        if (BC127Commands.inFlightRetries < BC127_CMD_RETRIES &&
+            BC127CommandIsRepeatable(BC127Commands.inFlight) == 1
+        ) {
+            if (BC127CommandTransmit(bt) == 1) {
+                BC127Commands.inFlightRetries++;
+                BC127Commands.retries++;
+            }
+            return;
+        }
+        BC127Commands.timeouts++;
+        LogDebug(
+            LOG_SOURCE_BT,
+            "BT: Command '%s' timed out",
+            BC127Commands.inFlight
+        );
+        BC127Commands.inFlightLength = 0;
+        if (BC127Commands.inFlightResponse == BC127_CMD_RESPONSE_OPEN) {
+            BC127CommandOpenDone(bt, BC127_CMD_STATUS_ERROR);
+        }
+    }
+    // Only OPEN_OK or OPEN_ERROR can answer an OPEN once it has its OK, so
+    // the next OPEN waits for those while the other commands go ahead
+    if (BC127Commands.openInFlight == 0 && BC127Commands.opensCount > 0) {
+        BC127CommandOpenStart(bt);
+        return;
+    }
+    uint16_t length = CharQueueSeekLine(
+        &BC127Commands.pending,
+        BC127_MSG_END_CHAR
+    );
+    if (length == 0 ||
+        CHAR_QUEUE_SIZE - CharQueueGetSize(&bt->uart.txQueue) < length
+    ) {
+        return;
+    }
+    CharQueueRead(
+        &BC127Commands.pending,
+        (unsigned char *) BC127Commands.inFlight,
+        length
+    );
+    BC127Commands.pendingCount--;
+    BC127Commands.sent++;
+    if (length == 1) {
+        // An empty command only nudges the module, and gets no answer
+        UARTSendChar(&bt->uart, BC127_MSG_END_CHAR);
+        return;
+    }
+    BC127Commands.inFlight[length - 1] = '\0';
+    BC127Commands.inFlightLength = length - 1;
+    BC127Commands.inFlightRetries = 0;
+    if (strcmp(BC127Commands.inFlight, "RESET") == 0) {
+        BC127Commands.inFlightResponse = BC127_CMD_RESPONSE_BOOT;
+    } else {
+        BC127Commands.inFlightResponse = BC127_CMD_RESPONSE_OK;
+    }
+    BC127CommandTransmit(bt);
 }
 
-/** Begin BC127 Paired Device Implementation **/
+/**
+ * BC127GetCommandStats()
+ *     Description:
+ *         Get the command pipeline statistics, for diagnostics
+ *     Params:
+ *         void
+ *     Returns:
+ *         BC127CommandQueue_t *
+ */
+BC127CommandQueue_t *BC127GetCommandStats()
+{
+    return &BC127Commands;
+}
 
 /**
- * BC127PairedDeviceInit()
+ * BC127GetMetadata()
  *     Description:
- *         Initialize a pairing profile if one does not exist
+ *         Get the display ready metadata. The UIs must not change it.
  *     Params:
- *         BC127_t *bt
- *         char *macId
- *         char *deviceName
+ *         None
  *     Returns:
- *         Void
+ *         const BC127Metadata_t * - The metadata
  */
-void BC127PairedDeviceInit(BC127_t *bt, char *macId, char *deviceName)
+const BC127Metadata_t *BC127GetMetadata()
 {
-    uint8_t deviceExists = 0;
-    uint8_t idx;
-    for (idx = 0; idx < bt->pairedDevicesCount; idx++) {
-        BC127PairedDevice_t *btDevice = &bt->pairedDevices[idx];
-        if (strcmp(macId, btDevice->macId) == 0) {
-            deviceExists = 1;
+    return &BC127Metadata;
+}
+
+/**
+ * BC127Tokenize()
+ *     Description:
+ *         Split a message into its space delimited tokens in place, by
+ *         terminating each token where its delimiter was. Only the first
+ *         tokens are split, and the last one holds the rest of the message
+ *         untouched, so that free text like a track title keeps its spaces.
+ *         Tokens that the message does not have are left empty, so callers
+ *         may look at any of the tokens.
+ *     Params:
+ *         char *msg - The message to split
+ *         char **tokens - Where to store the start of each token
+ *         uint8_t maxTokens - The number of tokens to split into
+ *     Returns:
+ *         uint8_t - The number of tokens found
+ */
+uint8_t BC127Tokenize(char *msg, char **tokens, uint8_t maxTokens)
+{
+    uint8_t count = 0;
+    while (count < maxTokens) {
+        while (*msg == BC127_MSG_DELIMETER) {
+            msg++;
+        }
+        if (*msg == '\0') {
+            break;
+        }
+        tokens[count++] = msg;
+        if (count == maxTokens) {
+            break;
+        }
+        while (*msg != '\0' && *msg != BC127_MSG_DELIMETER) {
+            msg++;
+        }
+        if (*msg != '\0') {
+            *msg++ = '\0';
         }
     }
-    // Create a connection for this device since one does not exist
-    if (deviceExists == 0) {
-        BC127PairedDevice_t pairedDevice;
-        strncpy(pairedDevice.macId, macId, 13);
-        memset(pairedDevice.deviceName, 0, 33);
-        strncpy(pairedDevice.deviceName, deviceName, 32);
-        bt->pairedDevices[bt->pairedDevicesCount++] = pairedDevice;
+    uint8_t idx;
+    for (idx = count; idx < maxTokens; idx++) {
+        tokens[idx] = "";
     }
+    return count;
 }
 
 /**
- * BC127PairedDeviceGetName()
+ * BC127MetadataHash()
  *     Description:
- *         Get the name of a device from its MAC ID
+ *         Hash the metadata fields as they came in (32-bit FNV-1a)
  *     Params:
- *         BC127_t *bt
- *         char *macId
+ *         BC127_t *bt - A pointer to the module object
  *     Returns:
- *         char * - A pointer to the device name
+ *         uint32_t - The hash
  */
-char *BC127PairedDeviceGetName(BC127_t *bt, char *macId)
+static uint32_t BC127MetadataHash(BC127_t *bt)
 {
-    char *deviceName = 0;
+    char *fields[3] = {bt->title, bt->artist, bt->album};
+    uint32_t hash = 2166136261UL;
     uint8_t idx;
-    for (idx = 0; idx <= bt->pairedDevicesCount; idx++) {
-        BC127PairedDevice_t *btDevice = &bt->pairedDevices[idx];
-        if (strcmp(macId, btDevice->macId) == 0) {
-            deviceName = btDevice->deviceName;
+    for (idx = 0; idx < 3; idx++) {
+        char *c = fields[idx];
+        while (*c != '\0') {
+            hash = (hash ^ (uint8_t) *c) * 16777619UL;
+            c++;
+        }
+        // Keep the field boundaries, so moving text between fields counts
+        hash = hash * 16777619UL;
+    }
+    return hash;
+}
+
+/**
+ * BC127MetadataPublish()
+ *     Description:
+ *         Build the display text from a complete set of metadata, unless it
+ *         is the same as what we have, and let the UIs know about it. Sets
+ *         that did not change are only passed on if they were asked for.
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+static void BC127MetadataPublish(BC127_t *bt)
+{
+    BC127Metadata_t *metadata = &BC127Metadata;
+    uint32_t hash = BC127MetadataHash(bt);
+    if (hash != metadata->hash || strlen(metadata->gtText) == 0) {
+        UtilsRemoveNonAscii(metadata->title, bt->title);
+        UtilsRemoveNonAscii(metadata->artist, bt->artist);
+        UtilsRemoveNonAscii(metadata->album, bt->album);
+        if (strlen(metadata->artist) > 0 && strlen(metadata->album) > 0) {
+            snprintf(
+                metadata->text,
+                UTILS_DISPLAY_TEXT_SIZE,
+                "%s - %s on %s",
+                metadata->title,
+                metadata->artist,
+                metadata->album
+            );
+        } else if (strlen(metadata->artist) > 0) {
+            snprintf(
+                metadata->text,
+                UTILS_DISPLAY_TEXT_SIZE,
+                "%s - %s",
+                metadata->title,
+                metadata->artist
+            );
+        } else if (strlen(metadata->album) > 0) {
+            snprintf(
+                metadata->text,
+                UTILS_DISPLAY_TEXT_SIZE,
+                "%s on %s",
+                metadata->title,
+                metadata->album
+            );
+        } else {
+            snprintf(metadata->text, UTILS_DISPLAY_TEXT_SIZE, "%s", metadata->title);
+        }
+        snprintf(
+            metadata->gtText,
+            UTILS_DISPLAY_TEXT_SIZE,
+            "%s - %s - %s",
+            metadata->title,
+            metadata->artist,
+            metadata->album
+        );
+        metadata->hash = hash;
+        metadata->version++;
+        LogDebug(
+            LOG_SOURCE_BT,
+            "BT: title=%s,artist=%s,album=%s",
+            metadata->title,
+            metadata->artist,
+            metadata->album
+        );
+    } else if (metadata->republish == 0) {
+        return;
+    }
+    metadata->republish = 0;
+    EventQueueTrigger(
+        EVENT_QUEUE_LANE_LOW,
+        BC127Event_MetadataChange,
+        0,
+        0
+    );
+}
+
+/**
+ * BC127ProcessAVRCPMedia()
+ *     Description:
+ *         Store the title, artist or album of the playing media, and announce
+ *         the metadata once the set is complete. The text is the rest of the
+ *         line after the field name.
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessAVRCPMedia(BC127_t *bt, char **msgBuf)
+{
+    // Always copy size of buffer minus one to make sure we're always
+    // null terminated
+    if (strcmp(msgBuf[2], "TITLE:") == 0) {
+        // Clear the incoming fields since we're receiving new data. What
+        // the UIs display stays in place until the set is complete.
+        memset(bt->title, 0, BC127_METADATA_FIELD_SIZE);
+        memset(bt->artist, 0, BC127_METADATA_FIELD_SIZE);
+        memset(bt->album, 0, BC127_METADATA_FIELD_SIZE);
+        bt->metadataStatus = BC127_METADATA_STATUS_NEW;
+        strncpy(
+            bt->title,
+            msgBuf[3],
+            BC127_METADATA_FIELD_SIZE - 1
+        );
+    } else if (strcmp(msgBuf[2], "ARTIST:") == 0) {
+        strncpy(
+            bt->artist,
+            msgBuf[3],
+            BC127_METADATA_FIELD_SIZE - 1
+        );
+    } else {
+        if (strcmp(msgBuf[2], "ALBUM:") == 0) {
+            strncpy(
+                bt->album,
+                msgBuf[3],
+                BC127_METADATA_FIELD_SIZE - 1
+            );
+        }
+        if (bt->metadataStatus == BC127_METADATA_STATUS_NEW) {
+            BC127MetadataPublish(bt);
+            // Setting this flag in either event prevents us from
+            // potentially spamming the BC127 with metadata requests
+            bt->metadataStatus = BC127_METADATA_STATUS_CUR;
+        }
+    }
+    bt->metadataTimestamp = TimerGetMillis();
+}
+
+/**
+ * BC127ProcessAVRCPPlay()
+ *     Description:
+ *         Playback started on a device
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessAVRCPPlay(BC127_t *bt, char **msgBuf)
+{
+    uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
+    if (bt->activeDevice.deviceId == deviceId) {
+        bt->playbackStatus = BC127_AVRCP_STATUS_PLAYING;
+        LogDebug(LOG_SOURCE_BT, "BT: Playing");
+        EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
+    }
+}
+
+/**
+ * BC127ProcessAVRCPPause()
+ *     Description:
+ *         Playback paused on a device
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessAVRCPPause(BC127_t *bt, char **msgBuf)
+{
+    uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
+    if (bt->activeDevice.deviceId == deviceId) {
+        bt->playbackStatus = BC127_AVRCP_STATUS_PAUSED;
+        LogDebug(LOG_SOURCE_BT, "BT: Paused");
+        EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
+    }
+}
+
+/**
+ * BC127ProcessA2DPStreamStart()
+ *     Description:
+ *         Audio started streaming, which means that playback started
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessA2DPStreamStart(BC127_t *bt, char **msgBuf)
+{
+    if (bt->playbackStatus == BC127_AVRCP_STATUS_PAUSED) {
+        bt->playbackStatus = BC127_AVRCP_STATUS_PLAYING;
+        LogDebug(LOG_SOURCE_BT, "BT: Playing [A2DP Stream Start]");
+        EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
+    }
+}
+
+/**
+ * BC127ProcessA2DPStreamSuspend()
+ *     Description:
+ *         Audio stopped streaming, which means that playback paused
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessA2DPStreamSuspend(BC127_t *bt, char **msgBuf)
+{
+    if (bt->playbackStatus == BC127_AVRCP_STATUS_PLAYING) {
+        bt->playbackStatus = BC127_AVRCP_STATUS_PAUSED;
+        LogDebug(LOG_SOURCE_BT, "BT: Paused [A2DP Stream Suspend]");
+        EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
+    }
+}
+
+/**
+ * BC127ProcessCallActive()
+ *     Description:
+ *         A call was answered
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessCallActive(BC127_t *bt, char **msgBuf)
+{
+    bt->callStatus = BC127_CALL_ACTIVE;
+    EventTriggerCallback(
+        BC127Event_CallStatus,
+        (unsigned char *) BC127_CALL_ACTIVE
+    );
+}
+
+/**
+ * BC127ProcessCallEnd()
+ *     Description:
+ *         A call ended
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessCallEnd(BC127_t *bt, char **msgBuf)
+{
+    bt->callStatus = BC127_CALL_INACTIVE;
+    EventTriggerCallback(
+        BC127Event_CallStatus,
+        (unsigned char *) BC127_CALL_INACTIVE
+    );
+}
+
+/**
+ * BC127ProcessCallIncoming()
+ *     Description:
+ *         A call is coming in
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessCallIncoming(BC127_t *bt, char **msgBuf)
+{
+    bt->callStatus = BC127_CALL_INCOMING;
+    EventTriggerCallback(
+        BC127Event_CallStatus,
+        (unsigned char *) BC127_CALL_INCOMING
+    );
+}
+
+/**
+ * BC127ProcessCallOutgoing()
+ *     Description:
+ *         A call is being placed
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessCallOutgoing(BC127_t *bt, char **msgBuf)
+{
+    bt->callStatus = BC127_CALL_OUTGOING;
+    EventTriggerCallback(
+        BC127Event_CallStatus,
+        (unsigned char *) BC127_CALL_OUTGOING
+    );
+}
+
+/**
+ * BC127ProcessLink()
+ *     Description:
+ *         A profile link is up, as reported by the STATUS command
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessLink(BC127_t *bt, char **msgBuf)
+{
+    uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
+    uint8_t isNew = 0;
+    // No active device is configured
+    if (bt->activeDevice.deviceId == 0) {
+        LogDebug(LOG_SOURCE_BT, "BT: New Active Device");
+        bt->activeDevice.deviceId = deviceId;
+        BC127MacIdParse(bt->activeDevice.macId, msgBuf[4]);
+        char *deviceName = BC127PairedDeviceGetName(bt, bt->activeDevice.macId);
+        if (deviceName != 0) {
+            bt->activeDevice.deviceName = deviceName;
+        } else {
+            BC127CommandGetDeviceName(bt, bt->activeDevice.macId);
+        }
+        isNew = 1;
+    }
+    if (bt->activeDevice.deviceId == deviceId) {
+        uint8_t linkId = UtilsStrToInt(msgBuf[1]);
+        BC127ConnectionOpenProfile(&bt->activeDevice, msgBuf[3], linkId);
+        // Set the playback status
+        if (strcmp(msgBuf[3], "AVRCP") == 0) {
+            if (strcmp(msgBuf[5], "PLAYING") == 0) {
+               bt->playbackStatus = BC127_AVRCP_STATUS_PLAYING;
+            } else {
+                bt->playbackStatus = BC127_AVRCP_STATUS_PAUSED;
+            }
+            EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
+        }
+        EventTriggerCallback(
+            BC127Event_DeviceLinkConnected,
+            (unsigned char *) msgBuf[1]
+        );
+    }
+    if (isNew == 1) {
+        EventTriggerCallback(BC127Event_DeviceConnected, 0);
+    }
+}
+
+/**
+ * BC127ProcessList()
+ *     Description:
+ *         A paired device, as reported by the LIST command
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessList(BC127_t *bt, char **msgBuf)
+{
+    // Request the device name. Note that the name will only be returned
+    // if the device is in range
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    LogDebug(LOG_SOURCE_BT, "BT: Paired Device %s", msgBuf[1]);
+    if (BC127MacIdParse(macId, msgBuf[1]) == 1) {
+        BC127CommandGetDeviceName(bt, macId);
+    }
+}
+
+/**
+ * BC127ProcessCloseOk()
+ *     Description:
+ *         A profile link was closed
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessCloseOk(BC127_t *bt, char **msgBuf)
+{
+    uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
+    // If the open connection is closing, update the state
+    if (bt->activeDevice.deviceId == deviceId) {
+        uint8_t status = BC127ConnectionCloseProfile(
+            &bt->activeDevice,
+            msgBuf[2]
+        );
+        if (status == BC127_CONN_STATE_DISCONNECTED) {
+            bt->playbackStatus = BC127_AVRCP_STATUS_PAUSED;
+            // Notify the world that the device disconnected
+            memset(&bt->activeDevice, 0, sizeof(BC127Connection_t));
+            bt->activeDevice = BC127ConnectionInit();
+            EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
+            EventTriggerCallback(BC127Event_DeviceDisconnected, 0);
+        }
+        LogDebug(LOG_SOURCE_BT, "BT: Closed link %s", msgBuf[1]);
+    }
+}
+
+/**
+ * BC127ProcessOpenOk()
+ *     Description:
+ *         A profile link was opened
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessOpenOk(BC127_t *bt, char **msgBuf)
+{
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    BC127MacIdParse(macId, msgBuf[3]);
+    BC127CommandOpenComplete(bt, macId, msgBuf[2], BC127_CMD_STATUS_OK);
+    uint8_t deviceId = BC127GetDeviceId(msgBuf[1]);
+    uint8_t linkId = UtilsStrToInt(msgBuf[1]);
+    if (bt->activeDevice.deviceId != deviceId) {
+        bt->activeDevice.deviceId = deviceId;
+        BC127MacIdParse(bt->activeDevice.macId, msgBuf[3]);
+        char *deviceName = BC127PairedDeviceGetName(bt, bt->activeDevice.macId);
+        if (deviceName != 0) {
+            bt->activeDevice.deviceName = deviceName;
+        } else {
+            BC127CommandGetDeviceName(bt, bt->activeDevice.macId);
+        }
+        EventTriggerCallback(BC127Event_DeviceConnected, 0);
+    }
+    // Clear the pairing error
+    if (strcmp(msgBuf[2], "A2DP") == 0) {
+        bt->pairingErrors[BC127_LINK_A2DP] = 0;
+    }
+    if (strcmp(msgBuf[2], "AVRCP") == 0) {
+        bt->pairingErrors[BC127_LINK_AVRCP] = 0;
+    }
+    if (strcmp(msgBuf[2], "HFP") == 0) {
+        bt->pairingErrors[BC127_LINK_HFP] = 0;
+    }
+    BC127ConnectionOpenProfile(&bt->activeDevice, msgBuf[2], linkId);
+    LogDebug(LOG_SOURCE_BT, "BT: Open %s for ID %s", msgBuf[2], msgBuf[1]);
+    EventTriggerCallback(
+        BC127Event_DeviceLinkConnected,
+        (unsigned char *) msgBuf[1]
+    );
+}
+
+/**
+ * BC127ProcessOpenError()
+ *     Description:
+ *         A profile link could not be opened
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessOpenError(BC127_t *bt, char **msgBuf)
+{
+    BC127CommandOpenComplete(bt, 0, msgBuf[1], BC127_CMD_STATUS_ERROR);
+    if (strcmp(msgBuf[1], "A2DP") == 0) {
+        bt->pairingErrors[BC127_LINK_A2DP] = 1;
+    }
+    if (strcmp(msgBuf[1], "AVRCP") == 0) {
+        bt->pairingErrors[BC127_LINK_AVRCP] = 1;
+    }
+    if (strcmp(msgBuf[1], "HFP") == 0) {
+        bt->pairingErrors[BC127_LINK_HFP] = 1;
+    }
+}
+
+/**
+ * BC127ProcessName()
+ *     Description:
+ *         The friendly name of a device. The name is the rest of the line,
+ *         wrapped in quotes.
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessName(BC127_t *bt, char **msgBuf)
+{
+    char deviceName[BC127_NAME_MAX_LENGTH + 1];
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    char *name = msgBuf[2];
+    uint8_t strIdx = 0;
+    if (BC127MacIdParse(macId, msgBuf[1]) == 0) {
+        return;
+    }
+    while (*name != '\0' && strIdx < BC127_NAME_MAX_LENGTH) {
+        // 0x22 (") is the character that wraps the device name
+        if (*name != 0x22) {
+            deviceName[strIdx] = *name;
+            strIdx++;
+        }
+        name++;
+    }
+    deviceName[strIdx] = '\0';
+    if (memcmp(macId, bt->activeDevice.macId, BC127_MAC_ID_LENGTH) == 0) {
+        bt->activeDevice.deviceName = BC127NamePoolIntern(bt, deviceName);
+        EventTriggerCallback(BC127Event_DeviceConnected, 0);
+    }
+    BC127PairedDeviceInit(bt, macId, deviceName);
+    EventTriggerCallback(BC127Event_DeviceFound, macId);
+    LogDebug(LOG_SOURCE_BT, "BT: New Pairing Profile %s -> %s", msgBuf[1], deviceName);
+}
+
+/**
+ * BC127ProcessBuild()
+ *     Description:
+ *         The module booted
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessBuild(BC127_t *bt, char **msgBuf)
+{
+    // Whatever we were waiting on will not be answered anymore
+    BC127CommandComplete(bt, BC127_CMD_RESPONSE_BOOT, BC127_CMD_STATUS_OK);
+    // Clear the Metadata
+    BC127ClearMetadata(bt);
+    // The device sometimes resets without sending the "Ready" message
+    // so we instead watch for the build string
+    memset(&bt->activeDevice, 0, sizeof(BC127Connection_t));
+    bt->activeDevice = BC127ConnectionInit();
+    bt->callStatus = BC127_CALL_INACTIVE;
+    bt->metadataStatus = BC127_METADATA_STATUS_NEW;
+    LogDebug(LOG_SOURCE_BT, "BT: Boot Complete");
+    EventTriggerCallback(BC127Event_Boot, 0);
+    EventTriggerCallback(BC127Event_PlaybackStatusChange, 0);
+}
+
+/**
+ * BC127ProcessSCOOpen()
+ *     Description:
+ *         The call audio channel opened
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessSCOOpen(BC127_t *bt, char **msgBuf)
+{
+    bt->scoStatus = BC127_CALL_SCO_OPEN;
+    EventTriggerCallback(
+        BC127Event_CallStatus,
+        (unsigned char *) BC127_CALL_SCO_OPEN
+    );
+}
+
+/**
+ * BC127ProcessSCOClose()
+ *     Description:
+ *         The call audio channel closed
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessSCOClose(BC127_t *bt, char **msgBuf)
+{
+    bt->scoStatus = BC127_CALL_SCO_CLOSE;
+    EventTriggerCallback(
+        BC127Event_CallStatus,
+        (unsigned char *) BC127_CALL_SCO_CLOSE
+    );
+}
+
+/**
+ * BC127ProcessState()
+ *     Description:
+ *         The connectable and discoverable state, as reported by the STATUS
+ *         command
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessState(BC127_t *bt, char **msgBuf)
+{
+    // Make sure the state is not "OFF", like when module first boots
+    if (strcmp(msgBuf[1], "OFF") != 0) {
+        if (strcmp(msgBuf[2], "CONNECTABLE[ON]") == 0) {
+            bt->connectable = BC127_STATE_ON;
+        } else if (strcmp(msgBuf[2], "CONNECTABLE[OFF]") == 0) {
+            bt->connectable = BC127_STATE_OFF;
+        }
+        if (strcmp(msgBuf[3], "DISCOVERABLE[ON]") == 0) {
+            bt->discoverable = BC127_STATE_ON;
+        } else if (strcmp(msgBuf[3], "DISCOVERABLE[OFF]") == 0) {
+            bt->discoverable = BC127_STATE_OFF;
+        }
+        LogDebug(LOG_SOURCE_BT, "BT: Got Status %s %s", msgBuf[2], msgBuf[3]);
+    } else {
+        // The BT Radio is off, likely meaning a reboot
+        EventTriggerCallback(BC127Event_BootStatus, 0);
+    }
+}
+
+/**
+ * BC127ProcessOk()
+ *     Description:
+ *         The command in flight succeeded
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessOk(BC127_t *bt, char **msgBuf)
+{
+    BC127CommandComplete(bt, BC127_CMD_RESPONSE_OK, BC127_CMD_STATUS_OK);
+}
+
+/**
+ * BC127ProcessError()
+ *     Description:
+ *         The command in flight was rejected
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char **msgBuf - The tokens of the message, the verb first
+ *     Returns:
+ *         void
+ */
+static void BC127ProcessError(BC127_t *bt, char **msgBuf)
+{
+    BC127CommandComplete(bt, BC127_CMD_RESPONSE_OK, BC127_CMD_STATUS_ERROR);
+}
+
+/*
+ * The messages that we act on, by their first token. Messages that end in
+ * free text are split into fewer tokens, so that the text stays whole.
+ */
+static const BC127Verb_t BC127Verbs[] = {
+    {"A2DP_STREAM_START", BC127_MSG_TOKENS_MAX, &BC127ProcessA2DPStreamStart},
+    {"A2DP_STREAM_SUSPEND", BC127_MSG_TOKENS_MAX, &BC127ProcessA2DPStreamSuspend},
+    {"AVRCP_MEDIA", 4, &BC127ProcessAVRCPMedia},
+    {"AVRCP_PAUSE", BC127_MSG_TOKENS_MAX, &BC127ProcessAVRCPPause},
+    {"AVRCP_PLAY", BC127_MSG_TOKENS_MAX, &BC127ProcessAVRCPPlay},
+    {"Build:", BC127_MSG_TOKENS_MAX, &BC127ProcessBuild},
+    {"CALL_ACTIVE", BC127_MSG_TOKENS_MAX, &BC127ProcessCallActive},
+    {"CALL_END", BC127_MSG_TOKENS_MAX, &BC127ProcessCallEnd},
+    {"CALL_INCOMING", BC127_MSG_TOKENS_MAX, &BC127ProcessCallIncoming},
+    {"CALL_OUTGOING", BC127_MSG_TOKENS_MAX, &BC127ProcessCallOutgoing},
+    {"CLOSE_OK", BC127_MSG_TOKENS_MAX, &BC127ProcessCloseOk},
+    {"ERROR", BC127_MSG_TOKENS_MAX, &BC127ProcessError},
+    {"LINK", BC127_MSG_TOKENS_MAX, &BC127ProcessLink},
+    {"LIST", BC127_MSG_TOKENS_MAX, &BC127ProcessList},
+    {"NAME", 3, &BC127ProcessName},
+    {"OK", BC127_MSG_TOKENS_MAX, &BC127ProcessOk},
+    {"OPEN_ERROR", BC127_MSG_TOKENS_MAX, &BC127ProcessOpenError},
+    {"OPEN_OK", BC127_MSG_TOKENS_MAX, &BC127ProcessOpenOk},
+    {"SCO_CLOSE", BC127_MSG_TOKENS_MAX, &BC127ProcessSCOClose},
+    {"SCO_OPEN", BC127_MSG_TOKENS_MAX, &BC127ProcessSCOOpen},
+    {"STATE", BC127_MSG_TOKENS_MAX, &BC127ProcessState}
+};
+#define BC127_VERBS_COUNT (sizeof(BC127Verbs) / sizeof(BC127Verbs[0]))
+
+/**
+ * BC127GetVerb()
+ *     Description:
+ *         Find the handler for the first token of a message. The first
+ *         character rules out most of the verbs, so a full comparison is only
+ *         made for the few that share it.
+ *     Params:
+ *         const char *verb - The first token of the message
+ *     Returns:
+ *         const BC127Verb_t * - The verb, or 0 if we do not act on it
+ */
+const BC127Verb_t *BC127GetVerb(const char *verb)
+{
+    uint8_t idx;
+    for (idx = 0; idx < BC127_VERBS_COUNT; idx++) {
+        const BC127Verb_t *candidate = &BC127Verbs[idx];
+        if (candidate->name[0] == verb[0] && strcmp(candidate->name, verb) == 0) {
+            return candidate;
+        }
+    }
+    return 0;
+}
+
+/**
+ * BC127Process()
+ *     Description:
+ *         Read the RX queue and process the messages into meaningful data
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *     Returns:
+ *         uint8_t - 1 if a message was processed, 0 otherwise
+ */
+uint8_t BC127Process(BC127_t *bt)
+{
+    uint16_t messageLength = CharQueueSeekLine(
+        &bt->uart.rxQueue,
+        BC127_MSG_END_CHAR
+    );
+    if (messageLength > 0) {
+        char msg[messageLength];
+        CharQueueRead(&bt->uart.rxQueue, (unsigned char *) msg, messageLength);
+        // The protocol states that 0x0D delimits messages,
+        // so we change it to a null terminator instead
+        msg[messageLength - 1] = '\0';
+        LogDebug(LOG_SOURCE_BT, "BT: %s", msg);
+        // Split off the verb first, since it decides how far to split the
+        // rest of the message
+        char *msgBuf[BC127_MSG_TOKENS_MAX];
+        BC127Tokenize(msg, msgBuf, 2);
+        const BC127Verb_t *verb = BC127GetVerb(msgBuf[0]);
+        if (verb != 0) {
+            BC127Tokenize(msgBuf[1], &msgBuf[1], verb->tokens - 1);
+            verb->handler(bt, msgBuf);
+        }
+        // Reset the age of the Rx queue
+        bt->rxQueueAge = 0;
+    } else if (CharQueueGetSize(&bt->uart.rxQueue) > 0) {
+        if (bt->rxQueueAge == 0) {
+            bt->rxQueueAge = TimerGetMillis();
+        } else {
+            if ((TimerGetMillis() - bt->rxQueueAge) > BC127_RX_QUEUE_TIMEOUT) {
+                UARTRXQueueReset(&bt->uart);
+                bt->rxQueueAge = 0;
+                LogInfo(LOG_SOURCE_BT, "BT: RX Queue Timeout");
+            }
+        }
+    }
+    /* Sometimes there is not more than a Title or Album, which does not give
+     * us sufficient information to push a metadata update. Sometimes, this is
+     * because the data is stuck in a buffer, and other times it's because it's
+     * not available. Therefore, we send a blank command to try to push data
+     * out of the buffer. Otherwise, request the full metadata if we have
+     * partial metadata for more than the specified timeout value.
+     **/
+    uint32_t now = TimerGetMillis();
+    if ((now - bt->metadataTimestamp) > BC127_METADATA_TIMEOUT &&
+        bt->metadataStatus == BC127_METADATA_STATUS_NEW &&
+        bt->activeDevice.avrcpLinkId != 0
+    ) {
+        BC127CommandGetMetadata(bt);
+        bt->metadataTimestamp = now;
+    }
+    BC127CommandProcess(bt);
+    UARTReportErrors(&bt->uart);
+    if (messageLength > 0) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * BC127SendCommand()
+ *     Description:
+ *         Queue a command for the BC127. Commands go out one at a time, each
+ *         once the previous one has been answered, so that none are lost
+ *         to a full UART or to a module that is still busy.
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *         char *command - A command to send, with null termination included
+ *     Returns:
+ *         void
+ */
+void BC127SendCommand(BC127_t *bt, char *command)
+{
+    uint16_t length = strlen(command);
+    uint16_t space = CHAR_QUEUE_SIZE - CharQueueGetSize(&BC127Commands.pending);
+    if (length >= BC127_CMD_MAX_LENGTH || space < length + 1) {
+        BC127Commands.dropped++;
+        LogError("BT: Command '%s' dropped", command);
+        return;
+    }
+    CharQueueWrite(&BC127Commands.pending, (unsigned char *) command, length);
+    CharQueueAdd(&BC127Commands.pending, BC127_MSG_END_CHAR);
+    BC127Commands.pendingCount++;
+    BC127CommandProcess(bt);
+}
+
+/**
+ * BC127SendCommandEmpty()
+ *     Description:
+ *         Send a carriage return over UART, in turn with the other commands
+ *     Params:
+ *         BC127_t *bt - A pointer to the module object
+ *     Returns:
+ *         void
+ */
+void BC127SendCommandEmpty(BC127_t *bt)
+{
+    BC127SendCommand(bt, "");
+}
+
+/** Begin BC127 Paired Device Implementation **/
+
+/**
+ * BC127PairedDeviceHash()
+ *     Description:
+ *         Get the index slot for a MAC ID. The last three bytes of a MAC ID
+ *         are assigned per device, while the first three name the vendor,
+ *         so only the last three are hashed.
+ *     Params:
+ *         uint8_t *macId - The MAC ID
+ *     Returns:
+ *         uint8_t - The slot in the paired device index
+ */
+static uint8_t BC127PairedDeviceHash(uint8_t *macId)
+{
+    return (macId[3] ^ macId[4] ^ macId[5]) &
+        (BC127_PAIRED_DEVICE_INDEX_SIZE - 1);
+}
+
+/**
+ * BC127PairedDeviceInit()
+ *     Description:
+ *         Initialize a pairing profile if one does not exist
+ *     Params:
+ *         BC127_t *bt
+ *         uint8_t *macId
+ *         char *deviceName
+ *     Returns:
+ *         Void
+ */
+void BC127PairedDeviceInit(BC127_t *bt, uint8_t *macId, char *deviceName)
+{
+    if (BC127PairedDeviceFind(bt, macId) != -1 ||
+        bt->pairedDevicesCount >= BC127_MAX_DEVICE_PAIRED
+    ) {
+        return;
+    }
+    // Intern the name first, since the pool may be compacted to make room
+    char *name = BC127NamePoolIntern(bt, deviceName);
+    uint8_t idx = bt->pairedDevicesCount++;
+    memcpy(bt->pairedDevices[idx].macId, macId, BC127_MAC_ID_LENGTH);
+    bt->pairedDevices[idx].deviceName = name;
+    // The index has twice as many slots as there are devices, so there is
+    // always a free one
+    uint8_t slot = BC127PairedDeviceHash(macId);
+    while (bt->pairedDevicesIndex[slot] != -1) {
+        slot = (slot + 1) & (BC127_PAIRED_DEVICE_INDEX_SIZE - 1);
+    }
+    bt->pairedDevicesIndex[slot] = idx;
+}
+
+/**
+ * BC127PairedDeviceFind()
+ *     Description:
+ *         Look a device up by its MAC ID in the paired device index
+ *     Params:
+ *         BC127_t *bt
+ *         uint8_t *macId
+ *     Returns:
+ *         int8_t - The index of the device in pairedDevices, or -1
+ */
+int8_t BC127PairedDeviceFind(BC127_t *bt, uint8_t *macId)
+{
+    uint8_t slot = BC127PairedDeviceHash(macId);
+    uint8_t probes;
+    for (probes = 0; probes < BC127_PAIRED_DEVICE_INDEX_SIZE; probes++) {
+        int8_t idx = bt->pairedDevicesIndex[slot];
+        if (idx == -1) {
+            return -1;
+        }
+        if (memcmp(bt->pairedDevices[idx].macId, macId, BC127_MAC_ID_LENGTH) == 0) {
+            return idx;
+        }
+        slot = (slot + 1) & (BC127_PAIRED_DEVICE_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+/**
+ * BC127PairedDeviceGetName()
+ *     Description:
+ *         Get the name of a device from its MAC ID
+ *     Params:
+ *         BC127_t *bt
+ *         uint8_t *macId
+ *     Returns:
+ *         char * - A pointer to the device name
+ */
+char *BC127PairedDeviceGetName(BC127_t *bt, uint8_t *macId)
+{
+    int8_t idx = BC127PairedDeviceFind(bt, macId);
+    if (idx == -1) {
+        return 0;
+    }
+    return bt->pairedDevices[idx].deviceName;
+}
+
+/** Begin BC127 Name Pool Implementation **/
+
+/**
+ * BC127NamePoolCompact()
+ *     Description:
+ *         Drop the names that no device points to anymore, and move the
+ *         rest to the front of the pool
+ *     Params:
+ *         BC127_t *bt
+ *     Returns:
+ *         void
+ */
+static void BC127NamePoolCompact(BC127_t *bt)
+{
+    uint16_t readIdx = 1;
+    uint16_t writeIdx = 1;
+    while (readIdx < BC127NamePoolLength) {
+        char *name = &BC127NamePool[readIdx];
+        char *newName = &BC127NamePool[writeIdx];
+        uint16_t length = strlen(name) + 1;
+        uint8_t isUsed = 0;
+        uint8_t idx;
+        for (idx = 0; idx < bt->pairedDevicesCount; idx++) {
+            if (bt->pairedDevices[idx].deviceName == name) {
+                bt->pairedDevices[idx].deviceName = newName;
+                isUsed = 1;
+            }
+        }
+        if (bt->activeDevice.deviceName == name) {
+            bt->activeDevice.deviceName = newName;
+            isUsed = 1;
+        }
+        if (isUsed == 1) {
+            memmove(newName, name, length);
+            writeIdx += length;
+        }
+        readIdx += length;
+    }
+    memset(&BC127NamePool[writeIdx], 0, BC127NamePoolLength - writeIdx);
+    BC127NamePoolLength = writeIdx;
+}
+
+/**
+ * BC127NamePoolIntern()
+ *     Description:
+ *         Get the pooled copy of a device name, adding it to the pool if it
+ *         is not there yet. If the pool cannot fit the name, even after
+ *         dropping the unused names, the blank name is returned.
+ *     Params:
+ *         BC127_t *bt
+ *         char *name - The name, of which at most 32 characters are kept
+ *     Returns:
+ *         char * - The pooled name
+ */
+char *BC127NamePoolIntern(BC127_t *bt, char *name)
+{
+    uint16_t length = 0;
+    while (name[length] != '\0' && length < BC127_NAME_MAX_LENGTH) {
+        length++;
+    }
+    if (length == 0) {
+        return BC127NamePool;
+    }
+    uint16_t idx = 1;
+    while (idx < BC127NamePoolLength) {
+        char *poolName = &BC127NamePool[idx];
+        if (strncmp(poolName, name, length) == 0 && poolName[length] == '\0') {
+            return poolName;
+        }
+        idx += strlen(poolName) + 1;
+    }
+    if (BC127NamePoolLength + length + 1 > BC127_NAME_POOL_SIZE) {
+        BC127NamePoolCompact(bt);
+        if (BC127NamePoolLength + length + 1 > BC127_NAME_POOL_SIZE) {
+            LogWarning("BT: No room to store the name %s", name);
+            return BC127NamePool;
+        }
+    }
+    char *poolName = &BC127NamePool[BC127NamePoolLength];
+    memcpy(poolName, name, length);
+    poolName[length] = '\0';
+    BC127NamePoolLength += length + 1;
+    return poolName;
+}
+
+/** Begin BC127 MAC ID Implementation **/
+
+/**
+ * BC127MacIdFormat()
+ *     Description:
+ *         Write a MAC ID out as the 12 hexadecimal characters that the BC127
+ *         uses for it
+ *     Params:
+ *         char *macIdText - Where to write the text, 13 bytes long
+ *         uint8_t *macId - The MAC ID
+ *     Returns:
+ *         void
+ */
+void BC127MacIdFormat(char *macIdText, uint8_t *macId)
+{
+    snprintf(
+        macIdText,
+        13,
+        "%02X%02X%02X%02X%02X%02X",
+        macId[0],
+        macId[1],
+        macId[2],
+        macId[3],
+        macId[4],
+        macId[5]
+    );
+}
+
+/**
+ * BC127MacIdIsEmpty()
+ *     Description:
+ *         Check if a MAC ID is all zeros, meaning that it is not set
+ *     Params:
+ *         uint8_t *macId - The MAC ID
+ *     Returns:
+ *         uint8_t - 1 if the MAC ID is not set, 0 otherwise
+ */
+uint8_t BC127MacIdIsEmpty(uint8_t *macId)
+{
+    uint8_t idx;
+    for (idx = 0; idx < BC127_MAC_ID_LENGTH; idx++) {
+        if (macId[idx] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * BC127MacIdParse()
+ *     Description:
+ *         Read a MAC ID from the 12 hexadecimal characters that the BC127
+ *         sends it as
+ *     Params:
+ *         uint8_t *macId - Where to store the MAC ID
+ *         char *macIdText - The text to read
+ *     Returns:
+ *         uint8_t - 1 if the text was a MAC ID, 0 otherwise. The MAC ID is
+ *             zeroed if the text was not a MAC ID.
+ */
+uint8_t BC127MacIdParse(uint8_t *macId, char *macIdText)
+{
+    uint8_t idx;
+    memset(macId, 0, BC127_MAC_ID_LENGTH);
+    for (idx = 0; idx < BC127_MAC_ID_LENGTH * 2; idx++) {
+        char c = macIdText[idx];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else {
+            memset(macId, 0, BC127_MAC_ID_LENGTH);
+            return 0;
         }
+        macId[idx / 2] = (macId[idx / 2] << 4) | nibble;
     }
-    return deviceName;
+    return 1;
 }
 
 /** Begin BC127 Connection Implementation **/
@@ -1489,8 +2560,8 @@ char *BC127PairedDeviceGetName(BC127_t *bt, char *macId)
 BC127Connection_t BC127ConnectionInit()
 {
     BC127Connection_t conn;
-    memset(conn.macId, 0, 13);
-    memset(conn.deviceName, 0, 33);
+    memset(conn.macId, 0, BC127_MAC_ID_LENGTH);
+    conn.deviceName = BC127NamePool;
     conn.deviceId = 0;
     conn.a2dpLinkId = 0;
     conn.avrcpLinkId = 0;
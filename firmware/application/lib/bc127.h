@@ -12,6 +12,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "../mappings.h"
+#include "char_queue.h"
 #include "log.h"
 #include "event.h"
 #include "uart.h"
@@ -27,24 +28,38 @@
 #define BC127_CALL_SCO_CLOSE 4
 #define BC127_CALL_SCO_OPEN 5
 #define BC127_CLOSE_ALL 255
+#define BC127_CMD_MAX_LENGTH 128
+#define BC127_CMD_RETRIES 2
+#define BC127_CMD_TIMEOUT 1000
+#define BC127_CMD_OPEN_TIMEOUT 6000 // Paging a device that is out of range
+#define BC127_CMD_BOOT_TIMEOUT 5000
+#define BC127_CMD_RESPONSE_OK 0
+#define BC127_CMD_RESPONSE_BOOT 1
+#define BC127_CMD_RESPONSE_OPEN 2 // OK, and then OPEN_OK or OPEN_ERROR
+#define BC127_CMD_OPEN_QUEUE_SIZE 4
+#define BC127_CMD_OPEN_PROFILE_LENGTH 8
+#define BC127_CMD_STATUS_OK 0
+#define BC127_CMD_STATUS_ERROR 1
 #define BC127_CONFIG_STATE_NEVER "0"
 #define BC127_CONFIG_STATE_ALWAYS "1"
 #define BC127_CONFIG_STATE_STARTUP "2"
 #define BC127_CONN_STATE_NEW 0
 #define BC127_CONN_STATE_CONNECTED 1
 #define BC127_CONN_STATE_DISCONNECTED 2
+#define BC127_MAC_ID_LENGTH 6
 #define BC127_MAX_DEVICE_PAIRED 8
 #define BC127_MAX_DEVICE_PROFILES 5
 #define BC127_METADATA_FIELD_SIZE 128
-#define BC127_METADATA_TITLE_OFFSET 22
-#define BC127_METADATA_ARTIST_OFFSET 23
-#define BC127_METADATA_ALBUM_OFFSET 22
 #define BC127_METADATA_STATUS_NEW 1
 #define BC127_METADATA_STATUS_CUR 2
 #define BC127_METADATA_TIMEOUT 500
 #define BC127_MSG_END_CHAR 0x0D
 #define BC127_MSG_LF_CHAR 0x0A
 #define BC127_MSG_DELIMETER 0x20
+#define BC127_MSG_TOKENS_MAX 6
+#define BC127_NAME_MAX_LENGTH 32
+#define BC127_NAME_POOL_SIZE 256
+#define BC127_PAIRED_DEVICE_INDEX_SIZE 16
 #define BC127_SHORT_NAME_MAX_LEN 8
 #define BC127_STATE_OFF 0
 #define BC127_STATE_ON 1
@@ -63,18 +78,19 @@
 #define BC127Event_DeviceFound 6
 #define BC127Event_CallStatus 7
 #define BC127Event_BootStatus 8
+#define BC127Event_DeviceLinkFailed 9
 extern int8_t BC127CVCGainTable[];
 /**
  * BC127PairedDevice_t
  *     Description:
  *         This object defines a previously paired device
  *     Fields:
- *         macId - The MAC ID of the device (12 hexadecimal characters)
- *         deviceName - The friendly name of the device (32 ASCII characters)
+ *         macId - The MAC ID of the device (6 bytes, binary)
+ *         deviceName - The friendly name of the device, in the name pool
  */
 typedef struct BC127PairedDevice_t {
-    char macId[13];
-    char deviceName[33];
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    char *deviceName;
 } BC127PairedDevice_t;
 
 /**
@@ -82,8 +98,8 @@ typedef struct BC127PairedDevice_t {
  *     Description:
  *         This object defines the actively connected device
  *     Fields:
- *         macId - The MAC ID of the device (12 hexadecimal characters)
- *         deviceName - The friendly name of the device (32 ASCII characters)
+ *         macId - The MAC ID of the device (6 bytes, binary)
+ *         deviceName - The friendly name of the device, in the name pool
  *         playbackStatus - Current Playback status - BC127_AVRCP_STATUS_PAUSED
  *                          or BC127_AVRCP_STATUS_PLAYING
  *         title - The title of the currently playing media
@@ -95,8 +111,8 @@ typedef struct BC127PairedDevice_t {
  *         hfpLinkId - The Melody Link ID for the HFP connection
  */
 typedef struct BC127Connection_t {
-    char macId[13];
-    char deviceName[33];
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    char *deviceName;
     uint8_t deviceId;
     uint8_t avrcpLinkId;
     uint8_t a2dpLinkId;
@@ -118,12 +134,17 @@ typedef struct BC127Connection_t {
  *         metadataStatus - Tracks if the metadata is new, so we can publish it
  *         pairedDevicesCount - The number of devices that have paired with us
  *            in all of time. The max is 8.
+ *         pairedDevicesIndex - An open addressed hash index of the paired
+ *            devices by MAC ID. Each slot holds an index into pairedDevices,
+ *            or -1 if it is free.
  *         pairingErrors - The key indicates the profile in error and the value
  *             in error. This is used to track what profiles we need to re-attempt
  *             a connection with.
  *         callStatus - The call status
  *         metadataStatus - Tracks the state of the metadata through the process
  *             of gathering it from the device
+ *         title / artist / album - The metadata as it comes in from the
+ *             device. The UIs read BC127GetMetadata() instead.
  *         playbackStatus - If we're paused or playing
  *         scoStatus - If the SCO channel is open or closed
  *         rxQueueAge - Used to track how long data has been sitting on the
@@ -135,6 +156,7 @@ typedef struct BC127_t {
     uint8_t connectable;
     uint8_t discoverable;
     uint8_t pairedDevicesCount;
+    int8_t pairedDevicesIndex[BC127_PAIRED_DEVICE_INDEX_SIZE];
     uint8_t pairingErrors[BC127_PROFILE_COUNT];
     uint8_t callStatus;
     uint8_t metadataStatus;
@@ -148,6 +170,122 @@ typedef struct BC127_t {
     UART_t uart;
 } BC127_t;
 
+/**
+ * BC127OpenCommand_t
+ *     Description:
+ *         A profile that we asked the BC127 to open to a device
+ *     Fields:
+ *         macId - The device
+ *         profile - The profile, as the BC127 names it
+ */
+typedef struct BC127OpenCommand_t {
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    char profile[BC127_CMD_OPEN_PROFILE_LENGTH];
+} BC127OpenCommand_t;
+
+/**
+ * BC127CommandQueue_t
+ *     Description:
+ *         This object tracks the commands sent to the BC127. The module
+ *         answers commands in order without saying which command it answers,
+ *         so one command is in flight at a time and the rest wait their turn.
+ *         OPEN is first answered by OK or ERROR like any other command, and
+ *         then by OPEN_OK or OPEN_ERROR, which name the profile. Paging a
+ *         device that is not around takes seconds, so once its OK is in, the
+ *         OPEN waits for the rest in a slot of its own and the other
+ *         commands go ahead.
+ *     Fields:
+ *         pending - The commands waiting to be sent, each ended by
+ *             BC127_MSG_END_CHAR
+ *         pendingCount - The number of commands waiting to be sent
+ *         inFlight - The command waiting on its response
+ *         inFlightLength - The length of the command in flight, 0 if none
+ *         inFlightResponse - The BC127_CMD_RESPONSE_* that answers it
+ *         inFlightRetries - The number of times it was sent again
+ *         sentAt - When the command in flight was last sent
+ *         opens - The OPEN commands, the one in flight first
+ *         opensHead - The index of the first OPEN command
+ *         opensCount - The number of OPEN commands queued or in flight
+ *         openInFlight - 1 if the first OPEN command was answered by OK and
+ *             waits for OPEN_OK or OPEN_ERROR
+ *         openSentAt - When the OPEN command in flight was sent
+ *         sent - The number of commands sent
+ *         completed - The number of commands that succeeded
+ *         errors - The number of commands that the module rejected
+ *         timeouts - The number of commands that were never answered
+ *         retries - The number of times a command was sent again
+ *         dropped - The number of commands that did not fit in the queue
+ *         latencyTotal - The summed round trip time of the completed commands
+ *         latencyMax - The longest round trip time of a completed command
+ */
+typedef struct BC127CommandQueue_t {
+    CharQueue_t pending;
+    uint8_t pendingCount;
+    char inFlight[BC127_CMD_MAX_LENGTH];
+    uint8_t inFlightLength;
+    uint8_t inFlightResponse;
+    uint8_t inFlightRetries;
+    uint32_t sentAt;
+    BC127OpenCommand_t opens[BC127_CMD_OPEN_QUEUE_SIZE];
+    uint8_t opensHead;
+    uint8_t opensCount;
+    uint8_t openInFlight;
+    uint32_t openSentAt;
+    uint32_t sent;
+    uint32_t completed;
+    uint16_t errors;
+    uint16_t timeouts;
+    uint16_t retries;
+    uint16_t dropped;
+    uint32_t latencyTotal;
+    uint16_t latencyMax;
+} BC127CommandQueue_t;
+
+/**
+ * BC127Metadata_t
+ *     Description:
+ *         The metadata of the playing track, made ready for display once per
+ *         change so that all of the UIs can share it
+ *     Fields:
+ *         title - The title, without non-ASCII characters
+ *         artist - The artist, without non-ASCII characters
+ *         album - The album, without non-ASCII characters
+ *         text - "Title - Artist on Album", leaving out the missing fields
+ *         gtText - "Title - Artist - Album", for the GT title area
+ *         hash - A hash of the raw fields, used to tell if new metadata is
+ *             any different from what we have
+ *         version - Incremented each time the metadata changes
+ *         republish - Set when the metadata was asked for, so that the next
+ *             set is published even if it did not change
+ */
+typedef struct BC127Metadata_t {
+    char title[BC127_METADATA_FIELD_SIZE];
+    char artist[BC127_METADATA_FIELD_SIZE];
+    char album[BC127_METADATA_FIELD_SIZE];
+    char text[UTILS_DISPLAY_TEXT_SIZE];
+    char gtText[UTILS_DISPLAY_TEXT_SIZE];
+    uint32_t hash;
+    uint16_t version;
+    uint8_t republish;
+} BC127Metadata_t;
+
+/**
+ * BC127Verb_t
+ *     Description:
+ *         This object maps the first token of a message from the BC127 to the
+ *         function that acts on it
+ *     Fields:
+ *         name - The first token of the message
+ *         tokens - The number of tokens to split the message into, the last
+ *             of which holds the rest of the message
+ *         (*handler)(BC127_t *, char **) - Called with the tokens
+ */
+typedef struct BC127Verb_t {
+    const char *name;
+    uint8_t tokens;
+    void (*handler)(BC127_t *, char **);
+} BC127Verb_t;
+
 BC127_t BC127Init();
 void BC127ClearActiveDevice(BC127_t *);
 void BC127ClearConnections(BC127_t *);
@@ -168,13 +306,13 @@ void BC127CommandCVCParams(BC127_t *, char *);
 void BC127CommandForward(BC127_t *);
 void BC127CommandForwardSeekPress(BC127_t *);
 void BC127CommandForwardSeekRelease(BC127_t *);
-void BC127CommandGetDeviceName(BC127_t *, char *);
+void BC127CommandGetDeviceName(BC127_t *, uint8_t *);
 void BC127CommandGetMetadata(BC127_t *);
 void BC127CommandList(BC127_t *);
 void BC127CommandPause(BC127_t *);
 void BC127CommandPlay(BC127_t *);
 void BC127CommandProfileClose(BC127_t *, uint8_t);
-void BC127CommandProfileOpen(BC127_t *, char *, char *);
+void BC127CommandProfileOpen(BC127_t *, uint8_t *, char *);
 void BC127CommandReset(BC127_t *);
 void BC127CommandSetAudio(BC127_t *, uint8_t, uint8_t);
 void BC127CommandSetAudioAnalog(BC127_t *, char *, char *, char *, char *);
@@ -196,14 +334,25 @@ void BC127CommandUnpair(BC127_t *);
 void BC127CommandVersion(BC127_t *);
 void BC127CommandVolume(BC127_t *, uint8_t, char *);
 void BC127CommandWrite(BC127_t *);
+BC127CommandQueue_t *BC127GetCommandStats();
+const BC127Metadata_t *BC127GetMetadata();
 uint8_t BC127GetConnectedDeviceCount(BC127_t *);
 uint8_t BC127GetDeviceId(char *);
-void BC127Process(BC127_t *);
+const BC127Verb_t *BC127GetVerb(const char *);
+uint8_t BC127Process(BC127_t *);
 void BC127SendCommand(BC127_t *, char *);
 void BC127SendCommandEmpty(BC127_t *);
+uint8_t BC127Tokenize(char *, char **, uint8_t);
+
+void BC127PairedDeviceInit(BC127_t *, uint8_t *, char *);
+int8_t BC127PairedDeviceFind(BC127_t *, uint8_t *);
+char *BC127PairedDeviceGetName(BC127_t *, uint8_t *);
+
+char *BC127NamePoolIntern(BC127_t *, char *);
 
-void BC127PairedDeviceInit(BC127_t *, char *, char *);
-char *BC127PairedDeviceGetName(BC127_t *, char *);
+void BC127MacIdFormat(char *, uint8_t *);
+uint8_t BC127MacIdIsEmpty(uint8_t *);
+uint8_t BC127MacIdParse(uint8_t *, char *);
 
 BC127Connection_t BC127ConnectionInit();
 uint8_t BC127ConnectionCloseProfile(BC127Connection_t *, char *);
@@ -18,10 +18,10 @@
 CharQueue_t CharQueueInit()
 {
     CharQueue_t queue;
-    // Initialize size, capacity and cursors
-    queue.size = 0;
+    // Initialize the cursors
     queue.readCursor = 0;
     queue.writeCursor = 0;
+    queue.seekLength = 0;
     return queue;
 }
 
@@ -29,41 +29,66 @@ CharQueue_t CharQueueInit()
  * CharQueueAdd()
  *     Description:
  *         Adds a byte to the queue. If the queue is full, the byte is discarded.
+ *         This may only be called by the producer.
  *     Params:
  *         CharQueue_t *queue - The queue
  *         const unsigned char value - The value to add
  *     Returns:
- *         None
+ *         uint8_t - 1 if the byte was added, 0 if it was discarded
  */
-void CharQueueAdd(CharQueue_t *queue, const unsigned char value)
+uint8_t CharQueueAdd(CharQueue_t *queue, const unsigned char value)
 {
-    if (queue->size != CHAR_QUEUE_SIZE) {
-        if (queue->writeCursor == CHAR_QUEUE_SIZE) {
-            queue->writeCursor = 0;
-        }
-        queue->data[queue->writeCursor] = value;
-        queue->writeCursor++;
-        queue->size++;
+    uint16_t writeCursor = queue->writeCursor;
+    if ((uint16_t) (writeCursor - queue->readCursor) == CHAR_QUEUE_SIZE) {
+        return 0;
     }
+    queue->data[writeCursor & CHAR_QUEUE_MASK] = value;
+    // The byte must be in place before the consumer can see it
+    CHAR_QUEUE_BARRIER();
+    queue->writeCursor = writeCursor + 1;
+    return 1;
 }
 
 /**
- * CharQueueGet()
+ * CharQueueGetSize()
  *     Description:
- *         Returns the byte at location idx. Returning the byte does not remove
- *         it from the queue.
+ *         Returns the amount of bytes in the queue. Either side may call this,
+ *         as the consumer will only ever see the size grow and the producer
+ *         will only ever see it shrink.
  *     Params:
- *         CharQueue_t queue - The queue
- *         uint16_t idx - The index to return data for
+ *         CharQueue_t *queue - The queue
  *     Returns:
- *         unsigned char
+ *         uint16_t - The amount of bytes in the queue
  */
-unsigned char CharQueueGet(CharQueue_t *queue, uint16_t idx)
+uint16_t CharQueueGetSize(CharQueue_t *queue)
 {
-    if (idx >= CHAR_QUEUE_SIZE) {
-        return 0x00;
+    return (uint16_t) (queue->writeCursor - queue->readCursor);
+}
+
+/**
+ * CharQueueGetSpan()
+ *     Description:
+ *         Points the caller at the contiguous run of readable bytes that
+ *         starts at the read cursor. Since the queue is a ring, this may be
+ *         shorter than the queue size, in which case the rest of the data
+ *         starts at the beginning of the array. The bytes remain in the queue
+ *         until CharQueueSkip() is called. This may only be called by the
+ *         consumer.
+ *     Params:
+ *         CharQueue_t *queue - The queue
+ *         unsigned char **span - Set to the first readable byte
+ *     Returns:
+ *         uint16_t - The amount of contiguous readable bytes
+ */
+uint16_t CharQueueGetSpan(CharQueue_t *queue, unsigned char **span)
+{
+    uint16_t offset = queue->readCursor & CHAR_QUEUE_MASK;
+    uint16_t size = CharQueueGetSize(queue);
+    *span = &queue->data[offset];
+    if (size > CHAR_QUEUE_SIZE - offset) {
+        return CHAR_QUEUE_SIZE - offset;
     }
-    return queue->data[idx];
+    return size;
 }
 
 /**
@@ -71,7 +96,7 @@ unsigned char CharQueueGet(CharQueue_t *queue, uint16_t idx)
  *     Description:
  *         Shifts the next byte in the queue out, as seen by the read cursor.
  *         Once the byte is returned, it should be considered destroyed from the
- *         queue.
+ *         queue. This may only be called by the consumer.
  *     Params:
  *         CharQueue_t queue - The queue
  *     Returns:
@@ -79,44 +104,58 @@ unsigned char CharQueueGet(CharQueue_t *queue, uint16_t idx)
  */
 unsigned char CharQueueNext(CharQueue_t *queue)
 {
-    unsigned char data = queue->data[queue->readCursor];
-    // Remove the byte from memory
-    queue->data[queue->readCursor] = 0x00;
-    queue->readCursor++;
-    if (queue->readCursor >= CHAR_QUEUE_SIZE) {
-        queue->readCursor = 0;
+    uint16_t readCursor = queue->readCursor;
+    if (readCursor == queue->writeCursor) {
+        return 0x00;
     }
-    if (queue->size > 0) {
-        queue->size--;
+    unsigned char data = queue->data[readCursor & CHAR_QUEUE_MASK];
+    // The slot must be read before the producer can reuse it
+    CHAR_QUEUE_BARRIER();
+    queue->readCursor = readCursor + 1;
+    if (queue->seekLength > 0) {
+        queue->seekLength--;
     }
     return data;
 }
 
 /**
- * CharQueueRemoveLast()
+ * CharQueueRead()
  *     Description:
- *         Remove the last character in the buffer
+ *         Copies up to length bytes out of the queue and removes them from it
+ *         with a single update of the read cursor. This may only be called by
+ *         the consumer.
  *     Params:
- *         CharQueue_t queue - The queue
+ *         CharQueue_t *queue - The queue
+ *         unsigned char *buffer - The buffer to copy into
+ *         uint16_t length - The maximum amount of bytes to copy
  *     Returns:
- *         void
+ *         uint16_t - The amount of bytes copied
  */
-void CharQueueRemoveLast(CharQueue_t *queue)
-{
-    if (queue->size > 0) {
-        queue->size--;
-        if (queue->writeCursor == 0) {
-            queue->writeCursor = CHAR_QUEUE_SIZE - 1;
-        } else {
-            queue->writeCursor--;
-        }
+uint16_t CharQueueRead(
+    CharQueue_t *queue,
+    unsigned char *buffer,
+    uint16_t length
+) {
+    uint16_t size = CharQueueGetSize(queue);
+    if (length > size) {
+        length = size;
     }
+    uint16_t offset = queue->readCursor & CHAR_QUEUE_MASK;
+    uint16_t firstLength = CHAR_QUEUE_SIZE - offset;
+    if (firstLength > length) {
+        firstLength = length;
+    }
+    memcpy(buffer, &queue->data[offset], firstLength);
+    memcpy(&buffer[firstLength], queue->data, length - firstLength);
+    CharQueueSkip(queue, length);
+    return length;
 }
 
 /**
  * CharQueueReset()
  *     Description:
- *         Empty a char queue
+ *         Empty a char queue by discarding everything that has been added to
+ *         it so far. This may only be called by the consumer.
  *     Params:
  *         CharQueue_t queue - The queue
  *     Returns:
@@ -124,10 +163,8 @@ void CharQueueRemoveLast(CharQueue_t *queue)
  */
 void CharQueueReset(CharQueue_t *queue)
 {
-    memset(queue->data, 0, CHAR_QUEUE_SIZE);
-    queue->readCursor = 0;
-    queue->size = 0;
-    queue->writeCursor = 0;
+    queue->readCursor = queue->writeCursor;
+    queue->seekLength = 0;
 }
 
 /**
@@ -145,18 +182,108 @@ void CharQueueReset(CharQueue_t *queue)
 uint16_t CharQueueSeek(CharQueue_t *queue, const unsigned char needle)
 {
     uint16_t readCursor = queue->readCursor;
-    uint16_t size = queue->size;
+    uint16_t size = CharQueueGetSize(queue);
     uint16_t cnt = 1;
     while (size > 0) {
-        if (queue->data[readCursor] == needle) {
+        if (queue->data[readCursor & CHAR_QUEUE_MASK] == needle) {
             return cnt;
         }
-        if (readCursor >= CHAR_QUEUE_SIZE) {
-            readCursor = 0;
-        }
         cnt++;
         size--;
         readCursor++;
     }
     return 0;
 }
+
+/**
+ * CharQueueSeekLine()
+ *     Description:
+ *         Checks if a complete line, terminated by the given delimiter, is in
+ *         the queue and returns its length. Unlike CharQueueSeek(), only the
+ *         bytes added since the last call are searched, so polling for a line
+ *         that has only partially arrived costs nothing. A queue should only
+ *         ever be polled for a single delimiter through this function.
+ *     Params:
+ *         CharQueue_t *queue - The queue
+ *         const unsigned char delimiter - The character that ends a line
+ *     Returns:
+ *         uint16_t - The length of the line, including the delimiter, or zero
+ *                   if no complete line is available
+ */
+uint16_t CharQueueSeekLine(CharQueue_t *queue, const unsigned char delimiter)
+{
+    uint16_t size = CharQueueGetSize(queue);
+    uint16_t cursor = queue->readCursor + queue->seekLength;
+    while (queue->seekLength < size) {
+        if (queue->data[cursor & CHAR_QUEUE_MASK] == delimiter) {
+            return queue->seekLength + 1;
+        }
+        queue->seekLength++;
+        cursor++;
+    }
+    return 0;
+}
+
+/**
+ * CharQueueSkip()
+ *     Description:
+ *         Removes length bytes from the queue without reading them, i.e.
+ *         after they have been consumed through CharQueueGetSpan(). This may
+ *         only be called by the consumer.
+ *     Params:
+ *         CharQueue_t *queue - The queue
+ *         uint16_t length - The amount of bytes to remove
+ *     Returns:
+ *         void
+ */
+void CharQueueSkip(CharQueue_t *queue, uint16_t length)
+{
+    uint16_t size = CharQueueGetSize(queue);
+    if (length > size) {
+        length = size;
+    }
+    // The slots must be read before the producer can reuse them
+    CHAR_QUEUE_BARRIER();
+    queue->readCursor = queue->readCursor + length;
+    if (queue->seekLength > length) {
+        queue->seekLength = queue->seekLength - length;
+    } else {
+        queue->seekLength = 0;
+    }
+}
+
+/**
+ * CharQueueWrite()
+ *     Description:
+ *         Adds up to length bytes to the queue with a single update of the
+ *         write cursor. Bytes that do not fit are discarded. This may only be
+ *         called by the producer.
+ *     Params:
+ *         CharQueue_t *queue - The queue
+ *         const unsigned char *data - The bytes to add
+ *         uint16_t length - The amount of bytes to add
+ *     Returns:
+ *         uint16_t - The amount of bytes added
+ */
+uint16_t CharQueueWrite(
+    CharQueue_t *queue,
+    const unsigned char *data,
+    uint16_t length
+) {
+    uint16_t writeCursor = queue->writeCursor;
+    uint16_t space = CHAR_QUEUE_SIZE - (uint16_t) (writeCursor - queue->readCursor);
+    if (length > space) {
+        length = space;
+    }
+    uint16_t offset = writeCursor & CHAR_QUEUE_MASK;
+    uint16_t firstLength = CHAR_QUEUE_SIZE - offset;
+    if (firstLength > length) {
+        firstLength = length;
+    }
+    memcpy(&queue->data[offset], data, firstLength);
+    memcpy(queue->data, &data[firstLength], length - firstLength);
+    // The bytes must be in place before the consumer can see them
+    CHAR_QUEUE_BARRIER();
+    queue->writeCursor = writeCursor + length;
+    return length;
+}
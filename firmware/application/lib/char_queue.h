@@ -10,29 +10,45 @@
 #include <string.h>
 /* The maximum amount of elements that the queue can hold */
 #define CHAR_QUEUE_SIZE 512
+#define CHAR_QUEUE_MASK (CHAR_QUEUE_SIZE - 1)
+#if (CHAR_QUEUE_SIZE & CHAR_QUEUE_MASK) != 0
+#error "CHAR_QUEUE_SIZE must be a power of two"
+#endif
+/* Keep the compiler from moving data accesses across a cursor update */
+#define CHAR_QUEUE_BARRIER() __asm__ volatile ("" ::: "memory")
 
 /**
  * CharQueue_t
  *     Description:
- *         This object holds QUEUE_SIZE amounts of unsigned chars. It operates
- *         with a read and write cursor to keep track of where the next byte
- *         needs to be read from and where the next byte should be added.
- *         Once those cursors are exhausted, meaning they've hit capacity, they
- *         are reset. If data is not removed from the buffer before it hits
- *         capacity, the data will be lost and an error will be logged.
+ *         This object holds QUEUE_SIZE amounts of unsigned chars. It is a
+ *         single producer, single consumer ring: the producer (i.e. the UART
+ *         RX ISR, or the main loop for TX) only ever moves the write cursor
+ *         and the consumer only ever moves the read cursor, so neither side
+ *         has to disable interrupts. The cursors run freely and are masked
+ *         into the data array, so the amount of data queued is always their
+ *         difference. If data is not removed from the buffer before it hits
+ *         capacity, new data will be discarded.
+ *         seekLength tracks how many bytes past the read cursor have already
+ *         been searched by CharQueueSeekLine() without finding the delimiter,
+ *         so that partially received lines are not rescanned. It belongs to
+ *         the consumer.
  */
 typedef struct CharQueue_t {
-    uint16_t size;
-    uint16_t readCursor;
-    uint16_t writeCursor;
+    volatile uint16_t readCursor;
+    volatile uint16_t writeCursor;
+    uint16_t seekLength;
     unsigned char data[CHAR_QUEUE_SIZE];
 } CharQueue_t;
 
 struct CharQueue_t CharQueueInit();
-void CharQueueAdd(CharQueue_t *, const unsigned char);
-unsigned char CharQueueGet(CharQueue_t *, uint16_t);
+uint8_t CharQueueAdd(CharQueue_t *, const unsigned char);
+uint16_t CharQueueGetSize(CharQueue_t *);
+uint16_t CharQueueGetSpan(CharQueue_t *, unsigned char **);
 unsigned char CharQueueNext(CharQueue_t *);
-void CharQueueRemoveLast(CharQueue_t *);
+uint16_t CharQueueRead(CharQueue_t *, unsigned char *, uint16_t);
 void CharQueueReset(CharQueue_t *);
 uint16_t CharQueueSeek(CharQueue_t *, const unsigned char);
+uint16_t CharQueueSeekLine(CharQueue_t *, const unsigned char);
+void CharQueueSkip(CharQueue_t *, uint16_t);
+uint16_t CharQueueWrite(CharQueue_t *, const unsigned char *, uint16_t);
 #endif /* CHAR_QUEUE_H */
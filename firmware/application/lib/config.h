@@ -47,10 +47,12 @@
 #define CONFIG_SETTING_TCU_MODE_ADDRESS 0x37
 #define CONFIG_SETTING_MIC_GAIN_ADDRESS 0x38
 #define CONFIG_SETTING_MIC_BIAS_ADDRESS 0x39
-/* Config 0x40 - 0x50: Audio Settings */
+/* Config 0x40 - 0x49: Audio Settings */
 #define CONFIG_SETTING_AUTOPLAY_ADDRESS 0x40
 #define CONFIG_SETTING_DAC_VOL_ADDRESS 0x41
 #define CONFIG_SETTING_USE_SPDIF_INPUT_ADDRESS 0x42
+/* Config 0x4A - 0x50: Diagnostic Settings */
+#define CONFIG_SETTING_IBUS_RECORDER_ADDRESS 0x4A
 
 #define CONFIG_DEVICE_LOG_BT 2
 #define CONFIG_DEVICE_LOG_IBUS 3
@@ -82,10 +84,12 @@
 #define CONFIG_SETTING_TCU_MODE CONFIG_SETTING_TCU_MODE_ADDRESS
 #define CONFIG_SETTING_MIC_GAIN CONFIG_SETTING_MIC_GAIN_ADDRESS
 #define CONFIG_SETTING_MIC_BIAS CONFIG_SETTING_MIC_BIAS_ADDRESS
-/* Config 0x40 - 0x50: Audio Settings */
+/* Config 0x40 - 0x49: Audio Settings */
 #define CONFIG_SETTING_AUTOPLAY CONFIG_SETTING_AUTOPLAY_ADDRESS
 #define CONFIG_SETTING_DAC_VOL CONFIG_SETTING_DAC_VOL_ADDRESS
 #define CONFIG_SETTING_USE_SPDIF_INPUT CONFIG_SETTING_USE_SPDIF_INPUT_ADDRESS
+/* Config 0x4A - 0x50: Diagnostic Settings */
+#define CONFIG_SETTING_IBUS_RECORDER CONFIG_SETTING_IBUS_RECORDER_ADDRESS
 /* Data Boundry Helpers */
 #define CONFIG_SETTING_START_ADDRESS 0x1A
 #define CONFIG_SETTING_END_ADDRESS 0x50
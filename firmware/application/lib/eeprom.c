@@ -120,6 +120,44 @@ void EEPROMIsReady()
     }
 }
 
+/**
+ * EEPROMIsBusy()
+ *     Description:
+ *         Check if the EEPROM is still in a write cycle, without waiting for
+ *         it to finish
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint8_t - 1 if the EEPROM is busy, 0 otherwise
+ */
+uint8_t EEPROMIsBusy()
+{
+    EEPROM_CS_PIN = 0;
+    EEPROMSend(EEPROM_COMMAND_RDSR);
+    char status = EEPROMSend(EEPROM_COMMAND_GET);
+    EEPROM_CS_PIN = 1;
+    if (status & EEPROM_STATUS_BUSY) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * EEPROMSendAddress()
+ *     Description:
+ *         Send a full 24-bit address, as the 25LC1024 expects
+ *     Params:
+ *         uint32_t address - The memory address to send
+ *     Returns:
+ *         void
+ */
+static void EEPROMSendAddress(uint32_t address)
+{
+    EEPROMSend((address >> 16) & 0xFF);
+    EEPROMSend((address >> 8) & 0xFF);
+    EEPROMSend(address & 0xFF);
+}
+
 /**
  * EEPROMReadByte()
  *     Description:
@@ -145,6 +183,32 @@ unsigned char EEPROMReadByte(uint32_t address)
     return data;
 }
 
+/**
+ * EEPROMReadBytes()
+ *     Description:
+ *         Read a run of bytes starting at the given address. The EEPROM
+ *         moves on to the next address by itself, so any length can be read
+ *         in one go.
+ *     Params:
+ *         uint32_t address - The memory address of the first byte
+ *         unsigned char *data - Where to store the bytes
+ *         uint16_t length - The number of bytes to read
+ *     Returns:
+ *         void
+ */
+void EEPROMReadBytes(uint32_t address, unsigned char *data, uint16_t length)
+{
+    EEPROMIsReady();
+    EEPROM_CS_PIN = 0;
+    EEPROMSend(EEPROM_COMMAND_READ);
+    EEPROMSendAddress(address);
+    uint16_t idx;
+    for (idx = 0; idx < length; idx++) {
+        data[idx] = (unsigned char) EEPROMSend(EEPROM_COMMAND_GET);
+    }
+    EEPROM_CS_PIN = 1;
+}
+
 /**
  * EEPROMWriteByte()
  *     Description:
@@ -168,3 +232,31 @@ void EEPROMWriteByte(uint32_t address, unsigned char data)
     EEPROMSend(data);
     EEPROM_CS_PIN = 1;
 }
+
+/**
+ * EEPROMWritePage()
+ *     Description:
+ *         Write up to a page of bytes in a single write cycle. The data must
+ *         not cross a page boundary, since the EEPROM would wrap around to
+ *         the start of the page. This does not wait for the write cycle to
+ *         finish, so callers that must not block should check
+ *         EEPROMIsBusy() first.
+ *     Params:
+ *         uint32_t address - The memory address of the first byte
+ *         unsigned char *data - The bytes to write
+ *         uint16_t length - The number of bytes to write
+ *     Returns:
+ *         void
+ */
+void EEPROMWritePage(uint32_t address, unsigned char *data, uint16_t length)
+{
+    EEPROMEnableWrite();
+    EEPROM_CS_PIN = 0;
+    EEPROMSend(EEPROM_COMMAND_WRITE);
+    EEPROMSendAddress(address);
+    uint16_t idx;
+    for (idx = 0; idx < length; idx++) {
+        EEPROMSend(data[idx]);
+    }
+    EEPROM_CS_PIN = 1;
+}
@@ -22,10 +22,14 @@
 #define EEPROM_COMMAND_RDSR 0x05 // Read the status register
 #define EEPROM_COMMAND_GET 0x00 // Dummy byte used to retrieve data
 #define EEPROM_STATUS_BUSY 0x01 // EEPROM Busy status response
+#define EEPROM_PAGE_SIZE 256 // 25LC1024 write page
 
 void EEPROMInit();
 void EEPROMErase();
 void EEPROMIsReady();
+uint8_t EEPROMIsBusy();
 unsigned char EEPROMReadByte(uint32_t);
+void EEPROMReadBytes(uint32_t, unsigned char *, uint16_t);
 void EEPROMWriteByte(uint32_t, unsigned char);
+void EEPROMWritePage(uint32_t, unsigned char *, uint16_t);
 #endif /* EEPROM_H */
@@ -6,35 +6,80 @@
  */
 #include "event.h"
 Event_t EVENT_CALLBACKS[EVENT_MAX_CALLBACKS];
+// The number of slots that have ever been handed out
 uint8_t EVENT_CALLBACKS_COUNT = 0;
+// The first callback registered for each event type
+uint8_t EVENT_CALLBACKS_HEAD[EVENT_MAX_TYPES];
+// Slots that have been released by EventUnregisterCallback()
+uint8_t EVENT_CALLBACKS_FREE = EVENT_SLOT_NONE;
+uint16_t EVENT_OVERFLOW_COUNT = 0;
+EventQueueEntry_t EVENT_QUEUE[EVENT_QUEUE_LANES][EVENT_QUEUE_SIZE];
+uint8_t EVENT_QUEUE_READ_IDX[EVENT_QUEUE_LANES];
+EventQueueStats_t EVENT_QUEUE_STATS[EVENT_QUEUE_LANES];
+
+/**
+ * EventGetOverflowCount()
+ *     Description:
+ *         Get the amount of registrations that were refused because the
+ *         callback table was full or the event type was out of range
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint16_t - The overflow count
+ */
+uint16_t EventGetOverflowCount()
+{
+    return EVENT_OVERFLOW_COUNT;
+}
 
 /**
  * EventRegisterCallback()
  *     Description:
  *         Adds a callback of event type to the event queue. Any triggers of
  *         this event type will result in the execution of the function,
- *         with the given context being passed through.
+ *         with the given context being passed through. Callbacks run in the
+ *         order they were registered.
  *     Params:
  *         uint8_t eventType
  *         void *callback - Pointer to the function to call when triggered
  *         void *context - The object to pass to the function. This needs to be
  *         cast to the appropriate type on the functions end.
  *     Returns:
- *         void
+ *         uint8_t - The status code
  */
-void EventRegisterCallback(uint8_t eventType, void *callback, void *context)
+uint8_t EventRegisterCallback(uint8_t eventType, void *callback, void *context)
 {
-    Event_t cb;
-    cb.type = eventType;
-    cb.callback = callback;
-    cb.context = context;
-    EVENT_CALLBACKS[EVENT_CALLBACKS_COUNT++] = cb;
+    uint8_t slot = EVENT_SLOT_NONE;
+    if (eventType < EVENT_MAX_TYPES) {
+        if (EVENT_CALLBACKS_FREE != EVENT_SLOT_NONE) {
+            slot = EVENT_CALLBACKS_FREE;
+            EVENT_CALLBACKS_FREE = EVENT_CALLBACKS[slot - 1].next;
+        } else if (EVENT_CALLBACKS_COUNT < EVENT_MAX_CALLBACKS) {
+            slot = ++EVENT_CALLBACKS_COUNT;
+        }
+    }
+    if (slot == EVENT_SLOT_NONE) {
+        EVENT_OVERFLOW_COUNT++;
+        return 1;
+    }
+    Event_t *cb = &EVENT_CALLBACKS[slot - 1];
+    cb->type = eventType;
+    cb->next = EVENT_SLOT_NONE;
+    cb->callback = callback;
+    cb->context = context;
+    // Append to the end of the chain to keep the registration order
+    uint8_t *link = &EVENT_CALLBACKS_HEAD[eventType];
+    while (*link != EVENT_SLOT_NONE) {
+        link = &EVENT_CALLBACKS[*link - 1].next;
+    }
+    *link = slot;
+    return 0;
 }
 
 /**
  * EventUnregisterCallback()
  *     Description:
- *         Unregister a callback
+ *         Unregister a callback and release its slot
  *     Params:
  *         uint8_t eventType
  *         void *callback - Pointer to the function to call when triggered
@@ -43,15 +88,21 @@ void EventRegisterCallback(uint8_t eventType, void *callback, void *context)
  */
 uint8_t EventUnregisterCallback(uint8_t eventType, void *callback)
 {
-    uint8_t idx;
-    for (idx = 0; idx < EVENT_CALLBACKS_COUNT; idx++) {
-        Event_t *cb = &EVENT_CALLBACKS[idx];
-        if (cb->type == eventType &&
-            cb->callback == callback
-        ) {
+    if (eventType >= EVENT_MAX_TYPES) {
+        return 1;
+    }
+    uint8_t *link = &EVENT_CALLBACKS_HEAD[eventType];
+    while (*link != EVENT_SLOT_NONE) {
+        uint8_t slot = *link;
+        Event_t *cb = &EVENT_CALLBACKS[slot - 1];
+        if (cb->callback == callback) {
+            *link = cb->next;
             memset(cb, 0, sizeof(Event_t));
+            cb->next = EVENT_CALLBACKS_FREE;
+            EVENT_CALLBACKS_FREE = slot;
             return 0;
         }
+        link = &cb->next;
     }
     return 1;
 }
@@ -68,11 +119,127 @@ uint8_t EventUnregisterCallback(uint8_t eventType, void *callback)
  */
 void EventTriggerCallback(uint8_t eventType, unsigned char *data)
 {
-    uint8_t idx;
-    for (idx = 0; idx < EVENT_CALLBACKS_COUNT; idx++) {
-        Event_t *cb = &EVENT_CALLBACKS[idx];
-        if (cb->type == eventType) {
-            cb->callback(cb->context, data);
+    if (eventType >= EVENT_MAX_TYPES) {
+        return;
+    }
+    uint8_t slot = EVENT_CALLBACKS_HEAD[eventType];
+    while (slot != EVENT_SLOT_NONE) {
+        Event_t *cb = &EVENT_CALLBACKS[slot - 1];
+        // Callbacks may unregister themselves, so find the next one first
+        slot = cb->next;
+        cb->callback(cb->context, data);
+        // Stop if the next slot was released and reused by the callback
+        if (slot != EVENT_SLOT_NONE &&
+            (EVENT_CALLBACKS[slot - 1].callback == 0 ||
+             EVENT_CALLBACKS[slot - 1].type != eventType)
+        ) {
+            return;
+        }
+    }
+}
+
+/**
+ * EventQueueGetStats()
+ *     Description:
+ *         Get the statistics for a deferred event lane
+ *     Params:
+ *         uint8_t lane - The lane
+ *     Returns:
+ *         EventQueueStats_t * - The lane statistics
+ */
+EventQueueStats_t *EventQueueGetStats(uint8_t lane)
+{
+    return &EVENT_QUEUE_STATS[lane];
+}
+
+/**
+ * EventQueueProcess()
+ *     Description:
+ *         Trigger deferred events, highest priority lane first, until all
+ *         lanes are empty or EVENT_QUEUE_BUDGET has been spent. At least one
+ *         event is always triggered, so that the queue makes progress.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if any events were triggered, 0 otherwise
+ */
+uint8_t EventQueueProcess()
+{
+    uint32_t start = TimerGetMillis();
+    uint8_t processed = 0;
+    uint8_t lane = 0;
+    while (lane < EVENT_QUEUE_LANES) {
+        EventQueueStats_t *stats = &EVENT_QUEUE_STATS[lane];
+        if (stats->depth == 0) {
+            lane++;
+        } else {
+            uint32_t now = TimerGetMillis();
+            if (processed == 1 && (now - start) >= EVENT_QUEUE_BUDGET) {
+                return processed;
+            }
+            uint8_t idx = EVENT_QUEUE_READ_IDX[lane];
+            EventQueueEntry_t *entry = &EVENT_QUEUE[lane][idx];
+            uint16_t latency = now - entry->timestamp;
+            if (latency > stats->maxLatency) {
+                stats->maxLatency = latency;
+            }
+            stats->totalLatency += latency;
+            stats->processed++;
+            // Keep the slot reserved until the callbacks have finished with
+            // the data, since they may queue events of their own
+            if (entry->hasData == 1) {
+                EventTriggerCallback(entry->type, entry->data);
+            } else {
+                EventTriggerCallback(entry->type, 0);
+            }
+            EVENT_QUEUE_READ_IDX[lane] = (idx + 1) % EVENT_QUEUE_SIZE;
+            stats->depth--;
+            processed = 1;
+            // Higher priority events may have been queued by the callbacks
+            lane = 0;
         }
     }
+    return processed;
+}
+
+/**
+ * EventQueueTrigger()
+ *     Description:
+ *         Queue an event to be triggered from the main loop by
+ *         EventQueueProcess(). The event data is copied, so it does not need
+ *         to outlive the call. If the lane is full, or the data does not fit,
+ *         the event is triggered immediately instead.
+ *     Params:
+ *         uint8_t lane - The lane to queue the event in
+ *         uint8_t eventType - The Event type to trigger
+ *         unsigned char *data - The event data, or zero
+ *         uint8_t length - The length of the event data
+ *     Returns:
+ *         void
+ */
+void EventQueueTrigger(
+    uint8_t lane,
+    uint8_t eventType,
+    unsigned char *data,
+    uint8_t length
+) {
+    EventQueueStats_t *stats = &EVENT_QUEUE_STATS[lane];
+    if (stats->depth == EVENT_QUEUE_SIZE || length > EVENT_QUEUE_DATA_SIZE) {
+        stats->overflows++;
+        EventTriggerCallback(eventType, data);
+        return;
+    }
+    uint8_t idx = (EVENT_QUEUE_READ_IDX[lane] + stats->depth) % EVENT_QUEUE_SIZE;
+    EventQueueEntry_t *entry = &EVENT_QUEUE[lane][idx];
+    entry->type = eventType;
+    entry->timestamp = TimerGetMillis();
+    entry->hasData = 0;
+    if (data != 0) {
+        memcpy(entry->data, data, length);
+        entry->hasData = 1;
+    }
+    stats->depth++;
+    if (stats->depth > stats->maxDepth) {
+        stats->maxDepth = stats->depth;
+    }
 }
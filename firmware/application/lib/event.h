@@ -7,14 +7,82 @@
 #ifndef EVENT_H
 #define EVENT_H
 #define EVENT_MAX_CALLBACKS 192
+/* Event types are indices into the subscriber table, so they must be lower */
+#define EVENT_MAX_TYPES 80
+#define EVENT_SLOT_NONE 0
+/* Deferred events: lanes are drained in order, so lower lanes run first */
+#define EVENT_QUEUE_LANE_HIGH 0
+#define EVENT_QUEUE_LANE_LOW 1
+#define EVENT_QUEUE_LANES 2
+#define EVENT_QUEUE_SIZE 12
+#define EVENT_QUEUE_DATA_SIZE 48
+/* Time in milliseconds that EventQueueProcess() may spend per call */
+#define EVENT_QUEUE_BUDGET 2
 #include <stdint.h>
 #include <string.h>
+#include "timer.h"
+/**
+ * Event_t
+ *     Description:
+ *         A registered callback. Callbacks of the same type are chained
+ *         together through next, as are the free slots.
+ *     Fields:
+ *         type - The event type the callback is registered to
+ *         next - The slot number (index + 1) of the next callback in the chain
+ *             or EVENT_SLOT_NONE
+ *         context - The object to pass to the callback
+ *         callback - The function to call, or zero if the slot is free
+ */
 typedef struct Event_t {
     uint8_t type;
+    uint8_t next;
     void *context;
     void (*callback) (void *, unsigned char *);
 } Event_t;
-void EventRegisterCallback(uint8_t, void *, void *);
+/**
+ * EventQueueEntry_t
+ *     Description:
+ *         A deferred event, holding its own copy of the event data
+ *     Fields:
+ *         type - The event type to trigger
+ *         hasData - If data should be passed to the callbacks
+ *         timestamp - The time at which the event was queued
+ *         data - The copy of the event data
+ */
+typedef struct EventQueueEntry_t {
+    uint8_t type;
+    uint8_t hasData;
+    uint32_t timestamp;
+    unsigned char data[EVENT_QUEUE_DATA_SIZE];
+} EventQueueEntry_t;
+
+/**
+ * EventQueueStats_t
+ *     Description:
+ *         Statistics for a deferred event lane
+ *     Fields:
+ *         depth - The amount of events waiting
+ *         maxDepth - The most events that have been waiting at once
+ *         overflows - Events that were triggered immediately because the
+ *             lane was full
+ *         maxLatency - The longest time an event waited, in milliseconds
+ *         totalLatency - The sum of the time all events waited
+ *         processed - The amount of events that were triggered
+ */
+typedef struct EventQueueStats_t {
+    uint8_t depth;
+    uint8_t maxDepth;
+    uint16_t overflows;
+    uint16_t maxLatency;
+    uint32_t totalLatency;
+    uint32_t processed;
+} EventQueueStats_t;
+
+uint16_t EventGetOverflowCount();
+EventQueueStats_t *EventQueueGetStats(uint8_t);
+uint8_t EventQueueProcess();
+void EventQueueTrigger(uint8_t, uint8_t, unsigned char *, uint8_t);
+uint8_t EventRegisterCallback(uint8_t, void *, void *);
 uint8_t EventUnregisterCallback(uint8_t, void *);
 void EventTriggerCallback(uint8_t, unsigned char *);
 #endif /* EVENT_H */
@@ -4,8 +4,616 @@
  * Description:
  *     This implements the I-Bus
  */
+#include <stddef.h>
 #include "ibus.h"
 
+/*
+ * Constant frames are kept in program memory, complete with their length and
+ * checksum, which the compiler works out from the source, destination and
+ * data bytes
+ */
+#define IBUS_FRAME_1(src, dst, d0) \
+    {src, 0x03, dst, d0, (src) ^ 0x03 ^ (dst) ^ (d0)}
+#define IBUS_FRAME_2(src, dst, d0, d1) \
+    {src, 0x04, dst, d0, d1, (src) ^ 0x04 ^ (dst) ^ (d0) ^ (d1)}
+#define IBUS_FRAME_3(src, dst, d0, d1, d2) \
+    {src, 0x05, dst, d0, d1, d2, (src) ^ 0x05 ^ (dst) ^ (d0) ^ (d1) ^ (d2)}
+#define IBUS_FRAME_4(src, dst, d0, d1, d2, d3) \
+    {src, 0x06, dst, d0, d1, d2, d3, \
+     (src) ^ 0x06 ^ (dst) ^ (d0) ^ (d1) ^ (d2) ^ (d3)}
+#define IBUS_FRAME_5(src, dst, d0, d1, d2, d3, d4) \
+    {src, 0x07, dst, d0, d1, d2, d3, d4, \
+     (src) ^ 0x07 ^ (dst) ^ (d0) ^ (d1) ^ (d2) ^ (d3) ^ (d4)}
+
+static const uint8_t IBusTXMaxRetries[IBUS_TX_CLASS_COUNT] = {
+    4, // IBUS_TX_CLASS_PROTOCOL
+    4, // IBUS_TX_CLASS_CONTROL
+    1 // IBUS_TX_CLASS_DISPLAY
+};
+
+static IBusRecorder_t IBusRecorder;
+
+/**
+ * IBusRecorderSeal()
+ *     Description:
+ *         Close the page being filled and hand it over to be written, so
+ *         that the next entry starts a new page in the other buffer. The
+ *         caller makes sure that the other buffer is free.
+ *     Params:
+ *         None
+ *     Returns:
+ *         None
+ */
+static void IBusRecorderSeal()
+{
+    unsigned char *page = IBusRecorder.pages[IBusRecorder.fillPage];
+    memset(
+        &page[IBusRecorder.fillIdx],
+        0xFF,
+        EEPROM_PAGE_SIZE - IBusRecorder.fillIdx
+    );
+    IBusRecorder.flushPending = 1;
+    IBusRecorder.fillPage ^= 1;
+    IBusRecorder.fillIdx = 0;
+}
+
+/**
+ * IBusRecorderFlush()
+ *     Description:
+ *         Write the sealed page to the EEPROM if the EEPROM is free. The
+ *         page goes out in one write cycle, which the EEPROM completes on
+ *         its own, so this never waits on it.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if a page was written, 0 otherwise
+ */
+static uint8_t IBusRecorderFlush()
+{
+    if (IBusRecorder.flushPending == 0 || EEPROMIsBusy() == 1) {
+        return 0;
+    }
+    EEPROMWritePage(
+        IBUS_RECORDER_START_ADDRESS +
+            (uint32_t) IBusRecorder.nextPage * EEPROM_PAGE_SIZE,
+        IBusRecorder.pages[IBusRecorder.fillPage ^ 1],
+        EEPROM_PAGE_SIZE
+    );
+    IBusRecorder.nextPage = (IBusRecorder.nextPage + 1) % IBUS_RECORDER_PAGES;
+    IBusRecorder.flushPending = 0;
+    return 1;
+}
+
+/**
+ * IBusRecorderAdd()
+ *     Description:
+ *         Add an entry to the flight recorder. Nothing here touches the
+ *         EEPROM, so it is safe to call from the middle of frame handling.
+ *         If the page fills up while the previous page is still waiting to
+ *         be written, the entry is counted as an overrun and dropped.
+ *     Params:
+ *         uint8_t type - The IBUS_TRACE_* type of the entry
+ *         const unsigned char *data - The frame or bytes to record
+ *         uint8_t length - The number of bytes to record
+ *     Returns:
+ *         None
+ */
+static void IBusRecorderAdd(uint8_t type, const unsigned char *data, uint8_t length)
+{
+    if (IBusRecorder.enabled == 0) {
+        return;
+    }
+    uint32_t now = TimerGetMillis();
+    if (IBusRecorder.fillIdx > 0 &&
+        (IBusRecorder.fillIdx + IBUS_RECORDER_ENTRY_HEADER_SIZE + length > EEPROM_PAGE_SIZE ||
+         now - IBusRecorder.pageStamp > 0xFFFF)
+    ) {
+        if (IBusRecorder.flushPending == 1) {
+            IBusRecorder.overruns++;
+            return;
+        }
+        IBusRecorderSeal();
+    }
+    unsigned char *page = IBusRecorder.pages[IBusRecorder.fillPage];
+    if (IBusRecorder.fillIdx == 0) {
+        uint32_t sequence = IBusRecorder.sequence++;
+        page[0] = IBUS_RECORDER_MAGIC;
+        page[1] = sequence & 0xFF;
+        page[2] = (sequence >> 8) & 0xFF;
+        page[3] = (sequence >> 16) & 0xFF;
+        page[4] = (sequence >> 24) & 0xFF;
+        page[5] = now & 0xFF;
+        page[6] = (now >> 8) & 0xFF;
+        page[7] = (now >> 16) & 0xFF;
+        page[8] = (now >> 24) & 0xFF;
+        IBusRecorder.fillIdx = IBUS_RECORDER_HEADER_SIZE;
+        IBusRecorder.pageStamp = now;
+    }
+    uint16_t delta = now - IBusRecorder.pageStamp;
+    unsigned char *entry = &page[IBusRecorder.fillIdx];
+    entry[0] = type;
+    entry[1] = delta & 0xFF;
+    entry[2] = (delta >> 8) & 0xFF;
+    entry[3] = length;
+    memcpy(&entry[IBUS_RECORDER_ENTRY_HEADER_SIZE], data, length);
+    IBusRecorder.fillIdx += IBUS_RECORDER_ENTRY_HEADER_SIZE + length;
+    IBusRecorder.entries++;
+}
+
+/**
+ * IBusRecorderProcess()
+ *     Description:
+ *         Seal a page that has been open for too long, so that a quiet bus
+ *         still reaches the EEPROM, or that IBusRecorderSync() asked for,
+ *         and write out the sealed page
+ *     Params:
+ *         None
+ *     Returns:
+ *         None
+ */
+static void IBusRecorderProcess()
+{
+    if (IBusRecorder.enabled == 0) {
+        return;
+    }
+    if (IBusRecorder.fillIdx == 0) {
+        IBusRecorder.syncPending = 0;
+    } else if (IBusRecorder.flushPending == 0 &&
+        (IBusRecorder.syncPending == 1 ||
+         TimerGetMillis() - IBusRecorder.pageStamp >= IBUS_RECORDER_SEAL_TIMEOUT)
+    ) {
+        IBusRecorderSeal();
+        IBusRecorder.syncPending = 0;
+    }
+    IBusRecorderFlush();
+}
+
+/**
+ * IBusRecorderGetStatus()
+ *     Description:
+ *         Get the flight recorder state, for diagnostics
+ *     Params:
+ *         None
+ *     Returns:
+ *         IBusRecorder_t *
+ */
+IBusRecorder_t *IBusRecorderGetStatus()
+{
+    return &IBusRecorder;
+}
+
+/**
+ * IBusRecorderInit()
+ *     Description:
+ *         Start the flight recorder if it is switched on. The ring carries on
+ *         after the page with the highest sequence number, so that the pages
+ *         of the previous drive are the last to be written over.
+ *     Params:
+ *         None
+ *     Returns:
+ *         None
+ */
+void IBusRecorderInit()
+{
+    memset(&IBusRecorder, 0, sizeof(IBusRecorder));
+    if (ConfigGetSetting(CONFIG_SETTING_IBUS_RECORDER) != CONFIG_SETTING_ON) {
+        return;
+    }
+    uint16_t page;
+    uint8_t found = 0;
+    for (page = 0; page < IBUS_RECORDER_PAGES; page++) {
+        unsigned char header[5];
+        EEPROMReadBytes(
+            IBUS_RECORDER_START_ADDRESS + (uint32_t) page * EEPROM_PAGE_SIZE,
+            header,
+            sizeof(header)
+        );
+        if (header[0] != IBUS_RECORDER_MAGIC) {
+            continue;
+        }
+        uint32_t sequence = (uint32_t) header[1] |
+            ((uint32_t) header[2] << 8) |
+            ((uint32_t) header[3] << 16) |
+            ((uint32_t) header[4] << 24);
+        if (found == 0 || sequence >= IBusRecorder.sequence) {
+            IBusRecorder.sequence = sequence + 1;
+            IBusRecorder.nextPage = (page + 1) % IBUS_RECORDER_PAGES;
+            found = 1;
+        }
+    }
+    IBusRecorder.enabled = 1;
+}
+
+/**
+ * IBusRecorderSync()
+ *     Description:
+ *         Ask for everything recorded so far to be written to the EEPROM.
+ *         The page being filled is sealed as soon as the other buffer is
+ *         free, and IBusRecorderProcess() writes it out from the main loop.
+ *         Poll IBusRecorderIsSynced() to know when it is done.
+ *     Params:
+ *         None
+ *     Returns:
+ *         None
+ */
+void IBusRecorderSync()
+{
+    if (IBusRecorder.enabled == 0) {
+        return;
+    }
+    IBusRecorder.syncPending = 1;
+    IBusRecorderProcess();
+}
+
+/**
+ * IBusRecorderIsSynced()
+ *     Description:
+ *         Check if what IBusRecorderSync() asked for has reached the EEPROM,
+ *         so that the pages can be read back. This never waits on the EEPROM.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - 1 if the recorder is synced or off, 0 otherwise
+ */
+uint8_t IBusRecorderIsSynced()
+{
+    if (IBusRecorder.enabled == 0) {
+        return 1;
+    }
+    if (IBusRecorder.syncPending == 1 ||
+        IBusRecorder.flushPending == 1 ||
+        EEPROMIsBusy() == 1
+    ) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * IBusSnifferSend()
+ *     Description:
+ *         Forward a frame to the system UART in binary, for bus analysis
+ *         on a host with utility/ibus_sniffer.py. Each record is
+ *         IBUS_SNIFFER_SYNC, the IBUS_TRACE_* type, the time in microseconds
+ *         that the frame was received or the problem happened (four bytes,
+ *         little endian), the data length, the data and the XOR
+ *         of all of the bytes before it, so that the host can find its way
+ *         back to the records around any text that the CLI sends. Records
+ *         that do not fit in the UART queue are dropped whole.
+ *     Params:
+ *         IBus_t *ibus
+ *         uint8_t type - The IBUS_TRACE_* type of the frame
+ *         const unsigned char *data - The frame or bytes to forward
+ *         uint8_t length - The number of bytes to forward
+ *         uint32_t micros - The time to put on the record
+ *     Returns:
+ *         None
+ */
+static void IBusSnifferSend(
+    IBus_t *ibus,
+    uint8_t type,
+    const unsigned char *data,
+    uint8_t length,
+    uint32_t micros
+) {
+    UART_t *uart = UARTGetModuleHandler(SYSTEM_UART_MODULE);
+    if (uart == 0) {
+        return;
+    }
+    uint16_t recordLength = IBUS_SNIFFER_HEADER_SIZE + length + 1;
+    if (CHAR_QUEUE_SIZE - CharQueueGetSize(&uart->txQueue) < recordLength) {
+        ibus->snifferDropped++;
+        return;
+    }
+    unsigned char record[IBUS_SNIFFER_HEADER_SIZE + IBUS_MAX_MSG_LENGTH + 1];
+    record[0] = IBUS_SNIFFER_SYNC;
+    record[1] = type;
+    record[2] = micros & 0xFF;
+    record[3] = (micros >> 8) & 0xFF;
+    record[4] = (micros >> 16) & 0xFF;
+    record[5] = (micros >> 24) & 0xFF;
+    record[6] = length;
+    memcpy(&record[IBUS_SNIFFER_HEADER_SIZE], data, length);
+    unsigned char checksum = 0x00;
+    uint8_t idx;
+    for (idx = 0; idx < recordLength - 1; idx++) {
+        checksum ^= record[idx];
+    }
+    record[recordLength - 1] = checksum;
+    UARTSendBytes(uart, record, recordLength);
+}
+
+/**
+ * IBusTrace()
+ *     Description:
+ *         Hand a frame, or a problem with one, to the sniffer and the flight
+ *         recorder
+ *     Params:
+ *         IBus_t *ibus
+ *         uint8_t type - The IBUS_TRACE_* type of the frame
+ *         const unsigned char *data - The frame or bytes to trace
+ *         uint8_t length - The number of bytes to trace
+ *         uint32_t micros - When the first byte of a received frame came
+ *             in, or the time now for a problem on our side
+ *     Returns:
+ *         None
+ */
+static void IBusTrace(
+    IBus_t *ibus,
+    uint8_t type,
+    const unsigned char *data,
+    uint8_t length,
+    uint32_t micros
+) {
+    if (ibus->snifferEnabled == 1) {
+        IBusSnifferSend(ibus, type, data, length, micros);
+    }
+    IBusRecorderAdd(type, data, length);
+}
+
+/**
+ * IBusTXQueueRemove()
+ *     Description:
+ *         Remove a frame from a TX class queue and release its buffer slot
+ *     Params:
+ *         IBus_t *ibus
+ *         IBusTXQueue_t *queue - The class queue to remove the frame from
+ *         uint8_t pos - The position of the frame in the queue
+ *     Returns:
+ *         None
+ */
+static void IBusTXQueueRemove(IBus_t *ibus, IBusTXQueue_t *queue, uint8_t pos)
+{
+    ibus->txBufferUsed &= ~(1U << queue->slots[pos]);
+    queue->count--;
+    for (; pos < queue->count; pos++) {
+        queue->slots[pos] = queue->slots[pos + 1];
+    }
+}
+
+/**
+ * IBusTXQueueEvict()
+ *     Description:
+ *         Drop the oldest frame of a TX class that is not on the wire, to
+ *         make room for a frame of a more important class
+ *     Params:
+ *         IBus_t *ibus
+ *         uint8_t txClass - The class to take the frame from
+ *     Returns:
+ *         uint8_t - 1 if a frame was evicted, 0 otherwise
+ */
+static uint8_t IBusTXQueueEvict(IBus_t *ibus, uint8_t txClass)
+{
+    IBusTXQueue_t *queue = &ibus->txQueues[txClass];
+    uint8_t pos;
+    for (pos = 0; pos < queue->count; pos++) {
+        uint8_t slot = queue->slots[pos];
+        if (slot != ibus->txActiveSlot) {
+            IBusTrace(
+                ibus,
+                IBUS_TRACE_TX_DROPPED,
+                ibus->txBuffer[slot],
+                ibus->txBuffer[slot][IBUS_PKT_LEN] + 2,
+                TimerGetMicros()
+            );
+            IBusTXQueueRemove(ibus, queue, pos);
+            queue->dropped++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// The handler gets back to the bus object from its UART, so the build
+// fails if the UART ever stops being the first field of IBus_t
+typedef char IBusUARTIsFirst[(offsetof(IBus_t, uart) == 0) ? 1 : -1];
+
+/**
+ * IBusTXInterruptHandler()
+ *     Description:
+ *         Feed the frame at the head of the TX buffer to the UART, one byte
+ *         per TX interrupt. The frame is abandoned if another module took
+ *         the bus between IBusTransmit() starting it and the first byte.
+ *     Params:
+ *         UART_t *uart - The IBus UART, which is the first field of IBus_t
+ *     Returns:
+ *         None
+ */
+static void IBusTXInterruptHandler(UART_t *uart)
+{
+    IBus_t *ibus = (IBus_t *) uart;
+    if (ibus->txState == IBUS_TX_STATE_SENDING) {
+        if (ibus->txFrameIdx == 0 && IBUS_UART_STATUS != 0) {
+            ibus->txState = IBUS_TX_STATE_ABORTED;
+        } else {
+            unsigned char *frame = ibus->txBuffer[ibus->txActiveSlot];
+            uint8_t msgLength = (uint8_t) frame[IBUS_PKT_LEN] + 2;
+            SetUARTTXIF(uart->moduleIndex, 0);
+            uart->registers->uxtxreg = frame[ibus->txFrameIdx++];
+            if (ibus->txFrameIdx < msgLength) {
+                return;
+            }
+            ibus->txState = IBUS_TX_STATE_DRAINING;
+        }
+    }
+    // Nothing left to load. The flag is left set so that the interrupt
+    // fires as soon as the next frame enables it.
+    SetUARTTXIE(uart->moduleIndex, 0);
+}
+
+/**
+ * IBusTransmit()
+ *     Description:
+ *         Advance the transmit state machine. Once the bus has been quiet
+ *         for the inter-frame gap, both since our last frame and since the
+ *         last byte we received, and the TH3122 STATUS pin shows that the
+ *         bus is idle, the
+ *         oldest frame of the most important non-empty class is handed to
+ *         the TX interrupt. Frames are removed from their queue once their
+ *         echo has come back intact. Aborted frames stay at its head to be
+ *         sent again, as do collided frames until they run out of retries.
+ *     Params:
+ *         IBus_t *ibus
+ *     Returns:
+ *         uint8_t - 1 if a frame was started or finished, 0 otherwise
+ */
+static uint8_t IBusTransmit(IBus_t *ibus)
+{
+    uint32_t now = TimerGetMillis();
+    if (ibus->txState == IBUS_TX_STATE_DRAINING) {
+        // Wait for the last byte to leave the shift register
+        if ((ibus->uart.registers->uxsta & UART_STA_TRMT) == 0) {
+            return 0;
+        }
+        // and for all of it to come back to us from the bus
+        if (ibus->txEchoIdx < ibus->txFrameIdx) {
+            if (ibus->txEchoStamp == 0) {
+                ibus->txEchoStamp = now;
+            }
+            if ((now - ibus->txEchoStamp) <= IBUS_TX_ECHO_TIMEOUT) {
+                return 0;
+            }
+            ibus->txState = IBUS_TX_STATE_COLLISION;
+        }
+    }
+    if (ibus->txState == IBUS_TX_STATE_COLLISION) {
+        if ((ibus->uart.registers->uxsta & UART_STA_TRMT) == 0) {
+            return 0;
+        }
+        uint8_t slot = ibus->txActiveSlot;
+        unsigned char *frame = ibus->txBuffer[slot];
+        IBusTXQueue_t *queue = &ibus->txQueues[ibus->txActiveClass];
+        queue->collisions++;
+        if (ibus->txBufferRetries[slot] >= IBusTXMaxRetries[ibus->txActiveClass]) {
+            IBusTrace(
+                ibus,
+                IBUS_TRACE_TX_FAILED,
+                frame,
+                frame[IBUS_PKT_LEN] + 2,
+                TimerGetMicros()
+            );
+            queue->failed++;
+            IBusTXQueueRemove(ibus, queue, 0);
+            LogDebug(LOG_SOURCE_IBUS, "IBus: TX retries exhausted");
+        } else {
+            IBusTrace(
+                ibus,
+                IBUS_TRACE_TX_COLLISION,
+                frame,
+                frame[IBUS_PKT_LEN] + 2,
+                TimerGetMicros()
+            );
+            queue->retries++;
+            ibus->txBufferRetries[slot]++;
+        }
+        // Back off for a random time that doubles with every retry, so that
+        // we do not collide with the same module in the same way again
+        uint8_t exponent = ibus->txBufferRetries[slot];
+        if (exponent > IBUS_TX_BACKOFF_MAX_EXP) {
+            exponent = IBUS_TX_BACKOFF_MAX_EXP;
+        }
+        ibus->txBackoff = rand() % (IBUS_TX_BACKOFF_SLOT << exponent);
+        ibus->txActiveSlot = IBUS_TX_SLOT_NONE;
+        ibus->txLastStamp = now;
+        ibus->txState = IBUS_TX_STATE_IDLE;
+        return 1;
+    }
+    if (ibus->txState == IBUS_TX_STATE_DRAINING) {
+        IBusTXQueue_t *queue = &ibus->txQueues[ibus->txActiveClass];
+        uint32_t wait = now - ibus->txBufferStamp[ibus->txActiveSlot];
+        if (wait > queue->waitMax) {
+            queue->waitMax = wait > 0xFFFF ? 0xFFFF : wait;
+        }
+        queue->waitTotal += wait;
+        queue->sent++;
+        ibus->busWindowTxBytes += ibus->txFrameIdx;
+        IBusTXQueueRemove(ibus, queue, 0);
+        ibus->txReadbackSlot = ibus->txActiveSlot;
+        ibus->txActiveSlot = IBUS_TX_SLOT_NONE;
+        ibus->txFrames++;
+        ibus->txBackoff = 0;
+        ibus->txLastStamp = now;
+        ibus->txState = IBUS_TX_STATE_IDLE;
+        return 1;
+    }
+    if (ibus->txState == IBUS_TX_STATE_ABORTED) {
+        ibus->txAborts++;
+        ibus->txActiveSlot = IBUS_TX_SLOT_NONE;
+        ibus->txLastStamp = now;
+        ibus->txState = IBUS_TX_STATE_IDLE;
+        return 1;
+    }
+    if (ibus->txState == IBUS_TX_STATE_IDLE &&
+        ibus->txBufferUsed != (1U << ibus->txStageSlot) &&
+        (now - ibus->txLastStamp) >= ibus->txGap + ibus->txBackoff &&
+        (now - ibus->rxLastStamp) >= ibus->txGap &&
+        IBUS_UART_STATUS == 0
+    ) {
+        uint8_t txClass = 0;
+        while (ibus->txQueues[txClass].count == 0) {
+            txClass++;
+        }
+        ibus->txActiveClass = txClass;
+        ibus->txActiveSlot = ibus->txQueues[txClass].slots[0];
+        ibus->txFrameIdx = 0;
+        ibus->txEchoIdx = 0;
+        ibus->txEchoStamp = 0;
+        ibus->txState = IBUS_TX_STATE_SENDING;
+        SetUARTTXIE(ibus->uart.moduleIndex, 1);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * IBusRXByte()
+ *     Description:
+ *         Queue a received byte and note whether the bus was silent for long
+ *         enough before it that it must start a new frame. IBus modules send
+ *         the bytes of a frame back to back, so a gap of more than two byte
+ *         times can only fall between frames. The time of the first byte
+ *         after each gap is kept, for IBusRXGetMicros().
+ *     Params:
+ *         IBus_t *ibus
+ *         unsigned char byte - The byte received
+ *         uint32_t micros - When the byte was received, in microseconds
+ *     Returns:
+ *         None
+ */
+void IBusRXByte(IBus_t *ibus, unsigned char byte, uint32_t micros)
+{
+    if ((micros - ibus->rxLastByteMicros) > IBUS_RX_FRAME_GAP) {
+        uint8_t stampIdx = ibus->rxBoundaryCount & (IBUS_RX_STAMPS - 1);
+        ibus->rxBoundarySeq = ibus->rxByteSeq;
+        ibus->rxStampSeq[stampIdx] = ibus->rxByteSeq;
+        ibus->rxStampMicros[stampIdx] = micros;
+        // The sequence numbers wrap, so also count the boundaries to tell a
+        // new one from one that has been dealt with
+        ibus->rxBoundaryCount++;
+    }
+    ibus->rxLastByteMicros = micros;
+    if (CharQueueAdd(&ibus->uart.rxQueue, byte) == 0) {
+        ibus->uart.rxDropped++;
+    } else {
+        ibus->rxByteSeq++;
+    }
+}
+
+/**
+ * IBusRXInterruptHandler()
+ *     Description:
+ *         Timestamp every byte as it comes off the UART
+ *     Params:
+ *         UART_t *uart - The IBus UART, which is the first field of IBus_t
+ *         unsigned char byte - The byte received
+ *     Returns:
+ *         None
+ */
+static void IBusRXInterruptHandler(UART_t *uart, unsigned char byte)
+{
+    IBusRXByte((IBus_t *) uart, byte, TimerGetMicros());
+}
+
 /**
  * IBusInit()
  *     Description:
@@ -36,519 +644,948 @@ IBus_t IBusInit()
     ibus.oilTemperature = 0x00;
     ibus.rxBufferIdx = 0;
     ibus.rxLastStamp = 0;
-    ibus.txBufferReadIdx = 0;
-    ibus.txBufferReadbackIdx = 0;
-    ibus.txBufferWriteIdx = 0;
+    ibus.rxResync = 0;
+    ibus.rxFrames = 0;
+    ibus.rxDroppedBytes = 0;
+    ibus.rxRecoveredBytes = 0;
+    ibus.rxLastByteMicros = 0;
+    ibus.rxByteSeq = 0;
+    ibus.rxBoundarySeq = 0;
+    ibus.rxBoundaryCount = 0;
+    ibus.rxBoundaryDone = 0;
+    ibus.rxReadSeq = 0;
+    ibus.rxStampDone = 0;
+    ibus.rxAnchorSeq = 0;
+    ibus.rxAnchorMicros = 0;
+    // The first slot starts out as the one frames are built in
+    ibus.txStageSlot = 0;
+    ibus.txBufferUsed = 1;
+    ibus.txActiveSlot = IBUS_TX_SLOT_NONE;
+    ibus.txActiveClass = 0;
+    ibus.txReadbackSlot = IBUS_TX_SLOT_NONE;
+    memset(ibus.txQueues, 0, sizeof(ibus.txQueues));
     ibus.txLastStamp = TimerGetMillis();
+    ibus.txState = IBUS_TX_STATE_IDLE;
+    ibus.txFrameIdx = 0;
+    ibus.txEchoIdx = 0;
+    ibus.txEchoStamp = 0;
+    ibus.txBackoff = 0;
+    ibus.txGap = IBUS_TX_GAP_MIN;
+    ibus.txThroughput = 0;
+    ibus.busLoad = 0;
+    ibus.busWindowRxBytes = 0;
+    ibus.busWindowTxBytes = 0;
+    ibus.busWindowStamp = TimerGetMillis();
+    ibus.txFrames = 0;
+    ibus.txAborts = 0;
+    ibus.txCoalescedFrames = 0;
+    ibus.txCoalescedBytes = 0;
+    ibus.snifferEnabled = 0;
+    ibus.snifferDropped = 0;
+    ibus.uart.txHandler = &IBusTXInterruptHandler;
+    ibus.uart.rxHandler = &IBusRXInterruptHandler;
+    IBusRoutesInit();
+    IBusRecorderInit();
+    // Seed the TX backoff, so that it doesn't follow the same sequence
+    // after every reset
+    srand(TimerGetMicros());
     return ibus;
 }
 
 /**
- * IBusHandleBMBTMessage()
+ * IBusTriggerEvent()
  *     Description:
- *         Handle any messages received from the BMBT (Board Monitor)
+ *         Queue an event for a received frame. User input and frames that
+ *         expect a reply from us go in the high priority lane, so that they
+ *         are handled before display and status updates.
  *     Params:
+ *         uint8_t eventType - The Event type to trigger
  *         unsigned char *pkt - The frame received on the IBus
  *     Returns:
  *         None
  */
-static void IBusHandleBMBTMessage(unsigned char *pkt)
+static void IBusTriggerEvent(uint8_t eventType, unsigned char *pkt)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_CMD_MOD_STATUS_RESP) {
-        EventTriggerCallback(IBusEvent_ModuleStatusResponse, pkt);
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_BMBT_BUTTON0 ||
-        pkt[IBUS_PKT_CMD] == IBUS_CMD_BMBT_BUTTON1
+    uint8_t lane = EVENT_QUEUE_LANE_LOW;
+    if (eventType == IBusEvent_BMBTButton ||
+        eventType == IBusEvent_CDStatusRequest ||
+        eventType == IBusEvent_GTMenuSelect ||
+        eventType == IBusEvent_MFLButton ||
+        eventType == IBusEvent_MFLVolume ||
+        eventType == IBusEvent_MIDButtonPress ||
+        eventType == IBusEvent_ModuleStatusRequest
     ) {
-        EventTriggerCallback(IBusEvent_BMBTButton, pkt);
+        lane = EVENT_QUEUE_LANE_HIGH;
     }
+    EventQueueTrigger(lane, eventType, pkt, pkt[IBUS_PKT_LEN] + 2);
 }
 
 /**
- * IBusHandleDSPMessage()
+ * IBusHandleCDStatusRequest()
  *     Description:
- *         Handle any messages received from the DSP Amplifier
+ *         Track the CD Changer function that the radio asked for and
+ *         publish the request
  *     Params:
+ *         IBus_t *ibus
  *         unsigned char *pkt - The frame received on the IBus
  *     Returns:
  *         None
  */
-static void IBusHandleDSPMessage(unsigned char *pkt)
+static void IBusHandleCDStatusRequest(IBus_t *ibus, unsigned char *pkt)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_CMD_MOD_STATUS_RESP) {
-        EventTriggerCallback(IBusEvent_ModuleStatusResponse, pkt);
+    if (pkt[4] == IBUS_CDC_CMD_STOP_PLAYING) {
+        ibus->cdChangerFunction = IBUS_CDC_FUNC_NOT_PLAYING;
+    } else if (pkt[4] == IBUS_CDC_CMD_PAUSE_PLAYING) {
+        ibus->cdChangerFunction = IBUS_CDC_FUNC_PAUSE;
+    } else if (pkt[4] == IBUS_CDC_CMD_START_PLAYING) {
+        ibus->cdChangerFunction = IBUS_CDC_FUNC_PLAYING;
     }
+    IBusTriggerEvent(IBusEvent_CDStatusRequest, pkt);
 }
 
 /**
- * IBusHandleEWSMessage()
+ * IBusHandleGTIdentity()
  *     Description:
- *         Handle any messages received from the EWS
+ *         Decode the GT part number and versions from its diagnostic
+ *         identity response
  *     Params:
+ *         IBus_t *ibus
  *         unsigned char *pkt - The frame received on the IBus
  *     Returns:
  *         None
  */
-static void IBusHandleEWSMessage(unsigned char *pkt)
+static void IBusHandleGTIdentity(IBus_t *ibus, unsigned char *pkt)
 {
-    // Do nothing for now -- for future use
+    // Decode the software and hardware versions
+    uint8_t hardwareVersion = IBusGetNavHWVersion(pkt);
+    uint8_t softwareVersion = IBusGetNavSWVersion(pkt);
+    uint8_t gtVersion = IBusGetNavType(pkt);
+    if (gtVersion != IBUS_GT_DETECT_ERROR) {
+        LogRaw(
+            "\r\nIBus: GT P/N: %c%c%c%c%c%c%c HW: %d SW: %d Build: %c%c/%c%c\r\n",
+            pkt[4],
+            pkt[5],
+            pkt[6],
+            pkt[7],
+            pkt[8],
+            pkt[9],
+            pkt[10],
+            hardwareVersion,
+            softwareVersion,
+            pkt[19],
+            pkt[20],
+            pkt[21],
+            pkt[22]
+        );
+        ibus->gtVersion = gtVersion;
+        EventTriggerCallback(IBusEvent_GTDIAIdentityResponse, &gtVersion);
+    } else {
+        LogError("IBus: Unable to decode navigation type");
+    }
 }
 
 /**
- * IBusHandleIKEMessage()
+ * IBusHandleIKEIgnitionStatus()
  *     Description:
- *         Handle any messages received from the IKE (Instrument Cluster)
+ *         Publish the ignition status synchronously, so that listeners can
+ *         compare it with the status we had before
  *     Params:
+ *         IBus_t *ibus
  *         unsigned char *pkt - The frame received on the IBus
  *     Returns:
  *         None
  */
-static void IBusHandleGMMessage(unsigned char *pkt)
+static void IBusHandleIKEIgnitionStatus(IBus_t *ibus, unsigned char *pkt)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_CMD_GM_DOORS_FLAPS_STATUS_RESP) {
-        EventTriggerCallback(IBusEvent_DoorsFlapsStatusResponse, pkt);
+    uint8_t ignitionStatus = pkt[4];
+    if (ignitionStatus == IBUS_IGNITION_OFF) {
+        // Implied that the CDC should not be playing with the ignition off
+        ibus->cdChangerFunction = IBUS_CDC_FUNC_NOT_PLAYING;
     }
+    // The order of the items below should not be changed,
+    // otherwise listeners will not know if the ignition status
+    // has changed
+    EventTriggerCallback(
+        IBusEvent_IKEIgnitionStatus,
+        &ignitionStatus
+    );
+    ibus->ignitionStatus = ignitionStatus;
 }
 
 /**
- * IBusHandleGTMessage()
+ * IBusHandleIKEVehicleType()
  *     Description:
- *         Handle any messages received from the GT (Graphics Terminal)
+ *         Track the vehicle type reported by the IKE and publish it
  *     Params:
+ *         IBus_t *ibus
  *         unsigned char *pkt - The frame received on the IBus
  *     Returns:
  *         None
  */
-static void IBusHandleGTMessage(IBus_t *ibus, unsigned char *pkt)
+static void IBusHandleIKEVehicleType(IBus_t *ibus, unsigned char *pkt)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_CMD_MOD_STATUS_RESP) {
-        EventTriggerCallback(IBusEvent_ModuleStatusResponse, pkt);
-    } else if (pkt[IBUS_PKT_LEN] == 0x22 &&
-        pkt[IBUS_PKT_DST] == IBUS_DEVICE_DIA &&
-        pkt[IBUS_PKT_CMD] == IBUS_CMD_DIA_DIAG_RESPONSE
+    ibus->vehicleType = IBusGetVehicleType(pkt);
+    IBusTriggerEvent(IBusEvent_IKEVehicleType, pkt);
+}
+
+/**
+ * IBusHandleLCMDiagnostics()
+ *     Description:
+ *         Read the dimmer values and the oil temperature from the LCM
+ *         diagnostic response
+ *     Params:
+ *         IBus_t *ibus
+ *         unsigned char *pkt - The frame received on the IBus
+ *     Returns:
+ *         None
+ */
+static void IBusHandleLCMDiagnostics(IBus_t *ibus, unsigned char *pkt)
+{
+    ibus->lcmDimmerStatus1 = pkt[19];
+    ibus->lcmDimmerStatus2 = pkt[20];
+    if (ibus->vehicleType != IBUS_VEHICLE_TYPE_E46_Z4 &&
+        pkt[23] != 0x00
     ) {
-        // Decode the software and hardware versions
-        uint8_t hardwareVersion = IBusGetNavHWVersion(pkt);
-        uint8_t softwareVersion = IBusGetNavSWVersion(pkt);
-        uint8_t gtVersion = IBusGetNavType(pkt);
-        if (gtVersion != IBUS_GT_DETECT_ERROR) {
-            LogRaw(
-                "\r\nIBus: GT P/N: %c%c%c%c%c%c%c HW: %d SW: %d Build: %c%c/%c%c\r\n",
-                pkt[4],
-                pkt[5],
-                pkt[6],
-                pkt[7],
-                pkt[8],
-                pkt[9],
-                pkt[10],
-                hardwareVersion,
-                softwareVersion,
-                pkt[19],
-                pkt[20],
-                pkt[21],
-                pkt[22]
+        // Oil Temp calculation
+        float rawTemperature = (pkt[23] * 0.01275) + (pkt[24] * 0.000050);
+        unsigned char oilTemperature = 1.0 * 67.2529 * log(rawTemperature) + 310.0;
+        if (oilTemperature != ibus->oilTemperature) {
+            ibus->oilTemperature = oilTemperature;
+            unsigned char updateType = 0x01;
+            EventTriggerCallback(
+                IBusEvent_ValueUpdate,
+                &updateType
             );
-            ibus->gtVersion = gtVersion;
-            EventTriggerCallback(IBusEvent_GTDIAIdentityResponse, &gtVersion);
-        } else {
-            LogError("IBus: Unable to decode navigation type");
         }
-    } else if (pkt[IBUS_PKT_LEN] >= 0x0C &&
-        pkt[IBUS_PKT_LEN] < 0x22 &&
-        pkt[IBUS_PKT_DST] == IBUS_DEVICE_DIA &&
-        pkt[IBUS_PKT_CMD] == IBUS_CMD_DIA_DIAG_RESPONSE
-    ) {
-        // Example Frame: 3B 0C 3F A0 42 4D 57 43 30 31 53 00 00 E1
-        EventTriggerCallback(IBusEvent_GTDIAOSIdentityResponse, pkt);
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_GT_MENU_SELECT) {
-        EventTriggerCallback(IBusEvent_GTMenuSelect, pkt);
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_GT_SCREEN_MODE_SET) {
-        EventTriggerCallback(IBusEvent_ScreenModeSet, pkt);
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_GT_CHANGE_UI_REQ) {
-        // Example Frame: 3B 05 FF 20 02 0C EF [Telephone Selected]
-        EventTriggerCallback(IBusEvent_GTChangeUIRequest, pkt);
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_BMBT_BUTTON1) {
-        // The GT broadcasts an emulated version of the BMBT button press
-        // command 0x48 that matches the "Phone" button on the BMBT
-        EventTriggerCallback(IBusEvent_BMBTButton, pkt);
     }
 }
 
 /**
- * IBusHandleIKEMessage()
+ * IBusHandleRADIdentity()
  *     Description:
- *         Handle any messages received from the IKE (Instrument Cluster)
+ *         Log the radio part number and versions from its diagnostic
+ *         identity response
  *     Params:
+ *         IBus_t *ibus
  *         unsigned char *pkt - The frame received on the IBus
  *     Returns:
  *         None
  */
-static void IBusHandleIKEMessage(IBus_t *ibus, unsigned char *pkt)
+static void IBusHandleRADIdentity(IBus_t *ibus, unsigned char *pkt)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_CMD_MOD_STATUS_RESP) {
-        EventTriggerCallback(IBusEvent_ModuleStatusResponse, pkt);
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_IKE_IGN_STATUS_RESP) {
-        uint8_t ignitionStatus = pkt[4];
-        if (ignitionStatus == IBUS_IGNITION_OFF) {
-            // Implied that the CDC should not be playing with the ignition off
-            ibus->cdChangerFunction = IBUS_CDC_FUNC_NOT_PLAYING;
-        }
-        // The order of the items below should not be changed,
-        // otherwise listeners will not know if the ignition status
-        // has changed
-        EventTriggerCallback(
-            IBusEvent_IKEIgnitionStatus,
-            &ignitionStatus
-        );
-        ibus->ignitionStatus = ignitionStatus;
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_IKE_RESP_VEHICLE_TYPE) {
-        ibus->vehicleType = IBusGetVehicleType(pkt);
-        EventTriggerCallback(IBusEvent_IKEVehicleType, pkt);
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_IKE_SPEED_RPM_UPDATE) {
-        EventTriggerCallback(IBusEvent_IKESpeedRPMUpdate, pkt);
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_IKE_COOLANT_TEMP_UPDATE) {
-        EventTriggerCallback(IBusEvent_IKECoolantTempUpdate, pkt);
+    LogRaw(
+        "\r\nIBus: RAD P/N: %d%d%d%d%d%d%d HW: %02d SW: %d%d Build: %d%d/%d%d\r\n",
+        pkt[4] & 0x0F,
+        (pkt[5] & 0xF0) >> 4,
+        pkt[5] & 0x0F,
+        (pkt[6] & 0xF0) >> 4,
+        pkt[6] & 0x0F,
+        (pkt[7] & 0xF0) >> 4,
+        pkt[7] & 0x0F,
+        pkt[8],
+        (pkt[15] & 0xF0) >> 4,
+        pkt[15] & 0x0F,
+        (pkt[12] & 0xF0) >> 4,
+        pkt[12] & 0x0F,
+        (pkt[13] & 0xF0) >> 4,
+        pkt[13] & 0x0F
+    );
+}
+
+/*
+ * The frames that we act on. A frame may match more than one route, and
+ * every route that matches is dispatched. Routes without a handler
+ * trigger their event with a copy of the frame.
+ */
+static const IBusRoute_t IBusRoutes[] = {
+    // Module status
+    {IBUS_DEVICE_BMBT, 0, IBUS_CMD_MOD_STATUS_RESP, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_ModuleStatusResponse, 0},
+    {IBUS_DEVICE_DSP, 0, IBUS_CMD_MOD_STATUS_RESP, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_ModuleStatusResponse, 0},
+    {IBUS_DEVICE_GT, 0, IBUS_CMD_MOD_STATUS_RESP, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_ModuleStatusResponse, 0},
+    {IBUS_DEVICE_IKE, 0, IBUS_CMD_MOD_STATUS_RESP, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_ModuleStatusResponse, 0},
+    {IBUS_DEVICE_LCM, 0, IBUS_CMD_MOD_STATUS_RESP, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_ModuleStatusResponse, 0},
+    {IBUS_DEVICE_RAD, 0, IBUS_CMD_MOD_STATUS_RESP, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_ModuleStatusResponse, 0},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_CDC, IBUS_CMD_MOD_STATUS_REQ, 0, 0, 0, IBusEvent_ModuleStatusRequest, 0},
+    {0, IBUS_DEVICE_TEL, IBUS_CMD_MOD_STATUS_REQ, IBUS_ROUTE_ANY_SRC, 0, 0, IBusEvent_ModuleStatusRequest, 0},
+    // BMBT (Board Monitor)
+    {IBUS_DEVICE_BMBT, 0, IBUS_CMD_BMBT_BUTTON0, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_BMBTButton, 0},
+    {IBUS_DEVICE_BMBT, 0, IBUS_CMD_BMBT_BUTTON1, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_BMBTButton, 0},
+    // GM (Body Module)
+    {IBUS_DEVICE_GM, 0, IBUS_CMD_GM_DOORS_FLAPS_STATUS_RESP, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_DoorsFlapsStatusResponse, 0},
+    // GT (Graphics Terminal)
+    {IBUS_DEVICE_GT, IBUS_DEVICE_DIA, IBUS_CMD_DIA_DIAG_RESPONSE, IBUS_ROUTE_LENGTH, 0x22, 0x22, IBusEvent_GTDIAIdentityResponse, &IBusHandleGTIdentity},
+    // Example Frame: 3B 0C 3F A0 42 4D 57 43 30 31 53 00 00 E1
+    {IBUS_DEVICE_GT, IBUS_DEVICE_DIA, IBUS_CMD_DIA_DIAG_RESPONSE, IBUS_ROUTE_LENGTH, 0x0C, 0x21, IBusEvent_GTDIAOSIdentityResponse, 0},
+    {IBUS_DEVICE_GT, 0, IBUS_CMD_GT_MENU_SELECT, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_GTMenuSelect, 0},
+    {IBUS_DEVICE_GT, 0, IBUS_CMD_GT_SCREEN_MODE_SET, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_ScreenModeSet, 0},
+    // Example Frame: 3B 05 FF 20 02 0C EF [Telephone Selected]
+    {IBUS_DEVICE_GT, 0, IBUS_CMD_GT_CHANGE_UI_REQ, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_GTChangeUIRequest, 0},
+    // The GT broadcasts an emulated version of the BMBT button press
+    // command 0x48 that matches the "Phone" button on the BMBT
+    {IBUS_DEVICE_GT, 0, IBUS_CMD_BMBT_BUTTON1, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_BMBTButton, 0},
+    // IKE (Instrument Cluster)
+    {IBUS_DEVICE_IKE, 0, IBUS_CMD_IKE_IGN_STATUS_RESP, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_IKEIgnitionStatus, &IBusHandleIKEIgnitionStatus},
+    {IBUS_DEVICE_IKE, 0, IBUS_CMD_IKE_RESP_VEHICLE_TYPE, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_IKEVehicleType, &IBusHandleIKEVehicleType},
+    {IBUS_DEVICE_IKE, 0, IBUS_CMD_IKE_SPEED_RPM_UPDATE, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_IKESpeedRPMUpdate, 0},
+    {IBUS_DEVICE_IKE, 0, IBUS_CMD_IKE_COOLANT_TEMP_UPDATE, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_IKECoolantTempUpdate, 0},
+    // LCM (Lighting Control Module)
+    {IBUS_DEVICE_LCM, IBUS_DEVICE_GLO, IBUS_LCM_LIGHT_STATUS, 0, 0, 0, IBusEvent_LCMLightStatus, 0},
+    {IBUS_DEVICE_LCM, IBUS_DEVICE_GLO, IBUS_LCM_DIMMER_STATUS, 0, 0, 0, IBusEvent_LCMDimmerStatus, 0},
+    {IBUS_DEVICE_LCM, IBUS_DEVICE_DIA, IBUS_CMD_DIA_DIAG_RESPONSE, IBUS_ROUTE_LENGTH, 0x23, 0x23, IBusEvent_ValueUpdate, &IBusHandleLCMDiagnostics},
+    {IBUS_DEVICE_LCM, 0, IBUS_CMD_LCM_RESP_REDUNDANT_DATA, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_LCMRedundantData, 0},
+    // MFL (Steering Wheel Controls)
+    {IBUS_DEVICE_MFL, 0, IBUS_MFL_BTN_EVENT, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_MFLButton, 0},
+    {IBUS_DEVICE_MFL, IBUS_DEVICE_TEL, 0x01, 0, 0, 0, IBusEvent_MFLButton, 0},
+    {IBUS_DEVICE_MFL, 0, IBUS_MFL_BTN_VOL, IBUS_ROUTE_ANY_DST, 0, 0, IBusEvent_MFLVolume, 0},
+    // MID (Multi-Info Display)
+    {IBUS_DEVICE_MID, IBUS_DEVICE_RAD, IBus_MID_Button_Press, 0, 0, 0, IBusEvent_MIDButtonPress, 0},
+    {IBUS_DEVICE_MID, IBUS_DEVICE_LOC, IBus_MID_CMD_MODE, 0, 0, 0, IBusEvent_MIDModeChange, 0},
+    // RAD (Radio)
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_CDC, IBUS_COMMAND_CDC_GET_STATUS, 0, 0, 0, IBusEvent_CDStatusRequest, &IBusHandleCDStatusRequest},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_DIA, IBUS_CMD_DIA_DIAG_RESPONSE, IBUS_ROUTE_LENGTH, 0x09, 0xFF, 0, &IBusHandleRADIdentity},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_GT, IBUS_CMD_RAD_SCREEN_MODE_UPDATE, 0, 0, 0, IBusEvent_ScreenModeUpdate, 0},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_GT, IBUS_CMD_RAD_UPDATE_MAIN_AREA, 0, 0, 0, IBusEvent_RADUpdateMainArea, 0},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_GT, IBUS_CMD_GT_DISPLAY_RADIO_MENU, 0, 0, 0, IBusEvent_RADDisplayMenu, 0},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_LOC, 0x3B, 0, 0, 0, IBusEvent_CDClearDisplay, 0},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_LOC, IBUS_CMD_RAD_UPDATE_MAIN_AREA, 0, 0, 0, IBusEvent_RADUpdateMainArea, 0},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_MID, IBUS_CMD_RAD_WRITE_MID_DISPLAY, IBUS_ROUTE_DATA, 0xC0, 0xC0, IBusEvent_RADMIDDisplayText, 0},
+    {IBUS_DEVICE_RAD, IBUS_DEVICE_MID, IBUS_CMD_RAD_WRITE_MID_MENU, 0, 0, 0, IBusEvent_RADMIDDisplayMenu, 0}
+};
+#define IBUS_ROUTES_COUNT (sizeof(IBusRoutes) / sizeof(IBusRoute_t))
+// The first route for every command, and the next route with the same command
+uint8_t IBusRouteHead[256];
+uint8_t IBusRouteNext[IBUS_ROUTES_COUNT];
+
+/**
+ * IBusRoutesInit()
+ *     Description:
+ *         Chain the routes by command, so that a frame only has to be checked
+ *         against the routes for its own command
+ *     Params:
+ *         None
+ *     Returns:
+ *         None
+ */
+void IBusRoutesInit()
+{
+    uint8_t idx = IBUS_ROUTES_COUNT;
+    memset(IBusRouteHead, IBUS_ROUTE_NONE, sizeof(IBusRouteHead));
+    // Walk backwards so that the chains keep the order of the table
+    while (idx > 0) {
+        idx--;
+        unsigned char cmd = IBusRoutes[idx].cmd;
+        IBusRouteNext[idx] = IBusRouteHead[cmd];
+        IBusRouteHead[cmd] = idx;
     }
 }
 
 /**
- * IBusHandleLCMMessage()
+ * IBusRouteMatches()
  *     Description:
- *         Handle any messages received from the LCM (Lighting Control Module)
+ *         Check if a frame matches a given route
  *     Params:
+ *         const IBusRoute_t *route - The route
  *         unsigned char *pkt - The frame received on the IBus
  *     Returns:
- *         None
+ *         uint8_t - 1 if the frame matches, 0 otherwise
  */
-static void IBusHandleLCMMessage(IBus_t *ibus, unsigned char *pkt)
+static uint8_t IBusRouteMatches(const IBusRoute_t *route, unsigned char *pkt)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_CMD_MOD_STATUS_RESP) {
-        EventTriggerCallback(IBusEvent_ModuleStatusResponse, pkt);
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_GLO &&
-        pkt[IBUS_PKT_CMD] == IBUS_LCM_LIGHT_STATUS
+    if ((route->flags & IBUS_ROUTE_ANY_SRC) == 0 &&
+        route->src != pkt[IBUS_PKT_SRC]
     ) {
-        EventTriggerCallback(IBusEvent_LCMLightStatus, pkt);
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_GLO &&
-               pkt[IBUS_PKT_CMD] == IBUS_LCM_DIMMER_STATUS
+        return 0;
+    }
+    if ((route->flags & IBUS_ROUTE_ANY_DST) == 0 &&
+        route->dst != pkt[IBUS_PKT_DST]
     ) {
-        EventTriggerCallback(IBusEvent_LCMDimmerStatus, pkt);
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_DIA &&
-               pkt[IBUS_PKT_CMD] == IBUS_CMD_DIA_DIAG_RESPONSE &&
-               pkt[IBUS_PKT_LEN] == 0x23
+        return 0;
+    }
+    if ((route->flags & IBUS_ROUTE_LENGTH) != 0 &&
+        (pkt[IBUS_PKT_LEN] < route->min || pkt[IBUS_PKT_LEN] > route->max)
     ) {
-        ibus->lcmDimmerStatus1 = pkt[19];
-        ibus->lcmDimmerStatus2 = pkt[20];
-        if (ibus->vehicleType != IBUS_VEHICLE_TYPE_E46_Z4 &&
-            pkt[23] != 0x00
-        ) {
-            // Oil Temp calculation
-            float rawTemperature = (pkt[23] * 0.01275) + (pkt[24] * 0.000050);
-            unsigned char oilTemperature = 1.0 * 67.2529 * log(rawTemperature) + 310.0;
-            if (oilTemperature != ibus->oilTemperature) {
-                ibus->oilTemperature = oilTemperature;
-                unsigned char updateType = 0x01;
-                EventTriggerCallback(
-                    IBusEvent_ValueUpdate,
-                    &updateType
-                );
-            }
-        }
-    } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_LCM_RESP_REDUNDANT_DATA) {
-        EventTriggerCallback(IBusEvent_LCMRedundantData, pkt);
+        return 0;
+    }
+    if ((route->flags & IBUS_ROUTE_DATA) != 0 &&
+        (pkt[IBUS_PKT_LEN] < 4 || pkt[4] < route->min || pkt[4] > route->max)
+    ) {
+        return 0;
     }
+    return 1;
 }
 
+static uint8_t IBusValidateChecksum(unsigned char *msg)
+{
+    uint8_t chk = 0;
+    uint8_t msgSize = msg[1] + 2;
+    uint8_t idx;
+    for (idx = 0; idx < msgSize; idx++) {
+        chk =  chk ^ msg[idx];
+    }
+    if (chk == 0) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
 
-static void IBusHandleMFLMessage(IBus_t *ibus, unsigned char *pkt)
+/**
+ * IBusHandleFrame()
+ *     Description:
+ *         Dispatch a frame that passed the checksum to every route that it
+ *         matches
+ *     Params:
+ *         IBus_t *ibus
+ *         unsigned char *pkt - The frame received on the IBus
+ *         uint32_t micros - When the first byte of the frame came in
+ *     Returns:
+ *         None
+ */
+static void IBusHandleFrame(IBus_t *ibus, unsigned char *pkt, uint32_t micros)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_MFL_BTN_EVENT ||
-        (pkt[IBUS_PKT_DST] == IBUS_DEVICE_TEL && pkt[IBUS_PKT_CMD] == 0x01)
+    uint8_t msgLength = pkt[IBUS_PKT_LEN] + 2;
+    uint8_t isSelf = 0;
+    // The echo of our own frame may be decoded before or after the TX state
+    // machine retires it
+    if (ibus->txActiveSlot != IBUS_TX_SLOT_NONE &&
+        memcmp(ibus->txBuffer[ibus->txActiveSlot], pkt, msgLength) == 0
     ) {
-        EventTriggerCallback(IBusEvent_MFLButton, pkt);
+        isSelf = 1;
+    } else if (ibus->txReadbackSlot != IBUS_TX_SLOT_NONE &&
+        memcmp(ibus->txBuffer[ibus->txReadbackSlot], pkt, msgLength) == 0
+    ) {
+        isSelf = 1;
+        ibus->txReadbackSlot = IBUS_TX_SLOT_NONE;
     }
-    if (pkt[IBUS_PKT_CMD] == IBUS_MFL_BTN_VOL) {
-        EventTriggerCallback(IBusEvent_MFLVolume, pkt);
+    if (isSelf == 1) {
+        // This is our echo, so it carries the time the bus heard us
+        IBusTrace(ibus, IBUS_TRACE_TX, pkt, msgLength, micros);
+    } else {
+        IBusTrace(ibus, IBUS_TRACE_RX, pkt, msgLength, micros);
+    }
+    // Most of the bus traffic is of no interest to us, so drop it before
+    // doing any other work
+    uint8_t routeIdx = IBusRouteHead[pkt[IBUS_PKT_CMD]];
+    while (routeIdx != IBUS_ROUTE_NONE &&
+        IBusRouteMatches(&IBusRoutes[routeIdx], pkt) == 0
+    ) {
+        routeIdx = IBusRouteNext[routeIdx];
+    }
+    if (routeIdx == IBUS_ROUTE_NONE) {
+        return;
+    }
+    // The sniffer already carries the frame, and text would only get in
+    // the way of its records
+    if (ibus->snifferEnabled == 0) {
+        uint8_t idx;
+        long long unsigned int ts = (long long unsigned int) TimerGetMillis();
+        LogRawDebug(LOG_SOURCE_IBUS, "[%llu] DEBUG: IBus: RX[%d]: ", ts, msgLength);
+        for (idx = 0; idx < msgLength; idx++) {
+            LogRawDebug(LOG_SOURCE_IBUS, "%02X ", pkt[idx]);
+        }
+        if (isSelf == 1) {
+            LogRawDebug(LOG_SOURCE_IBUS, "[SELF]");
+        }
+        LogRawDebug(LOG_SOURCE_IBUS, "\r\n");
+    }
+    while (routeIdx != IBUS_ROUTE_NONE) {
+        const IBusRoute_t *route = &IBusRoutes[routeIdx];
+        if (IBusRouteMatches(route, pkt) == 1) {
+            if (route->handler != 0) {
+                route->handler(ibus, pkt);
+            } else {
+                IBusTriggerEvent(route->eventType, pkt);
+            }
+        }
+        routeIdx = IBusRouteNext[routeIdx];
     }
 }
 
-static void IBusHandleMIDMessage(IBus_t *ibus, unsigned char *pkt)
+/**
+ * IBusRXGetMicros()
+ *     Description:
+ *         Work out when a byte in the RX buffer came in, from the time of the
+ *         first byte after the last gap before it. The bytes after it were
+ *         sent back to back, so each one follows a byte time later. Bytes
+ *         must be asked for in the order that they were received.
+ *     Params:
+ *         IBus_t *ibus
+ *         uint8_t bufferIdx - The index of the byte in the RX buffer
+ *     Returns:
+ *         uint32_t - The time that the byte came in, in microseconds
+ */
+static uint32_t IBusRXGetMicros(IBus_t *ibus, uint8_t bufferIdx)
 {
-    if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_RAD) {
-        if (pkt[IBUS_PKT_CMD] == IBus_MID_Button_Press) {
-            EventTriggerCallback(IBusEvent_MIDButtonPress, pkt);
-        }
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_LOC) {
-        if (pkt[IBUS_PKT_CMD] == IBus_MID_CMD_MODE) {
-            EventTriggerCallback(IBusEvent_MIDModeChange, pkt);
+    uint16_t seq = ibus->rxReadSeq - ibus->rxBufferIdx + bufferIdx;
+    uint8_t boundaryCount = ibus->rxBoundaryCount;
+    if ((uint8_t) (boundaryCount - ibus->rxStampDone) > IBUS_RX_STAMPS) {
+        // The main loop fell behind and the oldest gaps were written over
+        ibus->rxStampDone = boundaryCount - IBUS_RX_STAMPS;
+    }
+    while (ibus->rxStampDone != boundaryCount) {
+        uint8_t stampIdx = ibus->rxStampDone & (IBUS_RX_STAMPS - 1);
+        uint16_t stampSeq = ibus->rxStampSeq[stampIdx];
+        if ((uint16_t) (seq - stampSeq) >= 0x8000) {
+            // This gap comes after the byte
+            break;
         }
+        ibus->rxAnchorSeq = stampSeq;
+        ibus->rxAnchorMicros = ibus->rxStampMicros[stampIdx];
+        ibus->rxStampDone++;
     }
+    return ibus->rxAnchorMicros +
+        (uint32_t) (uint16_t) (seq - ibus->rxAnchorSeq) * IBUS_BYTE_TIME_US;
 }
 
-static void IBusHandleRadioMessage(IBus_t *ibus, unsigned char *pkt)
+/**
+ * IBusDecode()
+ *     Description:
+ *         Decode every complete frame in the RX buffer. A frame with an
+ *         impossible length or a bad checksum means we are not aligned to
+ *         the start of a frame, so slide the window forward by one byte and
+ *         try again rather than throwing the buffer away.
+ *     Params:
+ *         IBus_t *ibus
+ *         uint8_t flush - 1 if no more data is coming for the bytes in the
+ *             buffer, so that an incomplete frame is skipped as well
+ *     Returns:
+ *         None
+ */
+static void IBusDecode(IBus_t *ibus, uint8_t flush)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_CMD_MOD_STATUS_RESP) {
-        EventTriggerCallback(IBusEvent_ModuleStatusResponse, pkt);
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_CDC) {
-        if (pkt[IBUS_PKT_CMD] == IBUS_CMD_MOD_STATUS_REQ) {
-            EventTriggerCallback(IBusEvent_ModuleStatusRequest, pkt);
-        } else if(pkt[IBUS_PKT_CMD] == IBUS_COMMAND_CDC_GET_STATUS) {
-            if (pkt[4] == IBUS_CDC_CMD_STOP_PLAYING) {
-                ibus->cdChangerFunction = IBUS_CDC_FUNC_NOT_PLAYING;
-            } else if (pkt[4] == IBUS_CDC_CMD_PAUSE_PLAYING) {
-                ibus->cdChangerFunction = IBUS_CDC_FUNC_PAUSE;
-            } else if (pkt[4] == IBUS_CDC_CMD_START_PLAYING) {
-                ibus->cdChangerFunction = IBUS_CDC_FUNC_PLAYING;
+    uint8_t start = 0;
+    while (ibus->rxBufferIdx - start > IBUS_PKT_LEN) {
+        unsigned char *pkt = &ibus->rxBuffer[start];
+        uint8_t available = ibus->rxBufferIdx - start;
+        uint8_t msgLength = (uint8_t) pkt[IBUS_PKT_LEN] + 2;
+        uint8_t isValid = 0;
+        if (msgLength >= IBUS_MIN_MSG_LENGTH && msgLength <= IBUS_MAX_MSG_LENGTH) {
+            if (available < msgLength) {
+                if (flush == 0) {
+                    break;
+                }
+            } else if (IBusValidateChecksum(pkt) == 1) {
+                isValid = 1;
             }
-            EventTriggerCallback(IBusEvent_CDStatusRequest, pkt);
         }
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_DIA &&
-               pkt[IBUS_PKT_LEN] > 8 &&
-               pkt[IBUS_PKT_CMD] == IBUS_CMD_DIA_DIAG_RESPONSE
-    ) {
-        LogRaw(
-            "\r\nIBus: RAD P/N: %d%d%d%d%d%d%d HW: %02d SW: %d%d Build: %d%d/%d%d\r\n",
-            pkt[4] & 0x0F,
-            (pkt[5] & 0xF0) >> 4,
-            pkt[5] & 0x0F,
-            (pkt[6] & 0xF0) >> 4,
-            pkt[6] & 0x0F,
-            (pkt[7] & 0xF0) >> 4,
-            pkt[7] & 0x0F,
-            pkt[8],
-            (pkt[15] & 0xF0) >> 4,
-            pkt[15] & 0x0F,
-            (pkt[12] & 0xF0) >> 4,
-            pkt[12] & 0x0F,
-            (pkt[13] & 0xF0) >> 4,
-            pkt[13] & 0x0F
-        );
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_GT) {
-        if (pkt[IBUS_PKT_CMD] == IBUS_CMD_RAD_SCREEN_MODE_UPDATE) {
-            EventTriggerCallback(IBusEvent_ScreenModeUpdate, pkt);
-        }
-        if (pkt[IBUS_PKT_CMD] == IBUS_CMD_RAD_UPDATE_MAIN_AREA) {
-            EventTriggerCallback(IBusEvent_RADUpdateMainArea, pkt);
+        if (isValid == 1) {
+            IBusHandleFrame(ibus, pkt, IBusRXGetMicros(ibus, start));
+            ibus->rxFrames++;
+            if (ibus->rxResync == 1) {
+                ibus->rxRecoveredBytes += msgLength;
+                ibus->rxResync = 0;
+            }
+            start += msgLength;
+        } else {
+            if (ibus->rxResync == 0) {
+                long long unsigned int ts = (long long unsigned int) TimerGetMillis();
+                LogRawDebug(
+                    LOG_SOURCE_IBUS,
+                    "[%llu] ERROR: IBus: RX Resync [%d - %02X]\r\n",
+                    ts,
+                    msgLength,
+                    pkt[IBUS_PKT_LEN]
+                );
+                // Keep the source and length bytes that threw us off
+                IBusTrace(
+                    ibus,
+                    IBUS_TRACE_RX_ERROR,
+                    pkt,
+                    2,
+                    IBusRXGetMicros(ibus, start)
+                );
+                ibus->rxResync = 1;
+            }
+            ibus->rxDroppedBytes++;
+            start++;
         }
-        if (pkt[IBUS_PKT_CMD] == IBUS_CMD_GT_DISPLAY_RADIO_MENU) {
-            EventTriggerCallback(IBusEvent_RADDisplayMenu, pkt);
+    }
+    if (flush == 1) {
+        ibus->rxDroppedBytes += ibus->rxBufferIdx - start;
+        start = ibus->rxBufferIdx;
+        // Nothing is left to recover once the buffer has been flushed
+        ibus->rxResync = 0;
+    }
+    if (start > 0) {
+        ibus->rxBufferIdx -= start;
+        memmove(ibus->rxBuffer, &ibus->rxBuffer[start], ibus->rxBufferIdx);
+    }
+}
+
+/**
+ * IBusUpdateBusLoad()
+ *     Description:
+ *         Once per window, work out how much of the time the bus carried
+ *         data and how much of that was ours. The gap we leave between our
+ *         frames follows the load: on a quiet bus a burst of writes goes out
+ *         quickly, and on a busy one we give the other modules more room.
+ *     Params:
+ *         IBus_t *ibus
+ *         uint32_t now - The current time in milliseconds
+ *     Returns:
+ *         None
+ */
+static void IBusUpdateBusLoad(IBus_t *ibus, uint32_t now)
+{
+    uint32_t window = now - ibus->busWindowStamp;
+    if (window < IBUS_BUS_LOAD_WINDOW) {
+        return;
+    }
+    // Received bytes include the echo of ours, so this is the whole bus
+    uint32_t load = ((uint32_t) ibus->busWindowRxBytes * IBUS_BYTE_TIME_US) /
+        (window * 10);
+    if (load > 100) {
+        load = 100;
+    }
+    ibus->busLoad = (uint8_t) ((ibus->busLoad * 3 + load) / 4);
+    ibus->txThroughput = ((uint32_t) ibus->busWindowTxBytes * 1000) / window;
+    ibus->txGap = IBUS_TX_GAP_MIN +
+        ((IBUS_TX_GAP_MAX - IBUS_TX_GAP_MIN) * ibus->busLoad) / 100;
+    ibus->busWindowRxBytes = 0;
+    ibus->busWindowTxBytes = 0;
+    ibus->busWindowStamp = now;
+}
+
+/**
+ * IBusTXCheckEcho()
+ *     Description:
+ *         The TH3122 hands every byte on the bus back to us, including our
+ *         own. While a frame is going out, compare what comes back with what
+ *         was sent, and stop sending at the first difference since the
+ *         frame has collided with another module.
+ *     Params:
+ *         IBus_t *ibus
+ *         unsigned char *data - The bytes just received
+ *         uint8_t length - The number of bytes received
+ *     Returns:
+ *         None
+ */
+static void IBusTXCheckEcho(IBus_t *ibus, unsigned char *data, uint8_t length)
+{
+    if (ibus->txState != IBUS_TX_STATE_SENDING &&
+        ibus->txState != IBUS_TX_STATE_DRAINING
+    ) {
+        return;
+    }
+    unsigned char *frame = ibus->txBuffer[ibus->txActiveSlot];
+    uint8_t idx;
+    for (idx = 0; idx < length; idx++) {
+        if (ibus->txEchoIdx >= ibus->txFrameIdx ||
+            data[idx] != frame[ibus->txEchoIdx]
+        ) {
+            SetUARTTXIE(ibus->uart.moduleIndex, 0);
+            ibus->txState = IBUS_TX_STATE_COLLISION;
+            return;
         }
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_LOC) {
-        if (pkt[IBUS_PKT_CMD] == 0x3B) {
-            EventTriggerCallback(IBusEvent_CDClearDisplay, pkt);
+        ibus->txEchoIdx++;
+    }
+}
+
+/**
+ * IBusRXRead()
+ *     Description:
+ *         Move received bytes from the UART queue to the frame buffer
+ *     Params:
+ *         IBus_t *ibus
+ *         uint16_t count - The most bytes to move
+ *     Returns:
+ *         None
+ */
+static void IBusRXRead(IBus_t *ibus, uint16_t count)
+{
+    uint16_t space = IBUS_RX_BUFFER_SIZE - 1 - ibus->rxBufferIdx;
+    if (count > space) {
+        count = space;
+    }
+    uint8_t rxCount = CharQueueRead(
+        &ibus->uart.rxQueue,
+        &ibus->rxBuffer[ibus->rxBufferIdx],
+        count
+    );
+    IBusTXCheckEcho(ibus, &ibus->rxBuffer[ibus->rxBufferIdx], rxCount);
+    ibus->rxBufferIdx += rxCount;
+    ibus->rxReadSeq += rxCount;
+    ibus->busWindowRxBytes += rxCount;
+}
+
+/**
+ * IBusProcess()
+ *     Description:
+ *         Process messages in the IBus RX queue
+ *     Params:
+ *         IBus_t *ibus
+ *     Returns:
+ *         uint8_t - 1 if data was received or transmitted, 0 otherwise
+ */
+uint8_t IBusProcess(IBus_t *ibus)
+{
+    uint8_t workDone = 0;
+    uint32_t now = TimerGetMillis();
+    // Decode everything that has arrived, and then attempt to transmit
+    // whatever is sitting in the transmit buffer
+    uint16_t available = CharQueueGetSize(&ibus->uart.rxQueue);
+    if (available > 0) {
+        workDone = 1;
+        // Read the boundary after the size, so that it never points past
+        // the bytes we are about to read
+        uint8_t boundaryCount = ibus->rxBoundaryCount;
+        uint16_t toBoundary = ibus->rxBoundarySeq - ibus->rxReadSeq;
+        if (boundaryCount != ibus->rxBoundaryDone && toBoundary < available) {
+            // The bus went quiet before this byte, so whatever is left of
+            // the previous frame will never be completed
+            IBusRXRead(ibus, toBoundary);
+            IBusDecode(ibus, 1);
+            ibus->rxBoundaryDone = boundaryCount;
         }
-        if (pkt[IBUS_PKT_CMD] == IBUS_CMD_RAD_UPDATE_MAIN_AREA) {
-            EventTriggerCallback(IBusEvent_RADUpdateMainArea, pkt);
+        IBusRXRead(ibus, CharQueueGetSize(&ibus->uart.rxQueue));
+        if (ibus->rxLastStamp == 0) {
+            // Stir in when the bus first spoke to us, which varies from one
+            // start to the next far more than the time we boot in
+            srand(rand() ^ ibus->rxLastByteMicros);
+            EventTriggerCallback(IBusEvent_FirstMessageReceived, 0);
         }
-    } else if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_MID) {
-        if (pkt[IBUS_PKT_CMD] == IBUS_CMD_RAD_WRITE_MID_DISPLAY) {
-            if (pkt[4] == 0xC0) {
-                EventTriggerCallback(IBusEvent_RADMIDDisplayText, pkt);
-            }
-        } else if (pkt[IBUS_PKT_CMD] == IBUS_CMD_RAD_WRITE_MID_MENU) {
-            EventTriggerCallback(IBusEvent_RADMIDDisplayMenu, pkt);
+        ibus->rxLastStamp = now;
+        IBusDecode(ibus, 0);
+    } else if (ibus->rxBufferIdx > 0) {
+        uint32_t lastByteMicros;
+        do {
+            lastByteMicros = ibus->rxLastByteMicros;
+        } while (lastByteMicros != ibus->rxLastByteMicros);
+        if ((TimerGetMicros() - lastByteMicros) > IBUS_RX_FRAME_GAP) {
+            // The bus went quiet in the middle of a frame
+            IBusDecode(ibus, 1);
         }
     }
+
+    IBusUpdateBusLoad(ibus, now);
+    workDone |= IBusTransmit(ibus);
+    IBusRecorderProcess();
+    UARTReportErrors(&ibus->uart);
+    return workDone;
 }
 
-static void IBusHandleMessageForTEL(unsigned char *pkt)
+/**
+ * IBusGetTXClass()
+ *     Description:
+ *         Decide how urgent an outgoing frame is. Replies that another module
+ *         is waiting on go first, display text goes last and everything else,
+ *         like door locks and blinkers, sits in between.
+ *     Params:
+ *         const unsigned char cmd - The command byte of the frame
+ *     Returns:
+ *         uint8_t - The IBUS_TX_CLASS_* of the frame
+ */
+static uint8_t IBusGetTXClass(const unsigned char cmd)
 {
-    if (pkt[IBUS_PKT_CMD] == IBUS_CMD_MOD_STATUS_REQ) {
-        EventTriggerCallback(IBusEvent_ModuleStatusRequest, pkt);
+    switch (cmd) {
+        case IBUS_CMD_MOD_STATUS_RESP:
+        case IBUS_COMMAND_CDC_SET_STATUS:
+        case IBUS_TEL_CMD_STATUS:
+            return IBUS_TX_CLASS_PROTOCOL;
+        case IBUS_CMD_GT_WRITE_MK4:
+        case IBUS_CMD_GT_WRITE_TITLE:
+        case IBUS_CMD_GT_WRITE_MK2:
+            return IBUS_TX_CLASS_DISPLAY;
     }
+    return IBUS_TX_CLASS_CONTROL;
 }
 
-static uint8_t IBusValidateChecksum(unsigned char *msg)
-{
-    uint8_t chk = 0;
-    uint8_t msgSize = msg[1] + 2;
-    uint8_t idx;
-    for (idx = 0; idx < msgSize; idx++) {
-        chk =  chk ^ msg[idx];
-    }
-    if (chk == 0) {
-        return 1;
+/**
+ * IBusTXIsSameField()
+ *     Description:
+ *         Check if two display frames write the same field on the same
+ *         display, so that the newer one makes the older one pointless.
+ *         Text writes carry their field in the bytes after the command:
+ *         the layout and index for 0x21 and 0xA5 writes, and the layout and
+ *         area for 0x23 writes. Short frames without text, like the GT
+ *         refresh, are never treated as the same field since their position
+ *         relative to the writes around them matters.
+ *     Params:
+ *         const unsigned char *queued - The frame waiting in the TX buffer
+ *         const unsigned char *msg - The new frame
+ *     Returns:
+ *         uint8_t - 1 if the new frame supersedes the queued one
+ */
+static uint8_t IBusTXIsSameField(
+    const unsigned char *queued,
+    const unsigned char *msg
+) {
+    uint8_t keyLength = 0;
+    if (msg[IBUS_PKT_CMD] == IBUS_CMD_GT_WRITE_TITLE) {
+        keyLength = 2;
     } else {
+        keyLength = 3;
+    }
+    // Require text after the field bytes in both frames
+    if (msg[IBUS_PKT_LEN] <= keyLength + 3 ||
+        queued[IBUS_PKT_LEN] <= keyLength + 3
+    ) {
+        return 0;
+    }
+    if (queued[IBUS_PKT_DST] != msg[IBUS_PKT_DST] ||
+        memcmp(&queued[IBUS_PKT_CMD], &msg[IBUS_PKT_CMD], keyLength + 1) != 0
+    ) {
         return 0;
     }
+    return 1;
 }
 
 /**
- * IBusProcess()
+ * IBusTXEnqueue()
  *     Description:
- *         Process messages in the IBus RX queue
+ *         Queue the complete frame in the staging slot in its priority class.
+ *         Slots are handed around by index, so the frame is never copied:
+ *         the staging slot joins the queue, and a free slot takes its place.
+ *         When the buffer is full, display frames are evicted to make room
+ *         for more important ones. Frames that do not fit are refused, never
+ *         written over a frame that is still waiting to go out. The
+ *         exception is a display write that supersedes a queued write to the
+ *         same field, which takes the place of that write so that stale text
+ *         never plays out.
  *     Params:
  *         IBus_t *ibus
  *     Returns:
- *         void
+ *         None
  */
-void IBusProcess(IBus_t *ibus)
+static void IBusTXEnqueue(IBus_t *ibus)
 {
-    // Read messages from the IBus and if none are available, attempt to
-    // transmit whatever is sitting in the transmit buffer
-    if (ibus->uart.rxQueue.size > 0) {
-        ibus->rxBuffer[ibus->rxBufferIdx++] = CharQueueNext(&ibus->uart.rxQueue);
-        if (ibus->rxBufferIdx > 1) {
-            uint8_t msgLength = (uint8_t) ibus->rxBuffer[1] + 2;
-            // Make sure we do not read more than the maximum packet length
-            if (msgLength > IBUS_MAX_MSG_LENGTH) {
-                long long unsigned int ts = (long long unsigned int) TimerGetMillis();
-                LogRawDebug(
-                    LOG_SOURCE_IBUS,
-                    "[%llu] ERROR: IBus: RX Invalid Length [%d - %02X]: ",
-                    ts,
-                    msgLength,
-                    ibus->rxBuffer[1]
-                );
-                uint8_t idx;
-                for (idx = 0; idx < ibus->rxBufferIdx; idx++) {
-                    LogRawDebug(LOG_SOURCE_IBUS, "%02X ", ibus->rxBuffer[idx]);
-                }
-                LogRawDebug(LOG_SOURCE_IBUS, "\r\n");
-                ibus->rxBufferIdx = 0;
-                memset(ibus->rxBuffer, 0, IBUS_RX_BUFFER_SIZE);
-                CharQueueReset(&ibus->uart.rxQueue);
-            } else if (msgLength == ibus->rxBufferIdx) {
-                uint8_t idx;
-                unsigned char pkt[msgLength];
-                long long unsigned int ts = (long long unsigned int) TimerGetMillis();
-                LogRawDebug(LOG_SOURCE_IBUS, "[%llu] DEBUG: IBus: RX[%d]: ", ts, msgLength);
-                for(idx = 0; idx < msgLength; idx++) {
-                    pkt[idx] = ibus->rxBuffer[idx];
-                    LogRawDebug(LOG_SOURCE_IBUS, "%02X ", pkt[idx]);
-                }
-                if (memcmp(ibus->txBuffer[ibus->txBufferReadbackIdx], pkt, msgLength) == 0) {
-                    LogRawDebug(LOG_SOURCE_IBUS, "[SELF]");
-                    memset(ibus->txBuffer[ibus->txBufferReadbackIdx], 0, msgLength);
-                    if (ibus->txBufferReadbackIdx + 1 == IBUS_TX_BUFFER_SIZE) {
-                        ibus->txBufferReadbackIdx = 0;
-                    } else {
-                        ibus->txBufferReadbackIdx++;
-                    }
-                }
-                LogRawDebug(LOG_SOURCE_IBUS, "\r\n");
-                if (IBusValidateChecksum(pkt) == 1) {
-                    unsigned char srcSystem = pkt[IBUS_PKT_SRC];
-                    if (srcSystem == IBUS_DEVICE_RAD) {
-                        IBusHandleRadioMessage(ibus, pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_BMBT) {
-                        IBusHandleBMBTMessage(pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_IKE) {
-                        IBusHandleIKEMessage(ibus, pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_GT) {
-                        IBusHandleGTMessage(ibus, pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_LCM) {
-                        IBusHandleLCMMessage(ibus, pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_MID) {
-                        IBusHandleMIDMessage(ibus, pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_MFL) {
-                        IBusHandleMFLMessage(ibus, pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_DSP) {
-                        IBusHandleDSPMessage(pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_GM) {
-                        IBusHandleGMMessage(pkt);
-                    }
-                    if (srcSystem == IBUS_DEVICE_EWS) {
-                        IBusHandleEWSMessage(pkt);
-                    }
-                    if (pkt[IBUS_PKT_DST] == IBUS_DEVICE_TEL) {
-                        IBusHandleMessageForTEL(pkt);
-                    }
-                } else {
-                    LogError(
-                        "IBus: %02X -> %02X Length: %d - Invalid Checksum",
-                        pkt[0],
-                        pkt[IBUS_PKT_DST],
-                        msgLength,
-                        (uint8_t) pkt[IBUS_PKT_LEN]
-                    );
-                }
-                memset(ibus->rxBuffer, 0, IBUS_RX_BUFFER_SIZE);
-                ibus->rxBufferIdx = 0;
+    uint8_t stage = ibus->txStageSlot;
+    unsigned char *msg = ibus->txBuffer[stage];
+    uint8_t txClass = IBusGetTXClass(msg[IBUS_PKT_CMD]);
+    IBusTXQueue_t *queue = &ibus->txQueues[txClass];
+    uint8_t idx;
+    if (txClass == IBUS_TX_CLASS_DISPLAY) {
+        for (idx = 0; idx < queue->count; idx++) {
+            uint8_t slot = queue->slots[idx];
+            if (slot != ibus->txActiveSlot &&
+                IBusTXIsSameField(ibus->txBuffer[slot], msg) == 1
+            ) {
+                ibus->txCoalescedFrames++;
+                ibus->txCoalescedBytes += ibus->txBuffer[slot][IBUS_PKT_LEN] + 2;
+                // Keep the age and retries of the frame that we replace
+                ibus->txBufferStamp[stage] = ibus->txBufferStamp[slot];
+                ibus->txBufferRetries[stage] = ibus->txBufferRetries[slot];
+                queue->slots[idx] = stage;
+                ibus->txStageSlot = slot;
+                return;
             }
         }
-        if (ibus->rxLastStamp == 0) {
-            EventTriggerCallback(IBusEvent_FirstMessageReceived, 0);
-        }
-        ibus->rxLastStamp = TimerGetMillis();
     }
-
-    // Flush the transmit buffer out to the bus
-    uint8_t txTimeout = 0;
-    uint8_t beginTxTimestamp = TimerGetMillis();
-    while (ibus->txBufferWriteIdx != ibus->txBufferReadIdx &&
-           txTimeout == IBUS_TX_TIMEOUT_OFF
-    ) {
-        uint32_t now = TimerGetMillis();
-        if ((now - ibus->txLastStamp) >= IBUS_TX_BUFFER_WAIT) {
-            uint8_t msgLen = (uint8_t) ibus->txBuffer[ibus->txBufferReadIdx][1] + 2;
-            uint8_t idx;
-            /*
-             * Make sure that the STATUS pin on the TH3122 is low, indicating no
-             * bus activity before transmitting
-             */
-            if (IBUS_UART_STATUS == 0) {
-                for (idx = 0; idx < msgLen; idx++) {
-                    ibus->uart.registers->uxtxreg = ibus->txBuffer[ibus->txBufferReadIdx][idx];
-                    // Wait for the data to leave the TX buffer
-                    while ((ibus->uart.registers->uxsta & (1 << 9)) != 0);
-                }
-                txTimeout = IBUS_TX_TIMEOUT_DATA_SENT;
-                if (ibus->txBufferReadIdx + 1 == IBUS_TX_BUFFER_SIZE) {
-                    ibus->txBufferReadIdx = 0;
-                } else {
-                    ibus->txBufferReadIdx++;
-                }
-                ibus->txLastStamp = TimerGetMillis();
-            } else if (txTimeout != IBUS_TX_TIMEOUT_DATA_SENT) {
-                if ((now - beginTxTimestamp) > IBUS_TX_TIMEOUT_WAIT) {
-                    txTimeout = IBUS_TX_TIMEOUT_ON;
-                }
-            }
-        }
+    if (txClass == IBUS_TX_CLASS_DISPLAY && queue->count >= IBUS_TX_DISPLAY_MAX) {
+        IBusTrace(
+            ibus,
+            IBUS_TRACE_TX_DROPPED,
+            msg,
+            msg[IBUS_PKT_LEN] + 2,
+            TimerGetMicros()
+        );
+        queue->dropped++;
+        LogDebug(LOG_SOURCE_IBUS, "IBus: TX display queue full");
+        return;
     }
-
-    // Clear the RX Buffer if it's over the timeout or about to overflow
-    if (ibus->rxBufferIdx > 0) {
-        uint32_t now = TimerGetMillis();
-        if ((now - ibus->rxLastStamp) > IBUS_RX_BUFFER_TIMEOUT ||
-            (ibus->rxBufferIdx + 1) == IBUS_RX_BUFFER_SIZE
-        ) {
-            long long unsigned int ts = (long long unsigned int) TimerGetMillis();
-            LogRawDebug(
-                LOG_SOURCE_IBUS,
-                "[%llu] ERROR: IBus: RX Buffer Timeout [%d]: ",
-                ts,
-                ibus->rxBufferIdx
+    if (ibus->txBufferUsed == 0xFFFF) {
+        uint8_t evicted = 0;
+        if (txClass != IBUS_TX_CLASS_DISPLAY) {
+            evicted = IBusTXQueueEvict(ibus, IBUS_TX_CLASS_DISPLAY);
+        }
+        if (evicted == 0 && txClass == IBUS_TX_CLASS_PROTOCOL) {
+            evicted = IBusTXQueueEvict(ibus, IBUS_TX_CLASS_CONTROL);
+        }
+        if (evicted == 0) {
+            IBusTrace(
+                ibus,
+                IBUS_TRACE_TX_DROPPED,
+                msg,
+                msg[IBUS_PKT_LEN] + 2,
+                TimerGetMicros()
             );
-            uint8_t idx;
-            for (idx = 0; idx < ibus->rxBufferIdx; idx++) {
-                LogRawDebug(LOG_SOURCE_IBUS, "%02X ", ibus->rxBuffer[idx]);
-            }
-            LogRawDebug(LOG_SOURCE_IBUS, "\r\n");
-            ibus->rxBufferIdx = 0;
-            memset(ibus->rxBuffer, 0, IBUS_RX_BUFFER_SIZE);
+            queue->dropped++;
+            LogDebug(LOG_SOURCE_IBUS, "IBus: TX buffer full");
+            return;
         }
     }
-    UARTReportErrors(&ibus->uart);
+    /* Store the data into a buffer, so we can spread out their transmission */
+    ibus->txBufferStamp[stage] = TimerGetMillis();
+    ibus->txBufferRetries[stage] = 0;
+    queue->slots[queue->count++] = stage;
+    if (queue->count > queue->highWater) {
+        queue->highWater = queue->count;
+    }
+    uint8_t slot = 0;
+    while ((ibus->txBufferUsed & (1U << slot)) != 0) {
+        slot++;
+    }
+    if (slot == ibus->txReadbackSlot) {
+        ibus->txReadbackSlot = IBUS_TX_SLOT_NONE;
+    }
+    ibus->txBufferUsed |= 1U << slot;
+    ibus->txStageSlot = slot;
+}
+
+/**
+ * IBusTXReserve()
+ *     Description:
+ *         Start a frame in the TX staging slot and hand back where its data
+ *         goes, so that builders can write it in place. There is always a
+ *         staging slot, so this cannot fail. Every reservation has to be
+ *         followed by IBusTXCommit() before the next one.
+ *     Params:
+ *         IBus_t *ibus
+ *         const unsigned char src - The system sending the frame
+ *         const unsigned char dst - The system to address the frame to
+ *         uint8_t dataSize - The number of data bytes, the command included,
+ *             at most IBUS_TX_MAX_DATA_LENGTH
+ *     Returns:
+ *         unsigned char * - The command byte of the frame, followed by room
+ *             for the rest of the data
+ */
+unsigned char *IBusTXReserve(
+    IBus_t *ibus,
+    const unsigned char src,
+    const unsigned char dst,
+    uint8_t dataSize
+) {
+    unsigned char *frame = ibus->txBuffer[ibus->txStageSlot];
+    frame[IBUS_PKT_SRC] = src;
+    frame[IBUS_PKT_LEN] = dataSize + 2;
+    frame[IBUS_PKT_DST] = dst;
+    return &frame[IBUS_PKT_CMD];
+}
+
+/**
+ * IBusTXCommit()
+ *     Description:
+ *         Add the checksum to the frame started with IBusTXReserve() and
+ *         queue it for transmission
+ *     Params:
+ *         IBus_t *ibus
+ *     Returns:
+ *         None
+ */
+void IBusTXCommit(IBus_t *ibus)
+{
+    unsigned char *frame = ibus->txBuffer[ibus->txStageSlot];
+    uint8_t crcIdx = frame[IBUS_PKT_LEN] + 1;
+    uint8_t crc = 0;
+    uint8_t idx;
+    for (idx = 0; idx < crcIdx; idx++) {
+        crc ^= frame[idx];
+    }
+    frame[crcIdx] = crc;
+    IBusTXEnqueue(ibus);
 }
 
 /**
  * IBusSendCommand()
  *     Description:
  *         Take a Destination, source and message and add it to the transmit
- *         char queue so we can send it later.
+ *         queue so we can send it later.
  *     Params:
  *         IBus_t *ibus,
  *         const unsigned char src,
  *         const unsigned char dst,
  *         const unsigned char *data
+ *         const size_t dataSize
  *     Returns:
  *         void
  */
@@ -559,34 +1596,29 @@ void IBusSendCommand(
     const unsigned char *data,
     const size_t dataSize
 ) {
-    uint8_t idx, msgSize;
-    msgSize = dataSize + 4;
-    unsigned char msg[msgSize];
-    msg[0] = src;
-    msg[1] = dataSize + 2;
-    msg[2] = dst;
-    idx = 3;
-    uint8_t i;
-    // Add the Data to the packet
-    for (i = 0; i < dataSize; i++) {
-        msg[idx++] = data[i];
-    }
-    // Calculate the CRC
-    uint8_t crc = 0;
-    uint8_t maxIdx = msgSize - 1;
-    for (idx = 0; idx < maxIdx; idx++) {
-        crc ^= msg[idx];
-    }
-    msg[msgSize - 1] = (unsigned char) crc;
-    for (idx = 0; idx < msgSize; idx++) {
-        ibus->txBuffer[ibus->txBufferWriteIdx][idx] = msg[idx];
-    }
-    /* Store the data into a buffer, so we can spread out their transmission */
-    if (ibus->txBufferWriteIdx + 1 == IBUS_TX_BUFFER_SIZE) {
-        ibus->txBufferWriteIdx = 0;
-    } else {
-        ibus->txBufferWriteIdx++;
+    if (dataSize == 0 || dataSize > IBUS_TX_MAX_DATA_LENGTH) {
+        LogError("IBus: Refusing to send %d data bytes", (int) dataSize);
+        return;
     }
+    memcpy(IBusTXReserve(ibus, src, dst, dataSize), data, dataSize);
+    IBusTXCommit(ibus);
+}
+
+/**
+ * IBusSendFrame()
+ *     Description:
+ *         Queue a complete frame, checksum included, such as the constant
+ *         frames that are kept in program memory
+ *     Params:
+ *         IBus_t *ibus
+ *         const unsigned char *frame - The frame to send
+ *     Returns:
+ *         void
+ */
+void IBusSendFrame(IBus_t *ibus, const unsigned char *frame)
+{
+    memcpy(ibus->txBuffer[ibus->txStageSlot], frame, frame[IBUS_PKT_LEN] + 2);
+    IBusTXEnqueue(ibus);
 }
 
 uint8_t IBusGetDeviceManufacturer(const unsigned char mfgByte) {
@@ -863,6 +1895,13 @@ uint8_t IBusGetVehicleType(unsigned char *packet)
     return detectedVehicleType;
 }
 
+static const unsigned char IBusFrameCDCAnnounce[] = IBUS_FRAME_2(
+    IBUS_DEVICE_CDC,
+    IBUS_DEVICE_LOC,
+    0x02,
+    0x01
+);
+
 /**
  * IBusCommandCDCAnnounce()
  *     Description:
@@ -874,10 +1913,16 @@ uint8_t IBusGetVehicleType(unsigned char *packet)
  */
 void IBusCommandCDCAnnounce(IBus_t *ibus)
 {
-    const unsigned char cdcAlive[] = {0x02, 0x01};
-    IBusSendCommand(ibus, IBUS_DEVICE_CDC, IBUS_DEVICE_LOC, cdcAlive, sizeof(cdcAlive));
+    IBusSendFrame(ibus, IBusFrameCDCAnnounce);
 }
 
+static const unsigned char IBusFrameCDCPollResponse[] = IBUS_FRAME_2(
+    IBUS_DEVICE_CDC,
+    IBUS_DEVICE_RAD,
+    0x02,
+    0x00
+);
+
 /**
  * IBusCommandCDCPollResponse()
  *     Description:
@@ -889,8 +1934,7 @@ void IBusCommandCDCAnnounce(IBus_t *ibus)
  */
 void IBusCommandCDCPollResponse(IBus_t *ibus)
 {
-    const unsigned char cdcPing[] = {0x02, 0x00};
-    IBusSendCommand(ibus, IBUS_DEVICE_CDC, IBUS_DEVICE_RAD, cdcPing, sizeof(cdcPing));
+    IBusSendFrame(ibus, IBusFrameCDCPollResponse);
 }
 
 /**
@@ -911,28 +1955,25 @@ void IBusCommandCDCStatus(
     unsigned char function,
     unsigned char discCount
 ) {
-    function = function + 0x80;
-    const unsigned char cdcStatus[] = {
-        IBUS_COMMAND_CDC_SET_STATUS,
-        status,
-        function,
-        0x00, // Errors
-        discCount,
-        0x00,
-        0x01,
-        0x01,
-        0x00,
-        0x01,
-        0x01,// Disc Number
-        0x01 // Track Number
-    };
-    IBusSendCommand(
+    unsigned char *cdcStatus = IBusTXReserve(
         ibus,
         IBUS_DEVICE_CDC,
         IBUS_DEVICE_RAD,
-        cdcStatus,
-        sizeof(cdcStatus)
+        12
     );
+    cdcStatus[0] = IBUS_COMMAND_CDC_SET_STATUS;
+    cdcStatus[1] = status;
+    cdcStatus[2] = function + 0x80;
+    cdcStatus[3] = 0x00; // Errors
+    cdcStatus[4] = discCount;
+    cdcStatus[5] = 0x00;
+    cdcStatus[6] = 0x01;
+    cdcStatus[7] = 0x01;
+    cdcStatus[8] = 0x00;
+    cdcStatus[9] = 0x01;
+    cdcStatus[10] = 0x01; // Disc Number
+    cdcStatus[11] = 0x01; // Track Number
+    IBusTXCommit(ibus);
 }
 
 /**
@@ -1098,6 +2139,23 @@ void IBusCommandSetModuleStatus(
     IBusSendCommand(ibus, source, system, msg, 2);
 }
 
+static const unsigned char IBusFrameGMDoorCenterLockButtonE46[] = IBUS_FRAME_3(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    IBUS_CMD_ZKE5_JOB_CENTRAL_LOCK, // Job
+    0x01 // On / Off
+);
+
+static const unsigned char IBusFrameGMDoorCenterLockButtonE38[] = IBUS_FRAME_4(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    0x00, // Sub-Module
+    IBUS_CMD_ZKE3_GM4_JOB_CENTRAL_LOCK, // Job
+    0x01 // On / Off
+);
+
 /**
  * IBusCommandGMDoorCenterLockButton()
  *     Description:
@@ -1111,23 +2169,29 @@ void IBusCommandSetModuleStatus(
 void IBusCommandGMDoorCenterLockButton(IBus_t *ibus)
 {
     if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E46_Z4) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            IBUS_CMD_ZKE5_JOB_CENTRAL_LOCK, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorCenterLockButtonE46);
     } else if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E38_E39_E53) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            0x00, // Sub-Module
-            IBUS_CMD_ZKE3_GM4_JOB_CENTRAL_LOCK, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorCenterLockButtonE38);
     }
 }
 
+static const unsigned char IBusFrameGMDoorUnlockHighE46[] = IBUS_FRAME_3(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    IBUS_CMD_ZKE5_JOB_UNLOCK_HIGH, // Job
+    0x01 // On / Off
+);
+
+static const unsigned char IBusFrameGMDoorUnlockHighE38[] = IBUS_FRAME_4(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    0x00, // Sub-Module
+    IBUS_CMD_ZKE3_GM4_JOB_UNLOCK_HIGH, // Job
+    0x01 // On / Off
+);
+
 /**
  * IBusCommandGMDoorUnlockHigh()
  *     Description:
@@ -1140,23 +2204,29 @@ void IBusCommandGMDoorCenterLockButton(IBus_t *ibus)
 void IBusCommandGMDoorUnlockHigh(IBus_t *ibus)
 {
     if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E46_Z4) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            IBUS_CMD_ZKE5_JOB_UNLOCK_HIGH, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorUnlockHighE46);
     } else if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E38_E39_E53) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            0x00, // Sub-Module
-            IBUS_CMD_ZKE3_GM4_JOB_UNLOCK_HIGH, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorUnlockHighE38);
     }
 }
 
+static const unsigned char IBusFrameGMDoorUnlockLowE46[] = IBUS_FRAME_3(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    IBUS_CMD_ZKE5_JOB_UNLOCK_LOW, // Job
+    0x01 // On / Off
+);
+
+static const unsigned char IBusFrameGMDoorUnlockLowE38[] = IBUS_FRAME_4(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    0x00, // Sub-Module
+    IBUS_CMD_ZKE3_GM4_JOB_UNLOCK_LOW, // Job
+    0x01 // On / Off
+);
+
 /**
  * IBusCommandGMDoorUnlockLow()
  *     Description:
@@ -1169,23 +2239,29 @@ void IBusCommandGMDoorUnlockHigh(IBus_t *ibus)
 void IBusCommandGMDoorUnlockLow(IBus_t *ibus)
 {
     if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E46_Z4) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            IBUS_CMD_ZKE5_JOB_UNLOCK_LOW, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorUnlockLowE46);
     } else if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E38_E39_E53) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            0x00, // Sub-Module
-            IBUS_CMD_ZKE3_GM4_JOB_UNLOCK_LOW, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorUnlockLowE38);
     }
 }
 
+static const unsigned char IBusFrameGMDoorLockHighE46[] = IBUS_FRAME_3(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    IBUS_CMD_ZKE5_JOB_LOCK_HIGH, // Job
+    0x01 // On / Off
+);
+
+static const unsigned char IBusFrameGMDoorLockHighE38[] = IBUS_FRAME_4(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    0x00, // Sub-Module
+    IBUS_CMD_ZKE3_GM4_JOB_LOCK_HIGH, // Job
+    0x01 // On / Off
+);
+
 /**
  * IBusCommandGMDoorLockHigh()
  *     Description:
@@ -1198,23 +2274,29 @@ void IBusCommandGMDoorUnlockLow(IBus_t *ibus)
 void IBusCommandGMDoorLockHigh(IBus_t *ibus)
 {
     if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E46_Z4) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            IBUS_CMD_ZKE5_JOB_LOCK_HIGH, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorLockHighE46);
     } else if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E38_E39_E53) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            0x00, // Sub-Module
-            IBUS_CMD_ZKE3_GM4_JOB_LOCK_HIGH, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorLockHighE38);
     }
 }
 
+static const unsigned char IBusFrameGMDoorLockLowE46[] = IBUS_FRAME_3(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    IBUS_CMD_ZKE5_JOB_LOCK_LOW, // Job
+    0x01 // On / Off
+);
+
+static const unsigned char IBusFrameGMDoorLockLowE38[] = IBUS_FRAME_4(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    0x00, // Sub-Module
+    IBUS_CMD_ZKE3_GM4_JOB_LOCK_LOW, // Job
+    0x01 // On / Off
+);
+
 /**
  * IBusCommandGMDoorLockLow()
  *     Description:
@@ -1227,23 +2309,29 @@ void IBusCommandGMDoorLockHigh(IBus_t *ibus)
 void IBusCommandGMDoorLockLow(IBus_t *ibus)
 {
     if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E46_Z4) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            IBUS_CMD_ZKE5_JOB_LOCK_LOW, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorLockLowE46);
     } else if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E38_E39_E53) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            0x00, // Sub-Module
-            IBUS_CMD_ZKE3_GM4_JOB_LOCK_LOW, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorLockLowE38);
     }
 }
 
+static const unsigned char IBusFrameGMDoorUnlockAllE46[] = IBUS_FRAME_3(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    IBUS_CMD_ZKE5_JOB_UNLOCK_ALL, // Job
+    0x01 // On / Off
+);
+
+static const unsigned char IBusFrameGMDoorUnlockAllE38[] = IBUS_FRAME_4(
+    IBUS_DEVICE_DIA,
+    IBUS_DEVICE_GM,
+    IBUS_CMD_DIA_JOB_REQUEST,
+    0x00, // Sub-Module
+    IBUS_CMD_ZKE3_GM4_JOB_CENTRAL_LOCK, // Job
+    0x01 // On / Off
+);
+
 /**
  * IBusCommandGMDoorLockLow()
  *     Description:
@@ -1256,21 +2344,10 @@ void IBusCommandGMDoorLockLow(IBus_t *ibus)
 void IBusCommandGMDoorUnlockAll(IBus_t *ibus)
 {
     if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E46_Z4) {
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            IBUS_CMD_ZKE5_JOB_UNLOCK_ALL, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorUnlockAllE46);
     } else if (ibus->vehicleType == IBUS_VEHICLE_TYPE_E38_E39_E53) {
         // Central unlock unlocks all doors on the ZKE3
-        unsigned char msg[] = {
-            IBUS_CMD_DIA_JOB_REQUEST,
-            0x00, // Sub-Module
-            IBUS_CMD_ZKE3_GM4_JOB_CENTRAL_LOCK, // Job
-            0x01 // On / Off
-        };
-        IBusSendCommand(ibus, IBUS_DEVICE_DIA, IBUS_DEVICE_GM, msg, sizeof(msg));
+        IBusSendFrame(ibus, IBusFrameGMDoorUnlockAllE38);
     }
 }
 
@@ -1303,7 +2380,12 @@ static void IBusInternalCommandGTWriteIndex(
         length = 20;
     }
     const size_t pktLenght = length + 4;
-    unsigned char text[pktLenght];
+    unsigned char *text = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_GT,
+        pktLenght
+    );
     text[0] = command;
     text[1] = indexMode;
     text[2] = 0x00;
@@ -1312,7 +2394,7 @@ static void IBusInternalCommandGTWriteIndex(
     for (idx = 0; idx < length; idx++) {
         text[idx + 4] = message[idx];
     }
-    IBusSendCommand(ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, text, pktLenght);
+    IBusTXCommit(ibus);
 }
 
 /**
@@ -1332,7 +2414,12 @@ void IBusCommandGTWriteBusinessNavTitle(IBus_t *ibus, char *message) {
         length = 11;
     }
     const size_t pktLenght = length + 3;
-    unsigned char text[pktLenght];
+    unsigned char *text = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_GT,
+        pktLenght
+    );
     text[0] = 0x23;
     text[1] = 0x40;
     text[2] = 0x30;
@@ -1340,7 +2427,7 @@ void IBusCommandGTWriteBusinessNavTitle(IBus_t *ibus, char *message) {
     for (idx = 0; idx < length; idx++) {
         text[idx + 3] = message[idx];
     }
-    IBusSendCommand(ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, text, pktLenght);
+    IBusTXCommit(ibus);
 }
 
 void IBusCommandGTWriteIndex(
@@ -1375,7 +2462,12 @@ void IBusCommandGTWriteIndexTitle(IBus_t *ibus, char *message) {
         length = 20;
     }
     const size_t pktLenght = length + 4;
-    unsigned char text[pktLenght];
+    unsigned char *text = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_GT,
+        pktLenght
+    );
     text[0] = 0x21;
     text[1] = 0x61;
     text[2] = 0x00;
@@ -1384,7 +2476,7 @@ void IBusCommandGTWriteIndexTitle(IBus_t *ibus, char *message) {
     for (idx = 0; idx < length; idx++) {
         text[idx + 4] = message[idx];
     }
-    IBusSendCommand(ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, text, pktLenght);
+    IBusTXCommit(ibus);
 }
 
 void IBusCommandGTWriteIndexStatic(IBus_t *ibus, uint8_t index, char *message)
@@ -1394,7 +2486,12 @@ void IBusCommandGTWriteIndexStatic(IBus_t *ibus, uint8_t index, char *message)
         length = 38;
     }
     const size_t pktLenght = length + 4;
-    unsigned char text[pktLenght];
+    unsigned char *text = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_GT,
+        pktLenght
+    );
     text[0] = IBUS_CMD_GT_WRITE_MK4;
     text[1] = IBUS_CMD_GT_WRITE_STATIC;
     text[2] = 0x00;
@@ -1403,7 +2500,7 @@ void IBusCommandGTWriteIndexStatic(IBus_t *ibus, uint8_t index, char *message)
     for (idx = 0; idx < length; idx++) {
         text[idx + 4] = message[idx];
     }
-    IBusSendCommand(ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, text, pktLenght);
+    IBusTXCommit(ibus);
 }
 
 /**
@@ -1424,7 +2521,12 @@ void IBusCommandGTWriteTitleArea(IBus_t *ibus, char *message)
     }
     // Length + Write Type + Write Area + Size
     const size_t pktLenght = length + 3;
-    unsigned char text[pktLenght];
+    unsigned char *text = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_GT,
+        pktLenght
+    );
     text[0] = IBUS_CMD_GT_WRITE_TITLE;
     text[1] = IBUS_CMD_GT_WRITE_ZONE;
     text[2] = 0x30;
@@ -1432,7 +2534,7 @@ void IBusCommandGTWriteTitleArea(IBus_t *ibus, char *message)
     for (idx = 0; idx < length; idx++) {
         text[idx + 3] = message[idx];
     }
-    IBusSendCommand(ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, text, pktLenght);
+    IBusTXCommit(ibus);
 }
 
 /**
@@ -1453,7 +2555,12 @@ void IBusCommandGTWriteTitleIndex(IBus_t *ibus, char *message)
     }
     // Length + Write Type + Write Area + Write Index + Size
     const size_t pktLenght = length + 4;
-    unsigned char text[pktLenght];
+    unsigned char *text = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_GT,
+        pktLenght
+    );
     text[0] = IBUS_CMD_GT_WRITE_MK4;
     text[1] = IBUS_CMD_GT_WRITE_ZONE;
     text[2] = 0x01;
@@ -1462,7 +2569,7 @@ void IBusCommandGTWriteTitleIndex(IBus_t *ibus, char *message)
     for (idx = 0; idx < length; idx++) {
         text[idx + 4] = message[idx];
     }
-    IBusSendCommand(ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, text, pktLenght);
+    IBusTXCommit(ibus);
 }
 
 void IBusCommandGTWriteTitleC43(IBus_t *ibus, char *message)
@@ -1473,7 +2580,12 @@ void IBusCommandGTWriteTitleC43(IBus_t *ibus, char *message)
     }
     // Length + Write Type + Write Area + Size + Watermark
     const size_t pktLenght = length + 8;
-    unsigned char text[pktLenght];
+    unsigned char *text = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_GT,
+        pktLenght
+    );
     text[0] = IBUS_CMD_GT_WRITE_TITLE;
     text[1] = 0x40;
     text[2] = 0x20;
@@ -1491,7 +2603,7 @@ void IBusCommandGTWriteTitleC43(IBus_t *ibus, char *message)
     idx++;
     // "Watermark" Any update we send, so we know that it was us
     text[idx + 3] = IBUS_RAD_MAIN_AREA_WATERMARK;
-    IBusSendCommand(ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, text, pktLenght);
+    IBusTXCommit(ibus);
 }
 
 void IBusCommandGTWriteZone(IBus_t *ibus, uint8_t index, char *message)
@@ -1501,7 +2613,12 @@ void IBusCommandGTWriteZone(IBus_t *ibus, uint8_t index, char *message)
         length = 11;
     }
     const size_t pktLenght = length + 4;
-    unsigned char text[pktLenght];
+    unsigned char *text = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_GT,
+        pktLenght
+    );
     text[0] = IBUS_CMD_GT_WRITE_MK2;
     text[1] = IBUS_CMD_GT_WRITE_ZONE;
     text[2] = 0x01;
@@ -1510,9 +2627,15 @@ void IBusCommandGTWriteZone(IBus_t *ibus, uint8_t index, char *message)
     for (idx = 0; idx < length; idx++) {
         text[idx + 4] = message[idx];
     }
-    IBusSendCommand(ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, text, pktLenght);
+    IBusTXCommit(ibus);
 }
 
+static const unsigned char IBusFrameIKEGetIgnitionStatus[] = IBUS_FRAME_1(
+    IBUS_DEVICE_CDC,
+    IBUS_DEVICE_IKE,
+    IBUS_CMD_IKE_IGN_STATUS_REQ
+);
+
 /**
  * IBusCommandIKEGetIgnitionStatus()
  *     Description:
@@ -1525,8 +2648,7 @@ void IBusCommandGTWriteZone(IBus_t *ibus, uint8_t index, char *message)
  */
 void IBusCommandIKEGetIgnitionStatus(IBus_t *ibus)
 {
-    unsigned char msg[] = {IBUS_CMD_IKE_IGN_STATUS_REQ};
-    IBusSendCommand(ibus, IBUS_DEVICE_CDC, IBUS_DEVICE_IKE, msg, 1);
+    IBusSendFrame(ibus, IBusFrameIKEGetIgnitionStatus);
 }
 
 /**
@@ -1541,21 +2663,24 @@ void IBusCommandIKEGetIgnitionStatus(IBus_t *ibus)
  */
 void IBusCommandIKEText(IBus_t *ibus, char *message)
 {
-    unsigned char displayText[strlen(message) + 3];
+    uint8_t textLength = strlen(message);
+    if (textLength > IBUS_TX_MAX_DATA_LENGTH - 3) {
+        textLength = IBUS_TX_MAX_DATA_LENGTH - 3;
+    }
+    unsigned char *displayText = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_TEL,
+        IBUS_DEVICE_IKE,
+        textLength + 3
+    );
     displayText[0] = 0x23;
     displayText[1] = 0x42;
     displayText[2] = 0x32;
     uint8_t idx;
-    for (idx = 0; idx < strlen(message); idx++) {
+    for (idx = 0; idx < textLength; idx++) {
         displayText[idx + 3] = message[idx];
     }
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_TEL,
-        IBUS_DEVICE_IKE,
-        displayText,
-        sizeof(displayText)
-    );
+    IBusTXCommit(ibus);
 }
 
 /**
@@ -1572,6 +2697,12 @@ void IBusCommandIKETextClear(IBus_t *ibus)
     IBusCommandIKEText(ibus, 0);
 }
 
+static const unsigned char IBusFrameIKEGetVehicleType[] = IBUS_FRAME_1(
+    IBUS_DEVICE_RAD,
+    IBUS_DEVICE_IKE,
+    IBUS_CMD_IKE_REQ_VEHICLE_TYPE
+);
+
 /**
  * IBusCommandIKEGetVehicleType()
  *     Description:
@@ -1584,14 +2715,7 @@ void IBusCommandIKETextClear(IBus_t *ibus)
  */
 void IBusCommandIKEGetVehicleType(IBus_t *ibus)
 {
-    unsigned char msg[] = {IBUS_CMD_IKE_REQ_VEHICLE_TYPE};
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_RAD,
-        IBUS_DEVICE_IKE,
-        msg,
-        1
-    );
+    IBusSendFrame(ibus, IBusFrameIKEGetVehicleType);
 }
 
 /**
@@ -1630,31 +2754,35 @@ void IBusCommandLCMEnableBlinker(IBus_t *ibus, unsigned char blinker) {
     }
     // Only fire the command if the light status byte is set
     if (lightStatus != 0x00) {
-        unsigned char msg[] = {
-            0x0C,
-            0x00,
-            0x00,
-            lightStatus,
-            lightStatus2,
-            0x00,
-            0x00,
-            0x00,
-            ioStatus,
-            0x00,
-            ibus->lcmDimmerStatus1,
-            ibus->lcmDimmerStatus2,
-            0x00
-        };
-        IBusSendCommand(
+        unsigned char *msg = IBusTXReserve(
             ibus,
             IBUS_DEVICE_DIA,
             IBUS_DEVICE_LCM,
-            msg,
-            sizeof(msg)
+            13
         );
+        msg[0] = 0x0C;
+        msg[1] = 0x00;
+        msg[2] = 0x00;
+        msg[3] = lightStatus;
+        msg[4] = lightStatus2;
+        msg[5] = 0x00;
+        msg[6] = 0x00;
+        msg[7] = 0x00;
+        msg[8] = ioStatus;
+        msg[9] = 0x00;
+        msg[10] = ibus->lcmDimmerStatus1;
+        msg[11] = ibus->lcmDimmerStatus2;
+        msg[12] = 0x00;
+        IBusTXCommit(ibus);
     }
 }
 
+static const unsigned char IBusFrameLCMGetRedundantData[] = IBUS_FRAME_1(
+    IBUS_DEVICE_IKE,
+    IBUS_DEVICE_LCM,
+    IBUS_CMD_LCM_REQ_REDUNDANT_DATA
+);
+
 /**
  * IBusCommandLCMGetRedundantData()
  *     Description:
@@ -1667,14 +2795,7 @@ void IBusCommandLCMEnableBlinker(IBus_t *ibus, unsigned char blinker) {
  */
 void IBusCommandLCMGetRedundantData(IBus_t *ibus)
 {
-    unsigned char msg[] = {IBUS_CMD_LCM_REQ_REDUNDANT_DATA};
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_IKE,
-        IBUS_DEVICE_LCM,
-        msg,
-        sizeof(msg)
-    );
+    IBusSendFrame(ibus, IBusFrameLCMGetRedundantData);
 }
 
 /**
@@ -1690,26 +2811,25 @@ void IBusCommandLCMGetRedundantData(IBus_t *ibus)
  */
 void IBusCommandMIDDisplayTitleText(IBus_t *ibus, char *message)
 {
-    unsigned char displayText[strlen(message) + 4];
-    displayText[0] = IBUS_CMD_RAD_WRITE_MID_DISPLAY;
-    displayText[1] = 0xC0;
-    displayText[2] = 0x20;
     uint8_t idx;
     uint8_t textLength = strlen(message);
     if (textLength > IBus_MID_TITLE_MAX_CHARS) {
-        textLength = IBus_MID_MAX_CHARS;
+        textLength = IBus_MID_TITLE_MAX_CHARS;
     }
-    for (idx = 0; idx < textLength; idx++) {
-        displayText[idx + 3] = message[idx];
-    }
-    displayText[idx + 3] = IBUS_RAD_MAIN_AREA_WATERMARK;
-    IBusSendCommand(
+    unsigned char *displayText = IBusTXReserve(
         ibus,
         IBUS_DEVICE_RAD,
         IBUS_DEVICE_MID,
-        displayText,
-        sizeof(displayText)
+        textLength + 4
     );
+    displayText[0] = IBUS_CMD_RAD_WRITE_MID_DISPLAY;
+    displayText[1] = 0xC0;
+    displayText[2] = 0x20;
+    for (idx = 0; idx < textLength; idx++) {
+        displayText[idx + 3] = message[idx];
+    }
+    displayText[idx + 3] = IBUS_RAD_MAIN_AREA_WATERMARK;
+    IBusTXCommit(ibus);
 }
 
 /**
@@ -1729,7 +2849,12 @@ void IBusCommandMIDDisplayText(IBus_t *ibus, char *message)
     if (textLength > IBus_MID_MAX_CHARS) {
         textLength = IBus_MID_MAX_CHARS;
     }
-    unsigned char displayText[textLength + 4];
+    unsigned char *displayText = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_IKE,
+        IBUS_DEVICE_MID,
+        textLength + 4
+    );
     displayText[0] = IBUS_CMD_RAD_WRITE_MID_DISPLAY;
     displayText[1] = 0x40;
     displayText[2] = 0x20;
@@ -1738,13 +2863,7 @@ void IBusCommandMIDDisplayText(IBus_t *ibus, char *message)
         displayText[idx + 3] = message[idx];
     }
     displayText[idx + 3] = IBUS_RAD_MAIN_AREA_WATERMARK;
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_IKE,
-        IBUS_DEVICE_MID,
-        displayText,
-        sizeof(displayText)
-    );
+    IBusTXCommit(ibus);
 }
 
 /**
@@ -1763,7 +2882,12 @@ void IBusCommandMIDMenuText(IBus_t *ibus, uint8_t idx, char *text)
     if (textLength > IBus_MID_MENU_MAX_CHARS) {
         textLength = IBus_MID_MENU_MAX_CHARS;
     }
-    unsigned char menuText[textLength + 4];
+    unsigned char *menuText = IBusTXReserve(
+        ibus,
+        IBUS_DEVICE_RAD,
+        IBUS_DEVICE_MID,
+        textLength + 4
+    );
     menuText[0] = IBUS_CMD_RAD_WRITE_MID_MENU;
     menuText[1] = 0xC3;
     menuText[2] = 0x00;
@@ -1772,13 +2896,7 @@ void IBusCommandMIDMenuText(IBus_t *ibus, uint8_t idx, char *text)
     for (textIdx = 0; textIdx < textLength; textIdx++) {
         menuText[textIdx + 4] = text[textIdx];
     }
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_RAD,
-        IBUS_DEVICE_MID,
-        menuText,
-        sizeof(menuText)
-    );
+    IBusTXCommit(ibus);
 }
 
 /**
@@ -1808,6 +2926,13 @@ void IBusCommandRADC43ScreenModeSet(IBus_t *ibus, unsigned char mode)
     );
 }
 
+static const unsigned char IBusFrameRADClearMenu[] = IBUS_FRAME_2(
+    IBUS_DEVICE_RAD,
+    IBUS_DEVICE_GT,
+    0x46,
+    0x0A
+);
+
 /**
  * IBusCommandRADClearMenu()
  *     Description:
@@ -1821,16 +2946,16 @@ void IBusCommandRADC43ScreenModeSet(IBus_t *ibus, unsigned char mode)
  */
 void IBusCommandRADClearMenu(IBus_t *ibus)
 {
-    unsigned char msg[] = {0x46, 0x0A};
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_RAD,
-        IBUS_DEVICE_GT,
-        msg,
-        sizeof(msg)
-    );
+    IBusSendFrame(ibus, IBusFrameRADClearMenu);
 }
 
+static const unsigned char IBusFrameRADDisableMenu[] = IBUS_FRAME_2(
+    IBUS_DEVICE_GT,
+    IBUS_DEVICE_RAD,
+    0x45,
+    0x02
+);
+
 /**
  * IBusCommandRADDisableMenu()
  *     Description:
@@ -1842,16 +2967,16 @@ void IBusCommandRADClearMenu(IBus_t *ibus)
  */
 void IBusCommandRADDisableMenu(IBus_t *ibus)
 {
-    unsigned char msg[] = {0x45, 0x02};
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_GT,
-        IBUS_DEVICE_RAD,
-        msg,
-        sizeof(msg)
-    );
+    IBusSendFrame(ibus, IBusFrameRADDisableMenu);
 }
 
+static const unsigned char IBusFrameRADEnableMenu[] = IBUS_FRAME_2(
+    IBUS_DEVICE_GT,
+    IBUS_DEVICE_RAD,
+    0x45,
+    0x00
+);
+
 /**
  * IBusCommandRADEnableMenu()
  *     Description:
@@ -1863,16 +2988,16 @@ void IBusCommandRADDisableMenu(IBus_t *ibus)
  */
 void IBusCommandRADEnableMenu(IBus_t *ibus)
 {
-    unsigned char msg[] = {0x45, 0x00};
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_GT,
-        IBUS_DEVICE_RAD,
-        msg,
-        sizeof(msg)
-    );
+    IBusSendFrame(ibus, IBusFrameRADEnableMenu);
 }
 
+static const unsigned char IBusFrameRADExitMenu[] = IBUS_FRAME_2(
+    IBUS_DEVICE_GT,
+    IBUS_DEVICE_RAD,
+    0x45,
+    0x91
+);
+
 /**
  * IBusCommandRADExitMenu()
  *     Description:
@@ -1884,16 +3009,18 @@ void IBusCommandRADEnableMenu(IBus_t *ibus)
  */
 void IBusCommandRADExitMenu(IBus_t *ibus)
 {
-    unsigned char msg[] = {0x45, 0x91};
-    IBusSendCommand(
-        ibus,
-        IBUS_DEVICE_GT,
-        IBUS_DEVICE_RAD,
-        msg,
-        sizeof(msg)
-    );
+    IBusSendFrame(ibus, IBusFrameRADExitMenu);
 }
 
+static const unsigned char IBusFrameTELSetGTDisplayMenu[] = IBUS_FRAME_4(
+    IBUS_DEVICE_TEL,
+    IBUS_DEVICE_GT,
+    IBUS_TEL_CMD_MAIN_MENU,
+    0x42,
+    0x02,
+    0x20
+);
+
 /**
  * IBusCommandTELSetGTDisplayMenu()
  *     Description:
@@ -1905,8 +3032,7 @@ void IBusCommandRADExitMenu(IBus_t *ibus)
  */
 void IBusCommandTELSetGTDisplayMenu(IBus_t *ibus)
 {
-    const unsigned char msg[] = {IBUS_TEL_CMD_MAIN_MENU, 0x42, 0x02, 0x20};
-    IBusSendCommand(ibus, IBUS_DEVICE_TEL, IBUS_DEVICE_GT, msg, sizeof(msg));
+    IBusSendFrame(ibus, IBusFrameTELSetGTDisplayMenu);
 }
 
 /**
@@ -1943,6 +3069,26 @@ void IBusCommandTELStatus(IBus_t *ibus, unsigned char status)
 
 
 /* Temporary Commands for debugging */
+static const unsigned char IBusFrameLCMTurnLeft[] = IBUS_FRAME_5(
+    IBUS_DEVICE_LCM,
+    IBUS_DEVICE_GLO,
+    0x5B,
+    0xC3,
+    0xEF,
+    0x26,
+    0x33
+);
+
+static const unsigned char IBusFrameLCMTurnRight[] = IBUS_FRAME_5(
+    IBUS_DEVICE_LCM,
+    IBUS_DEVICE_GLO,
+    0x5B,
+    0x23,
+    0xEF,
+    0x26,
+    0x33
+);
+
 void IBusCommandIgnitionStatus(IBus_t *ibus, unsigned char status)
 {
     unsigned char statusMessage[2] = {0x11, status};
@@ -1951,12 +3097,10 @@ void IBusCommandIgnitionStatus(IBus_t *ibus, unsigned char status)
 
 void IBusCommandLCMTurnLeft(IBus_t *ibus)
 {
-    unsigned char statusMessage[] = {0x5B, 0xC3, 0xEF, 0x26, 0x33};
-    IBusSendCommand(ibus, IBUS_DEVICE_LCM, IBUS_DEVICE_GLO, statusMessage, 5);
+    IBusSendFrame(ibus, IBusFrameLCMTurnLeft);
 }
 
 void IBusCommandLCMTurnRight(IBus_t *ibus)
 {
-    unsigned char statusMessage[] = {0x5B, 0x23, 0xEF, 0x26, 0x33};
-    IBusSendCommand(ibus, IBUS_DEVICE_LCM, IBUS_DEVICE_GLO, statusMessage, 5);
+    IBusSendFrame(ibus, IBusFrameLCMTurnRight);
 }
@@ -8,6 +8,7 @@
 #define IBUS_H
 #include <math.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include "../mappings.h"
 #include "char_queue.h"
@@ -288,15 +289,121 @@
 
 // Configuration and protocol definitions
 #define IBUS_MAX_MSG_LENGTH 47 // Src Len Dest Cmd Data[42 Byte Max] XOR
+#define IBUS_MIN_MSG_LENGTH 5 // Src Len Dest Cmd XOR
 #define IBUS_RAD_MAIN_AREA_WATERMARK 0x10
 #define IBUS_RX_BUFFER_SIZE 256
 #define IBUS_TX_BUFFER_SIZE 16
-#define IBUS_RX_BUFFER_TIMEOUT 70 // At 9600 baud, we transmit ~1.5 byte/ms
-#define IBUS_TX_BUFFER_WAIT 7 // If we transmit faster, other modules may not hear us
-#define IBUS_TX_TIMEOUT_OFF 0
-#define IBUS_TX_TIMEOUT_ON 1
-#define IBUS_TX_TIMEOUT_DATA_SENT 2
-#define IBUS_TX_TIMEOUT_WAIT 250
+#define IBUS_TX_CLASS_PROTOCOL 0
+#define IBUS_TX_CLASS_CONTROL 1
+#define IBUS_TX_CLASS_DISPLAY 2
+#define IBUS_TX_CLASS_COUNT 3
+#define IBUS_TX_DISPLAY_MAX 12 // Keep slots free for replies and control frames
+#define IBUS_TX_MAX_DATA_LENGTH (IBUS_MAX_MSG_LENGTH - 4)
+#define IBUS_TX_SLOT_NONE 0xFF
+#define IBUS_ROUTE_ANY_SRC 0x01
+#define IBUS_ROUTE_ANY_DST 0x02
+#define IBUS_ROUTE_LENGTH 0x04
+#define IBUS_ROUTE_DATA 0x08
+#define IBUS_ROUTE_NONE 0xFF
+#define IBUS_RX_FRAME_GAP 2500 // Over two byte times of silence, in microseconds
+#define IBUS_RX_STAMPS 8 // Must be a power of two
+#define IBUS_TX_GAP_MIN 3 // If we transmit faster, other modules may not hear us
+#define IBUS_TX_GAP_MAX 10
+#define IBUS_BUS_LOAD_WINDOW 500
+#define IBUS_BYTE_TIME_US 1146 // 11 bits per byte at 9600 baud
+#define IBUS_TX_STATE_IDLE 0
+#define IBUS_TX_STATE_SENDING 1
+#define IBUS_TX_STATE_DRAINING 2
+#define IBUS_TX_STATE_ABORTED 3
+#define IBUS_TX_STATE_COLLISION 4
+#define IBUS_TX_BACKOFF_SLOT 5 // About the time a short frame holds the bus
+#define IBUS_TX_BACKOFF_MAX_EXP 4
+#define IBUS_TX_ECHO_TIMEOUT 3
+#define IBUS_TRACE_RX 0x01
+#define IBUS_TRACE_TX 0x02
+#define IBUS_TRACE_RX_ERROR 0x03
+#define IBUS_TRACE_TX_COLLISION 0x04
+#define IBUS_TRACE_TX_FAILED 0x05
+#define IBUS_TRACE_TX_DROPPED 0x06
+#define IBUS_RECORDER_START_ADDRESS 0x10000 // Upper half of the 25LC1024
+#define IBUS_RECORDER_PAGES 256
+#define IBUS_RECORDER_MAGIC 0xB5
+#define IBUS_RECORDER_HEADER_SIZE 9
+#define IBUS_RECORDER_ENTRY_HEADER_SIZE 4
+#define IBUS_RECORDER_SEAL_TIMEOUT 10000
+#define IBUS_SNIFFER_SYNC 0xB6
+#define IBUS_SNIFFER_HEADER_SIZE 7
+
+/**
+ * IBusTXQueue_t
+ *     Description:
+ *         This object tracks the frames of one TX priority class. The frames
+ *         themselves live in the shared IBus_t TX buffer.
+ *     Fields:
+ *         slots - The TX buffer slots of the queued frames, oldest first
+ *         count - The number of queued frames
+ *         highWater - The largest number of frames that were queued at once
+ *         sent - The number of frames that made it onto the bus
+ *         dropped - The number of frames refused or evicted before sending
+ *         waitTotal - The summed time from queue to bus of the sent frames
+ *         waitMax - The longest time from queue to bus of a sent frame
+ *         collisions - The number of transmissions whose echo did not match
+ *         retries - The number of frames queued again after a collision
+ *         failed - The number of frames dropped after their last retry
+ */
+typedef struct IBusTXQueue_t {
+    uint8_t slots[IBUS_TX_BUFFER_SIZE];
+    uint8_t count;
+    uint8_t highWater;
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t waitTotal;
+    uint16_t waitMax;
+    uint16_t collisions;
+    uint16_t retries;
+    uint16_t failed;
+} IBusTXQueue_t;
+
+/**
+ * IBusRecorder_t
+ *     Description:
+ *         This object tracks the IBus flight recorder, which keeps the most
+ *         recent bus traffic in a ring of EEPROM pages. Entries are gathered
+ *         in RAM one page at a time, and a full page is written in a single
+ *         write cycle while the next one fills.
+ *
+ *         Every page starts with IBUS_RECORDER_MAGIC, the page sequence
+ *         number and the time of its first entry in milliseconds, both
+ *         little endian. Entries follow as the entry type, the milliseconds
+ *         since the start of the page (two bytes, little endian), the data
+ *         length and the data. The rest of the page is 0xFF.
+ *     Fields:
+ *         pages - The page being filled and the page waiting to be written
+ *         fillPage - The buffer that entries are added to
+ *         fillIdx - The number of bytes used in the fill buffer
+ *         flushPending - 1 if the other buffer waits to be written
+ *         nextPage - The EEPROM page that is written next
+ *         sequence - The sequence number of the next page that is started
+ *         pageStamp - The time of the first entry of the fill buffer
+ *         enabled - 1 if the recorder is switched on
+ *         entries - The number of entries recorded since boot
+ *         overruns - The number of entries lost to a slow EEPROM
+ *         syncPending - 1 if the fill buffer is to be sealed and written
+ *             out as soon as the other buffer is free
+ */
+typedef struct IBusRecorder_t {
+    unsigned char pages[2][EEPROM_PAGE_SIZE];
+    uint8_t fillPage;
+    uint16_t fillIdx;
+    uint8_t flushPending;
+    uint16_t nextPage;
+    uint32_t sequence;
+    uint32_t pageStamp;
+    uint8_t enabled;
+    uint32_t entries;
+    uint16_t overruns;
+    uint8_t syncPending;
+} IBusRecorder_t;
 
 /**
  * IBus_t
@@ -308,12 +415,49 @@ typedef struct IBus_t {
     UART_t uart;
     unsigned char rxBuffer[IBUS_RX_BUFFER_SIZE];
     uint8_t rxBufferIdx;
+    uint8_t rxResync;
+    uint32_t rxFrames;
+    uint32_t rxDroppedBytes;
+    uint32_t rxRecoveredBytes;
+    volatile uint32_t rxLastByteMicros;
+    volatile uint16_t rxByteSeq;
+    volatile uint16_t rxBoundarySeq;
+    volatile uint8_t rxBoundaryCount;
+    uint8_t rxBoundaryDone;
+    uint16_t rxReadSeq;
+    volatile uint16_t rxStampSeq[IBUS_RX_STAMPS];
+    volatile uint32_t rxStampMicros[IBUS_RX_STAMPS];
+    uint8_t rxStampDone;
+    uint16_t rxAnchorSeq;
+    uint32_t rxAnchorMicros;
     unsigned char txBuffer[IBUS_TX_BUFFER_SIZE][IBUS_MAX_MSG_LENGTH];
-    uint8_t txBufferReadbackIdx;
-    uint8_t txBufferReadIdx;
-    uint8_t txBufferWriteIdx;
+    uint32_t txBufferStamp[IBUS_TX_BUFFER_SIZE];
+    uint8_t txBufferRetries[IBUS_TX_BUFFER_SIZE];
+    uint16_t txBufferUsed;
+    IBusTXQueue_t txQueues[IBUS_TX_CLASS_COUNT];
+    uint8_t txActiveSlot;
+    uint8_t txActiveClass;
+    uint8_t txReadbackSlot;
+    uint8_t txStageSlot;
     uint32_t rxLastStamp;
     uint32_t txLastStamp;
+    volatile uint8_t txState;
+    volatile uint8_t txFrameIdx;
+    uint8_t txEchoIdx;
+    uint32_t txEchoStamp;
+    uint16_t txBackoff;
+    uint8_t txGap;
+    uint16_t txThroughput;
+    uint8_t busLoad;
+    uint16_t busWindowRxBytes;
+    uint16_t busWindowTxBytes;
+    uint32_t busWindowStamp;
+    uint32_t txFrames;
+    uint16_t txAborts;
+    uint32_t txCoalescedFrames;
+    uint32_t txCoalescedBytes;
+    uint8_t snifferEnabled;
+    uint16_t snifferDropped;
     unsigned char cdChangerFunction;
     unsigned char gtVersion;
     unsigned char vehicleType;
@@ -322,9 +466,46 @@ typedef struct IBus_t {
     unsigned char lcmDimmerStatus2;
     unsigned char oilTemperature;
 } IBus_t;
+
+/**
+ * IBusRoute_t
+ *     Description:
+ *         This object maps received frames to the work that they cause
+ *     Fields:
+ *         src - The system that sent the frame
+ *         dst - The system that the frame is addressed to
+ *         cmd - The command byte of the frame
+ *         flags - IBUS_ROUTE_ANY_SRC and IBUS_ROUTE_ANY_DST ignore the
+ *             respective address. IBUS_ROUTE_LENGTH requires the length byte
+ *             and IBUS_ROUTE_DATA the first data byte to be within min - max.
+ *         min - The lowest value accepted by the predicate in flags
+ *         max - The highest value accepted by the predicate in flags
+ *         eventType - The event to trigger with a copy of the frame
+ *         (*handler)(IBus_t *, unsigned char *) - Called instead of
+ *             triggering eventType, for frames that need more work
+ */
+typedef struct IBusRoute_t {
+    unsigned char src;
+    unsigned char dst;
+    unsigned char cmd;
+    uint8_t flags;
+    unsigned char min;
+    unsigned char max;
+    uint8_t eventType;
+    void (*handler)(IBus_t *, unsigned char *);
+} IBusRoute_t;
 IBus_t IBusInit();
-void IBusProcess(IBus_t *);
+uint8_t IBusProcess(IBus_t *);
+void IBusRXByte(IBus_t *, unsigned char, uint32_t);
+IBusRecorder_t *IBusRecorderGetStatus();
+void IBusRecorderInit();
+void IBusRecorderSync();
+uint8_t IBusRecorderIsSynced();
+void IBusRoutesInit();
 void IBusSendCommand(IBus_t *, const unsigned char, const unsigned char, const unsigned char *, const size_t);
+void IBusSendFrame(IBus_t *, const unsigned char *);
+unsigned char *IBusTXReserve(IBus_t *, const unsigned char, const unsigned char, uint8_t);
+void IBusTXCommit(IBus_t *);
 uint8_t IBusGetDeviceManufacturer(const unsigned char);
 uint8_t IBusGetRadioType(uint32_t);
 uint8_t IBusGetNavHWVersion(unsigned char *);
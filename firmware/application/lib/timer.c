@@ -7,8 +7,11 @@
  */
 #include "timer.h"
 volatile uint32_t TimerCurrentMillis = 0;
-volatile TimerScheduledTask_t TimerRegisteredTasks[TIMER_TASKS_MAX];
-uint8_t TimerRegisteredTasksCount = 0;
+TimerScheduledTask_t TimerRegisteredTasks[TIMER_TASKS_MAX];
+// The IDs of the registered tasks, kept as a min-heap ordered by deadline
+uint8_t TimerTaskHeap[TIMER_TASKS_MAX];
+uint8_t TimerTaskHeapSize = 0;
+TimerIdleStats_t TimerIdleStats;
 
 /**
  * TimerInit()
@@ -22,7 +25,8 @@ uint8_t TimerRegisteredTasksCount = 0;
 void TimerInit()
 {
     T1CON = 0;
-    T1CON = TIMER_ON | STOP_TIMER_IN_IDLE_MODE | TIMER_SOURCE_INTERNAL | GATED_TIME_DISABLED | TIMER_16BIT_MODE | CLOCK_DIVIDER;
+    // Timer1 has to keep running in Idle, since it wakes the main loop
+    T1CON = TIMER_ON | TIMER_SOURCE_INTERNAL | GATED_TIME_DISABLED | TIMER_16BIT_MODE | CLOCK_DIVIDER;
     PR1 = PR1_SETTING;
     SetTIMERIP(TIMER_INDEX, TIMER_INTERRUPT_PRIORITY);
     SetTIMERIF(TIMER_INDEX, 0);
@@ -51,6 +55,215 @@ void TimerDelayMicroseconds(uint16_t delay)
     T2CONbits.TON = 0;
 }
 
+/**
+ * TimerIsBefore()
+ *     Description:
+ *         Compare two timestamps, allowing for the millisecond counter to
+ *         wrap around
+ *     Params:
+ *         uint32_t a - The first timestamp
+ *         uint32_t b - The second timestamp
+ *     Returns:
+ *         uint8_t - 1 if a is earlier than b, 0 otherwise
+ */
+static uint8_t TimerIsBefore(uint32_t a, uint32_t b)
+{
+    if ((int32_t) (a - b) < 0) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * TimerHeapSwap()
+ *     Description:
+ *         Swap two entries in the deadline heap
+ *     Params:
+ *         uint8_t i - The first heap position
+ *         uint8_t j - The second heap position
+ *     Returns:
+ *         void
+ */
+static void TimerHeapSwap(uint8_t i, uint8_t j)
+{
+    uint8_t taskId = TimerTaskHeap[i];
+    TimerTaskHeap[i] = TimerTaskHeap[j];
+    TimerTaskHeap[j] = taskId;
+    TimerRegisteredTasks[TimerTaskHeap[i]].heapIdx = i;
+    TimerRegisteredTasks[TimerTaskHeap[j]].heapIdx = j;
+}
+
+/**
+ * TimerHeapUpdate()
+ *     Description:
+ *         Move the entry at the given heap position up or down until the
+ *         deadline order is restored
+ *     Params:
+ *         uint8_t idx - The heap position of the entry that changed
+ *     Returns:
+ *         void
+ */
+static void TimerHeapUpdate(uint8_t idx)
+{
+    while (idx > 0) {
+        uint8_t parent = (idx - 1) / 2;
+        if (TimerIsBefore(
+            TimerRegisteredTasks[TimerTaskHeap[idx]].deadline,
+            TimerRegisteredTasks[TimerTaskHeap[parent]].deadline
+        ) == 0) {
+            break;
+        }
+        TimerHeapSwap(idx, parent);
+        idx = parent;
+    }
+    while (1) {
+        uint8_t earliest = idx;
+        uint8_t child = (idx * 2) + 1;
+        uint8_t i;
+        for (i = 0; i < 2; i++, child++) {
+            if (child < TimerTaskHeapSize &&
+                TimerIsBefore(
+                    TimerRegisteredTasks[TimerTaskHeap[child]].deadline,
+                    TimerRegisteredTasks[TimerTaskHeap[earliest]].deadline
+                ) == 1
+            ) {
+                earliest = child;
+            }
+        }
+        if (earliest == idx) {
+            return;
+        }
+        TimerHeapSwap(idx, earliest);
+        idx = earliest;
+    }
+}
+
+/**
+ * TimerHeapInsert()
+ *     Description:
+ *         Arm a task by adding it to the deadline heap
+ *     Params:
+ *         uint8_t taskId - The ID of the scheduled task
+ *     Returns:
+ *         void
+ */
+static void TimerHeapInsert(uint8_t taskId)
+{
+    TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
+    t->heapIdx = TimerTaskHeapSize;
+    TimerTaskHeap[TimerTaskHeapSize++] = taskId;
+    TimerHeapUpdate(t->heapIdx);
+}
+
+/**
+ * TimerHeapRemove()
+ *     Description:
+ *         Disarm a task by removing it from the deadline heap
+ *     Params:
+ *         uint8_t taskId - The ID of the scheduled task
+ *     Returns:
+ *         void
+ */
+static void TimerHeapRemove(uint8_t taskId)
+{
+    TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
+    uint8_t heapIdx = t->heapIdx;
+    if (heapIdx == TIMER_TASK_NONE) {
+        return;
+    }
+    TimerTaskHeapSize--;
+    if (heapIdx != TimerTaskHeapSize) {
+        TimerHeapSwap(heapIdx, TimerTaskHeapSize);
+        TimerHeapUpdate(heapIdx);
+    }
+    t->heapIdx = TIMER_TASK_NONE;
+}
+
+/**
+ * TimerFindTask()
+ *     Description:
+ *         Find the slot that a given function is registered in
+ *     Params:
+ *         void *task - A pointer to the function
+ *     Returns:
+ *         uint8_t - The ID of the scheduled task, or TIMER_TASK_NONE
+ */
+static uint8_t TimerFindTask(void *task)
+{
+    uint8_t taskId;
+    for (taskId = 0; taskId < TIMER_TASKS_MAX; taskId++) {
+        if (TimerRegisteredTasks[taskId].task != 0 &&
+            TimerRegisteredTasks[taskId].task == task
+        ) {
+            return taskId;
+        }
+    }
+    return TIMER_TASK_NONE;
+}
+
+/**
+ * TimerGetBusyPercent()
+ *     Description:
+ *         Get the share of the time since the statistics were reset that the
+ *         main loop did not spend in Idle
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint8_t - The busy time, in percent
+ */
+uint8_t TimerGetBusyPercent()
+{
+    uint32_t elapsed = TimerGetMillis() - TimerIdleStats.startMillis;
+    uint32_t idlePercent = 0;
+    if (elapsed >= 100) {
+        idlePercent = TimerIdleStats.idleMillis / (elapsed / 100);
+    } else if (elapsed > 0) {
+        idlePercent = (TimerIdleStats.idleMillis * 100) / elapsed;
+    }
+    return idlePercent < 100 ? 100 - idlePercent : 0;
+}
+
+/**
+ * TimerGetMicros()
+ *     Description:
+ *         Return the number of elapsed microseconds since boot, using the
+ *         Timer1 count for the part of the current millisecond. The value
+ *         wraps around every ~71 minutes, so only use it for differences.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint32_t - The microseconds since boot
+ */
+uint32_t TimerGetMicros()
+{
+    uint32_t millis;
+    uint16_t ticks;
+    do {
+        millis = TimerCurrentMillis;
+        ticks = TMR1;
+    } while (millis != TimerCurrentMillis);
+    // Interrupts that outrank Timer1 can see the counter wrap before the
+    // millisecond count catches up
+    if (IFS0bits.T1IF == 1 && ticks < (PR1_SETTING / 2)) {
+        millis++;
+    }
+    return (millis * 1000) + (ticks / TIMER_TICKS_PER_US);
+}
+
+/**
+ * TimerGetIdleStats()
+ *     Description:
+ *         Get the main loop utilization statistics
+ *     Params:
+ *         None
+ *     Returns:
+ *         TimerIdleStats_t * - The statistics
+ */
+TimerIdleStats_t *TimerGetIdleStats()
+{
+    return &TimerIdleStats;
+}
+
 /**
  * TimerGetMillis()
  *     Description:
@@ -62,28 +275,132 @@ void TimerDelayMicroseconds(uint16_t delay)
  */
 uint32_t TimerGetMillis()
 {
-    return (uint32_t) TimerCurrentMillis;
+    // The counter is updated from the ISR and cannot be read in a single
+    // instruction, so read it until we get the same value twice
+    uint32_t millis;
+    do {
+        millis = TimerCurrentMillis;
+    } while (millis != TimerCurrentMillis);
+    return millis;
+}
+
+/**
+ * TimerGetScheduledTask()
+ *     Description:
+ *         Get a registered task, i.e. to read its statistics
+ *     Params:
+ *         uint8_t taskId - The ID of the scheduled task
+ *     Returns:
+ *         TimerScheduledTask_t * - The task, or zero if nothing is registered
+ *             under the ID
+ */
+TimerScheduledTask_t *TimerGetScheduledTask(uint8_t taskId)
+{
+    if (taskId >= TIMER_TASKS_MAX || TimerRegisteredTasks[taskId].task == 0) {
+        return 0;
+    }
+    return &TimerRegisteredTasks[taskId];
+}
+
+/**
+ * TimerProcessIdle()
+ *     Description:
+ *         Account for a pass of the main loop. If no module did any work,
+ *         enter Idle until the next interrupt. Data that arrives between the
+ *         last check and Idle waits for the next Timer1 tick at most.
+ *     Params:
+ *         uint8_t workDone - 1 if any module did work during the pass
+ *     Returns:
+ *         void
+ */
+void TimerProcessIdle(uint8_t workDone)
+{
+    if (workDone != 0) {
+        TimerIdleStats.busyLoops++;
+        return;
+    }
+    uint32_t start = TimerGetMicros();
+    TIMER_IDLE();
+    // Carry whole milliseconds over, so that the total does not wrap around
+    // with the microsecond clock
+    uint32_t idleMicros = TimerIdleStats.idleMicros + (TimerGetMicros() - start);
+    TimerIdleStats.idleMillis += idleMicros / 1000;
+    TimerIdleStats.idleMicros = idleMicros % 1000;
+    TimerIdleStats.idleLoops++;
 }
 
 /**
  * TimerProcessScheduledTasks()
  *     Description:
- *         Run through the scheduled tasks and run any that are due.
+ *         Run the scheduled tasks that are due, earliest deadline first. Every
+ *         task runs at most once per call.
  *     Params:
  *         void
  *     Returns:
- *         void
+ *         uint8_t - 1 if any task ran, 0 otherwise
  */
-void TimerProcessScheduledTasks()
+uint8_t TimerProcessScheduledTasks()
 {
-    uint8_t idx;
-    for (idx = 0; idx < TimerRegisteredTasksCount; idx++) {
-        volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[idx];
-        if (t->ticks >= t->interval && t->task != 0) {
+    uint32_t now = TimerGetMillis();
+    uint8_t remaining = TimerTaskHeapSize;
+    uint8_t ran = 0;
+    while (TimerTaskHeapSize > 0 && remaining > 0) {
+        uint8_t taskId = TimerTaskHeap[0];
+        TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
+        if (TimerIsBefore(now, t->deadline) == 1) {
+            break;
+        }
+        uint32_t lateness = now - t->deadline;
+        if (lateness > t->maxLateness) {
+            t->maxLateness = lateness > UINT16_MAX ? UINT16_MAX : lateness;
+        }
+        if (t->interval > 0 && lateness >= t->interval) {
+            t->overruns++;
+        }
+        t->runs++;
+        if ((t->flags & TIMER_TASK_FLAG_ONCE) != 0) {
+            // Release the slot first, so that the task may arm itself again
+            void (*task)(void *) = t->task;
+            void *context = t->context;
+            TimerHeapRemove(taskId);
+            memset(t, 0, sizeof(TimerScheduledTask_t));
+            task(context);
+        } else {
+            // Schedule the next run first, so that the task may reset or
+            // unregister itself
+            t->deadline = now + t->interval;
+            TimerHeapUpdate(t->heapIdx);
             t->task(t->context);
-            t->ticks = 0;
         }
+        remaining--;
+        ran = 1;
     }
+    return ran;
+}
+
+/**
+ * TimerCancel()
+ *     Description:
+ *         Disarm a task without running it. A one-shot task releases its
+ *         slot, while a periodic task stays registered until it is
+ *         armed again with TimerReschedule().
+ *     Params:
+ *         void *task - A pointer to the function to cancel
+ *     Returns:
+ *         uint8_t - The status code
+ */
+uint8_t TimerCancel(void *task)
+{
+    uint8_t taskId = TimerFindTask(task);
+    if (taskId == TIMER_TASK_NONE) {
+        return 1;
+    }
+    TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
+    TimerHeapRemove(taskId);
+    if ((t->flags & TIMER_TASK_FLAG_ONCE) != 0) {
+        memset(t, 0, sizeof(TimerScheduledTask_t));
+    }
+    return 0;
 }
 
 /**
@@ -96,23 +413,94 @@ void TimerProcessScheduledTasks()
  *         void *ctx - A pointer to the context for which to pass to the function
  *         uint16_t interval - The number of milliseconds to elapse before calling
  *     Returns:
- *         uint8_t - The index of the scheduled task in the tasks array
+ *         uint8_t - The ID of the scheduled task, or TIMER_TASK_NONE if all
+ *             slots are in use
  */
 uint8_t TimerRegisterScheduledTask(void *task, void *ctx, uint16_t interval)
 {
-    TimerScheduledTask_t scheduledTask;
-    scheduledTask.task = task;
-    scheduledTask.context = ctx;
-    scheduledTask.ticks = 0;
-    scheduledTask.interval = interval;
-    TimerRegisteredTasks[TimerRegisteredTasksCount++] = scheduledTask;
-    return TimerRegisteredTasksCount - 1;
+    uint8_t taskId;
+    for (taskId = 0; taskId < TIMER_TASKS_MAX; taskId++) {
+        TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
+        if (t->task == 0) {
+            memset(t, 0, sizeof(TimerScheduledTask_t));
+            t->task = task;
+            t->context = ctx;
+            t->interval = interval;
+            t->deadline = TimerGetMillis() + interval;
+            TimerHeapInsert(taskId);
+            return taskId;
+        }
+    }
+    return TIMER_TASK_NONE;
+}
+
+/**
+ * TimerReschedule()
+ *     Description:
+ *         Move the deadline of a task to the given number of milliseconds
+ *         from now, arming it if it is idle. Tasks that are not registered
+ *         are scheduled to run once.
+ *     Params:
+ *         void *task - A pointer to the function to call
+ *         void *ctx - A pointer to the context for which to pass to the function
+ *         uint16_t delay - The number of milliseconds to elapse before calling
+ *     Returns:
+ *         uint8_t - The ID of the scheduled task, or TIMER_TASK_NONE if all
+ *             slots are in use
+ */
+uint8_t TimerReschedule(void *task, void *ctx, uint16_t delay)
+{
+    uint8_t taskId = TimerFindTask(task);
+    if (taskId == TIMER_TASK_NONE) {
+        return TimerScheduleOnce(task, ctx, delay);
+    }
+    TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
+    t->context = ctx;
+    t->deadline = TimerGetMillis() + delay;
+    if (t->heapIdx == TIMER_TASK_NONE) {
+        TimerHeapInsert(taskId);
+    } else {
+        TimerHeapUpdate(t->heapIdx);
+    }
+    return taskId;
+}
+
+/**
+ * TimerScheduleOnce()
+ *     Description:
+ *         Call a function once, after the given number of milliseconds. If
+ *         the function is already pending, its deadline is left alone.
+ *     Params:
+ *         void *task - A pointer to the function to call
+ *         void *ctx - A pointer to the context for which to pass to the function
+ *         uint16_t delay - The number of milliseconds to elapse before calling
+ *     Returns:
+ *         uint8_t - The ID of the scheduled task, or TIMER_TASK_NONE if all
+ *             slots are in use
+ */
+uint8_t TimerScheduleOnce(void *task, void *ctx, uint16_t delay)
+{
+    uint8_t taskId = TimerFindTask(task);
+    if (taskId != TIMER_TASK_NONE &&
+        TimerRegisteredTasks[taskId].heapIdx != TIMER_TASK_NONE
+    ) {
+        return taskId;
+    }
+    if (taskId != TIMER_TASK_NONE) {
+        // An idle periodic task: arm it again without changing its interval
+        return TimerReschedule(task, ctx, delay);
+    }
+    taskId = TimerRegisterScheduledTask(task, ctx, delay);
+    if (taskId != TIMER_TASK_NONE) {
+        TimerRegisteredTasks[taskId].flags = TIMER_TASK_FLAG_ONCE;
+    }
+    return taskId;
 }
 
 /**
  * TimerUnregisterScheduledTask()
  *     Description:
- *         Unregister a previously scheduled task
+ *         Unregister a previously scheduled task and release its slot
  *     Params:
  *         void *task - A pointer to the function to call
  *     Returns:
@@ -120,60 +508,74 @@ uint8_t TimerRegisterScheduledTask(void *task, void *ctx, uint16_t interval)
  */
 uint8_t TimerUnregisterScheduledTask(void *task)
 {
-    uint8_t idx;
-    for (idx = 0; idx < TimerRegisteredTasksCount; idx++) {
-        volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[idx];
-        if (t->task == task) {
-            memset((void *)t, 0, sizeof(TimerScheduledTask_t));
-            return 0;
-        }
+    uint8_t taskId = TimerFindTask(task);
+    if (taskId == TIMER_TASK_NONE) {
+        return 1;
     }
-    return 1;
+    TimerHeapRemove(taskId);
+    memset(&TimerRegisteredTasks[taskId], 0, sizeof(TimerScheduledTask_t));
+    return 0;
+}
+
+/**
+ * TimerResetIdleStats()
+ *     Description:
+ *         Start a new main loop utilization window
+ *     Params:
+ *         None
+ *     Returns:
+ *         void
+ */
+void TimerResetIdleStats()
+{
+    memset(&TimerIdleStats, 0, sizeof(TimerIdleStats_t));
+    TimerIdleStats.startMillis = TimerGetMillis();
 }
 
 /**
  * TimerResetScheduledTask()
  *     Description:
- *         Reset the ticks on a given task
+ *         Restart the interval of a given task
  *     Params:
- *         uint8_t - The index of the scheduled task in the tasks array
+ *         uint8_t - The ID of the scheduled task
  *     Returns:
  *         void
  */
 void TimerResetScheduledTask(uint8_t taskId)
 {
-    volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
-    if (t->task != 0) {
-        t->ticks = 0;
+    TimerScheduledTask_t *t = TimerGetScheduledTask(taskId);
+    if (t != 0 && t->heapIdx != TIMER_TASK_NONE) {
+        t->deadline = TimerGetMillis() + t->interval;
+        TimerHeapUpdate(t->heapIdx);
     }
 }
 
 /**
  * TimerTriggerScheduledTask()
  *     Description:
- *         Call a given scheduled task immediately and reset the interval count
+ *         Call a given scheduled task immediately and restart its interval
  *     Params:
- *         uint8_t - The index of the scheduled task in the tasks array
+ *         uint8_t - The ID of the scheduled task
  *     Returns:
  *         void
  */
 void TimerTriggerScheduledTask(uint8_t taskId)
 {
-    volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[taskId];
-    if (t->task != 0) {
-        // Prevent it from executing immediately
-        t->ticks = 0;
+    TimerScheduledTask_t *t = TimerGetScheduledTask(taskId);
+    if (t != 0) {
+        // Prevent it from executing again while it runs
+        TimerResetScheduledTask(taskId);
         t->task(t->context);
-        // Reset the ticks so it runs exactly `interval` times before firing
-        t->ticks = 0;
+        // Restart the interval so it runs `interval` ms after this call
+        TimerResetScheduledTask(taskId);
     }
 }
 
 /**
  * T1Interrupt
  *     Description:
- *         Update the milliseconds since boot. Iterate through the scheduled
- *         tasks and update their ticks.
+ *         Update the milliseconds since boot. Scheduled tasks are kept by
+ *         deadline, so there is nothing else to do here.
  *     Params:
  *         void
  *     Returns:
@@ -181,13 +583,9 @@ void TimerTriggerScheduledTask(uint8_t taskId)
  */
 void __attribute__((__interrupt__, auto_psv)) _AltT1Interrupt(void)
 {
-    TimerCurrentMillis++;
-    uint8_t idx;
-    for (idx = 0; idx < TimerRegisteredTasksCount; idx++) {
-        volatile TimerScheduledTask_t *t = &TimerRegisteredTasks[idx];
-        if (t->task != 0) {
-            TimerRegisteredTasks[idx].ticks++;
-        }
-    }
+    // Clear the flag first. A higher priority interrupt that reads the time
+    // in between would otherwise count this millisecond twice, once in the
+    // count and once for the pending flag.
     SetTIMERIF(TIMER_INDEX, 0);
+    TimerCurrentMillis++;
 }
@@ -18,12 +18,19 @@
 #define TIMER_INTERRUPT_PRIORITY 0x0002
 #define CLOCK_DIVIDER TIMER_PRESCALER
 #define PR1_SETTING (SYS_CLOCK / 1000 / 1)
+#define TIMER_TICKS_PER_US (SYS_CLOCK / 1000000)
 #define TIMER_TASKS_MAX 16
+#define TIMER_TASK_NONE 0xFF
+#define TIMER_TASK_FLAG_ONCE 0x01
 #define TIMER_INDEX 0
 #include <stdint.h>
 #include <string.h>
 #include <xc.h>
 #include "sfr_setters.h"
+/* Enter Idle, waking on the next enabled interrupt (Timer1 fires every 1ms) */
+#ifndef TIMER_IDLE
+#define TIMER_IDLE() Idle()
+#endif
 /**
  * TimerScheduledTask_t
  *     Description:
@@ -31,22 +38,64 @@
  *     Fields:
  *         (*task)(void *) - The pointer to the function to execute
  *         *context - A pointer to the context to pass to the function pointer
- *         interval - The number of ticks to let pass before executing (milliseconds)
- *         ticks - The amount of ticks that have passed since the last call
+ *         interval - The number of milliseconds between executions
+ *         deadline - The time at which the task is next due (milliseconds)
+ *         heapIdx - The position of the task in the deadline heap, or
+ *             TIMER_TASK_NONE if the task is not armed
+ *         flags - TIMER_TASK_FLAG_ONCE if the slot is released after the
+ *             task runs
+ *         runs - The number of times the task has executed
+ *         overruns - The number of times the task was late by at least a
+ *             whole interval
+ *         maxLateness - The latest the task has executed (milliseconds)
  */
 typedef struct TimerScheduledTask_t {
     void (*task)(void *);
     void *context;
     uint16_t interval;
-    uint16_t ticks;
+    uint32_t deadline;
+    uint8_t heapIdx;
+    uint8_t flags;
+    uint32_t runs;
+    uint16_t overruns;
+    uint16_t maxLateness;
 } TimerScheduledTask_t;
 
+/**
+ * TimerIdleStats_t
+ *     Description:
+ *         This object tracks how the main loop spends its time
+ *     Fields:
+ *         busyLoops - The number of loop passes in which a module did work
+ *         idleLoops - The number of loop passes that ended in Idle
+ *         idleMillis - The time spent in Idle (milliseconds)
+ *         idleMicros - The part of the time spent in Idle that does not yet
+ *             make up a whole millisecond (microseconds)
+ *         startMillis - The time at which the statistics were reset
+ */
+typedef struct TimerIdleStats_t {
+    uint32_t busyLoops;
+    uint32_t idleLoops;
+    uint32_t idleMillis;
+    uint16_t idleMicros;
+    uint32_t startMillis;
+} TimerIdleStats_t;
+
 void TimerInit();
 void TimerDelayMicroseconds(uint16_t);
+uint8_t TimerGetBusyPercent();
+uint32_t TimerGetMicros();
 uint32_t TimerGetMillis();
-void TimerProcessScheduledTasks();
+TimerIdleStats_t *TimerGetIdleStats();
+TimerScheduledTask_t *TimerGetScheduledTask(uint8_t);
+void TimerProcessIdle(uint8_t);
+uint8_t TimerProcessScheduledTasks();
+uint8_t TimerCancel(void *);
 uint8_t TimerRegisterScheduledTask(void *, void *, uint16_t);
+uint8_t TimerReschedule(void *, void *, uint16_t);
+uint8_t TimerScheduleOnce(void *, void *, uint16_t);
 uint8_t TimerUnregisterScheduledTask(void *);
+void TimerResetIdleStats();
 void TimerResetScheduledTask(uint8_t);
 void TimerTriggerScheduledTask(uint8_t);
 #endif /* TIMER_H */
@@ -26,6 +26,11 @@ UART_t UARTInit(
     uart.rxQueue = CharQueueInit();
     uart.moduleIndex = uartModule - 1;
     uart.rxError = 0;
+    uart.rxDropped = 0;
+    uart.txDropped = 0;
+    uart.txHighWater = 0;
+    uart.txHandler = 0;
+    uart.rxHandler = 0;
     uart.txPin = txPin;
     // Unlock the reprogrammable pin register
     __builtin_write_OSCCONL(OSCCON & 0xBF);
@@ -150,7 +155,11 @@ static uint8_t UARTRXInterruptHandler(uint8_t moduleIndex)
                 uart->rxError ^= UART_ERR_OERR;
                 uart->registers->uxsta ^= 0x2;
             }
-            CharQueueAdd(&uart->rxQueue, uart->registers->uxrxreg);
+            if (uart->rxHandler != 0) {
+                uart->rxHandler(uart, uart->registers->uxrxreg);
+            } else if (CharQueueAdd(&uart->rxQueue, uart->registers->uxrxreg) == 0) {
+                uart->rxDropped++;
+            }
         } else {
             // Set a "General" Error
             uart->rxError ^= UART_ERR_GERR;
@@ -182,17 +191,22 @@ static uint8_t UARTRXInterruptHandler(uint8_t moduleIndex)
 static void UARTTXInterruptHandler(uint8_t moduleIndex)
 {
     UART_t *uart = UARTModules[moduleIndex];
-    if (uart != 0) {
-        while (uart->txQueue.size > 0) {
-            // TXIF is 1 if the queue is empty, set it before pushing data
-            SetUARTTXIF(moduleIndex, 0);
+    if (uart != 0 && uart->txHandler != 0) {
+        uart->txHandler(uart);
+    } else if (uart != 0 && CharQueueGetSize(&uart->txQueue) > 0) {
+        // Clear the flag before filling the hardware buffer. It is set again
+        // as soon as the buffer has room, which brings us back here.
+        SetUARTTXIF(moduleIndex, 0);
+        while (CharQueueGetSize(&uart->txQueue) > 0 &&
+               (uart->registers->uxsta & UART_STA_UTXBF) == 0
+        ) {
             uart->registers->uxtxreg = CharQueueNext(&uart->txQueue);
-            // Wait for the data to leave the tx buffer
-            while ((uart->registers->uxsta & (1 << 9)) != 0);
         }
+    } else {
+        // Disable the interrupt once the queue is empty. The flag is left set
+        // so that the interrupt fires as soon as it is enabled again.
+        SetUARTTXIE(moduleIndex, 0);
     }
-    // Disable the interrupt after flushing the queue
-    SetUARTTXIE(moduleIndex, 0);
 }
 
 void UARTReportErrors(UART_t *uart)
@@ -227,32 +241,73 @@ void UARTRXQueueReset(UART_t *uart)
     CharQueueReset(&uart->rxQueue);
 }
 
+/**
+ * UARTTrackTXQueue()
+ *     Description:
+ *         Account for bytes that did not fit in the TX queue and keep the
+ *         high-water mark of the TX queue up to date
+ *     Params:
+ *         UART_t *uart - The UART module object
+ *         uint16_t dropped - The amount of bytes that were discarded
+ *     Returns:
+ *         void
+ */
+static void UARTTrackTXQueue(UART_t *uart, uint16_t dropped)
+{
+    uint16_t size = CharQueueGetSize(&uart->txQueue);
+    if (size > uart->txHighWater) {
+        uart->txHighWater = size;
+    }
+    uart->txDropped += dropped;
+}
+
+/**
+ * UARTSendBytes()
+ *     Description:
+ *         Queue a run of binary data, which may contain any byte value
+ *     Params:
+ *         UART_t *uart - The UART module object
+ *         const unsigned char *data - The bytes to send
+ *         uint16_t length - The number of bytes to send
+ *     Returns:
+ *         void
+ */
+void UARTSendBytes(UART_t *uart, const unsigned char *data, uint16_t length)
+{
+    uint16_t dropped = length - CharQueueWrite(&uart->txQueue, data, length);
+    UARTTrackTXQueue(uart, dropped);
+    // Set the interrupt flag
+    SetUARTTXIE(uart->moduleIndex, 1);
+}
+
 void UARTSendChar(UART_t *uart, unsigned char data)
 {
-    CharQueueAdd(&uart->txQueue, data);
+    uint16_t dropped = 1 - CharQueueAdd(&uart->txQueue, data);
+    UARTTrackTXQueue(uart, dropped);
     // Set the interrupt flag
     SetUARTTXIE(uart->moduleIndex, 1);
 }
 
 void UARTSendData(UART_t *uart, unsigned char *data)
 {
-    unsigned char c;
-    while ((c = *data++)) {
-        CharQueueAdd(&uart->txQueue, c);
-    }
+    uint16_t length = strlen((char *) data);
+    uint16_t dropped = length - CharQueueWrite(&uart->txQueue, data, length);
+    UARTTrackTXQueue(uart, dropped);
     // Set the interrupt flag
     SetUARTTXIE(uart->moduleIndex, 1);
 }
 
 void UARTSendString(UART_t *uart, char *data)
 {
+    uint16_t dropped = 0;
     char c;
     while ((c = *data++)) {
         // Print only readable and newline characters
         if ((c >= 0x20 && c <= 0x7E) || c == 0x0D || c == 0x0A) {
-            CharQueueAdd(&uart->txQueue, c);
+            dropped += 1 - CharQueueAdd(&uart->txQueue, c);
         }
     }
+    UARTTrackTXQueue(uart, dropped);
     // Set the interrupt flag
     SetUARTTXIE(uart->moduleIndex, 1);
 }
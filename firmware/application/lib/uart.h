@@ -22,6 +22,8 @@
 #define UART_PARITY_NONE 0
 #define UART_PARITY_EVEN 1
 #define UART_PARITY_ODD 2
+#define UART_STA_TRMT 0x100
+#define UART_STA_UTXBF 0x200
 
 
 /**
@@ -29,6 +31,15 @@
  *     Description:
  *         This object defines helper functionality to allow us to read and
  *         write data from the UART module
+ *     Fields:
+ *         rxDropped - Bytes received while the RX queue was full
+ *         txDropped - Bytes sent while the TX queue was full
+ *         txHighWater - The most bytes that have been waiting in the TX queue
+ *         (*txHandler)(struct UART_t *) - Called from the TX interrupt
+ *             instead of draining txQueue, for modules that feed the UART
+ *             themselves
+ *         (*rxHandler)(struct UART_t *, unsigned char) - Called from the RX
+ *             interrupt with each good byte instead of adding it to rxQueue
  */
 typedef struct UART_t {
     CharQueue_t rxQueue;
@@ -36,6 +47,11 @@ typedef struct UART_t {
     uint8_t moduleIndex;
     uint8_t txPin;
     volatile uint16_t rxError;
+    volatile uint16_t rxDropped;
+    uint16_t txDropped;
+    uint16_t txHighWater;
+    void (*txHandler)(struct UART_t *);
+    void (*rxHandler)(struct UART_t *, unsigned char);
     volatile UART *registers;
 } UART_t;
 
@@ -45,6 +61,7 @@ void UARTDestroy(uint8_t);
 UART_t * UARTGetModuleHandler(uint8_t);
 void UARTRXQueueReset(UART_t *);
 void UARTReportErrors(UART_t *);
+void UARTSendBytes(UART_t *, const unsigned char *, uint16_t);
 void UARTSendChar(UART_t *, unsigned char);
 void UARTSendData(UART_t *, unsigned char *);
 void UARTSendString(UART_t *, char *);
@@ -13,6 +13,7 @@
 #include "lib/bc127.h"
 #include "lib/config.h"
 #include "lib/eeprom.h"
+#include "lib/event.h"
 #include "lib/log.h"
 #include "lib/i2c.h"
 #include "lib/ibus.h"
@@ -94,11 +95,16 @@ int main(void)
     CLIInit(&systemUart, &bt, &ibus);
 
     // Process events
+    TimerResetIdleStats();
     while (1) {
-        BC127Process(&bt);
-        IBusProcess(&ibus);
-        TimerProcessScheduledTasks();
-        CLIProcess();
+        uint8_t workDone = BC127Process(&bt);
+        workDone |= IBusProcess(&ibus);
+        workDone |= EventQueueProcess();
+        workDone |= TimerProcessScheduledTasks();
+        workDone |= CLIProcess();
+        // Everything is driven by the UART and Timer1 interrupts, so sleep
+        // until the next one when there was nothing to do
+        TimerProcessIdle(workDone);
     }
 
     return 0;
@@ -0,0 +1,200 @@
+/*
+ * File: bench_bc127.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Benchmark splitting a recorded session of BC127 messages into tokens,
+ *     in place against the way it used to be done, and how fast
+ *     BC127Process() gets through the whole session
+ */
+#include <string.h>
+#include "test.h"
+#include "lib/bc127.h"
+
+#define BENCH_ROUNDS 20000
+
+/* A phone connecting, streaming with metadata updates, and taking a call */
+static const char *BenchBC127Session[] = {
+    "Ready",
+    "STATE CONNECTED[0] CONNECTABLE[ON] DISCOVERABLE[OFF] BLE[OFF]",
+    "LIST 3C2EFF4A1B2C",
+    "LIST 9476B7C3D4E5",
+    "OK",
+    "OPEN_OK 11 A2DP 3C2EFF4A1B2C",
+    "OPEN_OK 12 AVRCP 3C2EFF4A1B2C",
+    "OPEN_OK 13 HFP 3C2EFF4A1B2C",
+    "NAME 3C2EFF4A1B2C \"Ted's Pixel 7 Pro\"",
+    "STATE CONNECTED[1] CONNECTABLE[OFF] DISCOVERABLE[OFF] BLE[OFF]",
+    "ABS_VOL 11 96",
+    "AVRCP_PLAY 12",
+    "A2DP_STREAM_START 11",
+    "AVRCP_MEDIA 12 TITLE: Everything In Its Right Place",
+    "AVRCP_MEDIA 12 ARTIST: Radiohead",
+    "AVRCP_MEDIA 12 ALBUM: Kid A",
+    "AVRCP_MEDIA 12 PLAYING_TIME(MS): 251000",
+    "ABS_VOL 11 88",
+    "AVRCP_MEDIA 12 TITLE: Kid A",
+    "AVRCP_MEDIA 12 ARTIST: Radiohead",
+    "AVRCP_MEDIA 12 ALBUM: Kid A",
+    "AVRCP_MEDIA 12 PLAYING_TIME(MS): 284000",
+    "CALL_INCOMING 13 +15555550123",
+    "AVRCP_PAUSE 12",
+    "A2DP_STREAM_SUSPEND 11",
+    "SCO_OPEN 13",
+    "CALL_ACTIVE 13",
+    "CALL_END 13",
+    "SCO_CLOSE 13",
+    "AVRCP_PLAY 12",
+    "A2DP_STREAM_START 11",
+    "LINK 11 CONNECTED A2DP 3C2EFF4A1B2C STREAMING",
+    "LINK 12 CONNECTED AVRCP 3C2EFF4A1B2C PLAYING",
+    "OK"
+};
+#define BENCH_BC127_SESSION_LENGTH \
+    (sizeof(BenchBC127Session) / sizeof(BenchBC127Session[0]))
+
+/* The verbs in the order that the old if chain compared them */
+static const char *BenchBC127LegacyVerbs[] = {
+    "AVRCP_MEDIA", "AVRCP_PLAY", "AVRCP_PAUSE", "A2DP_STREAM_START",
+    "A2DP_STREAM_SUSPEND", "CALL_ACTIVE", "CALL_END", "CALL_INCOMING",
+    "CALL_OUTGOING", "LINK", "LIST", "CLOSE_OK", "OPEN_OK", "OPEN_ERROR",
+    "NAME", "Build:", "SCO_OPEN", "SCO_CLOSE", "STATE"
+};
+
+static volatile uint8_t benchVerb;
+
+/**
+ * BenchBC127LegacySplit()
+ *     Description:
+ *         The split as it was before messages were tokenized in place: count
+ *         the delimiters, copy the message for strtok() and compare the first
+ *         token against every verb in turn
+ */
+static void BenchBC127LegacySplit(char *msg, uint16_t messageLength)
+{
+    uint16_t i;
+    uint16_t delimCount = 1;
+    for (i = 0; i < messageLength; i++) {
+        if (msg[i] == ' ') {
+            delimCount++;
+        }
+    }
+    char tmpMsg[messageLength];
+    strcpy(tmpMsg, msg);
+    char *msgBuf[delimCount];
+    char *p = strtok(tmpMsg, " ");
+    i = 0;
+    while (p != NULL) {
+        msgBuf[i++] = p;
+        p = strtok(NULL, " ");
+    }
+    uint8_t verb;
+    for (verb = 0; verb < sizeof(BenchBC127LegacyVerbs) / sizeof(char *); verb++) {
+        if (strcmp(msgBuf[0], BenchBC127LegacyVerbs[verb]) == 0) {
+            break;
+        }
+    }
+    benchVerb = verb;
+    TEST_KEEP(msgBuf);
+}
+
+/**
+ * BenchBC127Split()
+ *     Description:
+ *         Split a message the way BC127Process() does now: the verb first,
+ *         and then only as far as the verb needs
+ */
+static void BenchBC127Split(char *msg, uint16_t messageLength)
+{
+    char *msgBuf[BC127_MSG_TOKENS_MAX];
+    BC127Tokenize(msg, msgBuf, 2);
+    const BC127Verb_t *verb = BC127GetVerb(msgBuf[0]);
+    if (verb != 0) {
+        BC127Tokenize(msgBuf[1], &msgBuf[1], verb->tokens - 1);
+    }
+    benchVerb = verb != 0;
+    TEST_KEEP(msgBuf);
+}
+
+/**
+ * BenchBC127SplitSession()
+ *     Description:
+ *         Time a split over the session
+ *     Returns:
+ *         double - The time per message, in nanoseconds
+ */
+static double BenchBC127SplitSession(void (*split)(char *, uint16_t))
+{
+    char msg[BC127_CMD_MAX_LENGTH];
+    uint32_t round;
+    uint8_t idx;
+    uint64_t start = TestGetNanos();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        for (idx = 0; idx < BENCH_BC127_SESSION_LENGTH; idx++) {
+            // Both read the message out of the RX queue first
+            uint16_t messageLength = strlen(BenchBC127Session[idx]) + 1;
+            memcpy(msg, BenchBC127Session[idx], messageLength);
+            split(msg, messageLength);
+        }
+    }
+    uint64_t elapsed = TestGetNanos() - start;
+    return (double) elapsed / ((double) BENCH_ROUNDS * BENCH_BC127_SESSION_LENGTH);
+}
+
+/**
+ * BenchBC127Process()
+ *     Description:
+ *         Time BC127Process() over the session, queued in the RX queue a few
+ *         messages at a time like the UART ISR would
+ */
+static double BenchBC127Process()
+{
+    static BC127_t bt;
+    uint64_t elapsed = 0;
+    uint32_t processed = 0;
+    uint32_t round;
+    bt = BC127Init();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        uint8_t idx = 0;
+        while (idx < BENCH_BC127_SESSION_LENGTH) {
+            uint8_t queued = 0;
+            while (idx < BENCH_BC127_SESSION_LENGTH) {
+                const char *line = BenchBC127Session[idx];
+                uint16_t length = strlen(line);
+                if (CHAR_QUEUE_SIZE - CharQueueGetSize(&bt.uart.rxQueue) < length + 1) {
+                    break;
+                }
+                CharQueueWrite(&bt.uart.rxQueue, (const unsigned char *) line, length);
+                CharQueueAdd(&bt.uart.rxQueue, BC127_MSG_END_CHAR);
+                queued++;
+                idx++;
+            }
+            uint64_t start = TestGetNanos();
+            while (queued-- > 0) {
+                BC127Process(&bt);
+            }
+            elapsed += TestGetNanos() - start;
+            // Whatever the handlers asked the module for goes nowhere
+            CharQueueReset(&bt.uart.txQueue);
+        }
+        processed += BENCH_BC127_SESSION_LENGTH;
+    }
+    return (double) elapsed / processed;
+}
+
+int main()
+{
+    printf("    %d message BC127 session:\n", (int) BENCH_BC127_SESSION_LENGTH);
+    printf(
+        "        Old split (copy, strtok, if chain): %6.1f ns/message\n",
+        BenchBC127SplitSession(&BenchBC127LegacySplit)
+    );
+    printf(
+        "        In place split and verb table:      %6.1f ns/message\n",
+        BenchBC127SplitSession(&BenchBC127Split)
+    );
+    printf(
+        "        BC127Process(), including handlers: %6.1f ns/message\n",
+        BenchBC127Process()
+    );
+    return 0;
+}
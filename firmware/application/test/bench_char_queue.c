@@ -0,0 +1,116 @@
+/*
+ * File: bench_char_queue.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Benchmarks for the CharQueue FIFO
+ */
+#include "test.h"
+#include "lib/char_queue.h"
+
+#define BENCH_POLLS 100000
+#define BENCH_LINES 100000
+
+static CharQueue_t queue;
+
+/* A 128 byte AVRCP metadata line */
+static const char benchLine[] = "AVRCP_MEDIA TITLE: "
+    "Everything In Its Right Place (Live at the Shepherds Bush Empire) "
+    "[Remastered 2017] - Kid A Mnesia Edition 2\r";
+#define BENCH_LINE_LENGTH (sizeof(benchLine) - 1)
+
+/**
+ * BenchCharQueueFillPartialLine()
+ *     Description:
+ *         Queue the first 400 bytes of an AVRCP metadata line, i.e. what the
+ *         main loop sees while the rest of the line is still arriving
+ */
+static void BenchCharQueueFillPartialLine()
+{
+    uint16_t i;
+    queue = CharQueueInit();
+    for (i = 0; i < 400; i++) {
+        CharQueueAdd(&queue, 'a' + (i % 26));
+    }
+}
+
+static void BenchCharQueuePollPartialLine()
+{
+    uint64_t start;
+    uint32_t i;
+    uint32_t found = 0;
+
+    BenchCharQueueFillPartialLine();
+    start = TestGetNanos();
+    for (i = 0; i < BENCH_POLLS; i++) {
+        found += CharQueueSeek(&queue, '\r');
+    }
+    double seekNanos = (double) (TestGetNanos() - start) / BENCH_POLLS;
+    TEST_KEEP(found);
+
+    BenchCharQueueFillPartialLine();
+    start = TestGetNanos();
+    for (i = 0; i < BENCH_POLLS; i++) {
+        found += CharQueueSeekLine(&queue, '\r');
+    }
+    double seekLineNanos = (double) (TestGetNanos() - start) / BENCH_POLLS;
+    TEST_KEEP(found);
+
+    printf("    Poll 400 byte partial line:\n");
+    printf("        CharQueueSeek():     %8.1f ns/poll\n", seekNanos);
+    printf("        CharQueueSeekLine(): %8.1f ns/poll\n", seekLineNanos);
+}
+
+/**
+ * BenchCharQueueFillMetadataLine()
+ *     Description:
+ *         Queue the metadata line, starting at the given offset
+ *         into the ring so that the line wraps around some of the time
+ */
+static void BenchCharQueueFillMetadataLine(uint16_t offset)
+{
+    queue.readCursor = offset;
+    queue.writeCursor = offset;
+    queue.seekLength = 0;
+    CharQueueWrite(&queue, (const unsigned char *) benchLine, BENCH_LINE_LENGTH);
+}
+
+static void BenchCharQueueReadLine()
+{
+    unsigned char buffer[BENCH_LINE_LENGTH];
+    uint64_t nextCycles = 0;
+    uint64_t readCycles = 0;
+    uint32_t i;
+    uint16_t j;
+    queue = CharQueueInit();
+    for (i = 0; i < BENCH_LINES; i++) {
+        BenchCharQueueFillMetadataLine(i * 13);
+        uint64_t start = TestGetCycles();
+        for (j = 0; j < BENCH_LINE_LENGTH; j++) {
+            buffer[j] = CharQueueNext(&queue);
+        }
+        nextCycles += TestGetCycles() - start;
+        TEST_KEEP(buffer[j - 1]);
+
+        BenchCharQueueFillMetadataLine(i * 13);
+        start = TestGetCycles();
+        CharQueueRead(&queue, buffer, BENCH_LINE_LENGTH);
+        readCycles += TestGetCycles() - start;
+        TEST_KEEP(buffer[BENCH_LINE_LENGTH - 1]);
+    }
+    printf("    Read %d byte metadata line:\n", (int) BENCH_LINE_LENGTH);
+    printf(
+        "        CharQueueNext() per byte: %6.2f cycles/byte\n",
+        (double) nextCycles / BENCH_LINES / BENCH_LINE_LENGTH
+    );
+    printf(
+        "        CharQueueRead():          %6.2f cycles/byte\n",
+        (double) readCycles / BENCH_LINES / BENCH_LINE_LENGTH
+    );
+}
+
+int main()
+{
+    BenchCharQueuePollPartialLine();
+    BenchCharQueueReadLine();
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * File: bench_event.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Benchmark the cost of dispatching events with the callbacks that the
+ *     handler, MID and BMBT register
+ */
+#include <string.h>
+#include "test.h"
+#include "handler.h"
+#include "lib/event.h"
+#include "ui/bmbt.h"
+#include "ui/mid.h"
+
+#define BENCH_ROUNDS 20000
+
+extern Event_t EVENT_CALLBACKS[EVENT_MAX_CALLBACKS];
+extern uint8_t EVENT_CALLBACKS_COUNT;
+extern uint8_t EVENT_CALLBACKS_HEAD[EVENT_MAX_TYPES];
+
+/* The registrations, as a flat table of types */
+static uint8_t benchTypes[EVENT_MAX_CALLBACKS];
+static uint8_t benchTypesCount = 0;
+static volatile uint32_t benchCalls = 0;
+
+static void BenchEventCallback(void *ctx, unsigned char *data)
+{
+    benchCalls++;
+}
+
+/**
+ * BenchEventLinearTrigger()
+ *     Description:
+ *         The dispatcher as it was before events were indexed by type:
+ *         compare every registration against the event type
+ */
+static void BenchEventLinearTrigger(uint8_t eventType, unsigned char *data)
+{
+    uint8_t idx;
+    for (idx = 0; idx < benchTypesCount; idx++) {
+        if (benchTypes[idx] == eventType) {
+            BenchEventCallback(0, data);
+        }
+    }
+}
+
+int main()
+{
+    static BC127_t bt;
+    static IBus_t ibus;
+    unsigned char data[] = {0x00};
+    uint32_t round;
+    uint8_t idx;
+
+    bt = BC127Init();
+    ibus = IBusInit();
+    HandlerInit(&bt, &ibus);
+    MIDInit(&bt, &ibus);
+    BMBTInit(&bt, &ibus);
+    for (idx = 0; idx < EVENT_CALLBACKS_COUNT; idx++) {
+        if (EVENT_CALLBACKS[idx].callback != 0) {
+            benchTypes[benchTypesCount++] = EVENT_CALLBACKS[idx].type;
+        }
+    }
+    // Put the same registrations back with a callback that does no work,
+    // so only the dispatch itself is measured
+    memset(EVENT_CALLBACKS, 0, sizeof(EVENT_CALLBACKS));
+    memset(EVENT_CALLBACKS_HEAD, 0, sizeof(EVENT_CALLBACKS_HEAD));
+    EVENT_CALLBACKS_COUNT = 0;
+    for (idx = 0; idx < benchTypesCount; idx++) {
+        EventRegisterCallback(benchTypes[idx], &BenchEventCallback, 0);
+    }
+    printf(
+        "    %d callbacks registered by Handler + MID + BMBT\n",
+        benchTypesCount
+    );
+
+    // Trigger every event type in turn, subscribed to or not
+    uint64_t start = TestGetNanos();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        for (idx = 0; idx < EVENT_MAX_TYPES; idx++) {
+            BenchEventLinearTrigger(idx, data);
+        }
+    }
+    double linearNanos = (double) (TestGetNanos() - start) /
+        BENCH_ROUNDS / EVENT_MAX_TYPES;
+    uint32_t linearCalls = benchCalls;
+
+    benchCalls = 0;
+    start = TestGetNanos();
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        for (idx = 0; idx < EVENT_MAX_TYPES; idx++) {
+            EventTriggerCallback(idx, data);
+        }
+    }
+    double indexedNanos = (double) (TestGetNanos() - start) /
+        BENCH_ROUNDS / EVENT_MAX_TYPES;
+    TEST_ASSERT_EQUAL(linearCalls, benchCalls);
+
+    printf("    Trigger each of %d event types:\n", EVENT_MAX_TYPES);
+    printf("        Linear scan:     %8.1f ns/event\n", linearNanos);
+    printf("        Indexed by type: %8.1f ns/event\n", indexedNanos);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/*
+ * File: bench_ibus.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Benchmark how many received frames per second IBusProcess() decodes
+ *     and dispatches
+ */
+#include <string.h>
+#include "test.h"
+#include "lib/event.h"
+#include "lib/ibus.h"
+
+extern volatile uint32_t TimerCurrentMillis;
+
+#define BENCH_FRAMES 200000
+
+/* Source, destination and data of frames that we route */
+static const unsigned char BenchIBusRouted[][8] = {
+    {0x50, 0x68, 0x3B, 0x01},
+    {0x68, 0x18, 0x38, 0x00, 0x00},
+    {0x80, 0xBF, 0x11, 0x01},
+    {0xF0, 0x68, 0x48, 0x08}
+};
+static const uint8_t BenchIBusRoutedLengths[] = {4, 5, 4, 4};
+
+/* and frames that nobody subscribes to, which are most of the bus */
+static const unsigned char BenchIBusIgnored[][8] = {
+    {0x3F, 0x00, 0x0C, 0x00, 0x00},
+    {0x80, 0xBF, 0x17, 0x00, 0x12, 0x34},
+    {0x44, 0xBF, 0x74, 0x04, 0x00},
+    {0x80, 0xBF, 0x19, 0x3A, 0x50, 0x00},
+    {0x00, 0xBF, 0x76, 0x00},
+    {0xE8, 0xD0, 0x59, 0x21, 0x03}
+};
+static const uint8_t BenchIBusIgnoredLengths[] = {5, 6, 5, 6, 4, 5};
+
+static IBus_t ibus;
+
+static uint8_t BenchIBusBuildFrame(
+    unsigned char *frame,
+    const unsigned char *src,
+    uint8_t dataLength
+) {
+    uint8_t idx;
+    frame[0] = src[0];
+    frame[1] = dataLength;
+    memcpy(&frame[2], &src[1], dataLength - 1);
+    frame[dataLength + 1] = 0x00;
+    for (idx = 0; idx < dataLength + 1; idx++) {
+        frame[dataLength + 1] ^= frame[idx];
+    }
+    return dataLength + 2;
+}
+
+/**
+ * BenchIBusRun()
+ *     Description:
+ *         Time IBusProcess() over BENCH_FRAMES frames, one in routedEvery of
+ *         which is routed, or none if routedEvery is zero
+ */
+static double BenchIBusRun(uint8_t routedEvery)
+{
+    unsigned char frame[IBUS_MAX_MSG_LENGTH];
+    uint64_t elapsed = 0;
+    uint32_t sent = 0;
+    uint32_t micros = 0;
+    ibus = IBusInit();
+    while (sent < BENCH_FRAMES) {
+        // Fill the RX queue like the ISR would between main loop passes
+        while (CharQueueGetSize(&ibus.uart.rxQueue) < CHAR_QUEUE_SIZE - IBUS_MAX_MSG_LENGTH) {
+            uint8_t length;
+            if (routedEvery != 0 && sent % routedEvery == 0) {
+                uint8_t idx = (sent / routedEvery) % sizeof(BenchIBusRoutedLengths);
+                length = BenchIBusBuildFrame(
+                    frame,
+                    BenchIBusRouted[idx],
+                    BenchIBusRoutedLengths[idx]
+                );
+            } else {
+                uint8_t idx = sent % sizeof(BenchIBusIgnoredLengths);
+                length = BenchIBusBuildFrame(
+                    frame,
+                    BenchIBusIgnored[idx],
+                    BenchIBusIgnoredLengths[idx]
+                );
+            }
+            uint8_t idx;
+            for (idx = 0; idx < length; idx++) {
+                micros += IBUS_BYTE_TIME_US;
+                IBusRXByte(&ibus, frame[idx], micros);
+            }
+            sent++;
+        }
+        TimerCurrentMillis = micros / 1000;
+        uint64_t start = TestGetNanos();
+        IBusProcess(&ibus);
+        while (EventQueueProcess() == 1);
+        elapsed += TestGetNanos() - start;
+    }
+    TEST_ASSERT_EQUAL(0, ibus.rxDroppedBytes);
+    return sent * 1e9 / elapsed;
+}
+
+int main()
+{
+    printf("    Decode and dispatch received frames:\n");
+    printf("        No routed frames:      %10.0f frames/s\n", BenchIBusRun(0));
+    printf("        One in five routed:    %10.0f frames/s\n", BenchIBusRun(5));
+    printf("        Every frame routed:    %10.0f frames/s\n", BenchIBusRun(1));
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * File: bench_ibus_pacing.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Simulate the IBus with synthetic traffic from other modules and time
+ *     how long a 10 line GT menu refresh takes to go out, with the gap
+ *     between our frames following the bus load and with the fixed 7ms gap
+ *     that it replaced
+ */
+#include <string.h>
+#include "test.h"
+#include "lib/ibus.h"
+
+void _AltU1TXInterrupt();
+extern volatile uint32_t TimerCurrentMillis;
+
+#define SIM_STEP_US 50
+#define SIM_REFRESHES 50
+#define SIM_MENU_LINES 10
+#define SIM_FIXED_GAP 7
+
+/* A frame from another module, as src len dst data... chk */
+static const unsigned char SimForeignFrame[] = {
+    0x80, 0x0A, 0xBF, 0x13, 0x03, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x37
+};
+
+typedef struct SimBus_t {
+    uint32_t now;
+    // Our UART shifting a byte out, and the TH3122 handing it back
+    uint8_t txShifting;
+    unsigned char txByte;
+    uint32_t txByteEnd;
+    // Another module sending a frame
+    uint8_t foreignIdx;
+    uint8_t foreignActive;
+    uint32_t foreignNextByte;
+    uint32_t foreignNextFrame;
+    uint32_t foreignMeanGap;
+} SimBus_t;
+
+static IBus_t ibus;
+static SimBus_t bus;
+
+static void SimSetClock()
+{
+    TimerCurrentMillis = bus.now / 1000;
+    TMR1 = (bus.now % 1000) * TIMER_TICKS_PER_US;
+}
+
+/**
+ * SimStep()
+ *     Description:
+ *         Move the bus forward by one step: finish and echo bytes, start the
+ *         frames of other modules once the bus is free, feed our UART from
+ *         the TX interrupt and run the main loop
+ */
+static void SimStep(uint8_t fixedGap)
+{
+    bus.now += SIM_STEP_US;
+    SimSetClock();
+    if (bus.txShifting == 1 && bus.now >= bus.txByteEnd) {
+        bus.txShifting = 0;
+        HostUART[0].uxsta |= UART_STA_TRMT;
+        IBusRXByte(&ibus, bus.txByte, bus.now);
+    }
+    if (bus.foreignActive == 1 && bus.now >= bus.foreignNextByte) {
+        IBusRXByte(&ibus, SimForeignFrame[bus.foreignIdx++], bus.now);
+        bus.foreignNextByte = bus.now + IBUS_BYTE_TIME_US;
+        if (bus.foreignIdx == sizeof(SimForeignFrame)) {
+            bus.foreignActive = 0;
+            bus.foreignNextFrame = bus.now + bus.foreignMeanGap / 2 +
+                rand() % (bus.foreignMeanGap + 1);
+        }
+    }
+    if (bus.foreignMeanGap > 0 &&
+        bus.foreignActive == 0 &&
+        bus.txShifting == 0 &&
+        ibus.txState == IBUS_TX_STATE_IDLE &&
+        bus.now >= bus.foreignNextFrame
+    ) {
+        bus.foreignActive = 1;
+        bus.foreignIdx = 0;
+        bus.foreignNextByte = bus.now;
+    }
+    // Other modules hold off while they see our frame on the bus, and the
+    // TH3122 STATUS line is high while there is traffic on it
+    PORTDbits.RD0 = (bus.txShifting == 1 || bus.foreignActive == 1);
+    if (bus.txShifting == 0 && HostUARTTXIE[0] == 1) {
+        uint8_t frameIdx = ibus.txFrameIdx;
+        _AltU1TXInterrupt();
+        if (ibus.txFrameIdx != frameIdx) {
+            bus.txShifting = 1;
+            bus.txByte = HostUART[0].uxtxreg;
+            bus.txByteEnd = bus.now + IBUS_BYTE_TIME_US;
+            HostUART[0].uxsta &= ~UART_STA_TRMT;
+        }
+    }
+    IBusProcess(&ibus);
+    if (fixedGap == 1) {
+        ibus.txGap = SIM_FIXED_GAP;
+    }
+}
+
+static uint8_t SimTXPending()
+{
+    uint8_t txClass;
+    for (txClass = 0; txClass < IBUS_TX_CLASS_COUNT; txClass++) {
+        if (ibus.txQueues[txClass].count > 0) {
+            return 1;
+        }
+    }
+    return ibus.txState != IBUS_TX_STATE_IDLE;
+}
+
+/**
+ * SimRun()
+ *     Description:
+ *         Send SIM_REFRESHES menu refreshes, each once the previous one is
+ *         out and the UI has had 100ms to think about the next
+ *     Returns:
+ *         double - The average time a refresh took, in milliseconds
+ */
+static double SimRun(uint8_t load, uint8_t fixedGap)
+{
+    uint32_t total = 0;
+    uint16_t refresh;
+    srand(16);
+    memset(&bus, 0, sizeof(bus));
+    bus.now = 1000000;
+    SimSetClock();
+    memset((void *) HostUART, 0, sizeof(HostUART));
+    HostUART[0].uxsta = UART_STA_TRMT;
+    ibus = IBusInit();
+    UARTAddModuleHandler(&ibus.uart);
+    // Work out the mean silence between foreign frames for the given load
+    if (load > 0) {
+        uint32_t frameTime = sizeof(SimForeignFrame) * IBUS_BYTE_TIME_US;
+        bus.foreignMeanGap = frameTime * (100 - load) / load;
+    }
+    bus.foreignNextFrame = bus.now;
+    for (refresh = 0; refresh < SIM_REFRESHES; refresh++) {
+        uint32_t idle = bus.now + 100000;
+        while (bus.now < idle) {
+            SimStep(fixedGap);
+        }
+        uint32_t start = bus.now;
+        uint8_t line;
+        for (line = 0; line < SIM_MENU_LINES; line++) {
+            char text[12];
+            snprintf(text, sizeof(text), "Device %d", line);
+            IBusCommandGTWriteIndex(&ibus, line, text);
+        }
+        while (SimTXPending() == 1) {
+            SimStep(fixedGap);
+        }
+        total += bus.now - start;
+    }
+    TEST_ASSERT_EQUAL(SIM_REFRESHES * SIM_MENU_LINES, ibus.txFrames);
+    return total / 1000.0 / SIM_REFRESHES;
+}
+
+int main()
+{
+    static const uint8_t loads[] = {0, 10, 25, 40};
+    uint8_t idx;
+    printf("    10 line GT menu refresh, average time to send:\n");
+    printf("        Bus load   Fixed 7ms gap   Adaptive gap\n");
+    for (idx = 0; idx < sizeof(loads); idx++) {
+        double fixed = SimRun(loads[idx], 1);
+        double adaptive = SimRun(loads[idx], 0);
+        printf(
+            "        %7d%%   %10.1f ms   %9.1f ms (txGap %dms, busLoad %d%%)\n",
+            loads[idx],
+            fixed,
+            adaptive,
+            ibus.txGap,
+            ibus.busLoad
+        );
+        // A quiet bus must never be slower than the fixed gap was
+        if (loads[idx] == 0) {
+            TEST_ASSERT(adaptive <= fixed);
+        }
+    }
+    return 0;
+}
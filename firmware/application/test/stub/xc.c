@@ -0,0 +1,110 @@
+/*
+ * File: xc.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Host definitions of the registers declared in the stub xc.h and of the
+ *     assembly routines in sfr_setters.s
+ */
+#include <xc.h>
+#include "../../lib/sfr_setters.h"
+
+volatile UART HostUART[4];
+
+volatile HostBits_t I2C3CONLbits, I2C3STATbits, IFS0bits, INTCON1bits;
+volatile HostBits_t INTCON2bits, T2CONbits;
+volatile HostBits_t LATBbits, LATDbits, LATEbits, LATFbits;
+volatile HostBits_t PORTDbits, PORTEbits, PORTFbits;
+volatile HostBits_t TRISBbits, TRISDbits, TRISEbits, TRISFbits;
+
+volatile uint16_t ANSB, ANSD, ANSE, ANSF, ANSG;
+volatile uint16_t I2C3BRG, I2C3CONL, I2C3RCV, I2C3TRN;
+volatile uint16_t OSCCON, PR1, PR2, T1CON, TMR1, TMR2;
+volatile uint16_t HostRPOR[32];
+// Transfers complete as soon as they start
+volatile HostBits_t SPI1STATLbits = {.SPIRBF = 1};
+volatile uint16_t SPI1BRGL, SPI1BUFL, SPI1CON1L;
+volatile uint16_t _SDI1R, _U1RXR, _U2RXR, _U3RXR, _U4RXR;
+
+uint8_t HostUARTRXIE[4], HostUARTRXIF[4];
+uint8_t HostUARTTXIE[4], HostUARTTXIF[4];
+
+void (*HostIdleHook)(void);
+
+void Idle(void)
+{
+    if (HostIdleHook != 0) {
+        HostIdleHook();
+    }
+}
+
+void Nop(void)
+{
+}
+
+void __builtin_write_OSCCONL(uint16_t value)
+{
+    OSCCON = value;
+}
+
+void SetI2CMAEV(unsigned index, unsigned value)
+{
+}
+
+void SetI2CSLEV(unsigned index, unsigned value)
+{
+}
+
+void SetSPIIE(unsigned index, unsigned value)
+{
+}
+
+void SetSPITXIE(unsigned index, unsigned value)
+{
+}
+
+void SetSPIRXIE(unsigned index, unsigned value)
+{
+}
+
+void SetTIMERIE(unsigned index, unsigned value)
+{
+}
+
+void SetTIMERIF(unsigned index, unsigned value)
+{
+    if (index == 0) {
+        IFS0bits.T1IF = value;
+    }
+}
+
+void SetTIMERIP(unsigned index, unsigned value)
+{
+}
+
+void SetUARTRXIE(unsigned index, unsigned value)
+{
+    HostUARTRXIE[index] = value;
+}
+
+void SetUARTRXIF(unsigned index, unsigned value)
+{
+    HostUARTRXIF[index] = value;
+}
+
+void SetUARTRXIP(unsigned index, unsigned value)
+{
+}
+
+void SetUARTTXIE(unsigned index, unsigned value)
+{
+    HostUARTTXIE[index] = value;
+}
+
+void SetUARTTXIF(unsigned index, unsigned value)
+{
+    HostUARTTXIF[index] = value;
+}
+
+void SetUARTTXIP(unsigned index, unsigned value)
+{
+}
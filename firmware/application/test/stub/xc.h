@@ -0,0 +1,80 @@
+/*
+ * File: xc.h
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Stand-in for the XC16 device header so that the application sources
+ *     can be built with the host compiler. Special function registers are
+ *     plain variables (defined in xc.c) that the tests read and write to
+ *     play the part of the hardware.
+ */
+#ifndef XC_H
+#define XC_H
+#include <stdint.h>
+/* The host compiler has no use for the XC16 interrupt attributes */
+#define __interrupt__ used
+#define auto_psv unused
+/* utils.c issues a RESET instruction, which the host assembler doesn't know */
+__asm__(".macro RESET\n.endm");
+
+/**
+ * HostBits_t
+ *     Description:
+ *         One structure serves every SFRbits register, holding all the bit
+ *         fields that the application touches.
+ */
+typedef struct HostBits_t {
+    unsigned ACKDT, ACKEN, ACKSTAT, AIVTEN, ADDRERR, BCL, DISSLW, I2CEN, I2COV;
+    unsigned IWCOL, MATHERR, OSCFAIL, PEN, RBF, RCEN, RSEN, SEN, STKERR;
+    unsigned SPIRBF, SPIROV, T1IF, T2IF, TBF, TON, TRSTAT;
+    unsigned LATB7, LATD3, LATE0, LATE2, LATE3, LATE6, LATE7, LATF1;
+    unsigned RD0, RD4, RD8, RE6, RE7, RF1;
+    unsigned TRISB7, TRISD3, TRISD4, TRISD8;
+    unsigned TRISE0, TRISE2, TRISE3, TRISE6, TRISE7, TRISF1;
+} HostBits_t;
+
+/**
+ * UART
+ *     Description:
+ *         The register block of a UART module. Each UxMODE register is the
+ *         first member of its module's block, like it is on the device, so
+ *         (UART *) &U1MODE is safe.
+ */
+typedef struct UART {
+    uint16_t uxmode;
+    uint16_t uxsta;
+    uint16_t uxtxreg;
+    uint16_t uxrxreg;
+    uint16_t uxbrg;
+} UART;
+
+extern volatile UART HostUART[4];
+#define U1MODE HostUART[0].uxmode
+#define U2MODE HostUART[1].uxmode
+#define U3MODE HostUART[2].uxmode
+#define U4MODE HostUART[3].uxmode
+
+extern volatile HostBits_t I2C3CONLbits, I2C3STATbits, IFS0bits, INTCON1bits;
+extern volatile HostBits_t INTCON2bits, SPI1STATLbits, T2CONbits;
+extern volatile HostBits_t LATBbits, LATDbits, LATEbits, LATFbits;
+extern volatile HostBits_t PORTDbits, PORTEbits, PORTFbits;
+extern volatile HostBits_t TRISBbits, TRISDbits, TRISEbits, TRISFbits;
+
+extern volatile uint16_t ANSB, ANSD, ANSE, ANSF, ANSG;
+extern volatile uint16_t I2C3BRG, I2C3CONL, I2C3RCV, I2C3TRN;
+extern volatile uint16_t OSCCON, PR1, PR2, T1CON, TMR1, TMR2;
+extern volatile uint16_t HostRPOR[32];
+#define RPOR0 HostRPOR[0]
+extern volatile uint16_t SPI1BRGL, SPI1BUFL, SPI1CON1L;
+extern volatile uint16_t _SDI1R, _U1RXR, _U2RXR, _U3RXR, _U4RXR;
+
+/* The state last set through sfr_setters.h, by module index */
+extern uint8_t HostUARTRXIE[4], HostUARTRXIF[4];
+extern uint8_t HostUARTTXIE[4], HostUARTTXIF[4];
+
+/* Called from Idle(), so that a test can move its clock while we sleep */
+extern void (*HostIdleHook)(void);
+
+void Idle(void);
+void Nop(void);
+void __builtin_write_OSCCONL(uint16_t);
+#endif /* XC_H */
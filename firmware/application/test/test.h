@@ -0,0 +1,87 @@
+/*
+ * File: test.h
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Minimal assertion and timing helpers for the host tests and benchmarks
+ */
+#ifndef TEST_H
+#define TEST_H
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Fail the test with the location of the broken expectation */
+#define TEST_ASSERT(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: FAIL: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL(expected, actual) \
+    do { \
+        long long _e = (long long) (expected); \
+        long long _a = (long long) (actual); \
+        if (_e != _a) { \
+            fprintf( \
+                stderr, \
+                "%s:%d: FAIL: %s == %s (%lld != %lld)\n", \
+                __FILE__, \
+                __LINE__, \
+                #expected, \
+                #actual, \
+                _e, \
+                _a \
+            ); \
+            exit(1); \
+        } \
+    } while (0)
+
+/* Run a test function and report it */
+#define TEST_RUN(test) \
+    do { \
+        test(); \
+        printf("    %s: OK\n", #test); \
+        fflush(stdout); \
+    } while (0)
+
+/* Keep the compiler from optimizing away a benchmarked result */
+#define TEST_KEEP(value) __asm__ volatile ("" :: "r" (value) : "memory")
+
+/**
+ * TestGetNanos()
+ *     Description:
+ *         Return a monotonic timestamp for benchmarks
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint64_t - The time in nanoseconds
+ */
+static inline uint64_t TestGetNanos()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * TestGetCycles()
+ *     Description:
+ *         Return the CPU timestamp counter for benchmarks that report cycles.
+ *         Hosts without one fall back to nanoseconds.
+ *     Params:
+ *         None
+ *     Returns:
+ *         uint64_t - The cycle count
+ */
+static inline uint64_t TestGetCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return TestGetNanos();
+#endif
+}
+#endif /* TEST_H */
@@ -0,0 +1,355 @@
+/*
+ * File: test_bc127.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Unit tests for the BC127 paired device index, device name pool and
+ *     command pipeline
+ */
+#include <string.h>
+#include "test.h"
+#include "lib/bc127.h"
+
+extern volatile uint32_t TimerCurrentMillis;
+
+static BC127_t bt;
+static uint8_t linkFailures;
+
+/**
+ * TestBC127MacId()
+ *     Description:
+ *         Make up the MAC ID of device n, such that it hashes to the given
+ *         slot of the paired device index
+ */
+static void TestBC127MacId(uint8_t *macId, uint8_t n, uint8_t slot)
+{
+    macId[0] = 0x3C;
+    macId[1] = 0x2E;
+    macId[2] = 0xFF;
+    macId[3] = n;
+    macId[4] = 0x40;
+    macId[5] = n ^ 0x40 ^ slot;
+}
+
+/**
+ * TestBC127Name()
+ *     Description:
+ *         Make up a name of the longest length that is kept, unique to n
+ */
+static void TestBC127Name(char *name, uint8_t n)
+{
+    memset(name, 'A' + n, BC127_NAME_MAX_LENGTH);
+    name[BC127_NAME_MAX_LENGTH] = '\0';
+}
+
+static void TestBC127IndexWrap()
+{
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    uint8_t n;
+    bt = BC127Init();
+    // Every device lands on the last slot, so the probe has to wrap
+    for (n = 0; n < BC127_MAX_DEVICE_PAIRED; n++) {
+        TestBC127MacId(macId, n, BC127_PAIRED_DEVICE_INDEX_SIZE - 1);
+        BC127PairedDeviceInit(&bt, macId, "Phone");
+    }
+    TEST_ASSERT_EQUAL(BC127_MAX_DEVICE_PAIRED, bt.pairedDevicesCount);
+    TEST_ASSERT_EQUAL(0, bt.pairedDevicesIndex[BC127_PAIRED_DEVICE_INDEX_SIZE - 1]);
+    TEST_ASSERT_EQUAL(1, bt.pairedDevicesIndex[0]);
+    for (n = 0; n < BC127_MAX_DEVICE_PAIRED; n++) {
+        TestBC127MacId(macId, n, BC127_PAIRED_DEVICE_INDEX_SIZE - 1);
+        TEST_ASSERT_EQUAL(n, BC127PairedDeviceFind(&bt, macId));
+    }
+    // Misses stop at the first free slot, whether they share the slot or
+    // start on one of the slots that the probe wrapped onto
+    TestBC127MacId(macId, BC127_MAX_DEVICE_PAIRED, BC127_PAIRED_DEVICE_INDEX_SIZE - 1);
+    TEST_ASSERT_EQUAL(-1, BC127PairedDeviceFind(&bt, macId));
+    TestBC127MacId(macId, BC127_MAX_DEVICE_PAIRED, 0);
+    TEST_ASSERT_EQUAL(-1, BC127PairedDeviceFind(&bt, macId));
+    // A full table takes no more devices
+    BC127PairedDeviceInit(&bt, macId, "Tablet");
+    TEST_ASSERT_EQUAL(BC127_MAX_DEVICE_PAIRED, bt.pairedDevicesCount);
+    TEST_ASSERT_EQUAL(-1, BC127PairedDeviceFind(&bt, macId));
+}
+
+static void TestBC127ClearInactiveFirst()
+{
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    uint8_t n;
+    bt = BC127Init();
+    for (n = 0; n < 3; n++) {
+        TestBC127MacId(macId, n, 5);
+        BC127PairedDeviceInit(&bt, macId, n == 0 ? "Phone" : "Tablet");
+    }
+    TestBC127MacId(bt.activeDevice.macId, 0, 5);
+    bt.activeDevice.deviceName = bt.pairedDevices[0].deviceName;
+    BC127ClearInactivePairedDevices(&bt);
+    TEST_ASSERT_EQUAL(1, bt.pairedDevicesCount);
+    TEST_ASSERT_EQUAL(0, BC127PairedDeviceFind(&bt, bt.activeDevice.macId));
+    TEST_ASSERT(strcmp(bt.pairedDevices[0].deviceName, "Phone") == 0);
+    TEST_ASSERT(bt.pairedDevices[0].deviceName == bt.activeDevice.deviceName);
+    for (n = 1; n < 3; n++) {
+        TestBC127MacId(macId, n, 5);
+        TEST_ASSERT_EQUAL(-1, BC127PairedDeviceFind(&bt, macId));
+    }
+    // The device that was second is not found through a stale index slot
+    TEST_ASSERT_EQUAL(-1, bt.pairedDevicesIndex[6]);
+}
+
+static void TestBC127NamePoolCompact()
+{
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    char name[BC127_NAME_MAX_LENGTH + 1];
+    uint8_t n;
+    bt = BC127Init();
+    char *blank = BC127NamePoolIntern(&bt, "");
+    for (n = 0; n < 7; n++) {
+        TestBC127MacId(macId, n, n);
+        TestBC127Name(name, n);
+        BC127PairedDeviceInit(&bt, macId, name);
+    }
+    // Only the last name stays in use, by a device and the active device
+    BC127ClearPairedDevices(&bt);
+    TestBC127Name(name, 6);
+    TestBC127MacId(macId, 6, 6);
+    BC127PairedDeviceInit(&bt, macId, name);
+    char *lastName = bt.pairedDevices[0].deviceName;
+    TEST_ASSERT(lastName == blank + 1 + 6 * (BC127_NAME_MAX_LENGTH + 1));
+    bt.activeDevice.deviceName = lastName;
+    // There is no room for another name until the pool is compacted
+    TestBC127Name(name, 7);
+    char *newName = BC127NamePoolIntern(&bt, name);
+    TEST_ASSERT(newName == blank + 1 + (BC127_NAME_MAX_LENGTH + 1));
+    TEST_ASSERT(strcmp(newName, name) == 0);
+    TEST_ASSERT(bt.pairedDevices[0].deviceName == blank + 1);
+    TEST_ASSERT(bt.activeDevice.deviceName == blank + 1);
+    TestBC127Name(name, 6);
+    TEST_ASSERT(strcmp(bt.activeDevice.deviceName, name) == 0);
+    TEST_ASSERT_EQUAL(0, BC127PairedDeviceFind(&bt, macId));
+}
+
+static void TestBC127NamePoolFull()
+{
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    char name[BC127_NAME_MAX_LENGTH + 1];
+    uint8_t n;
+    bt = BC127Init();
+    char *blank = BC127NamePoolIntern(&bt, "");
+    // Seven of the longest names fill the pool, and all of them are in use
+    for (n = 0; n < BC127_MAX_DEVICE_PAIRED; n++) {
+        TestBC127MacId(macId, n, n);
+        TestBC127Name(name, n);
+        BC127PairedDeviceInit(&bt, macId, name);
+    }
+    TEST_ASSERT_EQUAL(BC127_MAX_DEVICE_PAIRED, bt.pairedDevicesCount);
+    for (n = 0; n < BC127_MAX_DEVICE_PAIRED - 1; n++) {
+        TestBC127Name(name, n);
+        TEST_ASSERT(strcmp(bt.pairedDevices[n].deviceName, name) == 0);
+    }
+    TEST_ASSERT(bt.pairedDevices[BC127_MAX_DEVICE_PAIRED - 1].deviceName == blank);
+    TEST_ASSERT_EQUAL('\0', blank[0]);
+    // Names that are already pooled are still found
+    TestBC127Name(name, 3);
+    TEST_ASSERT(BC127NamePoolIntern(&bt, name) == bt.pairedDevices[3].deviceName);
+}
+
+/**
+ * TestBC127Sent()
+ *     Description:
+ *         Take the next command that was written to the UART
+ *     Returns:
+ *         char * - The command, empty if none was written
+ */
+static char *TestBC127Sent()
+{
+    static char command[BC127_CMD_MAX_LENGTH];
+    uint16_t length = CharQueueSeekLine(&bt.uart.txQueue, BC127_MSG_END_CHAR);
+    command[0] = '\0';
+    if (length > 0) {
+        CharQueueRead(&bt.uart.txQueue, (unsigned char *) command, length);
+        command[length - 1] = '\0';
+    }
+    return command;
+}
+
+/**
+ * TestBC127Reply()
+ *     Description:
+ *         Hand a message from the module to the parser
+ */
+static void TestBC127Reply(char *msg)
+{
+    CharQueueWrite(&bt.uart.rxQueue, (unsigned char *) msg, strlen(msg));
+    CharQueueAdd(&bt.uart.rxQueue, BC127_MSG_END_CHAR);
+    BC127Process(&bt);
+}
+
+static void TestBC127Wait(uint32_t millis)
+{
+    TimerCurrentMillis += millis;
+    BC127Process(&bt);
+}
+
+static void TestBC127LinkFailed(void *ctx, unsigned char *macId)
+{
+    linkFailures++;
+}
+
+static void TestBC127CommandMatch()
+{
+    TimerCurrentMillis = 1000;
+    bt = BC127Init();
+    BC127CommandQueue_t *stats = BC127GetCommandStats();
+    BC127SendCommand(&bt, "VERSION");
+    BC127SendCommand(&bt, "STATUS");
+    BC127SendCommand(&bt, "MUSIC 1 PLAY");
+    // One command at a time, each sent once the one before is answered
+    TEST_ASSERT(strcmp(TestBC127Sent(), "VERSION") == 0);
+    TEST_ASSERT_EQUAL('\0', TestBC127Sent()[0]);
+    TestBC127Wait(20);
+    TEST_ASSERT_EQUAL('\0', TestBC127Sent()[0]);
+    TestBC127Reply("OK");
+    TEST_ASSERT_EQUAL(1, stats->completed);
+    TEST_ASSERT_EQUAL(20, stats->latencyMax);
+    TEST_ASSERT(strcmp(TestBC127Sent(), "STATUS") == 0);
+    TestBC127Reply("ERROR");
+    TEST_ASSERT_EQUAL(1, stats->errors);
+    TEST_ASSERT(strcmp(TestBC127Sent(), "MUSIC 1 PLAY") == 0);
+    TestBC127Reply("OK");
+    TEST_ASSERT_EQUAL(2, stats->completed);
+    TEST_ASSERT_EQUAL(3, stats->sent);
+    // An answer with nothing in flight is ignored
+    TestBC127Reply("OK");
+    TEST_ASSERT_EQUAL(2, stats->completed);
+    TEST_ASSERT_EQUAL(1, stats->errors);
+}
+
+static void TestBC127CommandTimeout()
+{
+    uint8_t retry;
+    TimerCurrentMillis = 1000;
+    bt = BC127Init();
+    BC127CommandQueue_t *stats = BC127GetCommandStats();
+    BC127SendCommand(&bt, "STATUS");
+    BC127SendCommand(&bt, "MUSIC 1 FORWARD");
+    BC127SendCommand(&bt, "VERSION");
+    TEST_ASSERT(strcmp(TestBC127Sent(), "STATUS") == 0);
+    TestBC127Wait(BC127_CMD_TIMEOUT);
+    TEST_ASSERT_EQUAL('\0', TestBC127Sent()[0]);
+    // A query is sent again when its answer is overdue
+    for (retry = 0; retry < BC127_CMD_RETRIES; retry++) {
+        TestBC127Wait(1);
+        TEST_ASSERT(strcmp(TestBC127Sent(), "STATUS") == 0);
+        TestBC127Wait(BC127_CMD_TIMEOUT);
+    }
+    TEST_ASSERT_EQUAL(BC127_CMD_RETRIES, stats->retries);
+    // until it runs out of retries
+    TestBC127Wait(1);
+    TEST_ASSERT_EQUAL(1, stats->timeouts);
+    TEST_ASSERT(strcmp(TestBC127Sent(), "MUSIC 1 FORWARD") == 0);
+    // Skipping a track must not happen twice, so it is never sent again
+    TestBC127Wait(BC127_CMD_TIMEOUT + 1);
+    TEST_ASSERT_EQUAL(2, stats->timeouts);
+    TEST_ASSERT_EQUAL(BC127_CMD_RETRIES, stats->retries);
+    TEST_ASSERT(strcmp(TestBC127Sent(), "VERSION") == 0);
+    TEST_ASSERT_EQUAL('\0', TestBC127Sent()[0]);
+    // A late answer goes to the command that is in flight now
+    TestBC127Reply("OK");
+    TEST_ASSERT_EQUAL(1, stats->completed);
+    TEST_ASSERT_EQUAL(0, stats->inFlightLength);
+}
+
+static void TestBC127CommandOpen()
+{
+    uint8_t macId[BC127_MAC_ID_LENGTH];
+    char macIdText[13];
+    char expected[32];
+    char reply[40];
+    TimerCurrentMillis = 1000;
+    bt = BC127Init();
+    linkFailures = 0;
+    EventRegisterCallback(BC127Event_DeviceLinkFailed, &TestBC127LinkFailed, 0);
+    BC127CommandQueue_t *stats = BC127GetCommandStats();
+    TestBC127MacId(macId, 1, 1);
+    BC127MacIdFormat(macIdText, macId);
+    BC127CommandProfileOpen(&bt, macId, "A2DP");
+    BC127CommandProfileOpen(&bt, macId, "AVRCP");
+    BC127SendCommand(&bt, "VERSION");
+    // The OK of an OPEN cannot be told apart, so nothing else is in flight
+    snprintf(expected, sizeof(expected), "OPEN %s A2DP", macIdText);
+    TEST_ASSERT(strcmp(TestBC127Sent(), expected) == 0);
+    TEST_ASSERT_EQUAL('\0', TestBC127Sent()[0]);
+    TestBC127Reply("OK");
+    TEST_ASSERT_EQUAL(1, stats->openInFlight);
+    TEST_ASSERT_EQUAL(0, stats->completed);
+    // After that only OPEN_OK or OPEN_ERROR can follow, so the other
+    // commands go ahead, but the next OPEN waits
+    TEST_ASSERT(strcmp(TestBC127Sent(), "VERSION") == 0);
+    TEST_ASSERT_EQUAL('\0', TestBC127Sent()[0]);
+    TestBC127Reply("OK");
+    TEST_ASSERT_EQUAL(1, stats->completed);
+    TEST_ASSERT_EQUAL(1, stats->openInFlight);
+    TEST_ASSERT_EQUAL('\0', TestBC127Sent()[0]);
+    // A profile that we did not ask for is not ours
+    snprintf(reply, sizeof(reply), "OPEN_OK 12 HFP %s", macIdText);
+    TestBC127Reply(reply);
+    TEST_ASSERT_EQUAL(1, stats->openInFlight);
+    TEST_ASSERT_EQUAL(2, stats->opensCount);
+    // though it does connect the device, whose name is then asked for
+    TEST_ASSERT(strncmp(TestBC127Sent(), "NAME ", 5) == 0);
+    TestBC127Reply("OK");
+    TestBC127Reply("OPEN_ERROR A2DP");
+    TEST_ASSERT_EQUAL(1, linkFailures);
+    TEST_ASSERT_EQUAL(1, stats->errors);
+    TEST_ASSERT_EQUAL(1, stats->opensCount);
+    snprintf(expected, sizeof(expected), "OPEN %s AVRCP", macIdText);
+    TEST_ASSERT(strcmp(TestBC127Sent(), expected) == 0);
+    // An OPEN that is rejected outright fails the link as well
+    TestBC127Reply("ERROR");
+    TEST_ASSERT_EQUAL(2, linkFailures);
+    TEST_ASSERT_EQUAL(0, stats->opensCount);
+    TEST_ASSERT_EQUAL(0, stats->openInFlight);
+
+    // An OPEN that never gets its OK is not sent again
+    BC127CommandProfileOpen(&bt, macId, "A2DP");
+    TestBC127Wait(0);
+    snprintf(expected, sizeof(expected), "OPEN %s A2DP", macIdText);
+    TEST_ASSERT(strcmp(TestBC127Sent(), expected) == 0);
+    TestBC127Wait(BC127_CMD_TIMEOUT + 1);
+    TEST_ASSERT_EQUAL(3, linkFailures);
+    TEST_ASSERT_EQUAL(1, stats->timeouts);
+    TEST_ASSERT_EQUAL(0, stats->retries);
+    TEST_ASSERT_EQUAL('\0', TestBC127Sent()[0]);
+    // and neither is one that never gets its OPEN_OK
+    BC127CommandProfileOpen(&bt, macId, "A2DP");
+    TestBC127Wait(0);
+    TestBC127Sent();
+    TestBC127Reply("OK");
+    TestBC127Wait(BC127_CMD_OPEN_TIMEOUT);
+    TEST_ASSERT_EQUAL(1, stats->openInFlight);
+    TestBC127Wait(1);
+    TEST_ASSERT_EQUAL(4, linkFailures);
+    TEST_ASSERT_EQUAL(2, stats->timeouts);
+    TEST_ASSERT_EQUAL(0, stats->openInFlight);
+
+    // An OPEN_OK that comes before the OK completes the OPEN too
+    BC127CommandProfileOpen(&bt, macId, "A2DP");
+    TestBC127Wait(0);
+    TestBC127Sent();
+    snprintf(reply, sizeof(reply), "OPEN_OK 11 A2DP %s", macIdText);
+    TestBC127Reply(reply);
+    TEST_ASSERT_EQUAL(0, stats->opensCount);
+    TEST_ASSERT_EQUAL(0, stats->inFlightLength);
+    TEST_ASSERT_EQUAL(4, linkFailures);
+    EventUnregisterCallback(BC127Event_DeviceLinkFailed, &TestBC127LinkFailed);
+}
+
+int main()
+{
+    TEST_RUN(TestBC127IndexWrap);
+    TEST_RUN(TestBC127ClearInactiveFirst);
+    TEST_RUN(TestBC127NamePoolCompact);
+    TEST_RUN(TestBC127NamePoolFull);
+    TEST_RUN(TestBC127CommandMatch);
+    TEST_RUN(TestBC127CommandTimeout);
+    TEST_RUN(TestBC127CommandOpen);
+    return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * File: test_char_queue.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Unit tests for the CharQueue FIFO
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "test.h"
+#include "lib/char_queue.h"
+
+static CharQueue_t queue;
+
+static void TestCharQueueAddString(CharQueue_t *q, const char *str)
+{
+    while (*str) {
+        CharQueueAdd(q, (unsigned char) *str++);
+    }
+}
+
+static void TestCharQueueSeekLinePartial()
+{
+    queue = CharQueueInit();
+    TEST_ASSERT_EQUAL(0, CharQueueSeekLine(&queue, '\r'));
+    TestCharQueueAddString(&queue, "AVRCP_MEDIA TITLE: ");
+    TEST_ASSERT_EQUAL(0, CharQueueSeekLine(&queue, '\r'));
+    // Nothing new arrived, so nothing is searched again
+    TEST_ASSERT_EQUAL(19, queue.seekLength);
+    TEST_ASSERT_EQUAL(0, CharQueueSeekLine(&queue, '\r'));
+    TEST_ASSERT_EQUAL(19, queue.seekLength);
+    TestCharQueueAddString(&queue, "Song\rOK\r");
+    TEST_ASSERT_EQUAL(24, CharQueueSeekLine(&queue, '\r'));
+    // Polling again without consuming reports the same line
+    TEST_ASSERT_EQUAL(24, CharQueueSeekLine(&queue, '\r'));
+}
+
+static void TestCharQueueSeekLineConsume()
+{
+    unsigned char buffer[32];
+    queue = CharQueueInit();
+    TestCharQueueAddString(&queue, "OPEN_OK 10\rSTATE");
+    TEST_ASSERT_EQUAL(11, CharQueueSeekLine(&queue, '\r'));
+    TEST_ASSERT_EQUAL(11, CharQueueRead(&queue, buffer, 11));
+    TEST_ASSERT_EQUAL(0, memcmp(buffer, "OPEN_OK 10\r", 11));
+    TEST_ASSERT_EQUAL(0, CharQueueSeekLine(&queue, '\r'));
+    TestCharQueueAddString(&queue, " CONNECTED\r");
+    TEST_ASSERT_EQUAL(16, CharQueueSeekLine(&queue, '\r'));
+    // Consuming a byte at a time keeps the searched length in step
+    CharQueueNext(&queue);
+    TEST_ASSERT_EQUAL(15, CharQueueSeekLine(&queue, '\r'));
+    CharQueueSkip(&queue, 5);
+    TEST_ASSERT_EQUAL(10, CharQueueSeekLine(&queue, '\r'));
+    CharQueueReset(&queue);
+    TEST_ASSERT_EQUAL(0, queue.seekLength);
+    TEST_ASSERT_EQUAL(0, CharQueueSeekLine(&queue, '\r'));
+}
+
+static void TestCharQueueSeekLineMatchesSeek()
+{
+    unsigned char buffer[CHAR_QUEUE_SIZE];
+    uint16_t round;
+    srand(1);
+    queue = CharQueueInit();
+    // Cover the wrap of the ring many times over
+    for (round = 0; round < 20000; round++) {
+        uint16_t length = rand() % 60 + 1;
+        uint16_t i;
+        for (i = 0; i < length; i++) {
+            unsigned char c = 'a' + rand() % 26;
+            if (i == length - 1 && rand() % 2) {
+                c = '\r';
+            }
+            CharQueueAdd(&queue, c);
+            TEST_ASSERT_EQUAL(
+                CharQueueSeek(&queue, '\r'),
+                CharQueueSeekLine(&queue, '\r')
+            );
+        }
+        uint16_t lineLength = CharQueueSeekLine(&queue, '\r');
+        switch (rand() % 4) {
+            case 0:
+                CharQueueRead(&queue, buffer, lineLength);
+                break;
+            case 1:
+                for (i = 0; i < lineLength; i++) {
+                    CharQueueNext(&queue);
+                }
+                break;
+            case 2:
+                CharQueueSkip(&queue, rand() % (CharQueueGetSize(&queue) + 1));
+                break;
+        }
+        TEST_ASSERT_EQUAL(
+            CharQueueSeek(&queue, '\r'),
+            CharQueueSeekLine(&queue, '\r')
+        );
+    }
+}
+
+#define TEST_STRESS_BYTES 4000000
+
+/* The value of the nth byte of the stress stream */
+#define TEST_STRESS_BYTE(n) ((unsigned char) (((n) * 7) % 251))
+
+static CharQueue_t stressQueue;
+
+/**
+ * TestCharQueueStressProducer()
+ *     Description:
+ *         Play the part of the UART RX ISR: add bytes one at a time or in
+ *         bursts, retrying whatever didn't fit. The writer never waits on the
+ *         reader for anything but space.
+ */
+static void *TestCharQueueStressProducer(void *arg)
+{
+    unsigned char burst[64];
+    uint32_t sent = 0;
+    uint32_t seed = 1;
+    while (sent < TEST_STRESS_BYTES) {
+        seed = seed * 1103515245 + 12345;
+        if (seed & 0x10000) {
+            if (CharQueueAdd(&stressQueue, TEST_STRESS_BYTE(sent)) == 0) {
+                sched_yield();
+            } else {
+                sent++;
+            }
+        } else {
+            uint16_t length = (seed >> 20) % sizeof(burst) + 1;
+            uint16_t i;
+            if (length > TEST_STRESS_BYTES - sent) {
+                length = TEST_STRESS_BYTES - sent;
+            }
+            for (i = 0; i < length; i++) {
+                burst[i] = TEST_STRESS_BYTE(sent + i);
+            }
+            uint16_t written = CharQueueWrite(&stressQueue, burst, length);
+            if (written == 0) {
+                sched_yield();
+            }
+            sent += written;
+        }
+    }
+    return 0;
+}
+
+static void TestCharQueueConcurrent()
+{
+    unsigned char buffer[CHAR_QUEUE_SIZE];
+    pthread_t producer;
+    uint32_t received = 0;
+    uint32_t seed = 2;
+    stressQueue = CharQueueInit();
+    pthread_create(&producer, 0, TestCharQueueStressProducer, 0);
+    // Play the part of the main loop, draining with every consumer call
+    while (received < TEST_STRESS_BYTES) {
+        uint16_t size = CharQueueGetSize(&stressQueue);
+        TEST_ASSERT(size <= CHAR_QUEUE_SIZE);
+        if (size == 0) {
+            sched_yield();
+            continue;
+        }
+        seed = seed * 1103515245 + 12345;
+        switch ((seed >> 16) % 3) {
+            case 0: {
+                unsigned char c = CharQueueNext(&stressQueue);
+                TEST_ASSERT_EQUAL(TEST_STRESS_BYTE(received), c);
+                received++;
+                break;
+            }
+            case 1: {
+                uint16_t length = CharQueueRead(
+                    &stressQueue,
+                    buffer,
+                    (seed >> 20) % sizeof(buffer) + 1
+                );
+                uint16_t i;
+                for (i = 0; i < length; i++) {
+                    TEST_ASSERT_EQUAL(TEST_STRESS_BYTE(received), buffer[i]);
+                    received++;
+                }
+                break;
+            }
+            case 2: {
+                unsigned char *span;
+                uint16_t length = CharQueueGetSpan(&stressQueue, &span);
+                uint16_t i;
+                for (i = 0; i < length; i++) {
+                    TEST_ASSERT_EQUAL(TEST_STRESS_BYTE(received), span[i]);
+                    received++;
+                }
+                CharQueueSkip(&stressQueue, length);
+                break;
+            }
+        }
+    }
+    pthread_join(producer, 0);
+    TEST_ASSERT_EQUAL(0, CharQueueGetSize(&stressQueue));
+}
+
+int main()
+{
+    TEST_RUN(TestCharQueueSeekLinePartial);
+    TEST_RUN(TestCharQueueSeekLineConsume);
+    TEST_RUN(TestCharQueueSeekLineMatchesSeek);
+    TEST_RUN(TestCharQueueConcurrent);
+    return 0;
+}
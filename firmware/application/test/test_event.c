@@ -0,0 +1,86 @@
+/*
+ * File: test_event.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Unit tests for the event callback table
+ */
+#include "test.h"
+#include "handler.h"
+#include "lib/event.h"
+#include "ui/bmbt.h"
+
+extern uint8_t EVENT_CALLBACKS_COUNT;
+
+static uint8_t calls[4];
+static uint8_t callOrder[4];
+static uint8_t callCount;
+
+static void TestEventCallbackA(void *ctx, unsigned char *data)
+{
+    callOrder[callCount++] = 0;
+    calls[0]++;
+}
+
+static void TestEventCallbackB(void *ctx, unsigned char *data)
+{
+    callOrder[callCount++] = 1;
+    calls[1]++;
+    // Callbacks may remove themselves while being triggered
+    EventUnregisterCallback(70, &TestEventCallbackB);
+}
+
+static void TestEventCallbackC(void *ctx, unsigned char *data)
+{
+    callOrder[callCount++] = 2;
+    calls[2]++;
+}
+
+static void TestEventDispatchOrder()
+{
+    EventRegisterCallback(70, &TestEventCallbackA, 0);
+    EventRegisterCallback(71, &TestEventCallbackC, 0);
+    EventRegisterCallback(70, &TestEventCallbackB, 0);
+    EventRegisterCallback(70, &TestEventCallbackC, 0);
+    EventTriggerCallback(70, 0);
+    TEST_ASSERT_EQUAL(3, callCount);
+    TEST_ASSERT_EQUAL(0, callOrder[0]);
+    TEST_ASSERT_EQUAL(1, callOrder[1]);
+    TEST_ASSERT_EQUAL(2, callOrder[2]);
+    callCount = 0;
+    EventTriggerCallback(70, 0);
+    TEST_ASSERT_EQUAL(2, callCount);
+    TEST_ASSERT_EQUAL(1, calls[1]);
+    // Out of range types are refused
+    TEST_ASSERT_EQUAL(1, EventRegisterCallback(EVENT_MAX_TYPES, &TestEventCallbackA, 0));
+    TEST_ASSERT_EQUAL(1, EventGetOverflowCount());
+    EventUnregisterCallback(70, &TestEventCallbackA);
+    EventUnregisterCallback(70, &TestEventCallbackC);
+    EventUnregisterCallback(71, &TestEventCallbackC);
+}
+
+static void TestEventSlotReuse()
+{
+    static BC127_t bt;
+    static IBus_t ibus;
+    uint16_t cycle;
+    bt = BC127Init();
+    ibus = IBusInit();
+    HandlerInit(&bt, &ibus);
+    BMBTInit(&bt, &ibus);
+    uint8_t count = EVENT_CALLBACKS_COUNT;
+    uint16_t overflows = EventGetOverflowCount();
+    // Switching UIs must give back every slot it takes
+    for (cycle = 0; cycle < 100; cycle++) {
+        BMBTDestroy();
+        BMBTInit(&bt, &ibus);
+    }
+    TEST_ASSERT_EQUAL(count, EVENT_CALLBACKS_COUNT);
+    TEST_ASSERT_EQUAL(overflows, EventGetOverflowCount());
+}
+
+int main()
+{
+    TEST_RUN(TestEventDispatchOrder);
+    TEST_RUN(TestEventSlotReuse);
+    return 0;
+}
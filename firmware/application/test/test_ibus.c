@@ -0,0 +1,892 @@
+/*
+ * File: test_ibus.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Unit tests for the IBus receive and transmit paths. Bytes are fed in
+ *     as the RX ISR would, and the frames that come out of the decoder are
+ *     read back from the sniffer records on the system UART. Frames go out
+ *     through the TX ISR, with the test standing in for the TH3122.
+ */
+#include <string.h>
+#include "test.h"
+#include "lib/ibus.h"
+
+void _AltU1TXInterrupt();
+extern volatile uint32_t TimerCurrentMillis;
+
+#define TEST_IBUS_ROUNDS 500
+#define TEST_IBUS_MAX_FRAMES (TEST_IBUS_ROUNDS * 16)
+
+/*
+ * A stretch of typical E39 traffic, as source, destination and data. The
+ * length and checksum are filled in by TestIBusBuildFrame().
+ */
+static const unsigned char TestIBusTrace[][16] = {
+    {0x80, 0xBF, 0x11, 0x01},
+    {0x68, 0x18, 0x38, 0x00, 0x00},
+    {0x18, 0x68, 0x39, 0x00, 0x02, 0x00, 0x3F, 0x00, 0x07, 0x01},
+    {0x50, 0x68, 0x32, 0x11},
+    {0x50, 0x68, 0x3B, 0x01},
+    {0xD0, 0xBF, 0x5B, 0x00, 0x00, 0x00, 0x00},
+    {0x80, 0xBF, 0x13, 0x03, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x68, 0x3B, 0x23, 0x62, 0x10, 'C', 'D', ' ', '1', '-', '0', '1'},
+    {0x3B, 0x68, 0x31, 0x60, 0x00, 0x01},
+    {0xF0, 0x68, 0x48, 0x08},
+    {0x80, 0xBF, 0x18, 0x00, 0x0C},
+    {0x00, 0xBF, 0x72, 0x22}
+};
+static const uint8_t TestIBusTraceLengths[] = {
+    4, 5, 10, 4, 4, 7, 10, 12, 6, 4, 5, 4
+};
+#define TEST_IBUS_TRACE_FRAMES (sizeof(TestIBusTraceLengths))
+
+static IBus_t ibus;
+static UART_t systemUart;
+static uint32_t rxMicros;
+
+typedef struct TestIBusFrame_t {
+    unsigned char data[IBUS_MAX_MSG_LENGTH];
+    uint8_t length;
+    uint32_t micros;
+} TestIBusFrame_t;
+
+static TestIBusFrame_t expected[TEST_IBUS_MAX_FRAMES];
+static uint16_t expectedCount;
+static TestIBusFrame_t decoded[TEST_IBUS_MAX_FRAMES];
+static uint16_t decodedCount;
+
+static void TestIBusSetup()
+{
+    TimerCurrentMillis = 1000;
+    rxMicros = 1000000;
+    ibus = IBusInit();
+    systemUart = UARTInit(
+        SYSTEM_UART_MODULE,
+        SYSTEM_UART_RX_PIN,
+        SYSTEM_UART_TX_PIN,
+        SYSTEM_UART_RX_PRIORITY,
+        SYSTEM_UART_TX_PRIORITY,
+        UART_BAUD_115200,
+        UART_PARITY_NONE
+    );
+    UARTAddModuleHandler(&systemUart);
+    ibus.snifferEnabled = 1;
+    ibus.rxLastByteMicros = rxMicros;
+    expectedCount = 0;
+    decodedCount = 0;
+}
+
+static uint8_t TestIBusBuildFrame(unsigned char *frame, uint8_t traceIdx)
+{
+    uint8_t dataLength = TestIBusTraceLengths[traceIdx];
+    const unsigned char *src = TestIBusTrace[traceIdx];
+    uint8_t idx;
+    frame[0] = src[0];
+    frame[1] = dataLength;
+    memcpy(&frame[2], &src[1], dataLength - 1);
+    frame[dataLength + 1] = 0x00;
+    for (idx = 0; idx < dataLength + 1; idx++) {
+        frame[dataLength + 1] ^= frame[idx];
+    }
+    return dataLength + 2;
+}
+
+/**
+ * TestIBusCollect()
+ *     Description:
+ *         Pull the RX records that the sniffer sent out of the system UART
+ *         queue, skipping any log text in between
+ */
+static void TestIBusCollect()
+{
+    unsigned char record[IBUS_SNIFFER_HEADER_SIZE + IBUS_MAX_MSG_LENGTH + 1];
+    while (CharQueueGetSize(&systemUart.txQueue) > 0) {
+        if (CharQueueNext(&systemUart.txQueue) != IBUS_SNIFFER_SYNC) {
+            continue;
+        }
+        record[0] = IBUS_SNIFFER_SYNC;
+        CharQueueRead(&systemUart.txQueue, &record[1], IBUS_SNIFFER_HEADER_SIZE - 1);
+        uint8_t length = record[IBUS_SNIFFER_HEADER_SIZE - 1];
+        CharQueueRead(&systemUart.txQueue, &record[IBUS_SNIFFER_HEADER_SIZE], length + 1);
+        unsigned char checksum = 0;
+        uint8_t idx;
+        for (idx = 0; idx < IBUS_SNIFFER_HEADER_SIZE + length + 1; idx++) {
+            checksum ^= record[idx];
+        }
+        TEST_ASSERT_EQUAL(0, checksum);
+        if (record[1] == IBUS_TRACE_RX) {
+            TestIBusFrame_t *frame = &decoded[decodedCount++];
+            memcpy(frame->data, &record[IBUS_SNIFFER_HEADER_SIZE], length);
+            frame->length = length;
+            frame->micros = (uint32_t) record[2] |
+                ((uint32_t) record[3] << 8) |
+                ((uint32_t) record[4] << 16) |
+                ((uint32_t) record[5] << 24);
+        }
+    }
+}
+
+static void TestIBusSetClock()
+{
+    TimerCurrentMillis = rxMicros / 1000;
+    TMR1 = (rxMicros % 1000) * TIMER_TICKS_PER_US;
+}
+
+/**
+ * TestIBusReceive()
+ *     Description:
+ *         Hand bytes to the RX path back to back, at the speed of the bus
+ */
+static void TestIBusReceive(const unsigned char *data, uint16_t length)
+{
+    uint16_t idx;
+    for (idx = 0; idx < length; idx++) {
+        rxMicros += IBUS_BYTE_TIME_US;
+        IBusRXByte(&ibus, data[idx], rxMicros);
+        TestIBusSetClock();
+    }
+}
+
+/**
+ * TestIBusFeed()
+ *     Description:
+ *         Receive bytes, calling IBusProcess() every few bytes like the main
+ *         loop would
+ */
+static void TestIBusFeed(const unsigned char *data, uint16_t length)
+{
+    uint16_t idx;
+    for (idx = 0; idx < length; idx++) {
+        TestIBusReceive(&data[idx], 1);
+        if (rand() % 4 == 0) {
+            IBusProcess(&ibus);
+            TestIBusCollect();
+        }
+    }
+}
+
+static void TestIBusSilence(uint32_t micros)
+{
+    rxMicros += micros;
+    TestIBusSetClock();
+}
+
+static void TestIBusFinish()
+{
+    IBusProcess(&ibus);
+    TestIBusCollect();
+}
+
+/**
+ * TestIBusCountRecovered()
+ *     Description:
+ *         Match the decoded frames against the ones that were sent intact,
+ *         in order. Every decoded frame must be one that was sent, unless
+ *         noise happened to form a valid frame.
+ *     Returns:
+ *         uint16_t - The number of intact frames that were decoded
+ */
+static uint16_t TestIBusCountRecovered(uint16_t *spurious)
+{
+    uint16_t expectedIdx = 0;
+    uint16_t matched = 0;
+    uint16_t idx;
+    *spurious = 0;
+    for (idx = 0; idx < decodedCount; idx++) {
+        uint16_t search = expectedIdx;
+        while (search < expectedCount &&
+            (expected[search].length != decoded[idx].length ||
+             memcmp(expected[search].data, decoded[idx].data, decoded[idx].length) != 0)
+        ) {
+            search++;
+        }
+        if (search == expectedCount) {
+            (*spurious)++;
+        } else {
+            matched++;
+            expectedIdx = search + 1;
+        }
+    }
+    return matched;
+}
+
+static void TestIBusReplayClean()
+{
+    uint16_t round;
+    uint8_t traceIdx;
+    uint16_t spurious;
+    srand(10);
+    TestIBusSetup();
+    for (round = 0; round < TEST_IBUS_ROUNDS; round++) {
+        for (traceIdx = 0; traceIdx < TEST_IBUS_TRACE_FRAMES; traceIdx++) {
+            TestIBusFrame_t *frame = &expected[expectedCount++];
+            frame->length = TestIBusBuildFrame(frame->data, traceIdx);
+            TestIBusFeed(frame->data, frame->length);
+        }
+    }
+    TestIBusFinish();
+    TEST_ASSERT_EQUAL(expectedCount, decodedCount);
+    TEST_ASSERT_EQUAL(expectedCount, TestIBusCountRecovered(&spurious));
+    TEST_ASSERT_EQUAL(expectedCount, ibus.rxFrames);
+    TEST_ASSERT_EQUAL(0, ibus.rxDroppedBytes);
+}
+
+static void TestIBusReplayNoise()
+{
+    uint16_t round;
+    uint8_t traceIdx;
+    uint16_t spurious;
+    uint16_t corrupted = 0;
+    uint32_t noiseBytes = 0;
+    srand(11);
+    TestIBusSetup();
+    for (round = 0; round < TEST_IBUS_ROUNDS; round++) {
+        for (traceIdx = 0; traceIdx < TEST_IBUS_TRACE_FRAMES; traceIdx++) {
+            unsigned char noise[4];
+            uint8_t noiseLength = 0;
+            // Line noise between frames
+            if (rand() % 5 == 0) {
+                noiseLength = rand() % sizeof(noise) + 1;
+                uint8_t idx;
+                for (idx = 0; idx < noiseLength; idx++) {
+                    noise[idx] = rand() & 0xFF;
+                }
+                TestIBusFeed(noise, noiseLength);
+                noiseBytes += noiseLength;
+            }
+            TestIBusFrame_t *frame = &expected[expectedCount];
+            frame->length = TestIBusBuildFrame(frame->data, traceIdx);
+            if (rand() % 20 == 0) {
+                // A bit flipped on the wire: this frame is lost for good
+                unsigned char bad[IBUS_MAX_MSG_LENGTH];
+                memcpy(bad, frame->data, frame->length);
+                bad[rand() % frame->length] ^= 1 << (rand() % 8);
+                TestIBusFeed(bad, frame->length);
+                corrupted++;
+            } else {
+                TestIBusFeed(frame->data, frame->length);
+                expectedCount++;
+            }
+        }
+    }
+    TestIBusFinish();
+    uint16_t recovered = TestIBusCountRecovered(&spurious);
+    printf(
+        "        %u of %u intact frames recovered (%.1f%%), %u corrupted, "
+        "%u spurious, %lu noise bytes\n",
+        recovered,
+        expectedCount,
+        100.0 * recovered / expectedCount,
+        corrupted,
+        spurious,
+        (unsigned long) noiseBytes
+    );
+    printf(
+        "        Decoder counted %lu dropped and %lu recovered bytes\n",
+        (unsigned long) ibus.rxDroppedBytes,
+        (unsigned long) ibus.rxRecoveredBytes
+    );
+    TEST_ASSERT(recovered * 100 >= expectedCount * 95);
+    TEST_ASSERT(ibus.rxDroppedBytes >= noiseBytes);
+}
+
+static void TestIBusGapAfterNoise()
+{
+    unsigned char frame[IBUS_MAX_MSG_LENGTH];
+    // Noise that reads like the start of a 34 byte frame
+    const unsigned char noise[] = {0x68, 0x20, 0x3B};
+    TestIBusSetup();
+    uint8_t length = TestIBusBuildFrame(frame, 0);
+    TestIBusReceive(noise, sizeof(noise));
+    IBusProcess(&ibus);
+    TestIBusSilence(IBUS_RX_FRAME_GAP + 500);
+    TestIBusReceive(frame, length);
+    // The frame is decoded as soon as it is in, instead of waiting for the
+    // bytes that the noise asked for
+    TestIBusFinish();
+    TEST_ASSERT_EQUAL(1, decodedCount);
+    TEST_ASSERT_EQUAL(0, memcmp(frame, decoded[0].data, length));
+    TEST_ASSERT_EQUAL(sizeof(noise), ibus.rxDroppedBytes);
+    TEST_ASSERT_EQUAL(0, ibus.rxBufferIdx);
+}
+
+static void TestIBusGapsQueued()
+{
+    // Noise that can't be the start of a frame
+    const unsigned char noise[] = {0xFF, 0x2E};
+    uint8_t traceIdx;
+    uint16_t spurious;
+    TestIBusSetup();
+    // The main loop is busy while frames, each after a burst of noise and
+    // separated by silence, pile up in the queue
+    for (traceIdx = 0; traceIdx < TEST_IBUS_TRACE_FRAMES; traceIdx++) {
+        TestIBusReceive(noise, sizeof(noise));
+        TestIBusSilence(IBUS_RX_FRAME_GAP + 1);
+        TestIBusFrame_t *frame = &expected[expectedCount++];
+        frame->length = TestIBusBuildFrame(frame->data, traceIdx);
+        TestIBusReceive(frame->data, frame->length);
+        TestIBusSilence(IBUS_RX_FRAME_GAP + 1);
+    }
+    TestIBusFinish();
+    TEST_ASSERT_EQUAL(TEST_IBUS_TRACE_FRAMES, decodedCount);
+    TEST_ASSERT_EQUAL(TEST_IBUS_TRACE_FRAMES, TestIBusCountRecovered(&spurious));
+    TEST_ASSERT_EQUAL(TEST_IBUS_TRACE_FRAMES * sizeof(noise), ibus.rxDroppedBytes);
+}
+
+static void TestIBusPartialFrame()
+{
+    unsigned char frame[IBUS_MAX_MSG_LENGTH];
+    TestIBusSetup();
+    uint8_t length = TestIBusBuildFrame(frame, 2);
+    // Bytes of a frame that arrive a little late still belong to it
+    TestIBusReceive(frame, 4);
+    IBusProcess(&ibus);
+    TestIBusSilence(IBUS_RX_FRAME_GAP - IBUS_BYTE_TIME_US - 100);
+    IBusProcess(&ibus);
+    TestIBusReceive(&frame[4], length - 4);
+    TestIBusFinish();
+    TEST_ASSERT_EQUAL(1, decodedCount);
+    // A frame that stops halfway is thrown out once the bus is quiet
+    TestIBusReceive(frame, 4);
+    IBusProcess(&ibus);
+    TestIBusSilence(IBUS_RX_FRAME_GAP / 2);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(4, ibus.rxBufferIdx);
+    TestIBusSilence(IBUS_RX_FRAME_GAP / 2 + 1);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(0, ibus.rxBufferIdx);
+    TEST_ASSERT_EQUAL(4, ibus.rxDroppedBytes);
+    TestIBusReceive(frame, length);
+    TestIBusFinish();
+    TEST_ASSERT_EQUAL(2, decodedCount);
+}
+
+static void TestIBusSequenceWrap()
+{
+    unsigned char frame[IBUS_MAX_MSG_LENGTH];
+    uint32_t received = 0;
+    TestIBusSetup();
+    // A gap to set the boundary, then more than the sequence numbers can
+    // count without a single one
+    TestIBusSilence(IBUS_RX_FRAME_GAP + 1);
+    while (received < 3 * 0x10000UL) {
+        uint8_t length = TestIBusBuildFrame(frame, received % TEST_IBUS_TRACE_FRAMES);
+        TestIBusReceive(frame, length);
+        if (CharQueueGetSize(&ibus.uart.rxQueue) > CHAR_QUEUE_SIZE / 2) {
+            IBusProcess(&ibus);
+            decodedCount = 0;
+            CharQueueReset(&systemUart.txQueue);
+        }
+        received += length;
+    }
+    TestIBusFinish();
+    TEST_ASSERT_EQUAL(0, ibus.rxDroppedBytes);
+}
+
+static void TestIBusMIDTitleLength()
+{
+    TestIBusSetup();
+    uint8_t slot = ibus.txStageSlot;
+    IBusCommandMIDDisplayTitleText(&ibus, "A title far too long for the MID");
+    unsigned char *frame = ibus.txBuffer[slot];
+    // Command, two layout bytes, the clamped title and the watermark
+    TEST_ASSERT_EQUAL(IBus_MID_TITLE_MAX_CHARS + 4 + 2, frame[IBUS_PKT_LEN]);
+    TEST_ASSERT_EQUAL(
+        IBUS_RAD_MAIN_AREA_WATERMARK,
+        frame[IBUS_PKT_CMD + IBus_MID_TITLE_MAX_CHARS + 3]
+    );
+    TEST_ASSERT(memcmp(&frame[IBUS_PKT_CMD + 3], "A title far", 11) == 0);
+}
+
+static void TestIBusSnifferTime()
+{
+    unsigned char frame[IBUS_MAX_MSG_LENGTH];
+    uint32_t firstByte[4];
+    uint8_t idx;
+    TestIBusSetup();
+    // Two frames back to back, then two more each after a gap
+    for (idx = 0; idx < 4; idx++) {
+        if (idx != 1) {
+            TestIBusSilence(IBUS_RX_FRAME_GAP + 1000);
+        }
+        uint8_t length = TestIBusBuildFrame(frame, idx);
+        firstByte[idx] = rxMicros + IBUS_BYTE_TIME_US;
+        TestIBusReceive(frame, length);
+    }
+    // The main loop only gets to them much later
+    TestIBusSilence(50000);
+    TestIBusFinish();
+    TEST_ASSERT_EQUAL(4, decodedCount);
+    for (idx = 0; idx < 4; idx++) {
+        TEST_ASSERT_EQUAL(firstByte[idx], decoded[idx].micros);
+    }
+}
+
+/**
+ * TestIBusTXSetup()
+ *     Description:
+ *         Start with an idle bus: the STATUS line low, the shift register
+ *         empty and the UART TX interrupt routed to the IBus handler
+ */
+static void TestIBusTXSetup()
+{
+    TestIBusSetup();
+    ibus.snifferEnabled = 0;
+    UARTAddModuleHandler(&ibus.uart);
+    IBUS_UART_STATUS = 0;
+    HostUART[0].uxsta |= UART_STA_TRMT;
+    HostUARTTXIE[0] = 0;
+}
+
+/**
+ * TestIBusTXSend()
+ *     Description:
+ *         Run the TX interrupt until it has loaded the whole frame, reading
+ *         back the first echoLength bytes. The byte at noiseIdx, if echoed,
+ *         is garbled by the bus. The shift register is left busy with the
+ *         last byte.
+ *     Returns:
+ *         uint8_t - The number of bytes loaded into the UART
+ */
+static uint8_t TestIBusTXSend(uint8_t echoLength, uint8_t noiseIdx)
+{
+    uint8_t count = 0;
+    while (HostUARTTXIE[0] == 1) {
+        uint8_t frameIdx = ibus.txFrameIdx;
+        _AltU1TXInterrupt();
+        if (ibus.txFrameIdx != frameIdx) {
+            unsigned char byte = HostUART[0].uxtxreg;
+            if (count == noiseIdx) {
+                byte ^= 0x10;
+            }
+            if (count < echoLength) {
+                TestIBusReceive(&byte, 1);
+            }
+            count++;
+        }
+    }
+    HostUART[0].uxsta &= ~UART_STA_TRMT;
+    return count;
+}
+
+static void TestIBusTXQueueControl(unsigned char data)
+{
+    unsigned char msg[2] = {0x48, data};
+    IBusSendCommand(&ibus, IBUS_DEVICE_CDC, IBUS_DEVICE_RAD, msg, sizeof(msg));
+}
+
+static void TestIBusTXQueueProtocol(unsigned char data)
+{
+    unsigned char msg[2] = {IBUS_CMD_MOD_STATUS_RESP, data};
+    IBusSendCommand(&ibus, IBUS_DEVICE_CDC, IBUS_DEVICE_LOC, msg, sizeof(msg));
+}
+
+/**
+ * TestIBusTXQueueDisplay()
+ *     Description:
+ *         Queue a GT text write to the given index, so that writes with
+ *         different indexes never supersede each other
+ */
+static void TestIBusTXQueueDisplay(unsigned char index, char text)
+{
+    unsigned char msg[5] = {IBUS_CMD_GT_WRITE_MK4, 0x60, 0x00, index, text};
+    IBusSendCommand(&ibus, IBUS_DEVICE_RAD, IBUS_DEVICE_GT, msg, sizeof(msg));
+}
+
+/**
+ * TestIBusTXQueued()
+ *     Description:
+ *         Get the last data byte of the frame queued at pos, which is what
+ *         the helpers above tell their frames apart by
+ */
+static unsigned char TestIBusTXQueued(uint8_t txClass, uint8_t pos)
+{
+    unsigned char *frame = ibus.txBuffer[ibus.txQueues[txClass].slots[pos]];
+    return frame[frame[IBUS_PKT_LEN]];
+}
+
+static void TestIBusTXIdleInterrupt()
+{
+    TestIBusTXSetup();
+    // A stray interrupt with nothing on the wire must only switch itself off
+    HostUARTTXIE[0] = 1;
+    _AltU1TXInterrupt();
+    TEST_ASSERT_EQUAL(0, HostUARTTXIE[0]);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    TEST_ASSERT_EQUAL(0, ibus.txFrameIdx);
+}
+
+static void TestIBusTXAbort()
+{
+    TestIBusTXSetup();
+    TestIBusTXQueueControl(0x01);
+    uint8_t slot = ibus.txQueues[IBUS_TX_CLASS_CONTROL].slots[0];
+    TestIBusSilence(IBUS_TX_GAP_MAX * 1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_SENDING, ibus.txState);
+    TEST_ASSERT_EQUAL(1, HostUARTTXIE[0]);
+    // Another module takes the bus before our first byte
+    IBUS_UART_STATUS = 1;
+    TEST_ASSERT_EQUAL(0, TestIBusTXSend(0, 0xFF));
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    TEST_ASSERT_EQUAL(1, ibus.txAborts);
+    TEST_ASSERT_EQUAL(1, ibus.txQueues[IBUS_TX_CLASS_CONTROL].count);
+    TEST_ASSERT_EQUAL(slot, ibus.txQueues[IBUS_TX_CLASS_CONTROL].slots[0]);
+    // Nothing is started while the line stays busy
+    TestIBusSilence(IBUS_TX_GAP_MAX * 1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    // and the same frame goes out once it is free
+    IBUS_UART_STATUS = 0;
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_SENDING, ibus.txState);
+    TEST_ASSERT_EQUAL(slot, ibus.txActiveSlot);
+    TEST_ASSERT_EQUAL(6, TestIBusTXSend(6, 0xFF));
+    HostUART[0].uxsta |= UART_STA_TRMT;
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(0, ibus.txQueues[IBUS_TX_CLASS_CONTROL].count);
+    TEST_ASSERT_EQUAL(1, ibus.txQueues[IBUS_TX_CLASS_CONTROL].sent);
+    TEST_ASSERT_EQUAL(1, ibus.txAborts);
+}
+
+static void TestIBusTXGap()
+{
+    unsigned char frame[IBUS_MAX_MSG_LENGTH];
+    TestIBusTXSetup();
+    TestIBusTXQueueControl(0x01);
+    TestIBusTXQueueControl(0x02);
+    TestIBusSilence(IBUS_TX_GAP_MAX * 1000);
+    IBusProcess(&ibus);
+    TestIBusTXSend(6, 0xFF);
+    HostUART[0].uxsta |= UART_STA_TRMT;
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(1, ibus.txQueues[IBUS_TX_CLASS_CONTROL].sent);
+    // The next frame waits for the gap after our last one
+    uint8_t gap = ibus.txGap;
+    TEST_ASSERT(gap >= IBUS_TX_GAP_MIN && gap <= IBUS_TX_GAP_MAX);
+    TestIBusSilence((gap - 1) * 1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    // and for the gap after the last byte that another module sent
+    TestIBusReceive(frame, TestIBusBuildFrame(frame, 0));
+    IBusProcess(&ibus);
+    TestIBusSilence(1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    TestIBusSilence((ibus.txGap - 2) * 1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    TestIBusSilence(1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_SENDING, ibus.txState);
+}
+
+static void TestIBusTXDrain()
+{
+    TestIBusTXSetup();
+    TestIBusTXQueueControl(0x01);
+    TestIBusSilence(IBUS_TX_GAP_MAX * 1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(6, TestIBusTXSend(6, 0xFF));
+    TEST_ASSERT_EQUAL(0, HostUARTTXIE[0]);
+    // The echo is all back, but the stop bit of the last byte is not out
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_DRAINING, ibus.txState);
+    TEST_ASSERT_EQUAL(1, ibus.txQueues[IBUS_TX_CLASS_CONTROL].count);
+    TEST_ASSERT_EQUAL(0, ibus.txQueues[IBUS_TX_CLASS_CONTROL].sent);
+    HostUART[0].uxsta |= UART_STA_TRMT;
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    TEST_ASSERT_EQUAL(0, ibus.txQueues[IBUS_TX_CLASS_CONTROL].count);
+    TEST_ASSERT_EQUAL(1, ibus.txQueues[IBUS_TX_CLASS_CONTROL].sent);
+    TEST_ASSERT_EQUAL(1, ibus.txFrames);
+}
+
+static void TestIBusTXDisplayCap()
+{
+    uint8_t idx;
+    TestIBusTXSetup();
+    for (idx = 0; idx <= IBUS_TX_DISPLAY_MAX; idx++) {
+        TestIBusTXQueueDisplay(idx, 'A');
+    }
+    IBusTXQueue_t *display = &ibus.txQueues[IBUS_TX_CLASS_DISPLAY];
+    // The newest write is refused, the queued ones are left alone
+    TEST_ASSERT_EQUAL(IBUS_TX_DISPLAY_MAX, display->count);
+    TEST_ASSERT_EQUAL(1, display->dropped);
+    TEST_ASSERT_EQUAL(0, ibus.txBuffer[display->slots[0]][IBUS_PKT_CMD + 3]);
+    TEST_ASSERT_EQUAL(
+        IBUS_TX_DISPLAY_MAX - 1,
+        ibus.txBuffer[display->slots[IBUS_TX_DISPLAY_MAX - 1]][IBUS_PKT_CMD + 3]
+    );
+    // which still leaves room for everything else
+    TestIBusTXQueueControl(0x01);
+    TEST_ASSERT_EQUAL(1, ibus.txQueues[IBUS_TX_CLASS_CONTROL].count);
+    TEST_ASSERT_EQUAL(0, ibus.txQueues[IBUS_TX_CLASS_CONTROL].dropped);
+}
+
+static void TestIBusTXEvictOrder()
+{
+    uint8_t idx;
+    TestIBusTXSetup();
+    IBusTXQueue_t *display = &ibus.txQueues[IBUS_TX_CLASS_DISPLAY];
+    IBusTXQueue_t *control = &ibus.txQueues[IBUS_TX_CLASS_CONTROL];
+    IBusTXQueue_t *protocol = &ibus.txQueues[IBUS_TX_CLASS_PROTOCOL];
+    for (idx = 0; idx < IBUS_TX_DISPLAY_MAX; idx++) {
+        TestIBusTXQueueDisplay(idx, 'A');
+    }
+    for (idx = IBUS_TX_DISPLAY_MAX; idx < IBUS_TX_BUFFER_SIZE - 1; idx++) {
+        TestIBusTXQueueControl(idx);
+    }
+    TEST_ASSERT_EQUAL(0xFFFF, ibus.txBufferUsed);
+    // Control and protocol frames take the place of the oldest display text
+    TestIBusTXQueueControl(0x20);
+    TEST_ASSERT_EQUAL(IBUS_TX_DISPLAY_MAX - 1, display->count);
+    TEST_ASSERT_EQUAL(1, display->dropped);
+    TEST_ASSERT_EQUAL('A', TestIBusTXQueued(IBUS_TX_CLASS_DISPLAY, 0));
+    TEST_ASSERT_EQUAL(1, ibus.txBuffer[display->slots[0]][IBUS_PKT_CMD + 3]);
+    TEST_ASSERT_EQUAL(0x20, TestIBusTXQueued(IBUS_TX_CLASS_CONTROL, control->count - 1));
+    TestIBusTXQueueProtocol(0x21);
+    TEST_ASSERT_EQUAL(IBUS_TX_DISPLAY_MAX - 2, display->count);
+    TEST_ASSERT_EQUAL(2, ibus.txBuffer[display->slots[0]][IBUS_PKT_CMD + 3]);
+    TEST_ASSERT_EQUAL(1, protocol->count);
+    // Display text never pushes anything out
+    TestIBusTXQueueDisplay(0x30, 'A');
+    TEST_ASSERT_EQUAL(IBUS_TX_DISPLAY_MAX - 2, display->count);
+    TEST_ASSERT_EQUAL(3, display->dropped);
+    TEST_ASSERT_EQUAL(0, control->dropped);
+
+    // Once there is no display text, protocol frames push out control frames
+    TestIBusTXSetup();
+    for (idx = 0; idx < IBUS_TX_BUFFER_SIZE - 1; idx++) {
+        TestIBusTXQueueControl(idx);
+    }
+    TestIBusTXQueueProtocol(0x21);
+    TEST_ASSERT_EQUAL(1, protocol->count);
+    TEST_ASSERT_EQUAL(IBUS_TX_BUFFER_SIZE - 2, control->count);
+    TEST_ASSERT_EQUAL(1, control->dropped);
+    TEST_ASSERT_EQUAL(1, TestIBusTXQueued(IBUS_TX_CLASS_CONTROL, 0));
+    // but control frames do not
+    TestIBusTXQueueControl(0x20);
+    TEST_ASSERT_EQUAL(IBUS_TX_BUFFER_SIZE - 2, control->count);
+    TEST_ASSERT_EQUAL(2, control->dropped);
+    TEST_ASSERT_EQUAL(0, protocol->dropped);
+}
+
+static void TestIBusTXEvictActive()
+{
+    uint8_t idx;
+    TestIBusTXSetup();
+    IBusTXQueue_t *display = &ibus.txQueues[IBUS_TX_CLASS_DISPLAY];
+    IBusTXQueue_t *control = &ibus.txQueues[IBUS_TX_CLASS_CONTROL];
+    for (idx = 0; idx < IBUS_TX_DISPLAY_MAX; idx++) {
+        TestIBusTXQueueDisplay(idx, 'A');
+    }
+    TestIBusSilence(IBUS_TX_GAP_MAX * 1000);
+    IBusProcess(&ibus);
+    uint8_t active = ibus.txActiveSlot;
+    TEST_ASSERT_EQUAL(display->slots[0], active);
+    for (idx = IBUS_TX_DISPLAY_MAX; idx < IBUS_TX_BUFFER_SIZE; idx++) {
+        TestIBusTXQueueControl(idx);
+    }
+    // The frame on the wire stays, the one behind it makes room
+    TEST_ASSERT_EQUAL(1, display->dropped);
+    TEST_ASSERT_EQUAL(active, display->slots[0]);
+    TEST_ASSERT_EQUAL(2, ibus.txBuffer[display->slots[1]][IBUS_PKT_CMD + 3]);
+    TEST_ASSERT_EQUAL(9, TestIBusTXSend(9, 0xFF));
+    HostUART[0].uxsta |= UART_STA_TRMT;
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(1, display->sent);
+    TEST_ASSERT_EQUAL(IBUS_TX_DISPLAY_MAX - 2, display->count);
+
+    // The same goes for a control frame on the wire
+    TestIBusTXSetup();
+    for (idx = 0; idx < IBUS_TX_BUFFER_SIZE - 1; idx++) {
+        TestIBusTXQueueControl(idx);
+    }
+    TestIBusSilence(IBUS_TX_GAP_MAX * 1000);
+    IBusProcess(&ibus);
+    active = ibus.txActiveSlot;
+    TestIBusTXQueueProtocol(0x20);
+    TEST_ASSERT_EQUAL(1, control->dropped);
+    TEST_ASSERT_EQUAL(active, control->slots[0]);
+    TEST_ASSERT_EQUAL(2, TestIBusTXQueued(IBUS_TX_CLASS_CONTROL, 1));
+}
+
+static void TestIBusTXSupersede()
+{
+    TestIBusTXSetup();
+    IBusTXQueue_t *display = &ibus.txQueues[IBUS_TX_CLASS_DISPLAY];
+    TestIBusTXQueueDisplay(0x01, 'A');
+    uint32_t stamp = ibus.txBufferStamp[display->slots[0]];
+    TestIBusSilence(5000);
+    TestIBusTXQueueDisplay(0x02, 'A');
+    TestIBusSilence(5000);
+    TestIBusTXQueueDisplay(0x01, 'B');
+    // The new text takes the place and age of the old write to the field
+    TEST_ASSERT_EQUAL(2, display->count);
+    TEST_ASSERT_EQUAL(0, display->dropped);
+    TEST_ASSERT_EQUAL(1, ibus.txCoalescedFrames);
+    TEST_ASSERT_EQUAL(9, ibus.txCoalescedBytes);
+    TEST_ASSERT_EQUAL(0x01, ibus.txBuffer[display->slots[0]][IBUS_PKT_CMD + 3]);
+    TEST_ASSERT_EQUAL('B', TestIBusTXQueued(IBUS_TX_CLASS_DISPLAY, 0));
+    TEST_ASSERT_EQUAL(stamp, ibus.txBufferStamp[display->slots[0]]);
+    TEST_ASSERT_EQUAL(0x02, ibus.txBuffer[display->slots[1]][IBUS_PKT_CMD + 3]);
+    // The slot of the old write is the staging slot now, so none leaked
+    TEST_ASSERT_EQUAL(3, __builtin_popcount(ibus.txBufferUsed));
+
+    // A write to a field that is already on the wire is queued behind it
+    TestIBusSilence(IBUS_TX_GAP_MAX * 1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(display->slots[0], ibus.txActiveSlot);
+    TestIBusTXQueueDisplay(0x01, 'C');
+    TEST_ASSERT_EQUAL(3, display->count);
+    TEST_ASSERT_EQUAL('B', TestIBusTXQueued(IBUS_TX_CLASS_DISPLAY, 0));
+    TEST_ASSERT_EQUAL('C', TestIBusTXQueued(IBUS_TX_CLASS_DISPLAY, 2));
+}
+
+static void TestIBusTXSupersedeRefresh()
+{
+    TestIBusTXSetup();
+    IBusTXQueue_t *display = &ibus.txQueues[IBUS_TX_CLASS_DISPLAY];
+    TestIBusTXQueueDisplay(0x01, 'A');
+    IBusCommandGTUpdate(&ibus, IBUS_CMD_GT_WRITE_INDEX);
+    TestIBusTXQueueDisplay(0x01, 'B');
+    IBusCommandGTUpdate(&ibus, IBUS_CMD_GT_WRITE_INDEX);
+    // Only the text is merged, both refreshes keep their place after it
+    TEST_ASSERT_EQUAL(3, display->count);
+    TEST_ASSERT_EQUAL(1, ibus.txCoalescedFrames);
+    TEST_ASSERT_EQUAL('B', TestIBusTXQueued(IBUS_TX_CLASS_DISPLAY, 0));
+    TEST_ASSERT_EQUAL(0x00, TestIBusTXQueued(IBUS_TX_CLASS_DISPLAY, 1));
+    TEST_ASSERT_EQUAL(0x00, TestIBusTXQueued(IBUS_TX_CLASS_DISPLAY, 2));
+}
+
+/**
+ * TestIBusTXAttempt()
+ *     Description:
+ *         Send the next frame once the gap and any backoff have passed, and
+ *         wait out the echo timeout if the echo does not all come back
+ */
+static void TestIBusTXAttempt(uint8_t echoLength, uint8_t noiseIdx)
+{
+    TestIBusSilence(
+        (IBUS_TX_GAP_MAX + (IBUS_TX_BACKOFF_SLOT << IBUS_TX_BACKOFF_MAX_EXP)) * 1000
+    );
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_SENDING, ibus.txState);
+    TestIBusTXSend(echoLength, noiseIdx);
+    HostUART[0].uxsta |= UART_STA_TRMT;
+    IBusProcess(&ibus);
+    if (ibus.txState == IBUS_TX_STATE_DRAINING) {
+        TestIBusSilence((IBUS_TX_ECHO_TIMEOUT + 1) * 1000);
+        IBusProcess(&ibus);
+    }
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+}
+
+static void TestIBusTXEchoMismatch()
+{
+    TestIBusTXSetup();
+    IBusTXQueue_t *control = &ibus.txQueues[IBUS_TX_CLASS_CONTROL];
+    TestIBusTXQueueControl(0x01);
+    uint8_t slot = control->slots[0];
+    TestIBusTXAttempt(6, 3);
+    TEST_ASSERT_EQUAL(1, control->collisions);
+    TEST_ASSERT_EQUAL(1, control->retries);
+    TEST_ASSERT_EQUAL(0, control->sent);
+    TEST_ASSERT_EQUAL(1, control->count);
+    TEST_ASSERT_EQUAL(slot, control->slots[0]);
+    TEST_ASSERT_EQUAL(1, ibus.txBufferRetries[slot]);
+    TEST_ASSERT(ibus.txBackoff < (IBUS_TX_BACKOFF_SLOT << 1));
+    // The retry goes through and clears the backoff
+    TestIBusTXAttempt(6, 0xFF);
+    TEST_ASSERT_EQUAL(1, control->sent);
+    TEST_ASSERT_EQUAL(0, control->count);
+    TEST_ASSERT_EQUAL(0, ibus.txBackoff);
+}
+
+static void TestIBusTXEchoTimeout()
+{
+    TestIBusTXSetup();
+    IBusTXQueue_t *control = &ibus.txQueues[IBUS_TX_CLASS_CONTROL];
+    TestIBusTXQueueControl(0x01);
+    TestIBusSilence(IBUS_TX_GAP_MAX * 1000);
+    IBusProcess(&ibus);
+    // Only part of the frame comes back
+    TestIBusTXSend(4, 0xFF);
+    HostUART[0].uxsta |= UART_STA_TRMT;
+    IBusProcess(&ibus);
+    TestIBusSilence(IBUS_TX_ECHO_TIMEOUT * 1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_DRAINING, ibus.txState);
+    TestIBusSilence(1000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    TEST_ASSERT_EQUAL(1, control->collisions);
+    TEST_ASSERT_EQUAL(1, control->retries);
+    TEST_ASSERT_EQUAL(1, control->count);
+}
+
+static void TestIBusTXRetryLimit()
+{
+    uint8_t attempt;
+    TestIBusTXSetup();
+    IBusTXQueue_t *control = &ibus.txQueues[IBUS_TX_CLASS_CONTROL];
+    IBusTXQueue_t *display = &ibus.txQueues[IBUS_TX_CLASS_DISPLAY];
+    TestIBusTXQueueControl(0x01);
+    TestIBusTXQueueDisplay(0x01, 'A');
+    TestIBusTXQueueControl(0x02);
+    // Control frames get four retries before they are dropped
+    for (attempt = 0; attempt < 5; attempt++) {
+        TEST_ASSERT_EQUAL(0x01, TestIBusTXQueued(IBUS_TX_CLASS_CONTROL, 0));
+        TestIBusTXAttempt(0, 0xFF);
+    }
+    TEST_ASSERT_EQUAL(5, control->collisions);
+    TEST_ASSERT_EQUAL(4, control->retries);
+    TEST_ASSERT_EQUAL(1, control->failed);
+    TEST_ASSERT_EQUAL(1, control->count);
+    // and the frame behind it starts over
+    TEST_ASSERT_EQUAL(0x02, TestIBusTXQueued(IBUS_TX_CLASS_CONTROL, 0));
+    TEST_ASSERT_EQUAL(0, ibus.txBufferRetries[control->slots[0]]);
+    TestIBusTXAttempt(6, 0xFF);
+    TEST_ASSERT_EQUAL(1, control->sent);
+    // Display text is only retried once, since newer text replaces it
+    TestIBusTXAttempt(9, 4);
+    TEST_ASSERT_EQUAL(1, display->count);
+    TestIBusTXAttempt(0, 0xFF);
+    TEST_ASSERT_EQUAL(2, display->collisions);
+    TEST_ASSERT_EQUAL(1, display->retries);
+    TEST_ASSERT_EQUAL(1, display->failed);
+    TEST_ASSERT_EQUAL(0, display->count);
+    TEST_ASSERT_EQUAL(0, display->sent);
+    // Nothing is left to send
+    TestIBusSilence(100000);
+    IBusProcess(&ibus);
+    TEST_ASSERT_EQUAL(IBUS_TX_STATE_IDLE, ibus.txState);
+    TEST_ASSERT_EQUAL(1U << ibus.txStageSlot, ibus.txBufferUsed);
+}
+
+int main()
+{
+    TEST_RUN(TestIBusReplayClean);
+    TEST_RUN(TestIBusReplayNoise);
+    TEST_RUN(TestIBusGapAfterNoise);
+    TEST_RUN(TestIBusGapsQueued);
+    TEST_RUN(TestIBusPartialFrame);
+    TEST_RUN(TestIBusSequenceWrap);
+    TEST_RUN(TestIBusMIDTitleLength);
+    TEST_RUN(TestIBusSnifferTime);
+    TEST_RUN(TestIBusTXIdleInterrupt);
+    TEST_RUN(TestIBusTXAbort);
+    TEST_RUN(TestIBusTXGap);
+    TEST_RUN(TestIBusTXDrain);
+    TEST_RUN(TestIBusTXDisplayCap);
+    TEST_RUN(TestIBusTXEvictOrder);
+    TEST_RUN(TestIBusTXEvictActive);
+    TEST_RUN(TestIBusTXSupersede);
+    TEST_RUN(TestIBusTXSupersedeRefresh);
+    TEST_RUN(TestIBusTXEchoMismatch);
+    TEST_RUN(TestIBusTXEchoTimeout);
+    TEST_RUN(TestIBusTXRetryLimit);
+    return 0;
+}
@@ -0,0 +1,279 @@
+/*
+ * File: test_timer.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Unit tests for the scheduled task queue, run against a virtual clock
+ *     that only moves when the Timer1 interrupt is called
+ */
+#include <string.h>
+#include "test.h"
+#include "lib/timer.h"
+
+void _AltT1Interrupt(void);
+extern volatile uint32_t TimerCurrentMillis;
+
+#define TEST_TASKS 4
+
+typedef struct TestTask_t {
+    uint32_t runs;
+    uint32_t lastRun;
+} TestTask_t;
+
+static TestTask_t tasks[TEST_TASKS];
+static uint8_t runOrder[TEST_TASKS];
+static uint8_t runCount;
+
+static void TestTimerTask(void *ctx)
+{
+    TestTask_t *task = (TestTask_t *) ctx;
+    task->runs++;
+    task->lastRun = TimerGetMillis();
+    runOrder[runCount++ % TEST_TASKS] = task - tasks;
+}
+
+static void TestTimerOtherTask(void *ctx)
+{
+    TestTimerTask(ctx);
+}
+
+static void TestTimerAdvance(uint32_t millis, uint8_t process)
+{
+    while (millis-- > 0) {
+        _AltT1Interrupt();
+        if (process != 0) {
+            TimerProcessScheduledTasks();
+        }
+    }
+}
+
+static void TestTimerReset(uint32_t now)
+{
+    uint8_t taskId;
+    for (taskId = 0; taskId < TIMER_TASKS_MAX; taskId++) {
+        TimerScheduledTask_t *t = TimerGetScheduledTask(taskId);
+        if (t != 0 && t->task != 0) {
+            TimerUnregisterScheduledTask(t->task);
+        }
+    }
+    TimerCurrentMillis = now;
+    memset(tasks, 0, sizeof(tasks));
+    runCount = 0;
+}
+
+static void TestTimerPeriodic()
+{
+    TestTimerReset(0);
+    TimerRegisterScheduledTask(&TestTimerTask, &tasks[0], 10);
+    TimerRegisterScheduledTask(&TestTimerOtherTask, &tasks[1], 25);
+    TestTimerAdvance(9, 1);
+    TEST_ASSERT_EQUAL(0, tasks[0].runs);
+    TestTimerAdvance(91, 1);
+    TEST_ASSERT_EQUAL(10, tasks[0].runs);
+    TEST_ASSERT_EQUAL(100, tasks[0].lastRun);
+    TEST_ASSERT_EQUAL(4, tasks[1].runs);
+    TEST_ASSERT_EQUAL(100, tasks[1].lastRun);
+    // Nothing ran late
+    TEST_ASSERT_EQUAL(0, TimerGetScheduledTask(0)->maxLateness);
+    TEST_ASSERT_EQUAL(0, TimerGetScheduledTask(1)->overruns);
+}
+
+static void TestTimerOverrun()
+{
+    TestTimerReset(0);
+    TimerRegisterScheduledTask(&TestTimerOtherTask, &tasks[1], 30);
+    TimerRegisterScheduledTask(&TestTimerTask, &tasks[0], 10);
+    // Stall the main loop: both are due, the earliest deadline runs first
+    TestTimerAdvance(50, 0);
+    TEST_ASSERT_EQUAL(1, TimerProcessScheduledTasks());
+    TEST_ASSERT_EQUAL(2, runCount);
+    TEST_ASSERT_EQUAL(0, runOrder[0]);
+    TEST_ASSERT_EQUAL(1, runOrder[1]);
+    // Each task ran once, and is next due an interval from now
+    TEST_ASSERT_EQUAL(0, TimerProcessScheduledTasks());
+    TimerScheduledTask_t *fast = TimerGetScheduledTask(1);
+    TimerScheduledTask_t *slow = TimerGetScheduledTask(0);
+    TEST_ASSERT_EQUAL(60, fast->deadline);
+    TEST_ASSERT_EQUAL(40, fast->maxLateness);
+    TEST_ASSERT_EQUAL(1, fast->overruns);
+    TEST_ASSERT_EQUAL(20, slow->maxLateness);
+    TEST_ASSERT_EQUAL(0, slow->overruns);
+}
+
+static void TestTimerOnce()
+{
+    TestTimerReset(1000);
+    uint8_t taskId = TimerScheduleOnce(&TestTimerTask, &tasks[0], 5);
+    TEST_ASSERT(taskId != TIMER_TASK_NONE);
+    // Scheduling a pending task again leaves its deadline alone
+    TestTimerAdvance(3, 1);
+    TEST_ASSERT_EQUAL(taskId, TimerScheduleOnce(&TestTimerTask, &tasks[0], 5));
+    TestTimerAdvance(2, 1);
+    TEST_ASSERT_EQUAL(1, tasks[0].runs);
+    TEST_ASSERT_EQUAL(1005, tasks[0].lastRun);
+    // The slot was released once it ran
+    TEST_ASSERT(TimerGetScheduledTask(taskId) == 0);
+    TestTimerAdvance(20, 1);
+    TEST_ASSERT_EQUAL(1, tasks[0].runs);
+    // Rescheduling pushes the deadline out, cancelling drops it
+    TimerScheduleOnce(&TestTimerTask, &tasks[0], 5);
+    TestTimerAdvance(4, 1);
+    TimerReschedule(&TestTimerTask, &tasks[0], 5);
+    TestTimerAdvance(4, 1);
+    TEST_ASSERT_EQUAL(1, tasks[0].runs);
+    TestTimerAdvance(1, 1);
+    TEST_ASSERT_EQUAL(2, tasks[0].runs);
+    TimerScheduleOnce(&TestTimerTask, &tasks[0], 5);
+    TEST_ASSERT_EQUAL(0, TimerCancel(&TestTimerTask));
+    TestTimerAdvance(10, 1);
+    TEST_ASSERT_EQUAL(2, tasks[0].runs);
+}
+
+static void TestTimerSlotReuse()
+{
+    uint8_t taskId;
+    uint16_t cycle;
+    TestTimerReset(0);
+    for (cycle = 0; cycle < 1000; cycle++) {
+        TEST_ASSERT(TimerRegisterScheduledTask(&TestTimerTask, &tasks[0], 10) != TIMER_TASK_NONE);
+        TEST_ASSERT_EQUAL(0, TimerUnregisterScheduledTask(&TestTimerTask));
+    }
+    for (taskId = 0; taskId < TIMER_TASKS_MAX; taskId++) {
+        TEST_ASSERT_EQUAL(taskId, TimerRegisterScheduledTask(&TestTimerTask, &tasks[0], 10));
+    }
+    TEST_ASSERT_EQUAL(
+        TIMER_TASK_NONE,
+        TimerRegisterScheduledTask(&TestTimerTask, &tasks[0], 10)
+    );
+}
+
+static void TestTimerClockWrap()
+{
+    TestTimerReset(UINT32_MAX - 15);
+    TimerRegisterScheduledTask(&TestTimerTask, &tasks[0], 10);
+    TimerRegisterScheduledTask(&TestTimerOtherTask, &tasks[1], 7);
+    TestTimerAdvance(70, 1);
+    TEST_ASSERT_EQUAL(7, tasks[0].runs);
+    TEST_ASSERT_EQUAL(10, tasks[1].runs);
+    TEST_ASSERT_EQUAL(0, TimerGetScheduledTask(0)->maxLateness);
+    TEST_ASSERT_EQUAL(0, TimerGetScheduledTask(1)->maxLateness);
+}
+
+static void TestTimerMicros()
+{
+    TestTimerReset(42);
+    TMR1 = PR1_SETTING / 4;
+    TEST_ASSERT_EQUAL(42250, TimerGetMicros());
+    // The counter wrapped but the interrupt hasn't been serviced yet
+    TMR1 = 16;
+    IFS0bits.T1IF = 1;
+    TEST_ASSERT_EQUAL(43001, TimerGetMicros());
+    _AltT1Interrupt();
+    TEST_ASSERT_EQUAL(43001, TimerGetMicros());
+    TMR1 = 0;
+}
+
+static uint16_t idleMicros;
+
+/**
+ * TestTimerIdleSleep()
+ *     Description:
+ *         Sleep for idleMicros on the virtual clock, firing the Timer1
+ *         interrupt when the count rolls over
+ */
+static void TestTimerIdleSleep()
+{
+    uint32_t ticks = TMR1 + (uint32_t) idleMicros * TIMER_TICKS_PER_US;
+    while (ticks >= PR1_SETTING) {
+        _AltT1Interrupt();
+        ticks -= PR1_SETTING;
+    }
+    TMR1 = ticks;
+}
+
+static void TestTimerIdleReset(uint32_t now, uint16_t sleep)
+{
+    TestTimerReset(now);
+    TMR1 = 0;
+    idleMicros = sleep;
+    HostIdleHook = &TestTimerIdleSleep;
+    TimerResetIdleStats();
+}
+
+static void TestTimerIdleBusy()
+{
+    uint16_t pass;
+    TestTimerIdleReset(1000, 700);
+    for (pass = 0; pass < 100; pass++) {
+        TimerProcessIdle(1);
+    }
+    // Work was done on every pass, so we never slept
+    TEST_ASSERT_EQUAL(1000, TimerGetMillis());
+    TEST_ASSERT_EQUAL(100, TimerGetIdleStats()->busyLoops);
+    TEST_ASSERT_EQUAL(0, TimerGetIdleStats()->idleLoops);
+    TEST_ASSERT_EQUAL(0, TimerGetIdleStats()->idleMillis);
+    HostIdleHook = 0;
+}
+
+static void TestTimerIdleTime()
+{
+    uint16_t pass;
+    TestTimerIdleReset(1000, 700);
+    for (pass = 0; pass < 10; pass++) {
+        TimerProcessIdle(0);
+    }
+    TEST_ASSERT_EQUAL(10, TimerGetIdleStats()->idleLoops);
+    TEST_ASSERT_EQUAL(0, TimerGetIdleStats()->busyLoops);
+    // Sub-millisecond sleeps add up to whole milliseconds
+    TEST_ASSERT_EQUAL(7, TimerGetIdleStats()->idleMillis);
+    TEST_ASSERT_EQUAL(0, TimerGetIdleStats()->idleMicros);
+    TimerProcessIdle(0);
+    TEST_ASSERT_EQUAL(7, TimerGetIdleStats()->idleMillis);
+    TEST_ASSERT_EQUAL(700, TimerGetIdleStats()->idleMicros);
+    HostIdleHook = 0;
+}
+
+static void TestTimerBusyPercent()
+{
+    uint32_t pass;
+    TestTimerIdleReset(1000, 1000);
+    TEST_ASSERT_EQUAL(100, TimerGetBusyPercent());
+    // A quarter of the time busy, three quarters asleep
+    for (pass = 0; pass < 400; pass++) {
+        if (pass % 4 == 0) {
+            TestTimerAdvance(1, 0);
+            TimerProcessIdle(1);
+        } else {
+            TimerProcessIdle(0);
+        }
+    }
+    TEST_ASSERT_EQUAL(25, TimerGetBusyPercent());
+    // A window longer than the microsecond clock can count, running across
+    // the wrap of the millisecond counter
+    TestTimerIdleReset(0xFFFFFFFFUL - 1000000, 1000);
+    for (pass = 0; pass < 6000000; pass++) {
+        if (pass % 3 == 0) {
+            TestTimerAdvance(1, 0);
+            TimerProcessIdle(1);
+        } else {
+            TimerProcessIdle(0);
+        }
+    }
+    TEST_ASSERT_EQUAL(6000000, TimerGetMillis() - TimerGetIdleStats()->startMillis);
+    TEST_ASSERT_EQUAL(4000000, TimerGetIdleStats()->idleMillis);
+    TEST_ASSERT_EQUAL(34, TimerGetBusyPercent());
+    HostIdleHook = 0;
+}
+
+int main()
+{
+    TEST_RUN(TestTimerPeriodic);
+    TEST_RUN(TestTimerOverrun);
+    TEST_RUN(TestTimerOnce);
+    TEST_RUN(TestTimerSlotReuse);
+    TEST_RUN(TestTimerClockWrap);
+    TEST_RUN(TestTimerMicros);
+    TEST_RUN(TestTimerIdleBusy);
+    TEST_RUN(TestTimerIdleTime);
+    TEST_RUN(TestTimerBusyPercent);
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * File: test_uart.c
+ * Author: Ted Salmon <tass2001@gmail.com>
+ * Description:
+ *     Unit tests for the UART TX path against the stub register block
+ */
+#include <string.h>
+#include "test.h"
+#include "lib/uart.h"
+
+void _AltU1TXInterrupt();
+
+static UART_t uart;
+
+static void TestUARTSetup()
+{
+    memset((void *) HostUART, 0, sizeof(HostUART));
+    uart = UARTInit(1, 12, 3, 7, 5, UART_BAUD_9600, UART_PARITY_EVEN);
+    UARTAddModuleHandler(&uart);
+}
+
+static void TestUARTTXFullFIFO()
+{
+    TestUARTSetup();
+    TEST_ASSERT_EQUAL(0, HostUARTTXIE[0]);
+    UARTSendBytes(&uart, (const unsigned char *) "\x68\x04\xFF", 3);
+    TEST_ASSERT_EQUAL(1, HostUARTTXIE[0]);
+    // The hardware buffer is full, so nothing may be written
+    HostUART[0].uxsta |= UART_STA_UTXBF;
+    _AltU1TXInterrupt();
+    TEST_ASSERT_EQUAL(3, CharQueueGetSize(&uart.txQueue));
+    TEST_ASSERT_EQUAL(0, HostUART[0].uxtxreg);
+    TEST_ASSERT_EQUAL(1, HostUARTTXIE[0]);
+}
+
+static void TestUARTTXFillAndDisable()
+{
+    TestUARTSetup();
+    HostUARTTXIF[0] = 1;
+    UARTSendBytes(&uart, (const unsigned char *) "\x68\x04\xFF", 3);
+    HostUART[0].uxsta &= ~UART_STA_UTXBF;
+    _AltU1TXInterrupt();
+    // The buffer had room for everything, and the flag waits for more room
+    TEST_ASSERT_EQUAL(0, CharQueueGetSize(&uart.txQueue));
+    TEST_ASSERT_EQUAL(0xFF, HostUART[0].uxtxreg);
+    TEST_ASSERT_EQUAL(0, HostUARTTXIF[0]);
+    TEST_ASSERT_EQUAL(1, HostUARTTXIE[0]);
+    // Once the queue is empty, the interrupt turns itself off
+    HostUARTTXIF[0] = 1;
+    _AltU1TXInterrupt();
+    TEST_ASSERT_EQUAL(0, HostUARTTXIE[0]);
+    TEST_ASSERT_EQUAL(1, HostUARTTXIF[0]);
+}
+
+static void TestUARTTXAccounting()
+{
+    unsigned char data[CHAR_QUEUE_SIZE + 88];
+    TestUARTSetup();
+    memset(data, 'a', sizeof(data));
+    UARTSendBytes(&uart, data, 100);
+    TEST_ASSERT_EQUAL(100, uart.txHighWater);
+    TEST_ASSERT_EQUAL(0, uart.txDropped);
+    UARTSendBytes(&uart, data, sizeof(data));
+    TEST_ASSERT_EQUAL(CHAR_QUEUE_SIZE, uart.txHighWater);
+    TEST_ASSERT_EQUAL(188, uart.txDropped);
+    UARTSendChar(&uart, 'b');
+    TEST_ASSERT_EQUAL(189, uart.txDropped);
+    // Draining the queue keeps the high-water mark
+    _AltU1TXInterrupt();
+    TEST_ASSERT_EQUAL(0, CharQueueGetSize(&uart.txQueue));
+    TEST_ASSERT_EQUAL(CHAR_QUEUE_SIZE, uart.txHighWater);
+    // Only printable characters and line endings are sent as strings
+    UARTSendString(&uart, "OK\x01\r\n");
+    TEST_ASSERT_EQUAL(4, CharQueueGetSize(&uart.txQueue));
+    TEST_ASSERT_EQUAL(189, uart.txDropped);
+}
+
+int main()
+{
+    TEST_RUN(TestUARTTXFullFIFO);
+    TEST_RUN(TestUARTTXFillAndDisable);
+    TEST_RUN(TestUARTTXAccounting);
+    return 0;
+}
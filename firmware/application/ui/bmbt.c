@@ -30,8 +30,6 @@ void BMBTInit(BC127_t *bt, IBus_t *ibus)
     Context.status.navIndexType = IBUS_CMD_GT_WRITE_INDEX_TMC;
     Context.status.radType = IBUS_RADIO_TYPE_BM53;
     Context.writtenIndices = 3;
-    Context.timerHeaderIntervals = BMBT_MENU_HEADER_TIMER_OFF;
-    Context.timerMenuIntervals = BMBT_MENU_HEADER_TIMER_OFF;
     Context.mainDisplay = UtilsDisplayValueInit("Bluetooth", BMBT_DISPLAY_OFF);
     EventRegisterCallback(
         BC127Event_DeviceConnected,
@@ -103,16 +101,6 @@ void BMBTInit(BC127_t *bt, IBus_t *ibus)
         &BMBTScreenModeUpdate,
         &Context
     );
-    Context.headerWriteTaskId = TimerRegisterScheduledTask(
-        &BMBTTimerHeaderWrite,
-        &Context,
-        BMBT_HEADER_TIMER_WRITE_INT
-    );
-    Context.menuWriteTaskId = TimerRegisterScheduledTask(
-        &BMBTTimerMenuWrite,
-        &Context,
-        BMBT_MENU_TIMER_WRITE_INT
-    );
     Context.displayUpdateTaskId = TimerRegisterScheduledTask(
         &BMBTTimerScrollDisplay,
         &Context,
@@ -187,8 +175,8 @@ void BMBTDestroy()
         IBusEvent_ScreenModeUpdate,
         &BMBTScreenModeUpdate
     );
-    TimerUnregisterScheduledTask(&BMBTTimerHeaderWrite);
-    TimerUnregisterScheduledTask(&BMBTTimerMenuWrite);
+    TimerCancel(&BMBTTimerHeaderWrite);
+    TimerCancel(&BMBTTimerMenuWrite);
     TimerUnregisterScheduledTask(&BMBTTimerScrollDisplay);
     memset(&Context, 0, sizeof(BMBTContext_t));
 }
@@ -251,8 +239,8 @@ static void BMBTSetMainDisplayText(
 /**
  * BMBTTriggerWriteHeader()
  *     Description:
- *         Trigger the counter that fires off our header field writing
- *         timer. If the counter has already been triggered, do nothing.
+ *         Arm the one-shot timer that writes our header fields. If the
+ *         timer is already armed, do nothing.
  *     Params:
  *         BMBTContext_t *context - The context
  *     Returns:
@@ -260,17 +248,18 @@ static void BMBTSetMainDisplayText(
  */
 static void BMBTTriggerWriteHeader(BMBTContext_t *context)
 {
-    if (context->timerHeaderIntervals == BMBT_MENU_HEADER_TIMER_OFF) {
-        TimerResetScheduledTask(context->headerWriteTaskId);
-        context->timerHeaderIntervals = 0;
-    }
+    TimerScheduleOnce(
+        &BMBTTimerHeaderWrite,
+        context,
+        BMBT_HEADER_TIMER_WRITE_TIMEOUT
+    );
 }
 
 /**
  * BMBTTriggerWriteMenu()
  *     Description:
- *         Trigger the counter that fires off our menu writing
- *         timer. If the counter has already been triggered, do nothing.
+ *         Arm the one-shot timer that writes our menu. If the timer is
+ *         already armed, do nothing.
  *     Params:
  *         BMBTContext_t *context - The context
  *     Returns:
@@ -285,10 +274,11 @@ static void BMBTTriggerWriteMenu(BMBTContext_t *context)
         context->ibus->gtVersion < IBUS_GT_MKIII_NEW_UI ||
         context->status.radType == IBUS_RADIO_TYPE_C43
     ) {
-        if (context->timerMenuIntervals == BMBT_MENU_HEADER_TIMER_OFF) {
-            TimerResetScheduledTask(context->menuWriteTaskId);
-            context->timerMenuIntervals = 0;
-        }
+        TimerScheduleOnce(
+            &BMBTTimerMenuWrite,
+            context,
+            BMBT_MENU_TIMER_WRITE_TIMEOUT
+        );
     } else {
         BMBTMenuRefresh(context);
     }
@@ -442,15 +432,13 @@ static void BMBTMenuDashboardUpdate(BMBTContext_t *context, char *f1, char *f2,
 
 static void BMBTMenuDashboard(BMBTContext_t *context)
 {
+    const BC127Metadata_t *metadata = BC127GetMetadata();
     char title[BC127_METADATA_FIELD_SIZE];
     char artist[BC127_METADATA_FIELD_SIZE];
     char album[BC127_METADATA_FIELD_SIZE];
-    memset(title, 0, BC127_METADATA_FIELD_SIZE);
-    memset(artist, 0, BC127_METADATA_FIELD_SIZE);
-    memset(album, 0, BC127_METADATA_FIELD_SIZE);
-    UtilsRemoveNonAscii(title, context->bt->title);
-    UtilsRemoveNonAscii(artist, context->bt->artist);
-    UtilsRemoveNonAscii(album, context->bt->album);
+    strncpy(title, metadata->title, BC127_METADATA_FIELD_SIZE);
+    strncpy(artist, metadata->artist, BC127_METADATA_FIELD_SIZE);
+    strncpy(album, metadata->album, BC127_METADATA_FIELD_SIZE);
     if (context->bt->playbackStatus == BC127_AVRCP_STATUS_PAUSED) {
         if (strlen(title) == 0) {
             strncpy(title, "- Not Playing -", 16);
@@ -494,7 +482,7 @@ static void BMBTMenuDeviceSelection(BMBTContext_t *context)
             cleanText[11] = '\0';
             // Add a space and asterisks to the end of the device name
             // if it's the currently selected device
-            if (strcmp(dev->macId, context->bt->activeDevice.macId) == 0) {
+            if (memcmp(dev->macId, context->bt->activeDevice.macId, BC127_MAC_ID_LENGTH) == 0) {
                 uint8_t startIdx = strlen(cleanText);
                 if (startIdx > 9) {
                     startIdx = 9;
@@ -954,22 +942,12 @@ static void BMBTSettingsUpdateUI(BMBTContext_t *context, uint8_t selectedIdx)
             BMBTGTWriteIndex(context, selectedIdx, "Metadata: Off");
         }
         ConfigSetSetting(CONFIG_SETTING_METADATA_MODE, value);
+        const BC127Metadata_t *metadata = BC127GetMetadata();
         if (value != BMBT_METADATA_MODE_OFF &&
-            strlen(context->bt->title) > 0 &&
+            strlen(metadata->title) > 0 &&
             context->bt->playbackStatus == BC127_AVRCP_STATUS_PLAYING
         ) {
-            char text[UTILS_DISPLAY_TEXT_SIZE];
-            snprintf(
-                text,
-                UTILS_DISPLAY_TEXT_SIZE,
-                "%s - %s - %s",
-                context->bt->title,
-                context->bt->artist,
-                context->bt->album
-            );
-            char cleanText[UTILS_DISPLAY_TEXT_SIZE];
-            UtilsRemoveNonAscii(cleanText, text);
-            BMBTSetMainDisplayText(context, cleanText, 0, 0);
+            BMBTSetMainDisplayText(context, metadata->gtText, 0, 0);
         } else if (value == BMBT_METADATA_MODE_OFF) {
             IBusCommandGTUpdate(context->ibus, context->status.navIndexType);
             BMBTGTWriteTitle(context, "Bluetooth");
@@ -1054,18 +1032,8 @@ void BMBTBC127Metadata(void *ctx, unsigned char *data)
         context->status.displayMode == BMBT_DISPLAY_ON
     ) {
         if (ConfigGetSetting(CONFIG_SETTING_METADATA_MODE) != CONFIG_SETTING_OFF) {
-            char text[UTILS_DISPLAY_TEXT_SIZE];
-            snprintf(
-                text,
-                UTILS_DISPLAY_TEXT_SIZE,
-                "%s - %s - %s",
-                context->bt->title,
-                context->bt->artist,
-                context->bt->album
-            );
-            char cleanText[UTILS_DISPLAY_TEXT_SIZE];
-            UtilsRemoveNonAscii(cleanText, text);
-            BMBTSetMainDisplayText(context, cleanText, 0, 1);
+            const BC127Metadata_t *metadata = BC127GetMetadata();
+            BMBTSetMainDisplayText(context, metadata->gtText, 0, 1);
         }
         if (context->menu == BMBT_MENU_DASHBOARD ||
             context->menu == BMBT_MENU_DASHBOARD_FRESH
@@ -1294,7 +1262,7 @@ void BMBTIBusMenuSelect(void *ctx, unsigned char *pkt)
             } else {
                 uint8_t deviceId = selectedIdx - BMBT_MENU_IDX_FIRST_DEVICE;
                 BC127PairedDevice_t *dev = &context->bt->pairedDevices[deviceId];
-                if (strcmp(dev->macId, context->bt->activeDevice.macId) != 0 &&
+                if (memcmp(dev->macId, context->bt->activeDevice.macId, BC127_MAC_ID_LENGTH) != 0 &&
                     dev != 0
                 ) {
                     // Trigger device selection event
@@ -1467,6 +1435,11 @@ void BMBTScreenModeUpdate(void *ctx, unsigned char *pkt)
          pkt[4] == IBUS_GT_SEL_MENU_OFF
     ) {
          context->status.displayMode = BMBT_DISPLAY_ON;
+         // The writes that were skipped while the display was off
+         if (context->status.playerMode == BMBT_MODE_ACTIVE) {
+             BMBTTriggerWriteHeader(context);
+             BMBTTriggerWriteMenu(context);
+         }
     }
 }
 
@@ -1511,16 +1484,7 @@ void BMBTTimerHeaderWrite(void *ctx)
     if (context->status.playerMode == BMBT_MODE_ACTIVE &&
         context->status.displayMode == BMBT_DISPLAY_ON
     ) {
-        if (context->timerHeaderIntervals != BMBT_MENU_HEADER_TIMER_OFF) {
-            uint16_t time = context->timerHeaderIntervals * BMBT_HEADER_TIMER_WRITE_INT;
-            if (time >= BMBT_HEADER_TIMER_WRITE_TIMEOUT) {
-                BMBTHeaderWrite(context);
-                // Increment the intervals so we aren't called again
-                context->timerHeaderIntervals = BMBT_MENU_HEADER_TIMER_OFF;
-            } else {
-                context->timerHeaderIntervals++;
-            }
-        }
+        BMBTHeaderWrite(context);
     }
 }
 
@@ -1540,48 +1504,39 @@ void BMBTTimerMenuWrite(void *ctx)
     if (context->status.playerMode == BMBT_MODE_ACTIVE &&
         context->status.displayMode == BMBT_DISPLAY_ON
     ) {
-        if (context->timerMenuIntervals != BMBT_MENU_HEADER_TIMER_OFF) {
-            uint16_t time = context->timerMenuIntervals * BMBT_MENU_TIMER_WRITE_INT;
-            if (time == BMBT_MENU_TIMER_WRITE_TIMEOUT) {
-                switch (context->menu) {
-                    case BMBT_MENU_MAIN:
-                        BMBTMenuMain(context);
-                        break;
-                    case BMBT_MENU_DASHBOARD:
-                    case BMBT_MENU_DASHBOARD_FRESH:
-                        BMBTMenuDashboard(context);
-                        break;
-                    case BMBT_MENU_DEVICE_SELECTION:
-                        BMBTMenuDeviceSelection(context);
-                        break;
-                    case BMBT_MENU_SETTINGS:
-                        BMBTMenuSettings(context);
-                        break;
-                    case BMBT_MENU_SETTINGS_AUDIO:
-                        BMBTMenuSettingsAudio(context);
-                        break;
-                    case BMBT_MENU_SETTINGS_COMFORT:
-                        BMBTMenuSettingsComfort(context);
-                        break;
-                    case BMBT_MENU_SETTINGS_CALLING:
-                        BMBTMenuSettingsCalling(context);
-                        break;
-                    case BMBT_MENU_SETTINGS_UI:
-                        BMBTMenuSettingsUI(context);
-                        break;
-                    case BMBT_MENU_NONE:
-                        if (ConfigGetSetting(CONFIG_SETTING_BMBT_DEFAULT_MENU) == 0x01) {
-                            BMBTMenuDashboard(context);
-                        } else {
-                            BMBTMenuMain(context);
-                        }
-                        break;
+        switch (context->menu) {
+            case BMBT_MENU_MAIN:
+                BMBTMenuMain(context);
+                break;
+            case BMBT_MENU_DASHBOARD:
+            case BMBT_MENU_DASHBOARD_FRESH:
+                BMBTMenuDashboard(context);
+                break;
+            case BMBT_MENU_DEVICE_SELECTION:
+                BMBTMenuDeviceSelection(context);
+                break;
+            case BMBT_MENU_SETTINGS:
+                BMBTMenuSettings(context);
+                break;
+            case BMBT_MENU_SETTINGS_AUDIO:
+                BMBTMenuSettingsAudio(context);
+                break;
+            case BMBT_MENU_SETTINGS_COMFORT:
+                BMBTMenuSettingsComfort(context);
+                break;
+            case BMBT_MENU_SETTINGS_CALLING:
+                BMBTMenuSettingsCalling(context);
+                break;
+            case BMBT_MENU_SETTINGS_UI:
+                BMBTMenuSettingsUI(context);
+                break;
+            case BMBT_MENU_NONE:
+                if (ConfigGetSetting(CONFIG_SETTING_BMBT_DEFAULT_MENU) == 0x01) {
+                    BMBTMenuDashboard(context);
+                } else {
+                    BMBTMenuMain(context);
                 }
-                // Increment the intervals so we aren't called again
-                context->timerMenuIntervals = BMBT_MENU_HEADER_TIMER_OFF;
-            } else {
-                context->timerMenuIntervals++;
-            }
+                break;
         }
     }
 }
@@ -63,11 +63,8 @@
 #define BMBT_MENU_IDX_CLEAR_PAIRING 1
 #define BMBT_MENU_IDX_FIRST_DEVICE 2
 #define BMBT_MENU_WRITE_DELAY 300
-#define BMBT_MENU_TIMER_WRITE_INT 100
 #define BMBT_MENU_TIMER_WRITE_TIMEOUT 500
-#define BMBT_HEADER_TIMER_WRITE_INT 50
 #define BMBT_HEADER_TIMER_WRITE_TIMEOUT 100
-#define BMBT_MENU_HEADER_TIMER_OFF 255
 #define BMBT_METADATA_MODE_OFF 0x00
 #define BMBT_METADATA_MODE_PARTY 0x01
 #define BMBT_METADATA_MODE_CHUNK 0x02
@@ -92,11 +89,7 @@ typedef struct BMBTContext_t {
     uint8_t menu;
     BMBTStatus_t status;
     uint8_t writtenIndices;
-    uint8_t timerHeaderIntervals;
-    uint8_t timerMenuIntervals;
     uint8_t displayUpdateTaskId;
-    uint8_t headerWriteTaskId;
-    uint8_t menuWriteTaskId;
     UtilsAbstractDisplayValue_t mainDisplay;
 } BMBTContext_t;
 void BMBTInit(BC127_t *, IBus_t *);
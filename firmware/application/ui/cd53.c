@@ -81,11 +81,6 @@ void CD53Init(BC127_t *bt, IBus_t *ibus)
         &CD53IBusRADUpdateMainArea,
         &Context
     );
-    Context.displayUpdateTaskId = TimerRegisterScheduledTask(
-        &CD53TimerDisplay,
-        &Context,
-        CD53_DISPLAY_TIMER_INT
-    );
 }
 
 /**
@@ -131,10 +126,44 @@ void CD53Destroy()
         IBusEvent_RADUpdateMainArea,
         &CD53IBusRADUpdateMainArea
     );
-    TimerUnregisterScheduledTask(&CD53TimerDisplay);
+    TimerCancel(&CD53TimerDisplay);
     memset(&Context, 0, sizeof(CD53Context_t));
 }
 
+/**
+ * CD53ScheduleDisplay()
+ *     Description:
+ *         Arm the display timer if there is text left to scroll or a timeout
+ *         left to count down, otherwise cancel it so that it does not tick
+ *         while there is nothing to do.
+ *     Params:
+ *         CD53Context_t *context - The CD53 context
+ *     Returns:
+ *         void
+ */
+static void CD53ScheduleDisplay(CD53Context_t *context)
+{
+    uint8_t hasWork = 0;
+    if (context->mode != CD53_MODE_OFF) {
+        if (context->tempDisplay.status > CD53_DISPLAY_STATUS_OFF) {
+            // Temporary text without a timeout stays until it is replaced
+            if (context->tempDisplay.timeout != -1) {
+                hasWork = 1;
+            }
+        } else if (context->mainDisplay.timeout > 0 ||
+            context->mainDisplay.length > 11 ||
+            context->mainDisplay.index == 0
+        ) {
+            hasWork = 1;
+        }
+    }
+    if (hasWork == 1) {
+        TimerReschedule(&CD53TimerDisplay, context, CD53_DISPLAY_TIMER_INT);
+    } else {
+        TimerCancel(&CD53TimerDisplay);
+    }
+}
+
 static void CD53SetMainDisplayText(
     CD53Context_t *context,
     const char *str,
@@ -143,8 +172,9 @@ static void CD53SetMainDisplayText(
     strncpy(context->mainDisplay.text, str, UTILS_DISPLAY_TEXT_SIZE - 1);
     context->mainDisplay.length = strlen(context->mainDisplay.text);
     context->mainDisplay.index = 0;
-    TimerTriggerScheduledTask(context->displayUpdateTaskId);
+    CD53TimerDisplay(context);
     context->mainDisplay.timeout = timeout;
+    CD53ScheduleDisplay(context);
 }
 
 static void CD53SetTempDisplayText(
@@ -159,13 +189,13 @@ static void CD53SetTempDisplayText(
     // Unlike the main display, we need to set the timeout beforehand, that way
     // the timer knows how many iterations to display the text for.
     context->tempDisplay.timeout = timeout;
-    TimerTriggerScheduledTask(context->displayUpdateTaskId);
+    CD53TimerDisplay(context);
 }
 
 static void CD53RedisplayText(CD53Context_t *context)
 {
     context->mainDisplay.index = 0;
-    TimerTriggerScheduledTask(context->displayUpdateTaskId);
+    CD53TimerDisplay(context);
 }
 
 static void CD53ShowNextAvailableDevice(CD53Context_t *context, uint8_t direction)
@@ -191,7 +221,7 @@ static void CD53ShowNextAvailableDevice(CD53Context_t *context, uint8_t directio
     text[11] = '\0';
     // Add a space and asterisks to the end of the device name
     // if it's the currently selected device
-    if (strcmp(dev->macId, context->bt->activeDevice.macId) == 0) {
+    if (memcmp(dev->macId, context->bt->activeDevice.macId, BC127_MAC_ID_LENGTH) == 0) {
         uint8_t startIdx = strlen(cleanText);
         if (startIdx > 9) {
             startIdx = 9;
@@ -479,7 +509,7 @@ static void CD53HandleUIButtons(CD53Context_t *context, unsigned char *pkt)
                 context->btDeviceIndex
             ];
             // Do nothing if the user selected the active device
-            if (strcmp(dev->macId, context->bt->activeDevice.macId) != 0) {
+            if (memcmp(dev->macId, context->bt->activeDevice.macId, BC127_MAC_ID_LENGTH) != 0) {
                 // Immediately connect if there isn't an active device
                 if (context->bt->activeDevice.deviceId == 0) {
                     // Trigger device selection event
@@ -570,7 +600,7 @@ static void CD53HandleUIButtons(CD53Context_t *context, unsigned char *pkt)
     } else {
         // A button was pressed - Push our display text back
         if (context->mode == CD53_MODE_ACTIVE) {
-            TimerTriggerScheduledTask(context->displayUpdateTaskId);
+            CD53TimerDisplay(context);
         } else if (context->mode != CD53_MODE_OFF) {
             CD53RedisplayText(context);
         }
@@ -596,45 +626,15 @@ void CD53BC127DeviceReady(void *ctx, unsigned char *tmp)
     }
 }
 
-void CD53BC127Metadata(CD53Context_t *context, unsigned char *metadata)
+void CD53BC127Metadata(CD53Context_t *context, unsigned char *data)
 {
+    const BC127Metadata_t *metadata = BC127GetMetadata();
     if (context->displayMetadata &&
         context->mode == CD53_MODE_ACTIVE &&
-        strlen(context->bt->title) > 0
+        strlen(metadata->title) > 0
     ) {
-        char text[UTILS_DISPLAY_TEXT_SIZE];
-        if (strlen(context->bt->artist) > 0 && strlen(context->bt->album) > 0) {
-            snprintf(
-                text,
-                UTILS_DISPLAY_TEXT_SIZE,
-                "%s - %s on %s",
-                context->bt->title,
-                context->bt->artist,
-                context->bt->album
-            );
-        } else if (strlen(context->bt->artist) > 0) {
-            snprintf(
-                text,
-                UTILS_DISPLAY_TEXT_SIZE,
-                "%s - %s",
-                context->bt->title,
-                context->bt->artist
-            );
-        } else if (strlen(context->bt->album) > 0) {
-            snprintf(
-                text,
-                UTILS_DISPLAY_TEXT_SIZE,
-                "%s on %s",
-                context->bt->title,
-                context->bt->album
-            );
-        } else {
-            snprintf(text, UTILS_DISPLAY_TEXT_SIZE, "%s", context->bt->title);
-        }
-        char cleanText[UTILS_DISPLAY_TEXT_SIZE];
-        UtilsRemoveNonAscii(cleanText, text);
-        CD53SetMainDisplayText(context, cleanText, 3000 / CD53_DISPLAY_SCROLL_SPEED);
-        TimerTriggerScheduledTask(context->displayUpdateTaskId);
+        CD53SetMainDisplayText(context, metadata->text, 3000 / CD53_DISPLAY_SCROLL_SPEED);
+        CD53TimerDisplay(context);
     }
 }
 
@@ -683,7 +683,7 @@ void CD53IBusClearScreen(void *ctx, unsigned char *pkt)
 {
     CD53Context_t *context = (CD53Context_t *) ctx;
     if (context->mode == CD53_MODE_ACTIVE) {
-        TimerTriggerScheduledTask(context->displayUpdateTaskId);
+        CD53TimerDisplay(context);
     } else if (context->mode != CD53_MODE_OFF) {
         CD53RedisplayText(context);
     }
@@ -709,12 +709,13 @@ void CD53IBusCDChangerStatus(void *ctx, unsigned char *pkt)
             }
             BC127CommandStatus(context->bt);
             context->mode = CD53_MODE_ACTIVE;
+            CD53ScheduleDisplay(context);
         }
     } else if (requestedCommand == IBUS_CDC_CMD_SCAN ||
                requestedCommand == IBUS_CDC_CMD_RANDOM_MODE
     ) {
         if (context->mode == CD53_MODE_ACTIVE) {
-            TimerTriggerScheduledTask(context->displayUpdateTaskId);
+            CD53TimerDisplay(context);
         } else if (context->mode != CD53_MODE_OFF) {
             CD53RedisplayText(context);
         }
@@ -738,7 +739,6 @@ void CD53IBusRADUpdateMainArea(void *ctx, unsigned char *pkt)
 void CD53TimerDisplay(void *ctx)
 {
     CD53Context_t *context = (CD53Context_t *) ctx;
-    LogRaw("CD53 Timer Called!\r\n");
     if (context->mode != CD53_MODE_OFF) {
         // Display the temp text, if there is any
         if (context->tempDisplay.status > CD53_DISPLAY_STATUS_OFF) {
@@ -813,4 +813,5 @@ void CD53TimerDisplay(void *ctx)
             }
         }
     }
+    CD53ScheduleDisplay(context);
 }
@@ -50,8 +50,6 @@
  *  bt: A pointer to the Bluetooth struct
  *  ibus: A pointer to the IBus struct
  *  mode: Track the state of the radio to see what we should display to the user.
- *  displayUpdateTaskId: The ID of the display update task. We use this to call
- *      the display update task immediately.
  *  btDeviceIndex: The selected Bluetooth device -- Used to change selected devices
  *  mainDisplay: The main text that should be displayed
  *  tempDisplay: The value to temporarily display on the screen. The max text
@@ -61,7 +59,6 @@ typedef struct CD53Context_t {
     BC127_t *bt;
     IBus_t *ibus;
     uint8_t mode;
-    uint8_t displayUpdateTaskId;
     int8_t btDeviceIndex;
     uint8_t seekMode;
     uint8_t displayMetadata;
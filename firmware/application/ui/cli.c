@@ -30,8 +30,67 @@ void CLIInit(UART_t *uart, BC127_t *bt, IBus_t *ibus)
         &cli,
         250
     );
-    cli.lastChar = 0;
+    cli.rxBufferIdx = 0;
     cli.lastRxTimestamp = 0;
+    cli.recorderState = CLI_RECORDER_STATE_IDLE;
+    cli.recorderPage = 0;
+}
+
+/**
+ * CLIRecorderProcess()
+ *     Description:
+ *         Move a recorder dump or shutdown along without blocking the main
+ *         loop. Once the recorder is synced, a dump sends one page per pass,
+ *         each after a marker line, and only when the UART TX queue has room
+ *         for all of it and the EEPROM is free to be read. The marker lets
+ *         utility/ibus_recorder_decode.py skip the log lines that other
+ *         modules send between pages.
+ *     Params:
+ *         void
+ *     Returns:
+ *         uint8_t - 1 if a page was sent or the state changed, 0 otherwise
+ */
+static uint8_t CLIRecorderProcess()
+{
+    if (cli.recorderState == CLI_RECORDER_STATE_IDLE) {
+        return 0;
+    }
+    if (cli.recorderState != CLI_RECORDER_STATE_DUMP &&
+        IBusRecorderIsSynced() == 0
+    ) {
+        return 0;
+    }
+    if (cli.recorderState == CLI_RECORDER_STATE_SYNC_OFF) {
+        ConfigSetSetting(CONFIG_SETTING_IBUS_RECORDER, CONFIG_SETTING_OFF);
+        IBusRecorderInit();
+        cli.recorderState = CLI_RECORDER_STATE_IDLE;
+        return 1;
+    }
+    if (cli.recorderState == CLI_RECORDER_STATE_SYNC_DUMP) {
+        LogRaw("IBUSREC %d %d\r\n", IBUS_RECORDER_PAGES, EEPROM_PAGE_SIZE);
+        cli.recorderPage = 0;
+        cli.recorderState = CLI_RECORDER_STATE_DUMP;
+        return 1;
+    }
+    // Leave room for the marker line as well as the page
+    if (CHAR_QUEUE_SIZE - CharQueueGetSize(&cli.uart->txQueue) < EEPROM_PAGE_SIZE + 24 ||
+        EEPROMIsBusy() == 1
+    ) {
+        return 0;
+    }
+    unsigned char page[EEPROM_PAGE_SIZE];
+    EEPROMReadBytes(
+        IBUS_RECORDER_START_ADDRESS + (uint32_t) cli.recorderPage * EEPROM_PAGE_SIZE,
+        page,
+        EEPROM_PAGE_SIZE
+    );
+    LogRaw("IBUSREC PAGE %u\r\n", cli.recorderPage);
+    UARTSendBytes(cli.uart, page, EEPROM_PAGE_SIZE);
+    cli.recorderPage++;
+    if (cli.recorderPage == IBUS_RECORDER_PAGES) {
+        cli.recorderState = CLI_RECORDER_STATE_IDLE;
+    }
+    return 1;
 }
 
 /**
@@ -41,17 +100,36 @@ void CLIInit(UART_t *uart, BC127_t *bt, IBus_t *ibus)
  *     Params:
  *         void
  *     Returns:
- *         void
+ *         uint8_t - 1 if any input was read, 0 otherwise
  */
-void CLIProcess()
+uint8_t CLIProcess()
 {
-    while (cli.lastChar != cli.uart->rxQueue.writeCursor) {
-        unsigned char nextChar = CharQueueGet(&cli.uart->rxQueue, cli.lastChar);
-        UARTSendChar(cli.uart, nextChar);
-        if (cli.lastChar >= (CHAR_QUEUE_SIZE - 1)) {
-            cli.lastChar = 0;
-        } else {
-            cli.lastChar++;
+    uint8_t workDone = 0;
+    uint16_t messageLength = 0;
+    // Move characters from the RX queue into the line buffer, echoing them
+    // back. The line is edited here, since the queue may only be consumed.
+    while (messageLength == 0 && CharQueueGetSize(&cli.uart->rxQueue) > 0) {
+        unsigned char c = CharQueueNext(&cli.uart->rxQueue);
+        workDone = 1;
+        if (c == CLI_MSG_DELETE_CHAR) {
+            if (cli.rxBufferIdx > 0) {
+                cli.rxBufferIdx--;
+                // Send the "back one" character, space character and then
+                // back one again
+                UARTSendChar(cli.uart, '\b');
+                UARTSendChar(cli.uart, ' ');
+                UARTSendChar(cli.uart, '\b');
+            }
+        } else if (c == CLI_MSG_END_CHAR) {
+            UARTSendChar(cli.uart, c);
+            // 0x0D delimits messages, so we change it to a null
+            // terminator instead
+            cli.rxBuffer[cli.rxBufferIdx] = '\0';
+            messageLength = cli.rxBufferIdx + 1;
+            cli.rxBufferIdx = 0;
+        } else if (cli.rxBufferIdx < (CLI_BUFFER_SIZE - 1)) {
+            UARTSendChar(cli.uart, c);
+            cli.rxBuffer[cli.rxBufferIdx++] = c;
         }
     }
     if (cli.terminalReady == 0 && SYS_DTR_STATUS == 0) {
@@ -61,54 +139,20 @@ void CLIProcess()
     if (cli.terminalReady == 2 && SYS_DTR_STATUS == 1) {
         cli.terminalReady = 0;
     }
-    // Check for the backspace character
-    uint16_t backspaceLegnth = CharQueueSeek(&cli.uart->rxQueue, CLI_MSG_DELETE_CHAR);
-    if (backspaceLegnth > 0) {
-        if (cli.lastChar < 2) {
-            cli.lastChar = CHAR_QUEUE_SIZE - (3 - cli.lastChar);
-        } else {
-            cli.lastChar = cli.lastChar - 2;
-        }
-        // Remove the backspace character
-        CharQueueRemoveLast(&cli.uart->rxQueue);
-        // Send the "back one" character, space character and then back one again
-        if (cli.uart->rxQueue.size > 0) {
-            UARTSendChar(cli.uart, '\b');
-            UARTSendChar(cli.uart, ' ');
-            UARTSendChar(cli.uart, '\b');
-        }
-        // Remove the character before it
-        CharQueueRemoveLast(&cli.uart->rxQueue);
-    }
-    uint16_t messageLength = CharQueueSeek(&cli.uart->rxQueue, CLI_MSG_END_CHAR);
     if (messageLength > 0) {
         // Send a newline to keep the CLI pretty
         UARTSendChar(cli.uart, 0x0A);
-        char msg[messageLength];
         uint16_t i;
         uint8_t delimCount = 1;
         for (i = 0; i < messageLength; i++) {
-            char c = CharQueueNext(&cli.uart->rxQueue);
-            if (c == CLI_MSG_DELIMETER) {
+            if (cli.rxBuffer[i] == CLI_MSG_DELIMETER) {
                 delimCount++;
             }
-            if (c != CLI_MSG_END_CHAR) {
-                msg[i] = c;
-            } else {
-                // 0x0D delimits messages, so we change it to a null
-                // terminator instead
-                msg[i] = '\0';
-            }
         }
         uint8_t cmdSuccess = 1;
         if (messageLength > 1) {
-            // Copy the message, since strtok adds a null terminator after the first
-            // occurrence of the delimiter, it will not cause issues with string
-            // functions
-            char tmpMsg[messageLength];
-            strcpy(tmpMsg, msg);
             char *msgBuf[delimCount];
-            char *p = strtok(tmpMsg, " ");
+            char *p = strtok(cli.rxBuffer, " ");
             i = 0;
             while (p != NULL) {
                 msgBuf[i++] = p;
@@ -202,9 +246,106 @@ void CLIProcess()
                     cmdSuccess = 0;
                 }
             } else if (UtilsStricmp(msgBuf[0], "GET") == 0) {
-                if (UtilsStricmp(msgBuf[1], "IBUS") == 0) {
+                if (UtilsStricmp(msgBuf[1], "BT") == 0) {
+                    BC127CommandQueue_t *commands = BC127GetCommandStats();
+                    uint32_t latencyAvg = 0;
+                    if (commands->completed > 0) {
+                        latencyAvg = commands->latencyTotal / commands->completed;
+                    }
+                    LogRaw(
+                        "BT: Commands Pending: %d Sent: %lu Completed: %lu Errors: %u Timeouts: %u Retries: %u Dropped: %u\r\n",
+                        commands->pendingCount,
+                        (long unsigned int) commands->sent,
+                        (long unsigned int) commands->completed,
+                        commands->errors,
+                        commands->timeouts,
+                        commands->retries,
+                        commands->dropped
+                    );
+                    LogRaw(
+                        "BT: Command Latency Avg: %lums Max: %ums\r\n",
+                        (long unsigned int) latencyAvg,
+                        commands->latencyMax
+                    );
+                    HandlerReconnect_t *reconnect = HandlerGetReconnect();
+                    LogRaw(
+                        "BT: Time to A2DP: %lums Time to Stream: %lums Reconnect Attempts: %d\r\n",
+                        (long unsigned int) reconnect->timeToA2DP,
+                        (long unsigned int) reconnect->timeToStream,
+                        reconnect->attempts
+                    );
+                    uint8_t idx;
+                    for (idx = 0; idx < reconnect->count; idx++) {
+                        char macIdText[13];
+                        BC127MacIdFormat(macIdText, reconnect->devices[idx].macId);
+                        LogRaw(
+                            "BT: Reconnect %d: %s Profiles: %02X\r\n",
+                            idx + 1,
+                            macIdText,
+                            reconnect->devices[idx].profiles
+                        );
+                    }
+                } else if (UtilsStricmp(msgBuf[1], "IBUS") == 0) {
+                    LogRaw(
+                        "IBus: RX Frames: %lu Dropped Bytes: %lu Recovered Bytes: %lu\r\n",
+                        (long unsigned int) cli.ibus->rxFrames,
+                        (long unsigned int) cli.ibus->rxDroppedBytes,
+                        (long unsigned int) cli.ibus->rxRecoveredBytes
+                    );
+                    LogRaw(
+                        "IBus: TX Frames: %lu Aborts: %u Coalesced: %lu (%lu bytes saved)\r\n",
+                        (long unsigned int) cli.ibus->txFrames,
+                        cli.ibus->txAborts,
+                        (long unsigned int) cli.ibus->txCoalescedFrames,
+                        (long unsigned int) cli.ibus->txCoalescedBytes
+                    );
+                    LogRaw(
+                        "IBus: Bus Load: %d%% TX Gap: %dms TX Throughput: %u B/s\r\n",
+                        cli.ibus->busLoad,
+                        cli.ibus->txGap,
+                        cli.ibus->txThroughput
+                    );
+                    LogRaw("IBus: Sniffer Dropped: %u\r\n", cli.ibus->snifferDropped);
+                    uint8_t txClass;
+                    for (txClass = 0; txClass < IBUS_TX_CLASS_COUNT; txClass++) {
+                        IBusTXQueue_t *queue = &cli.ibus->txQueues[txClass];
+                        uint32_t waitAvg = 0;
+                        if (queue->sent > 0) {
+                            waitAvg = queue->waitTotal / queue->sent;
+                        }
+                        LogRaw(
+                            "IBus: TX Class %d: Depth: %d High Water: %d Sent: %lu Dropped: %lu Wait Avg: %lums Max: %ums Collisions: %u Retries: %u Failed: %u\r\n",
+                            txClass,
+                            queue->count,
+                            queue->highWater,
+                            (long unsigned int) queue->sent,
+                            (long unsigned int) queue->dropped,
+                            (long unsigned int) waitAvg,
+                            queue->waitMax,
+                            queue->collisions,
+                            queue->retries,
+                            queue->failed
+                        );
+                    }
                     IBusCommandDIAGetIdentity(cli.ibus, IBUS_DEVICE_GT);
                     IBusCommandDIAGetIdentity(cli.ibus, IBUS_DEVICE_RAD);
+                } else if (UtilsStricmp(msgBuf[1], "IBUSREC") == 0) {
+                    IBusRecorder_t *recorder = IBusRecorderGetStatus();
+                    if (delimCount > 2 && UtilsStricmp(msgBuf[2], "DUMP") == 0) {
+                        // Stream the raw pages from CLIRecorderProcess(),
+                        // for utility/ibus_recorder_decode.py to pick up
+                        IBusRecorderSync();
+                        cli.recorderState = CLI_RECORDER_STATE_SYNC_DUMP;
+                    } else {
+                        LogRaw(
+                            "IBus Recorder: %s Entries: %lu Overruns: %u Next Page: %u Sequence: %lu\r\n",
+                            recorder->enabled == 1 ? "On" : "Off",
+                            (long unsigned int) recorder->entries,
+                            recorder->overruns,
+                            recorder->nextPage,
+                            (long unsigned int) recorder->sequence
+                        );
+                    }
                 } else if (UtilsStricmp(msgBuf[1], "LCM") == 0) {
                     IBusCommandDIAGetIdentity(cli.ibus, IBUS_DEVICE_LCM);
                 } else if (UtilsStricmp(msgBuf[1], "ERR") == 0) {
@@ -217,6 +358,7 @@ void CLIProcess()
                     LogRaw("    NVM Failures: %d\r\n", ConfigGetTrapCount(CONFIG_TRAP_NVM));
                     LogRaw("    General Failures: %d\r\n", ConfigGetTrapCount(CONFIG_TRAP_GEN));
                     LogRaw("    Last Trap: %02x\r\n", ConfigGetTrapLast());
+                    LogRaw("Event Callback Overflows: %u\r\n", EventGetOverflowCount());
                 } else if (UtilsStricmp(msgBuf[1], "UI") == 0) {
                     unsigned char uiMode = ConfigGetUIMode();
                     if (uiMode == IBus_UI_CD53) {
@@ -232,6 +374,16 @@ void CLIProcess()
                     } else {
                         LogRaw("UI Mode: Not set or Invalid\r\n");
                     }
+                } else if (UtilsStricmp(msgBuf[1], "CPU") == 0) {
+                    TimerIdleStats_t *stats = TimerGetIdleStats();
+                    LogRaw(
+                        "CPU: Busy: %d%% Loops Busy: %lu Idle: %lu Window: %lums\r\n",
+                        TimerGetBusyPercent(),
+                        (long unsigned int) stats->busyLoops,
+                        (long unsigned int) stats->idleLoops,
+                        (long unsigned int) (TimerGetMillis() - stats->startMillis)
+                    );
+                    TimerResetIdleStats();
                 } else if (UtilsStricmp(msgBuf[1], "DAC") == 0) {
                     int8_t status;
                     unsigned char buffer;
@@ -260,6 +412,59 @@ void CLIProcess()
                     } else {
                         LogRaw("Auto-Power Off: Off\r\n");
                     }
+                } else if (UtilsStricmp(msgBuf[1], "EVENTS") == 0) {
+                    uint8_t lane;
+                    for (lane = 0; lane < EVENT_QUEUE_LANES; lane++) {
+                        EventQueueStats_t *stats = EventQueueGetStats(lane);
+                        uint32_t avgLatency = 0;
+                        if (stats->processed > 0) {
+                            avgLatency = stats->totalLatency / stats->processed;
+                        }
+                        LogRaw(
+                            "Event Lane %d: Depth: %d/%d Max Depth: %d Overflows: %u\r\n",
+                            lane,
+                            stats->depth,
+                            EVENT_QUEUE_SIZE,
+                            stats->maxDepth,
+                            stats->overflows
+                        );
+                        LogRaw(
+                            "    Processed: %lu Latency Avg: %lums Max: %ums\r\n",
+                            (long unsigned int) stats->processed,
+                            (long unsigned int) avgLatency,
+                            stats->maxLatency
+                        );
+                    }
+                } else if (UtilsStricmp(msgBuf[1], "TIMERS") == 0) {
+                    uint8_t taskId;
+                    for (taskId = 0; taskId < TIMER_TASKS_MAX; taskId++) {
+                        TimerScheduledTask_t *t = TimerGetScheduledTask(taskId);
+                        if (t != 0) {
+                            LogRaw(
+                                "Timer %d: Interval: %ums Runs: %lu Overruns: %u Max Late: %ums\r\n",
+                                taskId,
+                                t->interval,
+                                (long unsigned int) t->runs,
+                                t->overruns,
+                                t->maxLateness
+                            );
+                        }
+                    }
+                } else if (UtilsStricmp(msgBuf[1], "UART") == 0) {
+                    uint8_t module;
+                    for (module = 1; module <= UART_MODULES_COUNT; module++) {
+                        UART_t *uart = UARTGetModuleHandler(module);
+                        if (uart != 0) {
+                            LogRaw(
+                                "UART[%d]: TX High Water: %u/%u TX Dropped: %u RX Dropped: %u\r\n",
+                                module,
+                                uart->txHighWater,
+                                CHAR_QUEUE_SIZE,
+                                uart->txDropped,
+                                uart->rxDropped
+                            );
+                        }
+                    }
                 } else if (UtilsStricmp(msgBuf[1], "VIN") == 0) {
                     // Get VIN
                     unsigned char currentVehicleId[5] = {};
@@ -382,6 +587,18 @@ void CLIProcess()
                     } else {
                         cmdSuccess = 0;
                     }
+                } else if (UtilsStricmp(msgBuf[1], "IBUSREC") == 0) {
+                    if (UtilsStricmp(msgBuf[2], "ON") == 0) {
+                        ConfigSetSetting(CONFIG_SETTING_IBUS_RECORDER, CONFIG_SETTING_ON);
+                        IBusRecorderInit();
+                    } else if (UtilsStricmp(msgBuf[2], "OFF") == 0) {
+                        // Switched off from CLIRecorderProcess() once the
+                        // last entries are written
+                        IBusRecorderSync();
+                        cli.recorderState = CLI_RECORDER_STATE_SYNC_OFF;
+                    } else {
+                        cmdSuccess = 0;
+                    }
                 } else if (UtilsStricmp(msgBuf[1], "LOG") == 0) {
                     unsigned char system = 0xFF;
                     unsigned char value = 0xFF;
@@ -406,6 +623,14 @@ void CLIProcess()
                     } else {
                         LogRaw("Invalid Parameters for SET LOG\r\n");
                     }
+                } else if (UtilsStricmp(msgBuf[1], "SNIFF") == 0) {
+                    if (UtilsStricmp(msgBuf[2], "ON") == 0) {
+                        cli.ibus->snifferEnabled = 1;
+                    } else if (UtilsStricmp(msgBuf[2], "OFF") == 0) {
+                        cli.ibus->snifferEnabled = 0;
+                    } else {
+                        cmdSuccess = 0;
+                    }
                 } else if (UtilsStricmp(msgBuf[1], "TEL") == 0) {
                     if (UtilsStricmp(msgBuf[2], "ON") == 0) {
                         // Enable the amp and mute the radio
@@ -495,17 +720,25 @@ void CLIProcess()
                 LogRaw("    BT REBOOT - Reboot the BC127\r\n");
                 LogRaw("    BT UNPAIR - Unpair all devices from the BC127\r\n");
                 LogRaw("    BT VERSION - Get the BC127 Version Info\r\n");
+                LogRaw("    GET BT - Get the BC127 command statistics and the reconnect list\r\n");
+                LogRaw("    GET CPU - Get the main loop utilization since the last call\r\n");
                 LogRaw("    GET DAC - Get info from the PCM5122 DAC\r\n");
                 LogRaw("    GET ERR - Get the Error counter\r\n");
+                LogRaw("    GET EVENTS - Get the deferred event queue statistics\r\n");
                 LogRaw("    GET IBUS - Get debug info from the IBus\r\n");
+                LogRaw("    GET IBUSREC - Get the IBus recorder status. Add DUMP for the raw pages\r\n");
+                LogRaw("    GET TIMERS - Get the scheduled task statistics\r\n");
+                LogRaw("    GET UART - Get the UART queue high-water marks and drop counters\r\n");
                 LogRaw("    GET UI - Get the current UI Mode\r\n");
                 LogRaw("    GET I2S - Read the WM8804 INT/SPD Status registers\r\n");
                 LogRaw("    ID - Print 'BlueBus' to the terminal\r\n");
                 LogRaw("    REBOOT - Reboot the device\r\n");
                 LogRaw("    SET DAC GAIN xx - Set the PCM5122 gain from 0x00 - 0xCF (higher is lower)\r\n");
+                LogRaw("    SET IBUSREC ON/OFF - Record the IBus traffic to the EEPROM\r\n");
                 LogRaw("    SET IGN ON/OFF - Send the ignition status message [DEBUG]\r\n");
                 LogRaw("    SET LOG x ON/OFF - Change logging for x (BT, IBUS, SYS, UI)\r\n");
                 LogRaw("    SET PWROFF ON/OFF - Enable or disable auto power off\r\n");
+                LogRaw("    SET SNIFF ON/OFF - Stream every IBus frame in binary, for utility/ibus_sniffer.py\r\n");
                 LogRaw("    SET TEL ON/OFF - Enable/Disable output as the TCU\r\n");
                 LogRaw("    SET UI x - Set the UI to x, where x:\r\n");
                 LogRaw("        x = 1. CD53 (Business Radio)\r\n");
@@ -535,6 +768,8 @@ void CLIProcess()
         }
         cli.lastRxTimestamp = TimerGetMillis();
     }
+    workDone |= CLIRecorderProcess();
+    return workDone;
 }
 
 /**
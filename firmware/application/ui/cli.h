@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include "../handler.h"
 #include "../mappings.h"
 #include "../lib/bc127.h"
 #include "../lib/char_queue.h"
@@ -22,9 +23,14 @@
 
 // Banner timeout is in seconds
 #define CLI_BANNER_TIMEOUT 300
+#define CLI_BUFFER_SIZE 128
 #define CLI_MSG_END_CHAR 0x0D
 #define CLI_MSG_DELIMETER 0x20
 #define CLI_MSG_DELETE_CHAR 0x7F
+#define CLI_RECORDER_STATE_IDLE 0
+#define CLI_RECORDER_STATE_SYNC_DUMP 1
+#define CLI_RECORDER_STATE_DUMP 2
+#define CLI_RECORDER_STATE_SYNC_OFF 3
 /**
  * CLI_t
  *     Description:
@@ -33,18 +39,25 @@
  *         UART_t *uart - A pointer to the UART module object
  *         BC127_t *bt - A pointer to the BC127 object
  *         IBus_t *bt - A pointer to the IBus object
- *         uint16_t lastChar - The last character
+ *         char rxBuffer - The line currently being typed
+ *         uint16_t rxBufferIdx - The length of the line currently being typed
+ *         uint8_t recorderState - The CLI_RECORDER_STATE_* of a recorder
+ *             dump or shutdown that is in progress
+ *         uint16_t recorderPage - The next recorder page to dump
  */
 typedef struct CLI_t {
     UART_t *uart;
     BC127_t *bt;
     IBus_t *ibus;
     uint8_t terminalReadyTaskId;
-    uint16_t lastChar;
+    char rxBuffer[CLI_BUFFER_SIZE];
+    uint16_t rxBufferIdx;
     uint32_t lastRxTimestamp;
     uint8_t terminalReady;
+    uint8_t recorderState;
+    uint16_t recorderPage;
 } CLI_t;
 void CLIInit(UART_t *, BC127_t *, IBus_t *);
-void CLIProcess();
+uint8_t CLIProcess();
 void CLITimerTerminalReady(void *);
 #endif /* CLI_H */
@@ -72,11 +72,6 @@ void MIDInit(BC127_t *bt, IBus_t *ibus)
         &MIDIBusMIDModeChange,
         &Context
     );
-    Context.displayUpdateTaskId = TimerRegisterScheduledTask(
-        &MIDTimerDisplay,
-        &Context,
-        MID_DISPLAY_TIMER_INT
-    );
 }
 
 /**
@@ -118,10 +113,44 @@ void MIDDestroy()
         IBusEvent_MIDModeChange,
         &MIDIBusMIDModeChange
     );
-    TimerUnregisterScheduledTask(&MIDTimerDisplay);
+    TimerCancel(&MIDTimerDisplay);
     memset(&Context, 0, sizeof(MIDContext_t));
 }
 
+/**
+ * MIDScheduleDisplay()
+ *     Description:
+ *         Arm the display timer if there is text left to scroll or a timeout
+ *         left to count down, otherwise cancel it so that it does not tick
+ *         while there is nothing to do.
+ *     Params:
+ *         MIDContext_t *context - The MID context
+ *     Returns:
+ *         void
+ */
+static void MIDScheduleDisplay(MIDContext_t *context)
+{
+    uint8_t hasWork = 0;
+    if (context->mode != MID_MODE_OFF) {
+        if (context->tempDisplay.status > MID_DISPLAY_STATUS_OFF) {
+            // Temporary text without a timeout stays until it is replaced
+            if (context->tempDisplay.timeout != -1) {
+                hasWork = 1;
+            }
+        } else if (context->mainDisplay.timeout > 0 ||
+            context->mainDisplay.length > MID_DISPLAY_TEXT_SIZE ||
+            context->mainDisplay.index == 0
+        ) {
+            hasWork = 1;
+        }
+    }
+    if (hasWork == 1) {
+        TimerReschedule(&MIDTimerDisplay, context, MID_DISPLAY_TIMER_INT);
+    } else {
+        TimerCancel(&MIDTimerDisplay);
+    }
+}
+
 static void MIDSetMainDisplayText(
     MIDContext_t *context,
     const char *str,
@@ -130,8 +159,9 @@ static void MIDSetMainDisplayText(
     strncpy(context->mainDisplay.text, str, UTILS_DISPLAY_TEXT_SIZE - 1);
     context->mainDisplay.length = strlen(context->mainDisplay.text);
     context->mainDisplay.index = 0;
-    TimerTriggerScheduledTask(context->displayUpdateTaskId);
+    MIDTimerDisplay(context);
     context->mainDisplay.timeout = timeout;
+    MIDScheduleDisplay(context);
 }
 
 static void MIDSetTempDisplayText(
@@ -146,7 +176,7 @@ static void MIDSetTempDisplayText(
     // Unlike the main display, we need to set the timeout beforehand, that way
     // the timer knows how many iterations to display the text for.
     context->tempDisplay.timeout = timeout;
-    TimerTriggerScheduledTask(context->displayUpdateTaskId);
+    MIDTimerDisplay(context);
 }
 
 // Menu Creation
@@ -176,7 +206,7 @@ static void MIDShowNextDevice(MIDContext_t *context, uint8_t direction)
         text[15] = '\0';
         // Add a space and asterisks to the end of the device name
         // if it's the currently selected device
-        if (strcmp(dev->macId, context->bt->activeDevice.macId) == 0) {
+        if (memcmp(dev->macId, context->bt->activeDevice.macId, BC127_MAC_ID_LENGTH) == 0) {
             uint8_t startIdx = strlen(cleanText);
             if (startIdx > 15) {
                 startIdx = 16;
@@ -402,6 +432,7 @@ static void MIDMenuDevices(MIDContext_t *context)
 static void MIDMenuMain(MIDContext_t *context)
 {
     context->mode = MID_MODE_ACTIVE;
+    MIDScheduleDisplay(context);
     IBusCommandMIDDisplayTitleText(context->ibus, "Bluetooth");
     MIDBC127MetadataUpdate((void *) context, 0x00);
     if (context->bt->playbackStatus == BC127_AVRCP_STATUS_PLAYING) {
@@ -441,40 +472,10 @@ static void MIDMenuSettings(MIDContext_t *context)
 void MIDBC127MetadataUpdate(void *ctx, unsigned char *tmp)
 {
     MIDContext_t *context = (MIDContext_t *) ctx;
-    if (context->mode == MID_MODE_ACTIVE && strlen(context->bt->title) > 0) {
-        char text[UTILS_DISPLAY_TEXT_SIZE];
-        if (strlen(context->bt->artist) > 0 && strlen(context->bt->album) > 0) {
-            snprintf(
-                text,
-                UTILS_DISPLAY_TEXT_SIZE,
-                "%s - %s on %s",
-                context->bt->title,
-                context->bt->artist,
-                context->bt->album
-            );
-        } else if (strlen(context->bt->artist) > 0) {
-            snprintf(
-                text,
-                UTILS_DISPLAY_TEXT_SIZE,
-                "%s - %s",
-                context->bt->title,
-                context->bt->artist
-            );
-        } else if (strlen(context->bt->album) > 0) {
-            snprintf(
-                text,
-                UTILS_DISPLAY_TEXT_SIZE,
-                "%s on %s",
-                context->bt->title,
-                context->bt->album
-            );
-        } else {
-            snprintf(text, UTILS_DISPLAY_TEXT_SIZE, "%s", context->bt->title);
-        }
-        char cleanText[UTILS_DISPLAY_TEXT_SIZE];
-        UtilsRemoveNonAscii(cleanText, text);
-        MIDSetMainDisplayText(context, cleanText, 3000 / MID_DISPLAY_SCROLL_SPEED);
-        TimerTriggerScheduledTask(context->displayUpdateTaskId);
+    const BC127Metadata_t *metadata = BC127GetMetadata();
+    if (context->mode == MID_MODE_ACTIVE && strlen(metadata->title) > 0) {
+        MIDSetMainDisplayText(context, metadata->text, 3000 / MID_DISPLAY_SCROLL_SPEED);
+        MIDTimerDisplay(context);
     }
 }
 
@@ -557,7 +558,7 @@ void MIDIBusMIDButtonPress(void *ctx, unsigned char *pkt)
         }
     } else if (context->mode == MID_MODE_SETTINGS) {
         if (btnPressed == MID_BUTTON_BACK) {
-            if (strlen(context->bt->title) > 0) {
+            if (strlen(BC127GetMetadata()->title) > 0) {
                 MIDBC127MetadataUpdate((void *) context, 0x00);
             } else {
                 MIDSetMainDisplayText(context, "                    ", 0);
@@ -606,7 +607,7 @@ void MIDIBusMIDButtonPress(void *ctx, unsigned char *pkt)
         }
     } else if (context->mode == MID_MODE_DEVICES) {
         if (btnPressed == MID_BUTTON_BACK) {
-            if (strlen(context->bt->title) > 0) {
+            if (strlen(BC127GetMetadata()->title) > 0) {
                 MIDBC127MetadataUpdate((void *) context, 0x00);
             } else {
                 MIDSetMainDisplayText(context, "                    ", 0);
@@ -616,7 +617,7 @@ void MIDIBusMIDButtonPress(void *ctx, unsigned char *pkt)
             if (context->bt->pairedDevicesCount > 0) {
                 // Connect to device
                 BC127PairedDevice_t *dev = &context->bt->pairedDevices[context->btDeviceIndex];
-                if (strcmp(dev->macId, context->bt->activeDevice.macId) != 0 &&
+                if (memcmp(dev->macId, context->bt->activeDevice.macId, BC127_MAC_ID_LENGTH) != 0 &&
                     dev != 0
                 ) {
                     // Trigger device selection event
@@ -722,6 +723,7 @@ void MIDIBusMIDModeChange(void *ctx, unsigned char *pkt)
     } else if (pkt[4] == 0x01) {
         if (context->mode == MID_MODE_OFF) {
             context->mode = MID_MODE_ACTIVE;
+            MIDScheduleDisplay(context);
         } else {
             context->mode = MID_MODE_DISPLAY_OFF;
         }
@@ -798,4 +800,5 @@ void MIDTimerDisplay(void *ctx)
             }
         }
     }
+    MIDScheduleDisplay(context);
 }
@@ -78,7 +78,6 @@ typedef struct MIDContext_t {
     uint8_t settingMode;
     UtilsAbstractDisplayValue_t mainDisplay;
     UtilsAbstractDisplayValue_t tempDisplay;
-    uint8_t displayUpdateTaskId;
 } MIDContext_t;
 void MIDInit(BC127_t *, IBus_t *);
 void MIDDestroy();
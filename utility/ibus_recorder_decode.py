@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+import sys
+from argparse import ArgumentParser
+from serial import Serial
+from struct import unpack_from
+from time import time
+
+RECORDER_MAGIC = 0xB5
+RECORDER_HEADER_SIZE = 9
+RECORDER_ENTRY_HEADER_SIZE = 4
+RECORDER_ENTRY_TYPES = {
+    0x01: 'RX',
+    0x02: 'TX',
+    0x03: 'RX_ERROR',
+    0x04: 'TX_COLLISION',
+    0x05: 'TX_FAILED',
+    0x06: 'TX_DROPPED',
+}
+DUMP_COMMAND = b'GET IBUSREC DUMP\r'
+DUMP_MARKER = b'IBUSREC '
+PAGE_MARKER = b'IBUSREC PAGE '
+TIMEOUT = 30
+
+def read_dump(port):
+    serial = Serial(port, 115200, timeout=1)
+    serial.reset_input_buffer()
+    serial.write(DUMP_COMMAND)
+    start = int(time())
+    line = b''
+    while not line.startswith(DUMP_MARKER):
+        if int(time()) - start > TIMEOUT:
+            print('ERR: The device did not start the dump')
+            sys.exit(1)
+        line = serial.readline().strip()
+    _, pages, page_size = line.split(b' ')
+    pages = int(pages)
+    page_size = int(page_size)
+    data = b''
+    # Every page follows its own marker line, so that log lines sent in
+    # between pages can be skipped
+    while len(data) < pages * page_size:
+        if int(time()) - start > TIMEOUT:
+            print('ERR: Only got %d of %d pages' % (len(data) // page_size, pages))
+            sys.exit(1)
+        line = serial.readline().strip()
+        if not line.startswith(PAGE_MARKER):
+            continue
+        page = b''
+        while len(page) < page_size:
+            if int(time()) - start > TIMEOUT:
+                print('ERR: Page %s was cut short' % line.split(b' ')[2])
+                sys.exit(1)
+            page += serial.read(page_size - len(page))
+        data += page
+    return data, page_size
+
+def parse_page(page):
+    sequence, stamp = unpack_from('<II', page, 1)
+    entries = []
+    idx = RECORDER_HEADER_SIZE
+    while idx + RECORDER_ENTRY_HEADER_SIZE <= len(page):
+        entry_type = page[idx]
+        if entry_type not in RECORDER_ENTRY_TYPES:
+            # The rest of the page is padding
+            break
+        delta, length = unpack_from('<HB', page, idx + 1)
+        idx += RECORDER_ENTRY_HEADER_SIZE
+        entries.append((stamp + delta, entry_type, page[idx:idx + length]))
+        idx += length
+    return sequence, entries
+
+def decode(data, page_size):
+    pages = []
+    for offset in range(0, len(data), page_size):
+        page = data[offset:offset + page_size]
+        if len(page) == page_size and page[0] == RECORDER_MAGIC:
+            pages.append(parse_page(page))
+    pages.sort(key=lambda p: p[0])
+    for sequence, entries in pages:
+        for stamp, entry_type, frame in entries:
+            print(
+                '[%d] %-12s %s' % (
+                    stamp,
+                    RECORDER_ENTRY_TYPES[entry_type],
+                    ' '.join('%02X' % b for b in frame)
+                )
+            )
+
+if __name__ == '__main__':
+    try:
+        parser = ArgumentParser(description='Decode the BlueBus IBus flight recorder')
+        parser.add_argument(
+            '--port',
+            metavar='port',
+            type=str,
+            help='The port (COMx) or tty (/dev/ttyACMx or /dev/ttyUSBx) to read the recorder from',
+        )
+        parser.add_argument(
+            '--file',
+            metavar='dumpfile',
+            help='A raw dump saved earlier with --save',
+        )
+        parser.add_argument(
+            '--save',
+            metavar='dumpfile',
+            help='Save the raw dump read from --port to this file',
+        )
+        parser.add_argument(
+            '--page-size',
+            type=int,
+            default=256,
+            help='The page size of a raw dump given with --file',
+        )
+        args = parser.parse_args()
+        if args.port:
+            data, page_size = read_dump(args.port)
+            if args.save:
+                with open(args.save, 'wb') as f:
+                    f.write(data)
+        elif args.file:
+            with open(args.file, 'rb') as f:
+                data = f.read()
+            page_size = args.page_size
+        else:
+            parser.error('Either --port or --file is required')
+        decode(data, page_size)
+    except KeyboardInterrupt:
+        sys.exit(0)
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+import sys
+from argparse import ArgumentParser
+from serial import Serial
+from struct import pack, unpack_from
+
+SNIFFER_SYNC = 0xB6
+SNIFFER_HEADER_SIZE = 7
+SNIFFER_TYPES = {
+    0x01: 'RX',
+    0x02: 'TX',
+    0x03: 'RX_ERROR',
+    0x04: 'TX_COLLISION',
+    0x05: 'TX_FAILED',
+    0x06: 'TX_DROPPED',
+}
+PCAP_LINKTYPE_USER0 = 147
+PCAP_SNAPLEN = 256
+TIMER_WRAP = 1 << 32
+
+class SnifferParser(object):
+    def __init__(self):
+        self.buffer = bytearray()
+        self.last_stamp = None
+        self.wraps = 0
+
+    def unwrap(self, stamp):
+        # The device clock is a 32-bit microsecond counter. Frames carry the
+        # time they were received, so records may step back a little when
+        # one of our own problems is reported in between them.
+        if self.last_stamp is not None:
+            if self.last_stamp - stamp > TIMER_WRAP // 2:
+                self.wraps += 1
+            elif stamp - self.last_stamp > TIMER_WRAP // 2:
+                # From just before the last wrap
+                return stamp + (self.wraps - 1) * TIMER_WRAP
+        self.last_stamp = stamp
+        return stamp + self.wraps * TIMER_WRAP
+
+    def feed(self, data):
+        self.buffer += data
+        records = []
+        while True:
+            start = self.buffer.find(bytes([SNIFFER_SYNC]))
+            if start < 0:
+                self.buffer = bytearray()
+                break
+            del self.buffer[:start]
+            if len(self.buffer) < SNIFFER_HEADER_SIZE:
+                break
+            length = self.buffer[6]
+            size = SNIFFER_HEADER_SIZE + length + 1
+            if len(self.buffer) < size:
+                break
+            checksum = 0
+            for b in self.buffer[:size]:
+                checksum ^= b
+            if checksum != 0 or self.buffer[1] not in SNIFFER_TYPES:
+                # Not a record, most likely text from the CLI
+                del self.buffer[0]
+                continue
+            record_type = self.buffer[1]
+            stamp, = unpack_from('<I', self.buffer, 2)
+            frame = bytes(self.buffer[SNIFFER_HEADER_SIZE:size - 1])
+            records.append((self.unwrap(stamp), record_type, frame))
+            del self.buffer[:size]
+        return records
+
+class PcapWriter(object):
+    def __init__(self, filename):
+        self.file = open(filename, 'wb')
+        self.file.write(
+            pack('<IHHiIII', 0xA1B2C3D4, 2, 4, 0, 0, PCAP_SNAPLEN, PCAP_LINKTYPE_USER0)
+        )
+
+    def write(self, stamp, record_type, frame):
+        # The record type goes in front of the frame, so dissectors can tell
+        # our own frames and errors apart from what others sent
+        data = bytes([record_type]) + frame
+        self.file.write(
+            pack('<IIII', stamp // 1000000, stamp % 1000000, len(data), len(data))
+        )
+        self.file.write(data)
+        self.file.flush()
+
+    def close(self):
+        self.file.close()
+
+def print_record(stamp, record_type, frame):
+    addresses = ''
+    if len(frame) >= 3:
+        addresses = '%02X > %02X' % (frame[0], frame[2])
+    print(
+        '[%d.%06d] %-12s %-7s %s' % (
+            stamp // 1000000,
+            stamp % 1000000,
+            SNIFFER_TYPES[record_type],
+            addresses,
+            ' '.join('%02X' % b for b in frame)
+        )
+    )
+
+if __name__ == '__main__':
+    try:
+        parser = ArgumentParser(description='Decode the BlueBus IBus sniffer stream')
+        parser.add_argument(
+            '--port',
+            metavar='port',
+            type=str,
+            help='The port (COMx) or tty (/dev/ttyACMx or /dev/ttyUSBx) to read the stream from',
+        )
+        parser.add_argument(
+            '--file',
+            metavar='capture',
+            help='A raw capture saved earlier with --save',
+        )
+        parser.add_argument(
+            '--save',
+            metavar='capture',
+            help='Save the raw stream read from --port to this file',
+        )
+        parser.add_argument(
+            '--pcap',
+            metavar='pcapfile',
+            help='Also write the frames to this pcap file',
+        )
+        parser.add_argument(
+            '--start',
+            help='Switch the sniffer on before reading, and off on exit',
+            action='store_true',
+        )
+        args = parser.parse_args()
+        if not args.port and not args.file:
+            parser.error('Either --port or --file is required')
+        sniffer = SnifferParser()
+        pcap = PcapWriter(args.pcap) if args.pcap else None
+
+        def handle(data):
+            for stamp, record_type, frame in sniffer.feed(data):
+                print_record(stamp, record_type, frame)
+                if pcap:
+                    pcap.write(stamp, record_type, frame)
+
+        if args.file:
+            with open(args.file, 'rb') as f:
+                handle(f.read())
+        else:
+            serial = Serial(args.port, 115200, timeout=0.1)
+            save = open(args.save, 'wb') if args.save else None
+            if args.start:
+                serial.write(b'SET SNIFF ON\r')
+            try:
+                while True:
+                    data = serial.read(serial.in_waiting or 1)
+                    if save:
+                        save.write(data)
+                    handle(data)
+            finally:
+                if args.start:
+                    serial.write(b'SET SNIFF OFF\r')
+                if save:
+                    save.close()
+        if pcap:
+            pcap.close()
+    except KeyboardInterrupt:
+        sys.exit(0)